@@ -15,6 +15,7 @@ Item {
     property bool fileIsDir: model.isDir
     property int gridX: model.gridX
     property int gridY: model.gridY
+    property string thumbnail: model.thumbnail
 
     function getDragX() { return dragContainer.x; }
     function getDragY() { return dragContainer.y; }
@@ -35,13 +36,15 @@ Item {
         if (fileName.endsWith(".desktop")) {
             if (appEntry && appEntry.icon && appEntry.icon !== "") return appEntry.icon;
             return AppSearch.guessIcon(DesktopUtils.getAppId(fileName));
-        } else if (DesktopUtils.getFileType(fileName, fileIsDir) === "image") {
-            return "file://" + filePath;
+        } else if (thumbnail !== "") {
+            return thumbnail;
         } else {
             return DesktopUtils.getIconName(fileName, fileIsDir);
         }
     }
 
+    Component.onDestruction: desktopModel.releaseThumbnail(filePath)
+
     x: gridX * root.cellWidth
     y: gridY * root.cellHeight
 
@@ -7,67 +7,30 @@ Item {
     anchors.fill: parent
     z: 50
 
-    ListModel {
-        id: postItModel
-        Component.onCompleted: {
-            let notes = DesktopStateManager.getPostIts()
-            for (let i = 0; i < notes.length; i++) {
-                postItModel.append(notes[i])
-            }
-        }
-    }
-
-    function saveNotes() {
-        let arr = []
-        for(let i = 0; i < postItModel.count; i++) {
-            let item = postItModel.get(i)
-            arr.push({
-                posX: item.posX,
-                posY: item.posY,
-                text: item.text
-            })
-        }
-        DesktopStateManager.savePostIts(arr)
-    }
-
     function createNote(spawnX, spawnY) {
-        postItModel.append({
-            "posX": spawnX, 
-            "posY": spawnY, 
-            "text": ""
-        })
-        postItManager.saveNotes()
+        PostItStore.createNote(spawnX, spawnY)
     }
 
     Repeater {
-        model: postItModel
+        model: PostItStore
         delegate: PostItDelegate {
+            required property var noteId
             required property real posX
             required property real posY
+            required property real noteWidth
+            required property real noteHeight
             required property string text
-            required property int index
-            
-            property var manager: postItManager 
-            
+
             x: posX
             y: posY
+            width: noteWidth
+            height: noteHeight
             noteText: text
             
-            onDeleteRequested: {
-                postItModel.remove(index)
-                manager.saveNotes()
-            }
-            
-            onPositionUpdated: (newX, newY) => {
-                postItModel.setProperty(index, "posX", newX)
-                postItModel.setProperty(index, "posY", newY)
-                manager.saveNotes()
-            }
-            
-            onTextUpdated: (newText) => {
-                postItModel.setProperty(index, "text", newText)
-                manager.saveNotes()
-            }
+            onDeleteRequested: PostItStore.removeNote(noteId)
+            onPositionUpdated: (newX, newY) => PostItStore.moveNote(noteId, newX, newY)
+            onSizeUpdated: (newWidth, newHeight) => PostItStore.resizeNote(noteId, newWidth, newHeight)
+            onTextUpdated: (newText) => PostItStore.setNoteText(noteId, newText)
         }
     }
-}
\ No newline at end of file
+}
@@ -14,9 +14,11 @@ Rectangle {
     radius: 4
     
     property string noteText: ""
+    property real minimumSize: 120
     signal deleteRequested()
     signal textUpdated(string newText)
     signal positionUpdated(real newX, real newY)
+    signal sizeUpdated(real newWidth, real newHeight)
 
     DragHandler {
         target: postitRoot
@@ -76,4 +78,31 @@ Rectangle {
             editor.forceActiveFocus()
         }
     }
-}
\ No newline at end of file
+
+    // Bottom-right grip, the size is saved once the drag ends
+    MouseArea {
+        id: resizeGrip
+        anchors.right: parent.right
+        anchors.bottom: parent.bottom
+        width: 16
+        height: 16
+        z: 100
+        cursorShape: Qt.SizeFDiagCursor
+        preventStealing: true
+
+        // The grip moves with the corner, so track the pointer in note coordinates
+        property point pressOffset
+
+        onPressed: (mouse) => {
+            const point = mapToItem(postitRoot, mouse.x, mouse.y)
+            pressOffset = Qt.point(postitRoot.width - point.x, postitRoot.height - point.y)
+        }
+        onPositionChanged: (mouse) => {
+            if (!pressed) return
+            const point = mapToItem(postitRoot, mouse.x, mouse.y)
+            postitRoot.width = Math.max(postitRoot.minimumSize, point.x + pressOffset.x)
+            postitRoot.height = Math.max(postitRoot.minimumSize, point.y + pressOffset.y)
+        }
+        onReleased: postitRoot.sizeUpdated(postitRoot.width, postitRoot.height)
+    }
+}
@@ -488,7 +488,7 @@ Scope {
                                     spacing: 0
 
                                     Revealer {
-                                        reveal: Notifications.list.length > 0
+                                        reveal: Notifications.count > 0
                                         Layout.fillHeight: true
                                         Layout.rightMargin: reveal ? indicatorsRowLayout.realSpacing : 0
                                         Behavior on Layout.rightMargin {
@@ -9,7 +9,7 @@ import Quickshell.Io
 
 Item {
     id: root
-    property int count: Notifications.list.length
+    property int count: Notifications.count
     height: 20
     width: notifRow.width
     visible: count > 0
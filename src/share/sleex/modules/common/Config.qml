@@ -9,10 +9,14 @@ import SleexUiKit.Functions
 Singleton {
     id: root
     property alias options: configOptionsObj
-    property bool loaded: true
+    // False until DatabaseManager has opened the settings DB and the options got its values,
+    // or it failed to open and the options keep their defaults
+    property bool loaded: false
+    // The settings DB could not be opened, nothing is read or saved this session
+    readonly property bool failed: DatabaseManager.error !== ""
     property bool isReloading: false
-
-    property string triggerPath: Directories.config + "/sleex/.db_trigger"
+    // Set while this instance writes, its own changes are already applied
+    property bool isSaving: false
 
     function reloadFromDB() {
         root.isReloading = true;
@@ -22,28 +26,57 @@ Singleton {
         } else {
             console.log("[Config] Initializing config in DB with default values.");
             let plainObj = ObjectUtils.toPlainObject(root.options);
+            root.isSaving = true;
             DatabaseManager.saveAll(JSON.stringify(plainObj));
+            root.isSaving = false;
         }
         root.isReloading = false;
     }
 
-    Component.onCompleted: {
+    // Assigns one changed leaf, so only bindings on that key re-evaluate
+    function applyChangedValue(path, value) {
+        // Keys with dots or quotes come quoted, the C++ side splits them
+        let keys = path.indexOf('"') === -1 ? path.split(".") : DatabaseManager.pathKeys(path);
+        let obj = root.options;
+        for (let i = 0; i < keys.length - 1; ++i) {
+            obj = obj[keys[i]];
+            if (obj === undefined || obj === null || typeof obj !== "object") return;
+        }
+        let key = keys[keys.length - 1];
+        if (value === undefined || !(key in obj)) return;
+        obj[key] = value;
+    }
+
+    function load() {
         reloadFromDB();
         root.loaded = true;
     }
 
-    FileView {
-        path: root.triggerPath
-        watchChanges: true
-        onLoadFailed: error => {
-            if (error == FileViewError.FileNotFound) {
-                return;
-            }
+    function loadDefaults() {
+        console.warn("[Config] Settings DB unavailable, using default values:", DatabaseManager.error);
+        root.loaded = true;
+    }
+
+    Component.onCompleted: {
+        if (DatabaseManager.ready) load();
+        else if (root.failed) loadDefaults();
+    }
+
+    Connections {
+        target: DatabaseManager
+        function onReadyChanged() {
+            if (DatabaseManager.ready && !root.loaded) root.load();
+        }
+        function onErrorChanged() {
+            if (root.failed && !root.loaded) root.loadDefaults();
         }
-        onFileChanged: {
-            if (root.loaded) {
-                root.reloadFromDB();
+        function onSettingsChanged(paths, values) {
+            if (!root.loaded || root.isSaving) return;
+            root.isReloading = true;
+            for (let i = 0; i < paths.length; ++i) {
+                root.applyChangedValue(paths[i], values[paths[i]]);
             }
+            root.isReloading = false;
         }
     }
 
@@ -72,17 +105,22 @@ Singleton {
 
         let moduleName = keys[0];
         let jsonPath = keys.slice(1).join("."); // ex: "palette.accentColorHex"
+        root.isSaving = true;
         DatabaseManager.updateSettingField(moduleName, jsonPath, convertedValue);
+        root.isSaving = false;
     }
 
     JsonAdapter {
         id: configOptionsObj
 
         onAdapterUpdated: {
-            if (!root.loaded || root.isReloading) return;
+            // Without a DB every full save would only pile up in DatabaseManager's queue
+            if (!root.loaded || root.isReloading || root.failed) return;
 
             let plainObj = ObjectUtils.toPlainObject(configOptionsObj);
+            root.isSaving = true;
             DatabaseManager.saveAll(JSON.stringify(plainObj));
+            root.isSaving = false;
         }
         
         property JsonObject appearance: JsonObject {
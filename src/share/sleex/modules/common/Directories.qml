@@ -27,6 +27,7 @@ Singleton {
     property string generatedMaterialThemePath: FileUtils.trimFileProtocol(`${Directories.state}/sleex/user/generated/colors.json`)
     property string cliphistDecode: FileUtils.trimFileProtocol(`/tmp/sleex/media/cliphist`)
     property string wallpaperSwitchScriptPath: FileUtils.trimFileProtocol('/usr/share/sleex/scripts/colors/switchwall.sh')
+    property string terminalSchemePath: FileUtils.trimFileProtocol('/usr/share/sleex/scripts/terminal/scheme-base.json')
     property string wallpaperPath: FileUtils.trimFileProtocol(`/usr/share/backgrounds/sleex`)
 
 
@@ -9,6 +9,7 @@ import Quickshell.Widgets
 import Quickshell.Services.Notifications
 import SleexUiKit.Widgets
 import SleexUiKit.Appearance
+import Sleex.Services
 
 Rectangle { // App icon
     id: root
@@ -71,8 +72,9 @@ Rectangle { // App icon
                 anchors.fill: parent
                 readonly property int size: parent.width
 
-                source: root.image
+                source: ImageCache.url(root.image)
                 fillMode: Image.PreserveAspectCrop
+                // ImageCache keeps it, the pixmap cache would only hold a second copy
                 cache: false
                 antialiasing: true
                 asynchronous: true
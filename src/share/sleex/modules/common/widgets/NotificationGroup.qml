@@ -23,9 +23,19 @@ Item { // Notification group area
     id: root
     property var notificationGroup
     property var notifications: notificationGroup?.notifications ?? []
-    property int notificationCount: notifications.length
+    // Store rows carry the newest notifications only, count is all of them
+    property int notificationCount: notificationGroup?.count ?? notifications.length
     property bool multipleNotifications: notificationCount > 1
     property bool expanded: false
+    // Newest notifications an expanded store row shows, 0 for just what the row carries
+    property int historyLimit: 0
+    readonly property var shownNotifications: {
+        // Reading the row's notifications re-evaluates this when the group changes
+        const newest = root.notifications;
+        if (root.popup || root.historyLimit <= newest.length) return newest;
+        return Notifications.store.notifications(root.notificationGroup.appName, 0, root.historyLimit);
+    }
+    onExpandedChanged: if (!expanded) historyLimit = 0
     property bool popup: false
     property real padding: 10
     implicitHeight: background.implicitHeight
@@ -60,11 +70,17 @@ Item { // Notification group area
             easing.bezierCurve: Appearance.animation.elementMove.bezierCurve
         }
         onFinished: () => {
-            root.notifications.forEach((notif) => {
+            if (root.popup) {
+                const ids = root.notifications.map((notif) => notif.notificationId);
+                Qt.callLater(() => {
+                    Notifications.discardNotifications(ids);
+                });
+            } else {
+                const appName = root.notificationGroup.appName;
                 Qt.callLater(() => {
-                    Notifications.discardNotification(notif.notificationId);
+                    Notifications.discardApp(appName);
                 });
-            });
+            }
         }
     }
 
@@ -150,13 +166,13 @@ Item { // Notification group area
                 Layout.fillWidth: false
                 image: root?.multipleNotifications ? "" : notificationGroup?.notifications[0]?.image ?? ""
                 appIcon: notificationGroup?.appIcon
-                summary: notificationGroup?.notifications[root.notificationCount - 1]?.summary
+                summary: root.notifications[root.notifications.length - 1]?.summary
             }
 
             ColumnLayout { // Content
                 Layout.fillWidth: true
                 spacing: expanded ? (root.multipleNotifications ? 
-                    (notificationGroup?.notifications[root.notificationCount - 1].image != "") ? 35 : 
+                    (root.notifications[root.notifications.length - 1].image != "") ? 35 : 
                     5 : 0) : 0
                 // spacing: 00
                 Behavior on spacing {
@@ -223,7 +239,7 @@ Item { // Notification group area
                         animation: Appearance.animation.elementMoveFast.numberAnimation.createObject(this)
                     }
                     model: ScriptModel {
-                        values: root.expanded ? root.notifications.slice().reverse() : 
+                        values: root.expanded ? root.shownNotifications.slice().reverse() : 
                             root.notifications.slice().reverse().slice(0, 2)
                     }
                     delegate: NotificationItem {
@@ -239,6 +255,15 @@ Item { // Notification group area
                     }
                 }
 
+                NotificationActionButton { // Pages older notifications in from the store
+                    Layout.fillWidth: true
+                    visible: root.expanded && !root.popup && root.shownNotifications.length < root.notificationCount
+                    buttonText: qsTr("Show older (%1)").arg(root.notificationCount - root.shownNotifications.length)
+                    onClicked: {
+                        root.historyLimit = root.shownNotifications.length + Notifications.store.groupLimit;
+                    }
+                }
+
             }
         }
     }
@@ -16,17 +16,19 @@ StyledListView { // Scrollable window
 
     spacing: 3
 
-    model: ScriptModel {
-        values: root.popup ? Notifications.popupAppNameList : Notifications.appNameList
+    // The history is paged in from the store as the view scrolls
+    model: root.popup ? popupModel : Notifications.store
+    ScriptModel {
+        id: popupModel
+        values: Notifications.popupAppNameList
     }
     delegate: NotificationGroup {
         required property int index
-        required property var modelData
+        required property var model
         popup: root.popup
         anchors.left: parent?.left
         anchors.right: parent?.right
-        notificationGroup: popup ? 
-            Notifications.popupGroupsByAppName[modelData] :
-            Notifications.groupsByAppName[modelData]
+        // A store row has appName, appIcon, time and notifications like a group object
+        notificationGroup: popup ? Notifications.popupGroupsByAppName[model.modelData] : model
     }
 }
\ No newline at end of file
@@ -120,6 +120,9 @@ Item {
         if (!event)
             return false;
 
+        if (event.allDay !== undefined)
+            return event.allDay;
+
         let start = event.start || "";
         let end = event.end || "";
 
@@ -135,13 +138,6 @@ Item {
         return events.filter(function(evt) { return root.isAllDayEvent(evt); });
     }
 
-    function getTimedEvents(events) {
-        if (!events || !events.length)
-            return [];
-
-        return events.filter(function(evt) { return !root.isAllDayEvent(evt); });
-    }
-
     function formatEventTooltip(event) {
         if (!event)
             return "";
@@ -183,21 +179,7 @@ Item {
     }
 
     function earliestEventStartMinutes() {
-        if (!root.days || root.days.length === 0)
-            return -1;
-
-        var earliest = -1;
-        for (var i = 0; i < root.days.length; i++) {
-            var timed = root.getTimedEvents(root.days[i]?.events);
-            for (var j = 0; j < timed.length; j++) {
-                var start = root.parseTimeToMinutes(timed[j].start);
-                if (start === null)
-                    continue;
-                if (earliest === -1 || start < earliest)
-                    earliest = start;
-            }
-        }
-        return earliest;
+        return CalendarService.eventModel.earliestStartMinute;
     }
 
     function scrollToFirstEvent() {
@@ -240,6 +222,19 @@ Item {
         root.initialScrollApplied = true;
     }
 
+    // Slot and span roles of the event model are measured on this timeline
+    Binding {
+        target: CalendarService.eventModel
+        property: "timelineStart"
+        value: root.startHour * 60 + root.startMinute
+    }
+
+    Binding {
+        target: CalendarService.eventModel
+        property: "slotDuration"
+        value: root.slotDuration
+    }
+
     Connections {
         target: DateTime.clock
         function onDateChanged() {
@@ -517,165 +512,165 @@ Item {
                     }
                 }
 
-                Row {
+                Item {
                     id: eventsRow
+                    width: dayColumns.width
                     height: root.contentHeight
-                    spacing: root.spacing
+                    clip: true
+
+                    Row {
+                        id: dayColumns
+                        height: parent.height
+                        spacing: root.spacing
+
+                        Repeater {
+                            model: root.days
+                            delegate: Item {
+                                width: root.dayColumnWidth
+                                height: parent.height
+                                clip: true
+                                // highlight if this column's date equals today's date (respects week offset)
+                                property bool isToday: (function() {
+                                    const col = root.dateForColumn(index);
+                                    const now = new Date(DateTime.clock.date);
+                                    return col.getFullYear() === now.getFullYear()
+                                        && col.getMonth() === now.getMonth()
+                                        && col.getDate() === now.getDate();
+                                })()
 
+                                Rectangle {
+                                    anchors.fill: parent
+                                    radius: Appearance.rounding.large
+                                    color: isToday ? root.todayHighlightFill : Qt.rgba(0, 0, 0, 0)
+                                    border.width: isToday ? 1 : 0
+                                    border.color: isToday ? root.todayHighlightBorder : Qt.rgba(0, 0, 0, 0)
+                                    z: -1
+                                }
+                            }
+                        }
+                    }
+
+                    // One delegate per event segment, the model has already
+                    // split multi-day events and assigned overlap columns
                     Repeater {
-                        model: root.days
-                        delegate: Item {
-                            width: root.dayColumnWidth
-                            height: parent.height
+                        model: CalendarService.eventModel
+                        delegate: Rectangle {
+                            required property var model
+                            readonly property var eventData: model.eventData
+                            readonly property color eventColor: ColorUtils.stringToColor(model.title)
+                            readonly property real laneWidth: (root.dayColumnWidth - 10) / Math.max(1, model.columnCount)
+
+                            visible: !model.allDay
+                            x: model.day * (root.dayColumnWidth + root.spacing) + 5 + model.column * laneWidth
+                            width: laneWidth - (model.column < model.columnCount - 1 ? 2 : 0)
+                            radius: Appearance.rounding.large
                             clip: true
-                            // highlight if this column's date equals today's date (respects week offset)
-                            property bool isToday: (function() {
-                                const col = root.dateForColumn(index);
-                                const now = new Date(DateTime.clock.date);
-                                return col.getFullYear() === now.getFullYear()
-                                    && col.getMonth() === now.getMonth()
-                                    && col.getDate() === now.getDate();
-                            })()
-                            property var timedEvents: root.getTimedEvents(modelData.events)
+                            y: model.slot * root.slotHeight
+                            height: Math.max(model.span * root.slotHeight - 4, 48) // Minimum height for touch targets
 
-                            Rectangle {
-                                anchors.fill: parent
-                                radius: Appearance.rounding.large
-                                color: isToday ? root.todayHighlightFill : Qt.rgba(0, 0, 0, 0)
-                                border.width: isToday ? 1 : 0
-                                border.color: isToday ? root.todayHighlightBorder : Qt.rgba(0, 0, 0, 0)
-                                z: -1
+                            color: eventColor
+
+                            HoverHandler {
+                                id: eventHover
                             }
+                            Row {
+                                anchors.bottom: parent.bottom
+                                anchors.right: parent.right
+                                anchors.margins: 4
+                                spacing: 4
 
-                            Repeater {
-                                model: timedEvents
-                                Rectangle {
-                                    width: parent.width - 10
-                                    anchors.horizontalCenter: parent.horizontalCenter
-                                    radius: Appearance.rounding.large
-                                    clip: true
-                                    y: {
-                                        let startHr = parseInt(modelData.start.split(":")[0]);
-                                        let startMin = parseInt(modelData.start.split(":")[1]);
-                                        let baseTotalMinutes = root.startHour * 60 + root.startMinute;
-                                        let eventTotalMinutes = startHr * 60 + startMin;
-                                        let diffMinutes = eventTotalMinutes - baseTotalMinutes;
-                                        return diffMinutes * root.pixelsPerMinute;
-                                    }
-                                    height: {
-                                        let startHr = parseInt(modelData.start.split(":")[0]);
-                                        let endHr = parseInt(modelData.end.split(":")[0]);
-                                        let startMin = parseInt(modelData.start.split(":")[1]);
-                                        let endMin = parseInt(modelData.end.split(":")[1]);
-                                        let totalMins = (endHr * 60 + endMin) - (startHr * 60 + startMin);
-                                        return Math.max(totalMins * root.pixelsPerMinute - 4, 48); // Minimum height for touch targets
-                                    }
+                                RippleButton {
+                                    width: 28
+                                    height: 28
+                                    buttonRadius: Appearance.rounding.large
+                                    opacity: eventHover.hovered ? 1 : 0
+                                    visible: opacity > 0
 
-                                    color: modelData.color || Appearance.colors.colTertiaryContainer
+                                    colBackgroundHover: Appearance.colors.colSurfaceContainerHigh
 
-                                    HoverHandler {
-                                        id: eventHover
-                                    }
-                                    Row {
-                                        anchors.bottom: parent.bottom
-                                        anchors.right: parent.right
-                                        anchors.margins: 4
-                                        spacing: 4
-
-                                        RippleButton {
-                                            width: 28
-                                            height: 28
-                                            buttonRadius: Appearance.rounding.large
-                                            opacity: eventHover.hovered ? 1 : 0
-                                            visible: opacity > 0
-
-                                            colBackgroundHover: Appearance.colors.colSurfaceContainerHigh
-
-                                            Behavior on opacity { NumberAnimation { duration: 120 } }
-
-                                            contentItem: MaterialSymbol {
-                                                anchors.fill: parent
-                                                horizontalAlignment: Text.AlignHCenter
-                                                font.pixelSize: Appearance.font.pixelSize.title
-                                                text: "edit"
-                                            }
-
-                                            onClicked: {
-                                                root.tempCalendarEvent = modelData;
-                                                root.editMode = true;
-                                            }
-                                        }
-
-                                        RippleButton {
-                                            width: 28
-                                            height: 28
-                                            buttonRadius: Appearance.rounding.large
-                                            opacity: eventHover.hovered ? 1 : 0
-                                            visible: opacity > 0
-
-                                            colBackgroundHover: Appearance.colors.colSurfaceContainerHigh
-
-                                            Behavior on opacity { NumberAnimation { duration: 120 } }
-
-                                            contentItem: MaterialSymbol {
-                                                anchors.fill: parent
-                                                horizontalAlignment: Text.AlignHCenter
-                                                font.pixelSize: Appearance.font.pixelSize.title
-                                                text: "cancel"
-                                            }
-
-                                            onClicked: CalendarService.removeItem(modelData)
-                                        }
+                                    Behavior on opacity { NumberAnimation { duration: 120 } }
+
+                                    contentItem: MaterialSymbol {
+                                        anchors.fill: parent
+                                        horizontalAlignment: Text.AlignHCenter
+                                        font.pixelSize: Appearance.font.pixelSize.title
+                                        text: "edit"
                                     }
 
-                                    ToolTip {
-                                        visible: eventHover.hovered
-                                        delay: 200
-                                        timeout: 0
-                                        text: root.formatEventTooltip(modelData)
+                                    onClicked: {
+                                        root.tempCalendarEvent = eventData;
+                                        root.editMode = true;
                                     }
+                                }
+
+                                RippleButton {
+                                    width: 28
+                                    height: 28
+                                    buttonRadius: Appearance.rounding.large
+                                    opacity: eventHover.hovered ? 1 : 0
+                                    visible: opacity > 0
 
-                                    Column {
+                                    colBackgroundHover: Appearance.colors.colSurfaceContainerHigh
+
+                                    Behavior on opacity { NumberAnimation { duration: 120 } }
+
+                                    contentItem: MaterialSymbol {
                                         anchors.fill: parent
-                                        anchors.margins: 12
-                                        spacing: 4
-
-                                        Text {
-                                            text: {
-                                                let startHr = parseInt(modelData.start.split(":")[0]);
-                                                let startMin = parseInt(modelData.start.split(":")[1]);
-                                                let endHr = parseInt(modelData.end.split(":")[0]);
-                                                let endMin = parseInt(modelData.end.split(":")[1]);
-
-                                                let formatTime = (hour, minute) => {
-                                                    let testDate = new Date();
-                                                    testDate.setHours(hour, minute, 0);
-                                                    return Qt.formatTime(testDate, Config.options?.time.format ?? "hh:mm");
-                                                };
-
-                                                return formatTime(startHr, startMin) + " - " + formatTime(endHr, endMin);
-                                            }
-                                            font.weight: Font.Medium
-                                            color: ColorUtils.getContrastingTextColor(modelData.color)
-                                            width: parent.width
-                                            wrapMode: Text.NoWrap
-                                            elide: Text.ElideRight
-                                            lineHeight: 1.2
-                                        }
-
-                                        Text {
-                                            id: eventTitle
-                                            text: modelData.title
-                                            font.weight: Font.Medium
-                                            wrapMode: Text.WordWrap
-                                            elide: Text.ElideRight
-                                            maximumLineCount: 2
-                                            width: parent.width
-                                            color: ColorUtils.getContrastingTextColor(modelData.color)
-                                            lineHeight: 1.1
-                                            visible: !truncated
-                                        }
+                                        horizontalAlignment: Text.AlignHCenter
+                                        font.pixelSize: Appearance.font.pixelSize.title
+                                        text: "cancel"
+                                    }
+
+                                    onClicked: CalendarService.removeItem(eventData)
+                                }
+                            }
+
+                            ToolTip {
+                                visible: eventHover.hovered
+                                delay: 200
+                                timeout: 0
+                                text: root.formatEventTooltip(eventData)
+                            }
+
+                            Column {
+                                anchors.fill: parent
+                                anchors.margins: 12
+                                spacing: 4
+
+                                Text {
+                                    text: {
+                                        let startHr = parseInt(eventData.start.split(":")[0]);
+                                        let startMin = parseInt(eventData.start.split(":")[1]);
+                                        let endHr = parseInt(eventData.end.split(":")[0]);
+                                        let endMin = parseInt(eventData.end.split(":")[1]);
+
+                                        let formatTime = (hour, minute) => {
+                                            let testDate = new Date();
+                                            testDate.setHours(hour, minute, 0);
+                                            return Qt.formatTime(testDate, Config.options?.time.format ?? "hh:mm");
+                                        };
+
+                                        return formatTime(startHr, startMin) + " - " + formatTime(endHr, endMin);
                                     }
+                                    font.weight: Font.Medium
+                                    color: ColorUtils.getContrastingTextColor(eventColor)
+                                    width: parent.width
+                                    wrapMode: Text.NoWrap
+                                    elide: Text.ElideRight
+                                    lineHeight: 1.2
+                                }
+
+                                Text {
+                                    id: eventTitle
+                                    text: eventData.title
+                                    font.weight: Font.Medium
+                                    wrapMode: Text.WordWrap
+                                    elide: Text.ElideRight
+                                    maximumLineCount: 2
+                                    width: parent.width
+                                    color: ColorUtils.getContrastingTextColor(eventColor)
+                                    lineHeight: 1.1
+                                    visible: !truncated
                                 }
                             }
                         }
@@ -10,13 +10,11 @@ Item {
     width: calendar.implicitWidth
     height: calendar.implicitHeight
 
-    property var contribs: Github.contributions !== undefined ? Github.contributions : []
-
     ContributionCalendar {
         id: calendar
         anchors.centerIn: parent
 
-        contributions: root.contribs
+        source: Github.contributions
 
         cellSize: 7
         gap: 2
@@ -46,7 +46,7 @@ Item {
             anchors.fill: listview
 
             visible: opacity > 0
-            opacity: (Notifications.list.length === 0) ? 1 : 0
+            opacity: (Notifications.count === 0) ? 1 : 0
 
             Behavior on opacity {
                 NumberAnimation {
@@ -94,9 +94,9 @@ Item {
                 anchors.verticalCenter: parent.verticalCenter
                 anchors.leftMargin: 10
                 horizontalAlignment: Text.AlignHCenter
-                text: `${Notifications.list.length} notifications`
+                text: `${Notifications.count} notifications`
 
-                opacity: Notifications.list.length > 0 ? 1 : 0
+                opacity: Notifications.count > 0 ? 1 : 0
                 visible: opacity > 0
                 Behavior on opacity {
                     animation: Appearance.animation.elementMove.numberAnimation.createObject(this)
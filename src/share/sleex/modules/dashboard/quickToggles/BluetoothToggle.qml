@@ -6,7 +6,6 @@ import SleexUiKit.Widgets
 import SleexUiKit.Functions
 import QtQuick
 import Quickshell
-import Quickshell.Io
 import Quickshell.Bluetooth
 import Quickshell.Hyprland
 
@@ -22,15 +21,6 @@ QuickToggleButton {
         Quickshell.execDetached(["bash", "-c", `${Config.options.apps.bluetooth}`])
         GlobalStates.dashboardOpen = false
     }
-    Process {
-        id: toggleBluetooth
-        command: ["bash", "-c", `bluetoothctl power ${Bluetooth.defaultAdapter.enabled ? "off" : "on"}`]
-        onRunningChanged: {
-            if(!running) {
-                BluetoothService.update()
-            }
-        }
-    }
     StyledToolTip {
         text: StringUtils.format(qsTr("{0} | Right-click to configure"),
             (Bluetooth.defaultAdapter.enabled && BluetoothService.bluetoothDeviceName.length > 0) ?
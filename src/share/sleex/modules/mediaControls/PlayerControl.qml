@@ -14,6 +14,7 @@ import Quickshell.Services.Mpris
 import Quickshell.Widgets
 import Quickshell.Wayland
 import Quickshell.Hyprland
+import Sleex.Services
 
 Item {
     id: playerController
@@ -425,8 +426,8 @@ Item {
             Image {
                 id: blurredArt1
                 anchors.fill: parent
-                source: playerController.artSourceA
-                cache: true; asynchronous: true
+                source: ImageCache.url(playerController.artSourceA)
+                cache: false; asynchronous: true
                 fillMode: Image.PreserveAspectCrop
                 sourceSize.width: 512; sourceSize.height: 512
                 antialiasing: true
@@ -442,8 +443,8 @@ Item {
             Image {
                 id: blurredArt2
                 anchors.fill: parent
-                source: playerController.artSourceB
-                cache: true; asynchronous: true
+                source: ImageCache.url(playerController.artSourceB)
+                cache: false; asynchronous: true
                 fillMode: Image.PreserveAspectCrop
                 sourceSize.width: 512; sourceSize.height: 512
                 antialiasing: true
@@ -502,8 +503,8 @@ Item {
                     sourceSize.width: 512; sourceSize.height: 512
                     fillMode: Image.PreserveAspectCrop
                     smooth: false; mipmap: true; antialiasing: true
-                    asynchronous: true; cache: true
-                    source: playerController.artSourceA
+                    asynchronous: true; cache: false
+                    source: ImageCache.url(playerController.artSourceA)
                     opacity: 1.0
                     Behavior on opacity { NumberAnimation { duration: 500; easing.type: Easing.InOutCubic } }
                 }
@@ -515,8 +516,8 @@ Item {
                     sourceSize.width: 512; sourceSize.height: 512
                     fillMode: Image.PreserveAspectCrop
                     smooth: false; mipmap: true; antialiasing: true
-                    asynchronous: true; cache: true
-                    source: playerController.artSourceB
+                    asynchronous: true; cache: false
+                    source: ImageCache.url(playerController.artSourceB)
                     opacity: 0.0
                     Behavior on opacity { NumberAnimation { duration: 500; easing.type: Easing.InOutCubic } }
                 }
@@ -93,6 +93,8 @@ RippleButton {
 
     onClicked: {
         GlobalStates.overviewOpen = false
+        if (root.itemType === "App")
+            AppSearch.recordLaunch(root.entry)
         root.itemExecute()
     }
     Keys.onPressed: (event) => {
@@ -195,8 +197,7 @@ RippleButton {
                 }
             }
 
-            // Lazily decoded clipboard image preview; CliphistImage manages its own
-            // temp file lifecycle via Component.onCompleted / Component.onDestruction.
+            // Clipboard image preview, decoded from the cliphist database at display size
             Loader {
                 id: imagePreviewLoader
                 active: root.cliphistRawString && Cliphist.entryIsImage(root.cliphistRawString)
@@ -205,10 +206,13 @@ RippleButton {
                 Layout.preferredHeight: (active && item) ? item.height : 0
                 Layout.maximumHeight: 250
                 sourceComponent: Component {
-                    CliphistImage {
-                        entry: root.cliphistRawString
-                        maxWidth: contentColumn.width
-                        maxHeight: 250
+                    Image {
+                        source: Cliphist.imageSource(root.cliphistRawString)
+                        asynchronous: true
+                        fillMode: Image.PreserveAspectFit
+                        horizontalAlignment: Image.AlignLeft
+                        sourceSize.width: contentColumn.width
+                        sourceSize.height: 250
                     }
                 }
             }
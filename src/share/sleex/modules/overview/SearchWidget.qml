@@ -24,6 +24,16 @@ Item { // Wrapper
     property bool clipboardWorkSafetyActive: false
     property int clipboardRefreshCounter: 0
 
+    // Only typing behind the emoji prefix queries the emoji index
+    Binding {
+        target: Emojis
+        property: "query"
+        when: root.searchingText.startsWith(Config.options.search.prefix.emojis)
+        value: StringUtils.cleanPrefix(root.searchingText, Config.options.search.prefix.emojis)
+        // Leaving emoji mode keeps the last query instead of ranking everything again
+        restoreMode: Binding.RestoreNone
+    }
+
     property var searchActions: [
         {
             action: "accentcolor",
@@ -409,9 +419,9 @@ Item { // Wrapper
                             }).filter(Boolean);
                         }
                         else if (root.searchingText.startsWith(Config.options.search.prefix.emojis)) {
-                            // Clipboard
-                            const searchString = StringUtils.cleanPrefix(root.searchingText, Config.options.search.prefix.emojis);
-                            return Emojis.fuzzyQuery(searchString).map(entry => {
+                            // Emojis. The query follows the search text through the Binding above,
+                            // the results arrive from the index's worker
+                            return Emojis.results.map(entry => {
                                 const emoji = entry.match(/^\s*(\S+)/)?.[1] || ""
                                 return {
                                     key: emoji,
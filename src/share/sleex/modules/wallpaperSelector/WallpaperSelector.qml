@@ -108,19 +108,24 @@ Scope {
                             anchors.verticalCenter: parent.verticalCenter
 
                             Repeater {
-                                model: Wallpapers.wallpaperList
+                                model: Wallpapers.library
                                 delegate: Item {
+                                    id: wallpaperItem
+                                    required property string path
+                                    required property string thumbnail
+                                    required property color dominantColor
                                     width: 250
                                     height: wppselectorRoot.implicitHeight - wppselectorPadding
 
                                     Rectangle {
                                         anchors.fill: parent
                                         radius: Appearance.rounding.small
-                                        color: Appearance.colors.colLayer2
+                                        // Stands in for the picture until its thumbnail is ready
+                                        color: wallpaperItem.dominantColor.valid ? wallpaperItem.dominantColor : Appearance.colors.colLayer2
 
                                         StyledBusyIndicator {
                                             anchors.centerIn: parent
-                                            visible: wallpaperImage.status === Image.Loading
+                                            visible: wallpaperItem.thumbnail.length === 0 || wallpaperImage.status === Image.Loading
                                             running: true
                                             width: 45
                                             height: 45
@@ -130,7 +135,7 @@ Scope {
                                             id: wallpaperImage
                                             anchors.fill: parent
                                             fillMode: Image.PreserveAspectCrop
-                                            source: Config.options.background.wallpaperSelectorPath + "/" + modelData
+                                            source: wallpaperItem.thumbnail
                                             asynchronous: true
                                             cache: true
                                             sourceSize: Qt.size(250, 250)
@@ -139,7 +144,7 @@ Scope {
                                                 anchors.fill: parent
                                                 onClicked: {
                                                     GlobalStates.wppselectorOpen = false
-                                                    Quickshell.execDetached(["bash", Quickshell.shellPath("scripts/colors/switchwall.sh"), Config.options.background.wallpaperSelectorPath + "/" + modelData, "&"])
+                                                    Quickshell.execDetached(["bash", Quickshell.shellPath("scripts/colors/switchwall.sh"), wallpaperItem.path, "&"])
                                                 }
                                             }
                                         }
@@ -1,131 +1,398 @@
 #include "init.hpp"
+#include "settingsWriter.hpp"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
-#include <QFile>
 #include <QDir>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QStandardPaths>
 #include <QDebug>
+#include <QSet>
+#include <utility>
 
 namespace SleexCore {
 
+namespace {
+// QJsonObject is a value type, so nested writes rebuild the path on the way out
+QJsonObject setPath(QJsonObject obj, const QStringList &keys, int depth, const QJsonValue &value) {
+    const QString &key = keys.at(depth);
+    if (depth == keys.size() - 1) {
+        obj.insert(key, value);
+    } else {
+        obj.insert(key, setPath(obj.value(key).toObject(), keys, depth + 1, value));
+    }
+    return obj;
+}
+
+// Scalars, arrays and empty objects are stored as one row each
+bool isLeaf(const QJsonValue &value) {
+    if (value.isUndefined()) return false;
+    return !value.isObject() || value.toObject().isEmpty();
+}
+
+// Collects the leaf paths that differ between two JSON values
+void diffValues(const QString &path, const QJsonValue &oldValue, const QJsonValue &newValue, SettingChanges &out) {
+    if (oldValue == newValue) return;
+
+    if (oldValue.isObject() || newValue.isObject()) {
+        const QJsonObject oldObj = oldValue.toObject();
+        const QJsonObject newObj = newValue.toObject();
+        QSet<QString> keys;
+        for (auto it = oldObj.begin(); it != oldObj.end(); ++it) keys.insert(it.key());
+        for (auto it = newObj.begin(); it != newObj.end(); ++it) keys.insert(it.key());
+
+        for (const QString &key : keys) {
+            diffValues(appendPathKey(path, key), oldObj.value(key), newObj.value(key), out);
+        }
+        // A leaf replaced by an inner node (or the reverse) changes the node's own row too
+        if (isLeaf(oldValue) || isLeaf(newValue)) out.insert(path, newValue);
+        return;
+    }
+
+    out.insert(path, newValue);
+}
+
+// Polling a pragma is a read of the shared WAL index, no disk I/O
+constexpr int DATA_VERSION_POLL_MS = 500;
+}
+
+SettingsSubscription::SettingsSubscription(const QString &pattern, QObject *parent)
+    : QObject(parent), m_pattern(pattern) {
+    if (pattern == "*" || pattern.isEmpty()) {
+        m_matchAll = true;
+    } else if (pattern.endsWith(".*")) {
+        m_prefix = pattern.chopped(2);
+    } else {
+        m_prefix = pattern;
+    }
+}
+
+bool SettingsSubscription::matches(const QString &path) const {
+    if (m_matchAll) return true;
+    return path == m_prefix
+        || (path.startsWith(m_prefix) && path.at(m_prefix.size()) == '.');
+}
+
 DatabaseManager::DatabaseManager(QObject *parent) : QObject(parent) {
-    QString configDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex";
-    QString stateDir = QDir::homePath() + "/.local/state/sleex"; 
-    
-    QDir().mkpath(configDir);
-    QDir().mkpath(stateDir);
+    m_startupTimer.start();
 
+    // Everything touching the disk happens in SettingsWriter::open() on the
+    // writer thread, the first frame doesn't wait for SQLite
+    m_dbPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex/sleex_settings.db";
     QString jsonPath = QDir::homePath() + "/.sleex/settings.json";
-    QString settingsDbPath = configDir + "/sleex_settings.db";
-    QString stateDbPath = stateDir + "/sleex_state.db";
 
-    // Settings DB
-    QSqlDatabase settingsDb = QSqlDatabase::addDatabase("QSQLITE", "settings_conn");
-    settingsDb.setDatabaseName(settingsDbPath);
+    m_writer = new SettingsWriter(m_dbPath, jsonPath);
+    m_writer->moveToThread(&m_writerThread);
+    connect(&m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    connect(m_writer, &SettingsWriter::opened, this, &DatabaseManager::onDatabaseOpened);
+    connect(m_writer, &SettingsWriter::batchWritten, this, [this](quint64 seq, qint64 commit, int leaves, double latencyMs) {
+        m_committedSeq = seq;
+        if (commit > m_commitCount) m_ownCommits.insert(commit);
+        m_lastWriteLatencyMs = latencyMs;
+        emit writeCompleted(leaves, latencyMs);
+    });
+    connect(m_writer, &SettingsWriter::writeFailed, this, &DatabaseManager::writeFailed);
+    m_writerThread.setObjectName("sleex-settings-writer");
+    m_writerThread.start();
+    QMetaObject::invokeMethod(m_writer, &SettingsWriter::open, Qt::QueuedConnection);
+
+    m_pollTimer.setInterval(DATA_VERSION_POLL_MS);
+    connect(&m_pollTimer, &QTimer::timeout, this, &DatabaseManager::pollDataVersion);
+
+    m_startupTimings.insert("construct", m_startupTimer.nsecsElapsed() / 1e6);
+}
+
+void DatabaseManager::onDatabaseOpened(const QVariantMap &rows, const QVariantMap &timings, const QString &error) {
+    QElapsedTimer phase;
+    phase.start();
+    m_startupTimings.insert(timings);
+    if (!error.isEmpty()) {
+        // The writer has nowhere to put anything, so nothing is handed to it
+        m_error = error;
+        emit errorChanged();
+        return;
+    }
 
+    // Read-only use from here on, the schema is already in place
+    QSqlDatabase settingsDb = QSqlDatabase::addDatabase("QSQLITE", "settings_conn");
+    settingsDb.setDatabaseName(m_dbPath);
     if (settingsDb.open()) {
-        QSqlQuery query(settingsDb);
-        query.exec("CREATE TABLE IF NOT EXISTS sleex_settings (module TEXT PRIMARY KEY, config_json TEXT)");
-
-        // execute only if past version with JSON exists, otherwise we might mess with existing SQLite data
-        if (QFile::exists(jsonPath)) {
-            qInfo() << "[Sleex Core] Migration...";
-            
-            QFile file(jsonPath);
-            if (file.open(QIODevice::ReadOnly)) {
-                QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
-                file.close();
-
-                settingsDb.transaction();
-                query.prepare("INSERT OR REPLACE INTO sleex_settings (module, config_json) VALUES (:module, :config)");
-
-                for (auto it = root.begin(); it != root.end(); ++it) {
-                    query.bindValue(":module", it.key());
-                    query.bindValue(":config", QString(QJsonDocument(it.value().toObject()).toJson(QJsonDocument::Compact)));
-                    query.exec();
-                }
-                settingsDb.commit();
-
-                // Archiving the old JSON just in case, but it won't be used anymore
-                QFile::rename(jsonPath, jsonPath + ".bak");
-                qInfo() << "[Sleex Core] Migration completed. The JSON file is in the closet.";
-            }
-        }
+        QSqlQuery versionQuery(settingsDb);
+        if (versionQuery.exec("PRAGMA data_version") && versionQuery.next())
+            m_dataVersion = versionQuery.value(0).toLongLong();
+        if (versionQuery.exec("SELECT count FROM sleex_settings_commits") && versionQuery.next())
+            m_commitCount = versionQuery.value(0).toLongLong();
     } else {
         qCritical() << "[Sleex Core] settings DB error:" << settingsDb.lastError().text();
     }
+    m_startupTimings.insert("readerOpen", phase.nsecsElapsed() / 1e6);
+    phase.restart();
 
-    // States DB
-    QSqlDatabase stateDb = QSqlDatabase::addDatabase("QSQLITE", "state_conn");
-    stateDb.setDatabaseName(stateDbPath);
-    
-    if (stateDb.open()) {
-        QSqlQuery stateQuery(stateDb);
-        // Enable Machine Gun mode for faster writes
-        stateQuery.exec("PRAGMA journal_mode=WAL;");
-        stateQuery.exec("PRAGMA synchronous=NORMAL;");
-        
-        stateQuery.exec("CREATE TABLE IF NOT EXISTS sleex_states (key TEXT PRIMARY KEY, value TEXT)");
-    } else {
-        qCritical() << "[Sleex Core] state DB error:" << stateDb.lastError().text();
+    applyRows(rows);
+    m_startupTimings.insert("apply", phase.nsecsElapsed() / 1e6);
+
+    m_ready = true;
+    const auto requests = std::exchange(m_queuedRequests, {});
+    for (const auto &request : requests) request();
+
+    m_startupTimings.insert("total", m_startupTimer.nsecsElapsed() / 1e6);
+    qInfo() << "[Sleex Core] Settings ready in" << m_startupTimings.value("total").toDouble() << "ms" << m_startupTimings;
+
+    m_pollTimer.start();
+    emit readyChanged();
+}
+
+DatabaseManager::~DatabaseManager() {
+    if (m_writer) {
+        // Pending batches must hit the disk before the process goes away
+        QMetaObject::invokeMethod(m_writer, &SettingsWriter::close, Qt::BlockingQueuedConnection);
+    }
+    m_writerThread.quit();
+    m_writerThread.wait();
+}
+
+void DatabaseManager::queueLeafWrites(const QString &module, const SettingChanges &changes) {
+    const QString prefix = module + '.';
+    QList<QPair<QString, QJsonValue>> leaves;
+    for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) leaves.append({ it.key().mid(prefix.size()), it.value() });
+    }
+    if (leaves.isEmpty()) return;
+
+    const quint64 seq = ++m_writeSeq;
+    m_moduleWriteSeq.insert(module, seq);
+    QMetaObject::invokeMethod(m_writer, [writer = m_writer, seq, module, leaves]() {
+        for (const auto &leaf : leaves) writer->enqueueLeaf(seq, module, leaf.first, leaf.second);
+    }, Qt::QueuedConnection);
+}
+
+bool DatabaseManager::hasPendingWrite(const QString &module) const {
+    return m_moduleWriteSeq.value(module) > m_committedSeq;
+}
+
+void DatabaseManager::pollDataVersion() {
+    QSqlQuery query(QSqlDatabase::database("settings_conn"));
+    if (!query.exec("PRAGMA data_version") || !query.next()) return;
+
+    const qint64 dataVersion = query.value(0).toLongLong();
+    if (dataVersion == m_dataVersion) return;
+    m_dataVersion = dataVersion;
+
+    // Every batch bumps the counter once, so when each number since the last
+    // poll is one of ours the cache already holds what was committed. An
+    // unchanged counter means a writer that doesn't count, reload to be safe
+    bool foreign = true;
+    if (query.exec("SELECT count FROM sleex_settings_commits") && query.next()) {
+        const qint64 count = query.value(0).toLongLong();
+        foreign = count == m_commitCount;
+        for (qint64 commit = m_commitCount + 1; commit <= count; ++commit) {
+            if (!m_ownCommits.remove(commit)) foreign = true;
+        }
+        m_commitCount = qMax(m_commitCount, count);
+    }
+    if (foreign) reload();
+}
+
+SettingsSubscription *DatabaseManager::subscribe(const QString &pattern) {
+    auto *subscription = new SettingsSubscription(pattern, this);
+    m_subscriptions.append(subscription);
+    return subscription;
+}
+
+void DatabaseManager::unsubscribe(SettingsSubscription *subscription) {
+    m_subscriptions.removeAll(subscription);
+    if (subscription) subscription->deleteLater();
+}
+
+void DatabaseManager::notifyChanges(const SettingChanges &changes) {
+    if (changes.isEmpty()) return;
+
+    QVariantMap all;
+    for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        all.insert(it.key(), it.value().toVariant());
+    }
+    emit settingsChanged(all.keys(), all);
+
+    m_subscriptions.removeAll(nullptr);
+    for (const auto &subscription : std::as_const(m_subscriptions)) {
+        QStringList paths;
+        QVariantMap values;
+        for (auto it = all.constBegin(); it != all.constEnd(); ++it) {
+            if (!subscription->matches(it.key())) continue;
+            paths.append(it.key());
+            values.insert(it.key(), it.value());
+        }
+        if (!paths.isEmpty()) emit subscription->changed(paths, values);
     }
 }
 
 void DatabaseManager::updateSettingField(const QString &module, const QString &path, const QVariant &value) {
-    QSqlDatabase db = QSqlDatabase::database("settings_conn");
-    QSqlQuery query(db);
-    
-    QString fullPath = "$." + path; 
-    query.prepare("UPDATE sleex_settings SET config_json = json_set(config_json, :path, :val) WHERE module = :module");
-    query.bindValue(":path", fullPath);
-    query.bindValue(":val", value);
-    query.bindValue(":module", module);
-    
-    if (!query.exec()) {
-        qWarning() << "[Sleex Core] Error while setting a setting:" << query.lastError().text();
+    if (!m_ready) {
+        m_queuedRequests.append([this, module, path, value]() { updateSettingField(module, path, value); });
+        return;
     }
+
+    // The cache is updated synchronously, only the changed leaf rows are
+    // written by the writer thread, coalesced with other updates to the same keys
+    const QJsonObject config = setPath(m_config.value(module).toObject(), splitPath(path), 0, QJsonValue::fromVariant(value));
+    if (m_config.value(module).toObject() == config) return;
+
+    SettingChanges changes;
+    setModule(module, config, QString(), &changes);
+    queueLeafWrites(module, changes);
+    bumpVersion();
+    notifyChanges(changes);
 }
 
 QString DatabaseManager::getFullConfig() {
+    if (m_fullConfigCache.isEmpty())
+        m_fullConfigCache = QString(QJsonDocument(m_config).toJson(QJsonDocument::Compact));
+    return m_fullConfigCache;
+}
+
+bool DatabaseManager::reload() {
+    if (!m_ready) return false;
+
     QSqlDatabase db = QSqlDatabase::database("settings_conn");
     QSqlQuery query(db);
-    query.exec("SELECT module, config_json FROM sleex_settings");
-    
-    QJsonObject root;
-    while (query.next()) {
-        QString module = query.value(0).toString();
-        QString json = query.value(1).toString();
-        root.insert(module, QJsonDocument::fromJson(json.toUtf8()).object());
+    if (!query.exec("SELECT module, config_json FROM sleex_settings_view")) return false;
+
+    QVariantMap rows;
+    while (query.next()) rows.insert(query.value(0).toString(), query.value(1));
+    return applyRows(rows);
+}
+
+bool DatabaseManager::applyRows(const QVariantMap &rows) {
+    bool changed = false;
+    SettingChanges changes;
+    for (auto it = rows.constBegin(); it != rows.constEnd(); ++it) {
+        const QString &module = it.key();
+        const QString json = it.value().toString();
+
+        if (hasPendingWrite(module)) continue;
+        if (m_rawModules.value(module) == json && m_config.contains(module)) continue;
+
+        const QJsonObject config = QJsonDocument::fromJson(json.toUtf8()).object();
+        if (m_config.contains(module) && m_config.value(module).toObject() == config) {
+            // Our own write coming back, nothing to re-parse next time
+            m_rawModules.insert(module, json);
+            continue;
+        }
+        setModule(module, config, json, &changes);
+        changed = true;
+    }
+
+    for (const QString &module : m_config.keys()) {
+        if (rows.contains(module) || hasPendingWrite(module)) continue;
+        // An empty module has no leaf rows, so it never shows up in the view
+        if (m_config.value(module).toObject().isEmpty()) continue;
+        diffValues(module, m_config.value(module), QJsonValue(QJsonValue::Undefined), changes);
+        m_config.remove(module);
+        m_rawModules.remove(module);
+        m_moduleVersions.remove(module);
+        changed = true;
+    }
+
+    if (changed) bumpVersion();
+    notifyChanges(changes);
+    return changed;
+}
+
+void DatabaseManager::setModule(const QString &module, const QJsonObject &config, const QString &raw, SettingChanges *changes) {
+    if (changes) diffValues(module, m_config.value(module), config, *changes);
+    m_config.insert(module, config);
+    m_rawModules.insert(module, raw);
+    m_moduleVersions[module]++;
+}
+
+void DatabaseManager::bumpVersion() {
+    ++m_version;
+    m_fullConfigCache.clear();
+    emit versionChanged();
+}
+
+QJsonValue DatabaseManager::lookup(const QString &path) const {
+    QJsonValue current = m_config;
+    for (const QString &key : splitPath(path)) {
+        if (current.isObject()) {
+            current = current.toObject().value(key);
+        } else if (current.isArray()) {
+            bool ok = false;
+            const int index = key.toInt(&ok);
+            const QJsonArray array = current.toArray();
+            if (!ok || index < 0 || index >= array.size()) return QJsonValue(QJsonValue::Undefined);
+            current = array.at(index);
+        } else {
+            return QJsonValue(QJsonValue::Undefined);
+        }
     }
-    
-    return QString(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return current;
+}
+
+QStringList DatabaseManager::pathKeys(const QString &path) const {
+    return splitPath(path);
+}
+
+QVariant DatabaseManager::value(const QString &path, const QVariant &fallback) const {
+    const QJsonValue v = lookup(path);
+    return v.isUndefined() ? fallback : v.toVariant();
+}
+
+bool DatabaseManager::boolValue(const QString &path, bool fallback) const {
+    const QJsonValue v = lookup(path);
+    return v.isBool() ? v.toBool() : fallback;
+}
+
+int DatabaseManager::intValue(const QString &path, int fallback) const {
+    const QJsonValue v = lookup(path);
+    return v.isDouble() ? v.toInt(fallback) : fallback;
+}
+
+double DatabaseManager::realValue(const QString &path, double fallback) const {
+    const QJsonValue v = lookup(path);
+    return v.isDouble() ? v.toDouble() : fallback;
+}
+
+QString DatabaseManager::stringValue(const QString &path, const QString &fallback) const {
+    const QJsonValue v = lookup(path);
+    return v.isString() ? v.toString() : fallback;
+}
+
+QVariantMap DatabaseManager::objectValue(const QString &path) const {
+    return lookup(path).toObject().toVariantMap();
+}
+
+QVariantList DatabaseManager::listValue(const QString &path) const {
+    return lookup(path).toArray().toVariantList();
 }
 
 void DatabaseManager::saveAll(const QString &fullJson) {
-    QSqlDatabase db = QSqlDatabase::database("settings_conn");
-    QSqlQuery query(db);
+    if (!m_ready) {
+        m_queuedRequests.append([this, fullJson]() { saveAll(fullJson); });
+        return;
+    }
+
     QJsonDocument doc = QJsonDocument::fromJson(fullJson.toUtf8());
     QJsonObject root = doc.object();
 
-    db.transaction();
-    query.prepare("INSERT OR REPLACE INTO sleex_settings (module, config_json) VALUES (:module, :config)");
-    
+    // Only leaves that differ from the cached document are sent to the writer
+    bool changed = false;
+    SettingChanges changes;
     for (auto it = root.begin(); it != root.end(); ++it) {
-        query.bindValue(":config", QString(QJsonDocument(it.value().toObject()).toJson(QJsonDocument::Compact)));
-        query.bindValue(":module", it.key());
-        query.exec();
-    }
-    db.commit();
+        const QJsonObject config = it.value().toObject();
+        if (m_config.contains(it.key()) && m_config.value(it.key()).toObject() == config) continue;
 
-    // Touch the trigger file to notify other instances
-    QString triggerPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex/.db_trigger";
-    QFile trigger(triggerPath);
-    if (trigger.open(QIODevice::WriteOnly)) {
-        trigger.write("ping");
-        trigger.close();
+        SettingChanges moduleChanges;
+        setModule(it.key(), config, QString(), &moduleChanges);
+        queueLeafWrites(it.key(), moduleChanges);
+        changes.insert(moduleChanges);
+        changed = true;
     }
+
+    if (changed) bumpVersion();
+    notifyChanges(changes);
 }
+
 } // namespace SleexCore
\ No newline at end of file
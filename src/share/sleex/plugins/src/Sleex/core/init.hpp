@@ -1,20 +1,156 @@
 #pragma once
 #include <QObject>
 #include <QQmlEngine>
+#include <QJsonObject>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <functional>
 
 namespace SleexCore {
 
+class SettingsWriter;
+
+// Changed paths ("bar.workspaces.shown") mapped to their new value, undefined when removed
+using SettingChanges = QMap<QString, QJsonValue>;
+
+// Delivers settings changes matching one path pattern. "bar.*" matches
+// everything under bar, "bar.verbose" that key (and anything below it),
+// "*" every change.
+class SettingsSubscription : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Obtained from DatabaseManager.subscribe()")
+
+    Q_PROPERTY(QString pattern READ pattern CONSTANT FINAL)
+
+public:
+    SettingsSubscription(const QString &pattern, QObject *parent = nullptr);
+
+    QString pattern() const { return m_pattern; }
+    bool matches(const QString &path) const;
+
+signals:
+    void changed(const QStringList &paths, const QVariantMap &values);
+
+private:
+    QString m_pattern;
+    QString m_prefix;
+    bool m_matchAll = false;
+};
+
 class DatabaseManager : public QObject {
     Q_OBJECT
     QML_ELEMENT
     QML_SINGLETON
 
+    // Bumped whenever the cached settings tree changes, locally or after reload()
+    Q_PROPERTY(quint64 version READ version NOTIFY versionChanged FINAL)
+    // Time spent in the last settings transaction on the writer thread
+    Q_PROPERTY(double lastWriteLatencyMs READ lastWriteLatencyMs NOTIFY writeCompleted FINAL)
+    // The database is opened on the writer thread. Until then reads return
+    // their fallback and writes are queued.
+    Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged FINAL)
+    // Milliseconds spent in each startup phase, "total" from construction to ready
+    Q_PROPERTY(QVariantMap startupTimings READ startupTimings NOTIFY readyChanged FINAL)
+    // Why the database could not be opened. ready stays false then, writes
+    // stay queued in memory and reads return their fallback
+    Q_PROPERTY(QString error READ error NOTIFY errorChanged FINAL)
+
 public:
     explicit DatabaseManager(QObject *parent = nullptr);
+    ~DatabaseManager() override;
 
     Q_INVOKABLE QString getFullConfig();
     Q_INVOKABLE void saveAll(const QString &fullJson);
     Q_INVOKABLE void updateSettingField(const QString &module, const QString &path, const QVariant &value);
+
+    // Re-reads the settings view and only re-parses modules whose stored
+    // leaves differ from the cache. Returns true if anything changed.
+    Q_INVOKABLE bool reload();
+
+    quint64 version() const { return m_version; }
+    double lastWriteLatencyMs() const { return m_lastWriteLatencyMs; }
+    bool isReady() const { return m_ready; }
+    QVariantMap startupTimings() const { return m_startupTimings; }
+    QString error() const { return m_error; }
+    Q_INVOKABLE quint64 moduleVersion(const QString &module) const { return m_moduleVersions.value(module); }
+
+    // Lookups by dotted path ("bar.workspaces.shown") served from the cache
+    Q_INVOKABLE QVariant value(const QString &path, const QVariant &fallback = QVariant()) const;
+    Q_INVOKABLE bool boolValue(const QString &path, bool fallback = false) const;
+    Q_INVOKABLE int intValue(const QString &path, int fallback = 0) const;
+    Q_INVOKABLE double realValue(const QString &path, double fallback = 0) const;
+    Q_INVOKABLE QString stringValue(const QString &path, const QString &fallback = QString()) const;
+    Q_INVOKABLE QVariantMap objectValue(const QString &path) const;
+    Q_INVOKABLE QVariantList listValue(const QString &path) const;
+
+    // The keys of a setting path, with quoted keys unquoted ("apps.\"org.kde.dolphin\"")
+    Q_INVOKABLE QStringList pathKeys(const QString &path) const;
+
+    Q_INVOKABLE SleexCore::SettingsSubscription *subscribe(const QString &pattern);
+    Q_INVOKABLE void unsubscribe(SleexCore::SettingsSubscription *subscription);
+
+signals:
+    void versionChanged();
+    void readyChanged();
+    void errorChanged();
+    // Leaf paths that changed, with their new values (undefined when removed)
+    void settingsChanged(const QStringList &paths, const QVariantMap &values);
+    void writeCompleted(int leaves, double latencyMs);
+    // A settings batch could not be committed, it stays queued and is retried
+    void writeFailed(const QString &error);
+
+private:
+    QJsonValue lookup(const QString &path) const;
+    void onDatabaseOpened(const QVariantMap &rows, const QVariantMap &timings, const QString &error);
+    bool applyRows(const QVariantMap &rows);
+    void setModule(const QString &module, const QJsonObject &config, const QString &raw, SettingChanges *changes = nullptr);
+    void notifyChanges(const SettingChanges &changes);
+    void pollDataVersion();
+    // Sends the leaf rows of module touched by changes to the writer thread
+    void queueLeafWrites(const QString &module, const SettingChanges &changes);
+    bool hasPendingWrite(const QString &module) const;
+    void bumpVersion();
+
+    QJsonObject m_config;
+    // Module row of sleex_settings_view as last read, to skip parsing unchanged
+    // modules on reload. Empty after a local write until the next reload.
+    QHash<QString, QString> m_rawModules;
+    QHash<QString, quint64> m_moduleVersions;
+    quint64 m_version = 0;
+    QString m_fullConfigCache;
+
+    bool m_ready = false;
+    QString m_error;
+    QString m_dbPath;
+    QElapsedTimer m_startupTimer;
+    QVariantMap m_startupTimings;
+    // Writes made before the database was ready, replayed in order once it is
+    QList<std::function<void()>> m_queuedRequests;
+
+    QList<QPointer<SettingsSubscription>> m_subscriptions;
+    // Other processes' commits bump SQLite's data_version on our connection,
+    // and so do the writer thread's
+    QTimer m_pollTimer;
+    qint64 m_dataVersion = -1;
+    // sleex_settings_commits as of the last poll, and the numbers our writer
+    // committed since. A bump made only of those has nothing to reload
+    qint64 m_commitCount = -1;
+    QSet<qint64> m_ownCommits;
+
+    QThread m_writerThread;
+    SettingsWriter *m_writer = nullptr;
+    quint64 m_writeSeq = 0;
+    quint64 m_committedSeq = 0;
+    // Newest queued write per module, those rows are ahead of what reload() would read
+    QHash<QString, quint64> m_moduleWriteSeq;
+    double m_lastWriteLatencyMs = 0;
 };
 
 } // namespace SleexCore
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "settingsWriter.hpp"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTimer>
+#include <QDebug>
+
+namespace SleexCore {
+
+namespace {
+const QString CONNECTION_NAME = QStringLiteral("settings_writer_conn");
+
+// About one frame: a slider drag or a burst of toggles becomes one commit
+constexpr int BATCH_WINDOW_MS = 16;
+// A failed batch is retried, waiting twice as long each time
+constexpr int FIRST_RETRY_MS = 250;
+constexpr int MAX_RETRY_MS = 30000;
+
+// Stored in PRAGMA user_version, schema setup and migrations only run below it.
+// 2 nests the view's objects instead of keying them by dotted path,
+// 3 counts commits in sleex_settings_commits
+constexpr int SCHEMA_VERSION = 3;
+
+QString leafType(const QJsonValue &value) {
+    switch (value.type()) {
+        case QJsonValue::Bool: return QStringLiteral("bool");
+        case QJsonValue::Double: return QStringLiteral("number");
+        case QJsonValue::String: return QStringLiteral("string");
+        case QJsonValue::Array: return QStringLiteral("array");
+        case QJsonValue::Object: return QStringLiteral("object");
+        default: return QStringLiteral("null");
+    }
+}
+
+// Leaf values are stored as JSON text so the view can json() them back.
+// QJsonDocument only takes containers, scalars go through a one-element array.
+QString leafText(const QJsonValue &value) {
+    const QByteArray json = QJsonDocument(QJsonArray{ value }).toJson(QJsonDocument::Compact);
+    return QString::fromUtf8(json.mid(1, json.size() - 2));
+}
+
+void bindLeaf(QSqlQuery &upsert, const QString &module, const QString &path, const QJsonValue &value) {
+    upsert.bindValue(":module", module);
+    upsert.bindValue(":path", path);
+    upsert.bindValue(":type", leafType(value));
+    upsert.bindValue(":value", leafText(value));
+}
+}
+
+QString appendPathKey(const QString &path, const QString &key) {
+    const bool quoted = key.isEmpty() || key.contains('.') || key.contains('[') || key.contains('"');
+    QString segment = key;
+    if (quoted) {
+        // SQLite reads a quoted key as the inside of a JSON string
+        segment.replace('\\', QLatin1String("\\\\"));
+        segment.replace('"', QLatin1String("\\\""));
+        segment = '"' + segment + '"';
+    }
+    return path.isEmpty() ? segment : path + '.' + segment;
+}
+
+QStringList splitPath(const QString &path) {
+    if (!path.contains('"')) return path.split('.');
+    QStringList keys;
+    QString key;
+    bool quoted = false;
+    bool escaped = false;
+    for (const QChar c : path) {
+        if (escaped) {
+            key.append(c);
+            escaped = false;
+        } else if (c == '\\' && quoted) {
+            escaped = true;
+        } else if (c == '"') {
+            quoted = !quoted;
+        } else if (c == '.' && !quoted) {
+            keys.append(key);
+            key.clear();
+        } else {
+            key.append(c);
+        }
+    }
+    keys.append(key);
+    return keys;
+}
+
+SettingsWriter::SettingsWriter(const QString &dbPath, const QString &legacyJsonPath, QObject *parent)
+    : QObject(parent), m_dbPath(dbPath), m_legacyJsonPath(legacyJsonPath) {}
+
+void SettingsWriter::createSchema(QSqlDatabase &db) {
+    QSqlQuery query(db);
+    query.exec("CREATE TABLE IF NOT EXISTS sleex_settings_leaves ("
+               "module TEXT NOT NULL, path TEXT NOT NULL, type TEXT NOT NULL, value TEXT, "
+               "PRIMARY KEY (module, path))");
+    query.exec("CREATE INDEX IF NOT EXISTS sleex_settings_leaves_path ON sleex_settings_leaves (path)");
+    // One row, bumped by every settings batch. Readers tell their own commits
+    // from other processes' by the numbers flush() reports
+    query.exec("CREATE TABLE IF NOT EXISTS sleex_settings_commits (id INTEGER PRIMARY KEY CHECK (id = 0), count INTEGER NOT NULL)");
+    query.exec("INSERT OR IGNORE INTO sleex_settings_commits (id, count) VALUES (0, 0)");
+    // Same (module, config_json) shape the blob table had. Paths are JSON
+    // paths, json_set() creates the objects above each leaf as it goes
+    query.exec("DROP VIEW IF EXISTS sleex_settings_view");
+    query.exec("CREATE VIEW sleex_settings_view AS "
+               "WITH RECURSIVE "
+               "leaves(module, n, path, value) AS ("
+               "  SELECT module, row_number() OVER (PARTITION BY module ORDER BY path), path, value "
+               "  FROM sleex_settings_leaves), "
+               "built(module, n, config) AS ("
+               "  SELECT DISTINCT module, 0, '{}' FROM sleex_settings_leaves "
+               "  UNION ALL "
+               "  SELECT built.module, built.n + 1, json_set(built.config, '$.' || leaves.path, json(leaves.value)) "
+               "  FROM built JOIN leaves ON leaves.module = built.module AND leaves.n = built.n + 1) "
+               "SELECT module, config AS config_json FROM built "
+               "WHERE n = (SELECT count(*) FROM sleex_settings_leaves WHERE sleex_settings_leaves.module = built.module)");
+}
+
+void SettingsWriter::prepareUpsert(QSqlQuery &query) {
+    query.prepare("INSERT INTO sleex_settings_leaves (module, path, type, value) "
+                  "VALUES (:module, :path, :type, :value) "
+                  "ON CONFLICT(module, path) DO UPDATE SET type = excluded.type, value = excluded.value");
+}
+
+void SettingsWriter::insertLeaves(QSqlQuery &upsert, const QString &module, const QString &prefix, const QJsonObject &obj) {
+    for (auto it = obj.begin(); it != obj.end(); ++it) {
+        const QString path = appendPathKey(prefix, it.key());
+        const QJsonValue value = it.value();
+        if (value.isObject() && !value.toObject().isEmpty()) {
+            insertLeaves(upsert, module, path, value.toObject());
+            continue;
+        }
+        bindLeaf(upsert, module, path, value);
+        if (!upsert.exec())
+            qWarning() << "[Sleex Core] Error while saving" << module << path << ":" << upsert.lastError().text();
+    }
+}
+
+void SettingsWriter::open() {
+    QVariantMap timings;
+    QElapsedTimer phase;
+    phase.start();
+    const auto mark = [&](const QString &name) {
+        timings.insert(name, phase.nsecsElapsed() / 1e6);
+        phase.restart();
+    };
+
+    QDir().mkpath(QFileInfo(m_dbPath).absolutePath());
+    mark("mkpath");
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+    db.setDatabaseName(m_dbPath);
+    if (!db.open()) {
+        const QString error = db.lastError().text();
+        qCritical() << "[Sleex Core] settings DB error:" << error;
+        emit opened(QVariantMap(), timings, error);
+        return;
+    }
+    mark("open");
+
+    QSqlQuery query(db);
+    // WAL so reads on the GUI thread never wait for this thread's commits
+    query.exec("PRAGMA journal_mode=WAL;");
+    query.exec("PRAGMA synchronous=NORMAL;");
+
+    int schemaVersion = 0;
+    if (query.exec("PRAGMA user_version") && query.next())
+        schemaVersion = query.value(0).toInt();
+    if (schemaVersion < SCHEMA_VERSION) {
+        createSchema(db);
+        mark("schema");
+        migrate(db);
+        query.exec(QStringLiteral("PRAGMA user_version = %1").arg(SCHEMA_VERSION));
+        mark("migration");
+    } else {
+        mark("schema");
+    }
+
+    QVariantMap rows;
+    if (query.exec("SELECT module, config_json FROM sleex_settings_view")) {
+        while (query.next()) rows.insert(query.value(0).toString(), query.value(1));
+    }
+    mark("load");
+
+    m_batchTimer = new QTimer(this);
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(BATCH_WINDOW_MS);
+    connect(m_batchTimer, &QTimer::timeout, this, &SettingsWriter::flush);
+
+    emit opened(rows, timings, QString());
+}
+
+void SettingsWriter::migrate(QSqlDatabase &db) {
+    QSqlQuery upsert(db);
+
+    // Module blobs from before the per-leaf schema, every row is flattened once
+    QSqlQuery query(db);
+    query.exec("SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'sleex_settings'");
+    if (query.next()) {
+        qInfo() << "[Sleex Core] Migrating settings to one row per key...";
+
+        db.transaction();
+        prepareUpsert(upsert);
+        query.exec("SELECT module, config_json FROM sleex_settings");
+        int modules = 0;
+        while (query.next()) {
+            const QJsonObject config = QJsonDocument::fromJson(query.value(1).toString().toUtf8()).object();
+            insertLeaves(upsert, query.value(0).toString(), QString(), config);
+            ++modules;
+        }
+        query.finish();
+
+        // Kept around for a downgrade, nothing reads it anymore
+        QSqlQuery rename(db);
+        rename.exec("DROP TABLE IF EXISTS sleex_settings_blob_backup");
+        rename.exec("ALTER TABLE sleex_settings RENAME TO sleex_settings_blob_backup");
+
+        if (db.commit()) {
+            qInfo() << "[Sleex Core] Migrated" << modules << "settings modules.";
+        } else {
+            qWarning() << "[Sleex Core] Settings migration failed:" << db.lastError().text();
+            db.rollback();
+        }
+    }
+
+    // execute only if past version with JSON exists, otherwise we might mess with existing SQLite data
+    if (QFile::exists(m_legacyJsonPath)) {
+        qInfo() << "[Sleex Core] Migration...";
+
+        QFile file(m_legacyJsonPath);
+        if (file.open(QIODevice::ReadOnly)) {
+            QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+            file.close();
+
+            db.transaction();
+            prepareUpsert(upsert);
+            for (auto it = root.begin(); it != root.end(); ++it) {
+                insertLeaves(upsert, it.key(), QString(), it.value().toObject());
+            }
+            db.commit();
+
+            // Archiving the old JSON just in case, but it won't be used anymore
+            QFile::rename(m_legacyJsonPath, m_legacyJsonPath + ".bak");
+            qInfo() << "[Sleex Core] Migration completed. The JSON file is in the closet.";
+        }
+    }
+}
+
+void SettingsWriter::close() {
+    flush();
+    {
+        QSqlDatabase db = QSqlDatabase::database(CONNECTION_NAME, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(CONNECTION_NAME);
+}
+
+void SettingsWriter::enqueueLeaf(quint64 seq, const QString &module, const QString &path, const QJsonValue &value) {
+    m_pending.insert({ module, path }, value);
+    m_pendingSeq = seq;
+    if (m_batchTimer && !m_batchTimer->isActive()) m_batchTimer->start();
+}
+
+void SettingsWriter::flush() {
+    if (m_batchTimer) m_batchTimer->stop();
+    if (m_pending.isEmpty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlDatabase db = QSqlDatabase::database(CONNECTION_NAME);
+    QString error;
+    if (!db.transaction()) error = db.lastError().text();
+
+    QSqlQuery upsert(db);
+    prepareUpsert(upsert);
+    QSqlQuery remove(db);
+    remove.prepare("DELETE FROM sleex_settings_leaves WHERE module = :module AND path = :path");
+
+    for (auto it = m_pending.constBegin(); error.isEmpty() && it != m_pending.constEnd(); ++it) {
+        const QString &module = it.key().first;
+        const QString &path = it.key().second;
+        const QJsonValue &value = it.value();
+
+        QSqlQuery &query = (value.isUndefined() || (value.isObject() && !value.toObject().isEmpty())) ? remove : upsert;
+        if (&query == &remove) {
+            remove.bindValue(":module", module);
+            remove.bindValue(":path", path);
+        } else {
+            bindLeaf(upsert, module, path, value);
+        }
+        if (!query.exec()) error = module + ' ' + path + ": " + query.lastError().text();
+    }
+    upsert.finish();
+    remove.finish();
+
+    qint64 commit = -1;
+    if (error.isEmpty()) {
+        QSqlQuery counter(db);
+        if (counter.exec("UPDATE sleex_settings_commits SET count = count + 1")
+            && counter.exec("SELECT count FROM sleex_settings_commits") && counter.next())
+            commit = counter.value(0).toLongLong();
+        else
+            error = counter.lastError().text();
+        counter.finish();
+    }
+    if (error.isEmpty() && !db.commit()) error = db.lastError().text();
+
+    if (!error.isEmpty()) {
+        db.rollback();
+        // The batch stays pending, later writes to the same keys still replace
+        // their value in it. The cache keeps what was set, the disk catches up
+        m_retryMs = qMin(m_retryMs > 0 ? m_retryMs * 2 : FIRST_RETRY_MS, MAX_RETRY_MS);
+        qWarning() << "[Sleex Core] Settings commit failed, retrying in" << m_retryMs << "ms:" << error;
+        emit writeFailed(error);
+        if (m_batchTimer) m_batchTimer->start(m_retryMs);
+        return;
+    }
+
+    m_retryMs = 0;
+    if (m_batchTimer) m_batchTimer->setInterval(BATCH_WINDOW_MS);
+    const int leaves = m_pending.size();
+    m_pending.clear();
+    emit batchWritten(m_pendingSeq, commit, leaves, timer.nsecsElapsed() / 1e6);
+}
+
+} // namespace SleexCore
@@ -0,0 +1,71 @@
+#pragma once
+#include <QObject>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QVariantMap>
+
+class QTimer;
+class QSqlDatabase;
+class QSqlQuery;
+
+namespace SleexCore {
+
+// Setting paths are keys joined by dots, in the syntax of SQLite JSON paths
+// without the leading "$.": a key holding a dot, a bracket or a quote is double
+// quoted, so "apps.\"org.kde.dolphin\".pinned" is three keys deep. Inside the
+// quotes a backslash escapes the next character, as in a JSON string
+QString appendPathKey(const QString &path, const QString &key);
+QStringList splitPath(const QString &path);
+
+// Lives on DatabaseManager's writer thread with its own SQLite connection.
+// open() prepares the database off the GUI thread (schema, migrations, first
+// read). Leaf writes arriving within one frame are coalesced per (module, path)
+// and committed in a single transaction, so fsync never runs on the GUI thread.
+class SettingsWriter : public QObject {
+    Q_OBJECT
+
+public:
+    SettingsWriter(const QString &dbPath, const QString &legacyJsonPath, QObject *parent = nullptr);
+
+    // Settings are stored one row per leaf in sleex_settings_leaves, the
+    // sleex_settings_view view nests them back into one JSON object per module
+    static void createSchema(QSqlDatabase &db);
+    static void prepareUpsert(QSqlQuery &query);
+    // Flattens a module into leaf rows using a query from prepareUpsert()
+    static void insertLeaves(QSqlQuery &upsert, const QString &module, const QString &prefix, const QJsonObject &obj);
+
+    void open();
+    void close();
+    // An undefined value deletes the row, a non-empty object only clears a
+    // leaf that has become an inner node
+    void enqueueLeaf(quint64 seq, const QString &module, const QString &path, const QJsonValue &value);
+    void flush();
+
+signals:
+    // Module rows of sleex_settings_view, and the time spent in each open phase.
+    // error is set when the database could not be opened, nothing is written then
+    void opened(const QVariantMap &rows, const QVariantMap &timings, const QString &error);
+    // seq is the newest write included in the committed batch, commit the
+    // value it left in sleex_settings_commits
+    void batchWritten(quint64 seq, qint64 commit, int leaves, double latencyMs);
+    // The batch was rolled back and is retried later
+    void writeFailed(const QString &error);
+
+private:
+    // One-time moves of older settings stores into the leaf table
+    void migrate(QSqlDatabase &db);
+
+    QString m_dbPath;
+    QString m_legacyJsonPath;
+    QMap<QPair<QString, QString>, QJsonValue> m_pending;
+    quint64 m_pendingSeq = 0;
+    QTimer *m_batchTimer = nullptr;
+    // Delay before retrying a failed batch, 0 while commits succeed
+    int m_retryMs = 0;
+};
+
+} // namespace SleexCore
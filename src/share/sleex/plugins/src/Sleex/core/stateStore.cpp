@@ -0,0 +1,201 @@
+#include "stateStore.hpp"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+
+namespace SleexCore {
+
+namespace {
+const QString CONNECTION_NAME = QStringLiteral("state_store_conn");
+
+// States flip in bursts (tabs, toggles), one commit per burst is plenty
+constexpr int FLUSH_DELAY_MS = 250;
+
+QSqlDatabase database() {
+    return QSqlDatabase::database(CONNECTION_NAME);
+}
+
+// Values are stored as JSON text. QJsonDocument only takes containers,
+// so scalars go through a one-element array.
+QString encode(const QVariant &value) {
+    const QByteArray json = QJsonDocument(QJsonArray{ QJsonValue::fromVariant(value) }).toJson(QJsonDocument::Compact);
+    return QString::fromUtf8(json.mid(1, json.size() - 2));
+}
+
+QVariant decode(const QString &text) {
+    const QJsonArray array = QJsonDocument::fromJson(('[' + text + ']').toUtf8()).array();
+    return array.isEmpty() ? QVariant() : array.at(0).toVariant();
+}
+
+void flatten(const QString &prefix, const QJsonObject &obj, QHash<QString, QVariant> &out) {
+    for (auto it = obj.begin(); it != obj.end(); ++it) {
+        const QString key = prefix.isEmpty() ? it.key() : prefix + '.' + it.key();
+        if (it.value().isObject())
+            flatten(key, it.value().toObject(), out);
+        else
+            out.insert(key, it.value().toVariant());
+    }
+}
+}
+
+StateStore::StateStore(QObject *parent) : QObject(parent) {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &StateStore::flush);
+
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &StateStore::flush);
+
+    openDatabase();
+    loadAll();
+    migrateLegacyJson();
+}
+
+StateStore::~StateStore() {
+    flush();
+}
+
+void StateStore::openDatabase() {
+    if (QSqlDatabase::contains(CONNECTION_NAME)) return;
+
+    QString stateDir = QDir::homePath() + "/.local/state/sleex";
+    QDir().mkpath(stateDir);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+    db.setDatabaseName(stateDir + "/sleex_state.db");
+
+    if (!db.open()) {
+        qCritical() << "[Sleex Core] state store DB error:" << db.lastError().text();
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode=WAL;");
+    query.exec("PRAGMA synchronous=NORMAL;");
+    query.exec("CREATE TABLE IF NOT EXISTS sleex_states (key TEXT PRIMARY KEY, value TEXT)");
+}
+
+void StateStore::loadAll() {
+    QSqlQuery query(database());
+    if (!query.exec("SELECT key, value FROM sleex_states")) return;
+
+    while (query.next()) {
+        m_values.insert(query.value(0).toString(), decode(query.value(1).toString()));
+    }
+}
+
+void StateStore::migrateLegacyJson() {
+    // Written by the old PersistentStateManager.qml as one nested document
+    QString jsonPath = QStandardPaths::writableLocation(QStandardPaths::GenericStateLocation) + "/states.json";
+    if (!QFile::exists(jsonPath)) return;
+
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    QHash<QString, QVariant> legacy;
+    flatten(QString(), root, legacy);
+    for (auto it = legacy.constBegin(); it != legacy.constEnd(); ++it) {
+        // Anything already in the DB is newer than the JSON file
+        if (m_values.contains(it.key())) continue;
+        m_values.insert(it.key(), it.value());
+        m_dirty.insert(it.key());
+    }
+    if (!flush()) {
+        // The JSON stays where it is and is migrated again on the next start
+        qWarning() << "[Sleex Core] State migration failed, keeping" << jsonPath;
+        return;
+    }
+
+    QFile::rename(jsonPath, jsonPath + ".bak");
+    qInfo() << "[Sleex Core] Migrated" << legacy.size() << "persistent states to the state DB";
+}
+
+QVariant StateStore::get(const QString &key, const QVariant &fallback) const {
+    return m_values.value(key, fallback);
+}
+
+void StateStore::set(const QString &key, const QVariant &value) {
+    const auto it = m_values.constFind(key);
+    if (it != m_values.constEnd() && it.value() == value) return;
+
+    m_values.insert(key, value);
+    scheduleFlush(key);
+    emit stateChanged(key, value);
+}
+
+void StateStore::remove(const QString &key) {
+    if (!m_values.remove(key)) return;
+
+    scheduleFlush(key);
+    emit stateRemoved(key);
+}
+
+QStringList StateStore::keys(const QString &prefix) const {
+    QStringList result;
+    for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) result.append(it.key());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+QVariantMap StateStore::values(const QString &prefix) const {
+    QVariantMap result;
+    for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) result.insert(it.key(), it.value());
+    }
+    return result;
+}
+
+void StateStore::scheduleFlush(const QString &key) {
+    m_dirty.insert(key);
+    if (!m_flushTimer.isActive()) m_flushTimer.start();
+}
+
+bool StateStore::flush() {
+    m_flushTimer.stop();
+    if (m_dirty.isEmpty()) return true;
+
+    QSqlDatabase db = database();
+    QString error;
+    if (!db.transaction()) error = db.lastError().text();
+
+    QSqlQuery upsert(db);
+    upsert.prepare("INSERT INTO sleex_states (key, value) VALUES (:key, :value) "
+                   "ON CONFLICT(key) DO UPDATE SET value = excluded.value");
+    QSqlQuery remove(db);
+    remove.prepare("DELETE FROM sleex_states WHERE key = :key");
+
+    for (auto key = m_dirty.constBegin(); error.isEmpty() && key != m_dirty.constEnd(); ++key) {
+        const auto it = m_values.constFind(*key);
+        QSqlQuery &query = it == m_values.constEnd() ? remove : upsert;
+        query.bindValue(":key", *key);
+        if (&query == &upsert) upsert.bindValue(":value", encode(it.value()));
+        if (!query.exec()) error = *key + ": " + query.lastError().text();
+    }
+    upsert.finish();
+    remove.finish();
+    if (error.isEmpty() && !db.commit()) error = db.lastError().text();
+
+    if (!error.isEmpty()) {
+        // Nothing of the batch is on disk, the keys stay dirty for the next flush
+        qWarning() << "[Sleex Core] Error while saving states:" << error;
+        db.rollback();
+        return false;
+    }
+    m_dirty.clear();
+    return true;
+}
+
+} // namespace SleexCore
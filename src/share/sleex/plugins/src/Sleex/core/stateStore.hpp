@@ -0,0 +1,51 @@
+#pragma once
+#include <QObject>
+#include <QQmlEngine>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVariant>
+
+namespace SleexCore {
+
+// Key-value access to the sleex_states table of sleex_state.db. Reads come
+// from memory; writes update the cache at once and are committed in batches,
+// one row upsert per changed key.
+class StateStore : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+public:
+    explicit StateStore(QObject *parent = nullptr);
+    ~StateStore() override;
+
+    Q_INVOKABLE QVariant get(const QString &key, const QVariant &fallback = QVariant()) const;
+    Q_INVOKABLE void set(const QString &key, const QVariant &value);
+    Q_INVOKABLE void remove(const QString &key);
+    Q_INVOKABLE bool contains(const QString &key) const { return m_values.contains(key); }
+
+    // Keys / key-value pairs starting with prefix ("sidebar." etc.)
+    Q_INVOKABLE QStringList keys(const QString &prefix = QString()) const;
+    Q_INVOKABLE QVariantMap values(const QString &prefix = QString()) const;
+
+    // Commits the pending writes in one transaction, false when it was rolled back
+    Q_INVOKABLE bool flush();
+
+signals:
+    void stateChanged(const QString &key, const QVariant &value);
+    void stateRemoved(const QString &key);
+
+private:
+    void openDatabase();
+    void migrateLegacyJson();
+    void loadAll();
+    void scheduleFlush(const QString &key);
+
+    QHash<QString, QVariant> m_values;
+    // Keys whose row needs an upsert, or a delete when absent from m_values
+    QSet<QString> m_dirty;
+    QTimer m_flushTimer;
+};
+
+} // namespace SleexCore
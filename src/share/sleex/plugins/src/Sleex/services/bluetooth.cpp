@@ -2,48 +2,31 @@
 
 BluetoothService::BluetoothService(QObject *parent)
     : QObject(parent)
+    , m_devices(new BluetoothDeviceModel(this))
 {
-    // Check for Bluetooth adapters
-    const auto adapters = QBluetoothLocalDevice::allDevices();
-    if (!adapters.isEmpty()) {
-        m_localDevice = new QBluetoothLocalDevice(adapters.first().address(), this);
-        m_available = true;
-
-        connect(m_localDevice, &QBluetoothLocalDevice::hostModeStateChanged, this, [this](QBluetoothLocalDevice::HostMode mode) {
-            bool enabled = (mode != QBluetoothLocalDevice::HostPoweredOff);
-            if (m_enabled != enabled) {
-                m_enabled = enabled;
-                emit bluetoothEnabledChanged();
-            }
-        });
-    } else {
-        // No adapters at all
-        m_available = false;
-    }
+    // Adapter and device state arrive asynchronously from BlueZ
+    connect(m_devices, &BluetoothDeviceModel::adapterChanged, this, &BluetoothService::sync);
+    connect(m_devices, &BluetoothDeviceModel::connectedChanged, this, &BluetoothService::sync);
+    connect(m_devices, &BluetoothDeviceModel::dataChanged, this, &BluetoothService::sync);
+    connect(m_devices, &BluetoothDeviceModel::modelReset, this, &BluetoothService::sync);
+    sync();
 }
 
-void BluetoothService::update()
+void BluetoothService::sync()
 {
-    if (!m_available || !m_localDevice) {
-        // Reset state if no adapter
-        if (m_enabled) { m_enabled = false; emit bluetoothEnabledChanged(); }
-        if (m_connected) { m_connected = false; emit bluetoothConnectedChanged(); }
-        if (!m_deviceName.isEmpty()) { m_deviceName.clear(); emit bluetoothDeviceNameChanged(); }
-        if (!m_deviceAddress.isEmpty()) { m_deviceAddress.clear(); emit bluetoothDeviceAddressChanged(); }
-        return;
-    }
+    const bool available = m_devices->available();
+    if (m_available != available) { m_available = available; emit bluetoothAvailableChanged(); }
+
+    const bool enabled = m_devices->powered();
+    if (m_enabled != enabled) { m_enabled = enabled; emit bluetoothEnabledChanged(); }
+
+    const BluetoothDeviceModel::Device *device = m_devices->firstConnected();
+    const bool connected = device != nullptr;
+    if (m_connected != connected) { m_connected = connected; emit bluetoothConnectedChanged(); }
 
-    // Update enabled state
-    bool enabled = (m_localDevice->hostMode() != QBluetoothLocalDevice::HostPoweredOff);
-    if (m_enabled != enabled) {
-        m_enabled = enabled;
-        emit bluetoothEnabledChanged();
-    }
+    const QString name = device ? device->name : QString();
+    if (m_deviceName != name) { m_deviceName = name; emit bluetoothDeviceNameChanged(); }
 
-    // If enabled, fetch connected device info (stubbed here, needs device discovery logic)
-    // For now, just reset connected state
-    if (!m_connected) {
-        m_connected = false;
-        emit bluetoothConnectedChanged();
-    }
+    const QString address = device ? device->address : QString();
+    if (m_deviceAddress != address) { m_deviceAddress = address; emit bluetoothDeviceAddressChanged(); }
 }
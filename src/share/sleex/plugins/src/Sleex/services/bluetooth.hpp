@@ -1,9 +1,8 @@
 #pragma once
 
 #include <QObject>
-#include <QtBluetooth/QBluetoothLocalDevice>
-#include <QtBluetooth/QBluetoothDeviceDiscoveryAgent>
 #include <QtQml/qqml.h>
+#include "bluetoothDevices.hpp"
 
 class BluetoothService : public QObject {
     Q_OBJECT
@@ -15,6 +14,7 @@ class BluetoothService : public QObject {
     Q_PROPERTY(bool bluetoothConnected READ bluetoothConnected NOTIFY bluetoothConnectedChanged FINAL)
     Q_PROPERTY(QString bluetoothDeviceName READ bluetoothDeviceName NOTIFY bluetoothDeviceNameChanged FINAL)
     Q_PROPERTY(QString bluetoothDeviceAddress READ bluetoothDeviceAddress NOTIFY bluetoothDeviceAddressChanged FINAL)
+    Q_PROPERTY(BluetoothDeviceModel *devices READ devices CONSTANT FINAL)
 
 public:
     explicit BluetoothService(QObject *parent = nullptr);
@@ -24,8 +24,7 @@ public:
     bool bluetoothConnected() const { return m_connected; }
     QString bluetoothDeviceName() const { return m_deviceName; }
     QString bluetoothDeviceAddress() const { return m_deviceAddress; }
-
-    Q_INVOKABLE void update();
+    BluetoothDeviceModel *devices() const { return m_devices; }
 
 signals:
     void bluetoothAvailableChanged();
@@ -35,7 +34,9 @@ signals:
     void bluetoothDeviceAddressChanged();
 
 private:
-    QBluetoothLocalDevice *m_localDevice = nullptr;
+    void sync();
+
+    BluetoothDeviceModel *m_devices = nullptr;
     bool m_available = false;
     bool m_enabled = false;
     bool m_connected = false;
@@ -0,0 +1,388 @@
+#include "bluetoothDevices.hpp"
+#include <QDBusArgument>
+#include <QDBusError>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+namespace {
+const QString OBJECT_MANAGER = QStringLiteral("org.freedesktop.DBus.ObjectManager");
+const QString PROPERTIES = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString ADAPTER = QStringLiteral("org.bluez.Adapter1");
+const QString DEVICE = QStringLiteral("org.bluez.Device1");
+const QString BATTERY = QStringLiteral("org.bluez.Battery1");
+}
+
+BluetoothDeviceModel::BluetoothDeviceModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_bus(QDBusConnection::systemBus())
+{
+    qDBusRegisterMetaType<InterfaceMap>();
+    qDBusRegisterMetaType<ManagedObjects>();
+    attach();
+}
+
+BluetoothDeviceModel::~BluetoothDeviceModel()
+{
+    detach();
+    if (!m_busAddress.isEmpty()) QDBusConnection::disconnectFromBus(m_bus.name());
+}
+
+void BluetoothDeviceModel::setBusAddress(const QString &v)
+{
+    if (m_busAddress == v) return;
+    detach();
+    // A private bus opened for the old address would stay open otherwise
+    if (!m_busAddress.isEmpty()) QDBusConnection::disconnectFromBus(m_bus.name());
+    m_busAddress = v;
+    m_bus = v.isEmpty()
+        ? QDBusConnection::systemBus()
+        : QDBusConnection::connectToBus(v, QStringLiteral("sleex-bluetooth-") + v);
+    emit busChanged();
+    attach();
+}
+
+void BluetoothDeviceModel::setService(const QString &v)
+{
+    if (m_service == v) return;
+    detach();
+    m_service = v;
+    emit busChanged();
+    attach();
+}
+
+void BluetoothDeviceModel::attach()
+{
+    if (!m_bus.isConnected()) {
+        qWarning() << "Sleex: Bluetooth bus is not connected:" << m_bus.lastError().message();
+        return;
+    }
+    m_attachedService = m_service;
+
+    // Subscribe before asking for the objects so no change falls in between
+    m_bus.connect(m_service, QStringLiteral("/"), OBJECT_MANAGER, QStringLiteral("InterfacesAdded"),
+                  this, SLOT(onInterfacesAdded(QDBusMessage)));
+    m_bus.connect(m_service, QStringLiteral("/"), OBJECT_MANAGER, QStringLiteral("InterfacesRemoved"),
+                  this, SLOT(onInterfacesRemoved(QDBusMessage)));
+    m_bus.connect(m_service, QString(), PROPERTIES, QStringLiteral("PropertiesChanged"),
+                  this, SLOT(onPropertiesChanged(QDBusMessage)));
+
+    // bluetoothd restarting drops every object, its return brings them back
+    m_watcher = new QDBusServiceWatcher(m_service, m_bus,
+        QDBusServiceWatcher::WatchForRegistration | QDBusServiceWatcher::WatchForUnregistration, this);
+    connect(m_watcher, &QDBusServiceWatcher::serviceRegistered, this, &BluetoothDeviceModel::fetchObjects);
+    connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, this, &BluetoothDeviceModel::clear);
+
+    fetchObjects();
+}
+
+void BluetoothDeviceModel::detach()
+{
+    ++m_fetchGeneration;
+    delete m_watcher;
+    m_watcher = nullptr;
+
+    if (!m_attachedService.isEmpty() && m_bus.isConnected()) {
+        m_bus.disconnect(m_attachedService, QStringLiteral("/"), OBJECT_MANAGER, QStringLiteral("InterfacesAdded"),
+                         this, SLOT(onInterfacesAdded(QDBusMessage)));
+        m_bus.disconnect(m_attachedService, QStringLiteral("/"), OBJECT_MANAGER, QStringLiteral("InterfacesRemoved"),
+                         this, SLOT(onInterfacesRemoved(QDBusMessage)));
+        m_bus.disconnect(m_attachedService, QString(), PROPERTIES, QStringLiteral("PropertiesChanged"),
+                         this, SLOT(onPropertiesChanged(QDBusMessage)));
+    }
+    m_attachedService.clear();
+    clear();
+}
+
+void BluetoothDeviceModel::fetchObjects()
+{
+    const quint64 generation = ++m_fetchGeneration;
+    const QDBusMessage call = QDBusMessage::createMethodCall(m_service, QStringLiteral("/"), OBJECT_MANAGER,
+                                                             QStringLiteral("GetManagedObjects"));
+
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, generation](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        if (generation != m_fetchGeneration) return;
+
+        const QDBusMessage reply = watcher->reply();
+        if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+            // No bluetoothd (yet), the service watcher fetches again once it shows up
+            clear();
+            return;
+        }
+        reset(qdbus_cast<ManagedObjects>(reply.arguments().first()));
+    });
+}
+
+void BluetoothDeviceModel::reset(const ManagedObjects &objects)
+{
+    const int oldCount = m_devices.size();
+    const QMap<QString, bool> oldAdapters = m_adapters;
+
+    beginResetModel();
+    m_devices.clear();
+    m_adapters.clear();
+    for (auto it = objects.cbegin(); it != objects.cend(); ++it) {
+        const QString path = it.key().path();
+        const InterfaceMap &interfaces = it.value();
+
+        if (interfaces.contains(ADAPTER))
+            m_adapters.insert(path, interfaces.value(ADAPTER).value(QStringLiteral("Powered")).toBool());
+
+        if (interfaces.contains(DEVICE)) {
+            Device device;
+            device.path = path;
+            applyDevice(device, interfaces.value(DEVICE));
+            if (interfaces.contains(BATTERY))
+                device.battery = interfaces.value(BATTERY).value(QStringLiteral("Percentage")).toInt();
+            m_devices.append(device);
+        }
+    }
+    endResetModel();
+
+    if (m_devices.size() != oldCount) emit countChanged();
+    if (m_adapters != oldAdapters) emit adapterChanged();
+    updateConnectedCount();
+}
+
+void BluetoothDeviceModel::clear()
+{
+    if (!m_devices.isEmpty()) {
+        beginResetModel();
+        m_devices.clear();
+        endResetModel();
+        emit countChanged();
+    }
+    if (!m_adapters.isEmpty()) {
+        m_adapters.clear();
+        emit adapterChanged();
+    }
+    updateConnectedCount();
+}
+
+void BluetoothDeviceModel::onInterfacesAdded(const QDBusMessage &message)
+{
+    const QList<QVariant> args = message.arguments();
+    if (args.size() < 2) return;
+    addObject(args.at(0).value<QDBusObjectPath>().path(), qdbus_cast<InterfaceMap>(args.at(1)));
+}
+
+void BluetoothDeviceModel::addObject(const QString &path, const InterfaceMap &interfaces)
+{
+    if (interfaces.contains(ADAPTER) && applyAdapter(path, interfaces.value(ADAPTER)))
+        emit adapterChanged();
+
+    int row = indexOf(path);
+    if (interfaces.contains(DEVICE) && row < 0) {
+        Device device;
+        device.path = path;
+        applyDevice(device, interfaces.value(DEVICE));
+
+        row = m_devices.size();
+        beginInsertRows(QModelIndex(), row, row);
+        m_devices.append(device);
+        endInsertRows();
+        emit countChanged();
+        updateConnectedCount();
+    } else if (interfaces.contains(DEVICE)) {
+        const QList<int> roles = applyDevice(m_devices[row], interfaces.value(DEVICE));
+        if (!roles.isEmpty()) emit dataChanged(index(row), index(row), roles);
+        updateConnectedCount();
+    }
+
+    // Battery1 shows up on its own once the profile connects
+    if (interfaces.contains(BATTERY) && row >= 0) {
+        const int battery = interfaces.value(BATTERY).value(QStringLiteral("Percentage"), -1).toInt();
+        if (m_devices[row].battery != battery) {
+            m_devices[row].battery = battery;
+            emit dataChanged(index(row), index(row), { BatteryRole });
+        }
+    }
+}
+
+void BluetoothDeviceModel::onInterfacesRemoved(const QDBusMessage &message)
+{
+    const QList<QVariant> args = message.arguments();
+    if (args.size() < 2) return;
+    const QString path = args.at(0).value<QDBusObjectPath>().path();
+    const QStringList interfaces = qdbus_cast<QStringList>(args.at(1));
+
+    if (interfaces.contains(ADAPTER) && m_adapters.remove(path) > 0)
+        emit adapterChanged();
+
+    const int row = indexOf(path);
+    if (row < 0) return;
+
+    if (interfaces.contains(DEVICE)) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_devices.removeAt(row);
+        endRemoveRows();
+        emit countChanged();
+        updateConnectedCount();
+    } else if (interfaces.contains(BATTERY) && m_devices.at(row).battery != -1) {
+        m_devices[row].battery = -1;
+        emit dataChanged(index(row), index(row), { BatteryRole });
+    }
+}
+
+void BluetoothDeviceModel::onPropertiesChanged(const QDBusMessage &message)
+{
+    const QList<QVariant> args = message.arguments();
+    if (args.size() < 3) return;
+    const QString interface = args.at(0).toString();
+    const QVariantMap changed = qdbus_cast<QVariantMap>(args.at(1));
+    const QStringList invalidated = qdbus_cast<QStringList>(args.at(2));
+    const QString path = message.path();
+
+    if (interface == ADAPTER) {
+        if (m_adapters.contains(path) && applyAdapter(path, changed))
+            emit adapterChanged();
+        return;
+    }
+
+    const int row = indexOf(path);
+    if (row < 0) return;
+    Device &device = m_devices[row];
+
+    if (interface == DEVICE) {
+        QList<int> roles = applyDevice(device, changed);
+        // BlueZ drops RSSI once the device is out of discovery range
+        if (invalidated.contains(QStringLiteral("RSSI")) && device.hasRssi) {
+            device.hasRssi = false;
+            roles.append(RssiRole);
+        }
+        if (roles.isEmpty()) return;
+        emit dataChanged(index(row), index(row), roles);
+        if (roles.contains(ConnectedRole)) updateConnectedCount();
+    } else if (interface == BATTERY && changed.contains(QStringLiteral("Percentage"))) {
+        const int battery = changed.value(QStringLiteral("Percentage")).toInt();
+        if (device.battery == battery) return;
+        device.battery = battery;
+        emit dataChanged(index(row), index(row), { BatteryRole });
+    }
+}
+
+QList<int> BluetoothDeviceModel::applyDevice(Device &device, const QVariantMap &properties)
+{
+    QList<int> roles;
+    const auto assign = [&roles](auto &field, const auto &value, int role) {
+        if (field == value) return;
+        field = value;
+        roles.append(role);
+    };
+
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        const QString &key = it.key();
+        const QVariant &value = it.value();
+
+        if (key == QLatin1String("Address")) {
+            assign(device.address, value.toString(), AddressRole);
+        } else if (key == QLatin1String("Alias")) {
+            // Alias falls back to Name and then the address inside BlueZ
+            assign(device.name, value.toString(), NameRole);
+        } else if (key == QLatin1String("Name") && !properties.contains(QStringLiteral("Alias")) && device.name.isEmpty()) {
+            assign(device.name, value.toString(), NameRole);
+        } else if (key == QLatin1String("Icon")) {
+            assign(device.icon, value.toString(), IconRole);
+        } else if (key == QLatin1String("Paired")) {
+            assign(device.paired, value.toBool(), PairedRole);
+        } else if (key == QLatin1String("Trusted")) {
+            assign(device.trusted, value.toBool(), TrustedRole);
+        } else if (key == QLatin1String("Connected")) {
+            assign(device.connected, value.toBool(), ConnectedRole);
+        } else if (key == QLatin1String("RSSI")) {
+            if (!device.hasRssi) {
+                device.hasRssi = true;
+                device.rssi = value.toInt();
+                roles.append(RssiRole);
+            } else {
+                assign(device.rssi, value.toInt(), RssiRole);
+            }
+        } else if (key == QLatin1String("Adapter")) {
+            device.adapter = value.value<QDBusObjectPath>().path();
+        }
+    }
+    return roles;
+}
+
+bool BluetoothDeviceModel::applyAdapter(const QString &path, const QVariantMap &properties)
+{
+    const bool known = m_adapters.contains(path);
+    const bool powered = properties.contains(QStringLiteral("Powered"))
+        ? properties.value(QStringLiteral("Powered")).toBool()
+        : m_adapters.value(path);
+
+    if (known && m_adapters.value(path) == powered) return false;
+    m_adapters.insert(path, powered);
+    return true;
+}
+
+int BluetoothDeviceModel::indexOf(const QString &path) const
+{
+    for (int i = 0; i < m_devices.size(); ++i) {
+        if (m_devices.at(i).path == path) return i;
+    }
+    return -1;
+}
+
+void BluetoothDeviceModel::updateConnectedCount()
+{
+    int connected = 0;
+    for (const Device &device : std::as_const(m_devices)) {
+        if (device.connected) ++connected;
+    }
+    if (m_connectedCount == connected) return;
+    m_connectedCount = connected;
+    emit connectedChanged();
+}
+
+const BluetoothDeviceModel::Device *BluetoothDeviceModel::firstConnected() const
+{
+    for (const Device &device : m_devices) {
+        if (device.connected) return &device;
+    }
+    return nullptr;
+}
+
+int BluetoothDeviceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_devices.size();
+}
+
+QVariant BluetoothDeviceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_devices.size()) return QVariant();
+    const Device &device = m_devices.at(index.row());
+
+    switch (role) {
+        case PathRole: return device.path;
+        case AddressRole: return device.address;
+        case Qt::DisplayRole:
+        case NameRole: return device.name;
+        case IconRole: return device.icon;
+        case PairedRole: return device.paired;
+        case TrustedRole: return device.trusted;
+        case ConnectedRole: return device.connected;
+        case RssiRole: return device.hasRssi ? QVariant(device.rssi) : QVariant();
+        case BatteryRole: return device.battery;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> BluetoothDeviceModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[PathRole] = "path";
+    roles[AddressRole] = "address";
+    roles[NameRole] = "name";
+    roles[IconRole] = "icon";
+    roles[PairedRole] = "paired";
+    roles[TrustedRole] = "trusted";
+    roles[ConnectedRole] = "connected";
+    roles[RssiRole] = "rssi";
+    roles[BatteryRole] = "battery";
+    return roles;
+}
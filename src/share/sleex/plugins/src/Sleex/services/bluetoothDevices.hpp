@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QDBusConnection>
+#include <QDBusObjectPath>
+#include <QMap>
+#include <QVariantMap>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+class QDBusMessage;
+class QDBusServiceWatcher;
+
+// BlueZ devices as a list model. One GetManagedObjects call fills it, then
+// the ObjectManager and PropertiesChanged signals keep it current, nothing
+// is polled. busAddress / service point it at a mock bus for testing.
+class BluetoothDeviceModel : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+
+    // Empty means the system bus
+    Q_PROPERTY(QString busAddress READ busAddress WRITE setBusAddress NOTIFY busChanged FINAL)
+    Q_PROPERTY(QString service    READ service    WRITE setService    NOTIFY busChanged FINAL)
+
+    Q_PROPERTY(bool    available   READ available   NOTIFY adapterChanged FINAL)
+    Q_PROPERTY(bool    powered     READ powered     NOTIFY adapterChanged FINAL)
+    Q_PROPERTY(QString adapterPath READ adapterPath NOTIFY adapterChanged FINAL)
+
+    Q_PROPERTY(int count          READ count          NOTIFY countChanged FINAL)
+    Q_PROPERTY(int connectedCount READ connectedCount NOTIFY connectedChanged FINAL)
+
+public:
+    using InterfaceMap = QMap<QString, QVariantMap>;
+    using ManagedObjects = QMap<QDBusObjectPath, InterfaceMap>;
+
+    enum Roles {
+        PathRole = Qt::UserRole + 1,
+        AddressRole,
+        NameRole,
+        IconRole,
+        PairedRole,
+        TrustedRole,
+        ConnectedRole,
+        RssiRole,
+        BatteryRole
+    };
+
+    struct Device {
+        QString path;
+        QString adapter;
+        QString address;
+        QString name;
+        QString icon;
+        bool    paired = false;
+        bool    trusted = false;
+        bool    connected = false;
+        // Only reported while the device is in range of a discovery
+        bool    hasRssi = false;
+        int     rssi = 0;
+        // Battery1 percentage, -1 when the device has no such interface
+        int     battery = -1;
+    };
+
+    explicit BluetoothDeviceModel(QObject *parent = nullptr);
+    ~BluetoothDeviceModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString busAddress() const { return m_busAddress; }
+    QString service()    const { return m_service; }
+    void setBusAddress(const QString &v);
+    void setService(const QString &v);
+
+    bool    available()   const { return !m_adapters.isEmpty(); }
+    bool    powered()     const { return m_adapters.value(adapterPath()); }
+    QString adapterPath() const { return m_adapters.isEmpty() ? QString() : m_adapters.firstKey(); }
+
+    int count()          const { return m_devices.size(); }
+    int connectedCount() const { return m_connectedCount; }
+
+    const QVector<Device> &devices() const { return m_devices; }
+    // First connected device, nullptr when none is
+    const Device *firstConnected() const;
+
+signals:
+    void busChanged();
+    void adapterChanged();
+    void countChanged();
+    void connectedChanged();
+
+private slots:
+    void onInterfacesAdded(const QDBusMessage &message);
+    void onInterfacesRemoved(const QDBusMessage &message);
+    void onPropertiesChanged(const QDBusMessage &message);
+
+private:
+    void attach();
+    void detach();
+    void fetchObjects();
+    void reset(const ManagedObjects &objects);
+    void clear();
+
+    void addObject(const QString &path, const InterfaceMap &interfaces);
+    QList<int> applyDevice(Device &device, const QVariantMap &properties);
+    bool applyAdapter(const QString &path, const QVariantMap &properties);
+    int indexOf(const QString &path) const;
+    void updateConnectedCount();
+
+    QString m_busAddress;
+    QString m_service = QStringLiteral("org.bluez");
+
+    QDBusConnection      m_bus;
+    QString              m_attachedService;
+    QDBusServiceWatcher *m_watcher = nullptr;
+    // Replies to a superseded GetManagedObjects are dropped
+    quint64              m_fetchGeneration = 0;
+
+    QVector<Device>       m_devices;
+    // Adapter path -> Powered, the first one is the default adapter
+    QMap<QString, bool>   m_adapters;
+    int                   m_connectedCount = 0;
+};
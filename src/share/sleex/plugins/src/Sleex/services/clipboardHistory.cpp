@@ -0,0 +1,672 @@
+#include "clipboardHistory.hpp"
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QProcess>
+#include <QQmlEngine>
+#include <QQuickImageProvider>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/file.h>
+
+namespace {
+const QString PROVIDER = QStringLiteral("cliphist");
+// cliphist keeps every entry in this bucket, keyed by its big endian id
+const QByteArray BUCKET = QByteArrayLiteral("b");
+// Same width `cliphist list` uses for text previews
+constexpr int PREVIEW_WIDTH = 100;
+
+constexpr quint32 BOLT_MAGIC = 0xED0CDAED;
+constexpr quint32 BOLT_VERSION = 2;
+constexpr qint64  PAGE_HEADER = 16;
+constexpr qint64  ELEMENT_SIZE = 16;
+constexpr qint64  META_CHECKSUM_OFFSET = 56;
+constexpr quint16 BRANCH_PAGE = 0x01;
+constexpr quint16 LEAF_PAGE = 0x02;
+constexpr quint32 BUCKET_LEAF = 0x01;
+constexpr int     MAX_DEPTH = 32;
+
+template<typename T>
+T readLe(const uchar *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+// Read-only view of a bbolt database: the newest valid meta page, then a
+// walk of the B+tree pages in the mapped file. Holds a shared flock while
+// alive, bolt writers take it exclusively, so nothing changes underneath.
+class BoltFile
+{
+public:
+    struct Leaf {
+        quint32 flags = 0;
+        QByteArrayView value;
+    };
+
+    explicit BoltFile(const QString &path)
+        : m_file(path)
+    {
+        if (!m_file.open(QIODevice::ReadOnly)) return;
+        if (flock(m_file.handle(), LOCK_SH | LOCK_NB) != 0) {
+            m_busy = errno == EWOULDBLOCK;
+            return;
+        }
+        m_size = m_file.size();
+        if (m_size < 2 * PAGE_HEADER) return;
+        m_data = m_file.map(0, m_size);
+        if (!m_data) return;
+
+        quint32 pageSize = 0, pageSize1 = 0;
+        quint64 root = 0, root1 = 0, txid = 0, txid1 = 0;
+        const bool meta0 = readMeta(0, pageSize, root, txid);
+        const bool meta1 = readMeta(meta0 ? pageSize : 4096, pageSize1, root1, txid1);
+        if (meta1 && (!meta0 || txid1 > txid)) {
+            pageSize = pageSize1;
+            root = root1;
+        } else if (!meta0) {
+            m_file.unmap(m_data);
+            m_data = nullptr;
+            return;
+        }
+        m_pageSize = pageSize;
+        m_root = root;
+    }
+
+    ~BoltFile()
+    {
+        if (m_data) m_file.unmap(m_data);
+        if (m_file.isOpen()) flock(m_file.handle(), LOCK_UN);
+    }
+
+    bool isOpen() const { return m_data != nullptr; }
+    bool isBusy() const { return m_busy; }
+
+    // fn(key, value) for every plain key of a top level bucket, in key
+    // order. A missing bucket is empty, false means the file is damaged.
+    template<typename Fn>
+    bool forEach(const QByteArray &bucketName, Fn fn) const
+    {
+        Node node;
+        if (!bucket(bucketName, node)) return true;
+        return walk(node, fn, 0);
+    }
+
+    QByteArray value(const QByteArray &bucketName, const QByteArray &key) const
+    {
+        Node node;
+        Leaf leaf;
+        if (!bucket(bucketName, node) || !find(node, key, leaf, 0) || (leaf.flags & BUCKET_LEAF)) return QByteArray();
+        return leaf.value.toByteArray();
+    }
+
+private:
+    struct Node {
+        const uchar *page = nullptr;
+        qint64 size = 0;
+    };
+
+    bool readMeta(qint64 offset, quint32 &pageSize, quint64 &root, quint64 &txid) const
+    {
+        if (offset + PAGE_HEADER + META_CHECKSUM_OFFSET + 8 > m_size) return false;
+        const uchar *meta = m_data + offset + PAGE_HEADER;
+        if (readLe<quint32>(meta) != BOLT_MAGIC || readLe<quint32>(meta + 4) != BOLT_VERSION) return false;
+
+        // FNV-1a over everything before the checksum, like bolt's meta.sum64()
+        quint64 hash = 14695981039346656037ull;
+        for (qint64 i = 0; i < META_CHECKSUM_OFFSET; ++i) {
+            hash ^= meta[i];
+            hash *= 1099511628211ull;
+        }
+        if (hash != readLe<quint64>(meta + META_CHECKSUM_OFFSET)) return false;
+
+        pageSize = readLe<quint32>(meta + 8);
+        root = readLe<quint64>(meta + 16);
+        txid = readLe<quint64>(meta + 48);
+        return pageSize >= 512;
+    }
+
+    Node page(quint64 id) const
+    {
+        // Pages 0 and 1 are the meta pages, never part of a tree
+        if (id < 2 || id > quint64(m_size / m_pageSize)) return {};
+        const qint64 offset = qint64(id) * m_pageSize;
+        if (offset + PAGE_HEADER > m_size) return {};
+        const qint64 span = (qint64(readLe<quint32>(m_data + offset + 12)) + 1) * m_pageSize;
+        return { m_data + offset, std::min(span, m_size - offset) };
+    }
+
+    bool bucket(const QByteArray &name, Node &node) const
+    {
+        Leaf leaf;
+        if (!find(page(m_root), name, leaf, 0) || !(leaf.flags & BUCKET_LEAF) || leaf.value.size() < 16) return false;
+        const uchar *header = reinterpret_cast<const uchar *>(leaf.value.data());
+        const quint64 root = readLe<quint64>(header);
+        // Small buckets are stored inline, their only page follows the header
+        node = root ? page(root) : Node { header + 16, leaf.value.size() - 16 };
+        return node.page != nullptr;
+    }
+
+    // Element table of a page, nullptr when it does not fit the page
+    const uchar *elements(const Node &node, quint16 &flags, quint16 &count) const
+    {
+        if (!node.page || node.size < PAGE_HEADER) return nullptr;
+        flags = readLe<quint16>(node.page + 8);
+        count = readLe<quint16>(node.page + 10);
+        if (PAGE_HEADER + count * ELEMENT_SIZE > node.size) return nullptr;
+        return node.page + PAGE_HEADER;
+    }
+
+    bool leafAt(const Node &node, const uchar *element, QByteArrayView &key, Leaf &leaf) const
+    {
+        const qint64 start = (element - node.page) + readLe<quint32>(element + 4);
+        const quint32 keySize = readLe<quint32>(element + 8);
+        const quint32 valueSize = readLe<quint32>(element + 12);
+        if (start + keySize + valueSize > node.size) return false;
+        const char *data = reinterpret_cast<const char *>(node.page + start);
+        key = QByteArrayView(data, keySize);
+        leaf.flags = readLe<quint32>(element);
+        leaf.value = QByteArrayView(data + keySize, valueSize);
+        return true;
+    }
+
+    bool branchKeyAt(const Node &node, const uchar *element, QByteArrayView &key) const
+    {
+        const qint64 start = (element - node.page) + readLe<quint32>(element);
+        const quint32 keySize = readLe<quint32>(element + 4);
+        if (start + keySize > node.size) return false;
+        key = QByteArrayView(reinterpret_cast<const char *>(node.page + start), keySize);
+        return true;
+    }
+
+    bool find(const Node &node, QByteArrayView key, Leaf &leaf, int depth) const
+    {
+        quint16 flags = 0, count = 0;
+        const uchar *table = elements(node, flags, count);
+        if (!table || count == 0 || depth > MAX_DEPTH) return false;
+
+        if (flags & BRANCH_PAGE) {
+            // The child under the last separator not above the key
+            int chosen = 0;
+            for (int i = 1; i < count; ++i) {
+                QByteArrayView separator;
+                if (!branchKeyAt(node, table + i * ELEMENT_SIZE, separator)) return false;
+                if (key < separator) break;
+                chosen = i;
+            }
+            return find(page(readLe<quint64>(table + chosen * ELEMENT_SIZE + 8)), key, leaf, depth + 1);
+        }
+        if (!(flags & LEAF_PAGE)) return false;
+
+        for (int i = 0; i < count; ++i) {
+            QByteArrayView elementKey;
+            if (!leafAt(node, table + i * ELEMENT_SIZE, elementKey, leaf)) return false;
+            if (elementKey == key) return true;
+        }
+        return false;
+    }
+
+    template<typename Fn>
+    bool walk(const Node &node, Fn &fn, int depth) const
+    {
+        quint16 flags = 0, count = 0;
+        const uchar *table = elements(node, flags, count);
+        if (!table || depth > MAX_DEPTH) return false;
+
+        for (int i = 0; i < count; ++i) {
+            const uchar *element = table + i * ELEMENT_SIZE;
+            if (flags & BRANCH_PAGE) {
+                if (!walk(page(readLe<quint64>(element + 8)), fn, depth + 1)) return false;
+            } else if (flags & LEAF_PAGE) {
+                QByteArrayView key;
+                Leaf leaf;
+                if (!leafAt(node, element, key, leaf)) return false;
+                if (!(leaf.flags & BUCKET_LEAF)) fn(key, leaf.value);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    QFile        m_file;
+    uchar       *m_data = nullptr;
+    qint64       m_size = 0;
+    qint64       m_pageSize = 4096;
+    quint64      m_root = 0;
+    bool         m_busy = false;
+};
+
+QByteArray keyFor(quint64 id)
+{
+    uchar key[8];
+    qToBigEndian<quint64>(id, key);
+    return QByteArray(reinterpret_cast<const char *>(key), 8);
+}
+
+quint64 idOf(const QString &line, bool *ok)
+{
+    return line.section(QLatin1Char('\t'), 0, 0).trimmed().toULongLong(ok);
+}
+
+QString sizeString(qint64 size)
+{
+    static const char *units[] = { "B", "KiB", "MiB" };
+    double value = size;
+    int unit = 0;
+    while (value >= 1024 && unit < 2) {
+        value /= 1024;
+        ++unit;
+    }
+    return QStringLiteral("%1 %2").arg(qRound(value)).arg(QLatin1String(units[unit]));
+}
+
+// The line `cliphist list` would print for this entry
+ClipboardHistory::Entry makeEntry(quint64 id, QByteArrayView value)
+{
+    ClipboardHistory::Entry entry;
+    entry.id = id;
+
+    const QByteArray bytes = QByteArray::fromRawData(value.data(), value.size());
+    QBuffer buffer;
+    buffer.setData(bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    // Only formats with a real signature, a lenient reader would take text for an image
+    static const QList<QByteArray> formats = { "png", "jpeg", "gif", "webp", "bmp" };
+    const QByteArray format = QImageReader::imageFormat(&buffer);
+    QString preview;
+    if (formats.contains(format)) {
+        buffer.seek(0);
+        QImageReader reader(&buffer, format);
+        const QSize size = reader.size();
+        entry.image = true;
+        preview = QStringLiteral("[[ binary data %1 %2 %3x%4 ]]")
+            .arg(sizeString(value.size()), QString::fromLatin1(format))
+            .arg(size.width()).arg(size.height());
+    } else {
+        preview = QString::fromUtf8(value).simplified();
+        if (preview.size() > PREVIEW_WIDTH) preview = preview.left(PREVIEW_WIDTH - 1) + QChar(0x2026);
+    }
+    entry.folded = preview.toLower();
+    entry.line = QString::number(id) + QLatin1Char('\t') + preview;
+    return entry;
+}
+
+bool isSubsequence(const QString &needle, const QString &haystack)
+{
+    int j = 0;
+    for (int i = 0; i < haystack.size() && j < needle.size(); ++i) {
+        if (haystack.at(i) == needle.at(j)) ++j;
+    }
+    return j == needle.size();
+}
+
+QString defaultDbPath()
+{
+    const QString env = qEnvironmentVariable("CLIPHIST_DB_PATH");
+    if (!env.isEmpty()) return env;
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/cliphist/db");
+}
+
+// image://cliphist/<id>/<percent encoded database path>, decoded on the
+// image loader thread at the size the view asked for
+class ClipboardImageProvider : public QQuickImageProvider
+{
+public:
+    ClipboardImageProvider()
+        : QQuickImageProvider(QQuickImageProvider::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading)
+    {}
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override
+    {
+        const qsizetype slash = id.indexOf(QLatin1Char('/'));
+        bool ok = false;
+        const quint64 entryId = id.left(slash).toULongLong(&ok);
+        if (!ok || slash < 0) return QImage();
+        const QString path = QUrl::fromPercentEncoding(id.mid(slash + 1).toUtf8());
+
+        QByteArray bytes;
+        // Writers hold the lock for a few milliseconds
+        for (int attempt = 0; attempt < 10; ++attempt) {
+            BoltFile db(path);
+            if (db.isOpen()) {
+                bytes = db.value(BUCKET, keyFor(entryId));
+                break;
+            }
+            if (!db.isBusy()) break;
+            QThread::msleep(20);
+        }
+
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        const QSize original = reader.size();
+        if (size) *size = original;
+
+        if (original.isValid() && (requestedSize.width() > 0 || requestedSize.height() > 0)) {
+            const QSize bound(requestedSize.width() > 0 ? requestedSize.width() : INT_MAX,
+                              requestedSize.height() > 0 ? requestedSize.height() : INT_MAX);
+            if (original.width() > bound.width() || original.height() > bound.height())
+                reader.setScaledSize(original.scaled(bound, Qt::KeepAspectRatio));
+        }
+        return reader.read();
+    }
+};
+}
+
+ClipboardHistory::ClipboardHistory(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_dbPath(defaultDbPath())
+{
+    m_pool.setMaxThreadCount(1);
+    m_refreshTimer.setSingleShot(true);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &ClipboardHistory::refresh);
+
+    // bolt writes in place, a replaced or newly created file shows up in the directory
+    const auto rewatch = [this]() {
+        if (!m_watcher.files().contains(m_dbPath) && QFile::exists(m_dbPath)) m_watcher.addPath(m_dbPath);
+        scheduleRefresh();
+    };
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, rewatch);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, rewatch);
+
+    const auto bump = [this]() {
+        ++m_revision;
+        emit revisionChanged();
+    };
+    connect(this, &QAbstractItemModel::rowsInserted, this, bump);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, bump);
+    connect(this, &QAbstractItemModel::modelReset, this, bump);
+}
+
+ClipboardHistory::~ClipboardHistory()
+{
+    // A cliphist still running is killed with its QProcess, after our members are gone
+    for (QProcess *process : findChildren<QProcess *>(Qt::FindDirectChildrenOnly)) process->disconnect(this);
+    ++m_generation;
+    m_pool.waitForDone();
+}
+
+void ClipboardHistory::componentComplete()
+{
+    m_complete = true;
+    QQmlEngine *engine = qmlEngine(this);
+    if (engine && !engine->imageProvider(PROVIDER)) engine->addImageProvider(PROVIDER, new ClipboardImageProvider);
+    watch();
+    refresh();
+}
+
+void ClipboardHistory::setDbPath(const QString &v)
+{
+    const QString path = v.isEmpty() ? defaultDbPath() : v;
+    if (m_dbPath == path) return;
+    m_dbPath = path;
+    ++m_generation;
+    if (!m_entries.isEmpty()) {
+        beginResetModel();
+        m_entries.clear();
+        m_ids.clear();
+        endResetModel();
+        emit countChanged();
+    }
+    emit dbPathChanged();
+    if (m_complete) {
+        watch();
+        refresh();
+    }
+}
+
+void ClipboardHistory::setBinary(const QString &v)
+{
+    if (m_binary == v) return;
+    m_binary = v;
+    emit binaryChanged();
+}
+
+void ClipboardHistory::watch()
+{
+    if (!m_watcher.files().isEmpty()) m_watcher.removePaths(m_watcher.files());
+    if (!m_watcher.directories().isEmpty()) m_watcher.removePaths(m_watcher.directories());
+
+    const QFileInfo info(m_dbPath);
+    if (info.dir().exists()) m_watcher.addPath(info.absolutePath());
+    if (info.exists()) m_watcher.addPath(m_dbPath);
+}
+
+void ClipboardHistory::scheduleRefresh(int delay)
+{
+    m_refreshTimer.start(delay);
+}
+
+void ClipboardHistory::refresh()
+{
+    if (!m_complete) return;
+    if (m_reading) {
+        m_readQueued = true;
+        return;
+    }
+    m_reading = true;
+
+    const quint64 generation = ++m_generation;
+    const QString path = m_dbPath;
+    const QVector<quint64> known = m_ids;
+    m_pool.start([this, generation, path, known]() {
+        const Snapshot snapshot = read(path, known);
+        QMetaObject::invokeMethod(this, [this, generation, snapshot]() {
+            m_reading = false;
+            if (generation == m_generation) apply(snapshot);
+            if (m_readQueued) {
+                m_readQueued = false;
+                refresh();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+ClipboardHistory::Snapshot ClipboardHistory::read(const QString &path, const QVector<quint64> &known)
+{
+    Snapshot snapshot;
+    BoltFile db(path);
+    if (!db.isOpen()) {
+        snapshot.busy = db.isBusy();
+        return snapshot;
+    }
+
+    snapshot.ok = db.forEach(BUCKET, [&](QByteArrayView key, QByteArrayView value) {
+        if (key.size() != 8) return;
+        const quint64 id = qFromBigEndian<quint64>(key.data());
+        snapshot.ids.append(id);
+        // Known entries cost a binary search, only new ones are decoded
+        if (!std::binary_search(known.cbegin(), known.cend(), id)) snapshot.added.append(makeEntry(id, value));
+    });
+    if (!snapshot.ok) qWarning() << "Sleex: cliphist database is damaged:" << path;
+    return snapshot;
+}
+
+void ClipboardHistory::apply(const Snapshot &snapshot)
+{
+    if (!snapshot.ok && snapshot.busy) {
+        scheduleRefresh(100);
+        return;
+    }
+    if (m_available != snapshot.ok) {
+        m_available = snapshot.ok;
+        emit availableChanged();
+    }
+    // The result may predate a wipe that is still running
+    if (m_wiping) return;
+
+    const int before = m_entries.size();
+
+    // Every known id still present accounts for one id of the snapshot
+    if (snapshot.ids.size() - snapshot.added.size() != m_ids.size()) {
+        for (int i = m_ids.size() - 1; i >= 0; --i) {
+            if (std::binary_search(snapshot.ids.cbegin(), snapshot.ids.cend(), m_ids.at(i))) continue;
+            const int row = m_ids.size() - 1 - i;
+            beginRemoveRows(QModelIndex(), row, row);
+            m_ids.removeAt(i);
+            m_entries.removeAt(i);
+            endRemoveRows();
+        }
+    }
+
+    QVector<Entry> added;
+    added.reserve(snapshot.added.size());
+    for (const Entry &entry : snapshot.added) {
+        if (!m_pendingDeletes.contains(entry.id) && indexOfId(entry.id) < 0) added.append(entry);
+    }
+
+    if (!added.isEmpty() && (m_ids.isEmpty() || added.first().id > m_ids.last())) {
+        // New copies, they go on top
+        beginInsertRows(QModelIndex(), 0, added.size() - 1);
+        for (const Entry &entry : std::as_const(added)) {
+            m_ids.append(entry.id);
+            m_entries.append(entry);
+        }
+        endInsertRows();
+    } else if (!added.isEmpty()) {
+        // Older ids reappearing means the database was swapped out
+        beginResetModel();
+        m_entries += added;
+        std::sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) { return a.id < b.id; });
+        m_ids.clear();
+        for (const Entry &entry : std::as_const(m_entries)) m_ids.append(entry.id);
+        endResetModel();
+    }
+
+    if (m_entries.size() != before) emit countChanged();
+}
+
+int ClipboardHistory::indexOfId(quint64 id) const
+{
+    const auto it = std::lower_bound(m_ids.cbegin(), m_ids.cend(), id);
+    return it != m_ids.cend() && *it == id ? int(it - m_ids.cbegin()) : -1;
+}
+
+void ClipboardHistory::runCliphist(const QStringList &arguments, const QByteArray &input, const std::function<void()> &finished)
+{
+    auto *process = new QProcess(this);
+    const auto done = [this, process, finished]() {
+        finished();
+        process->deleteLater();
+        scheduleRefresh();
+    };
+    connect(process, &QProcess::finished, this, done);
+    connect(process, &QProcess::errorOccurred, this, [this, arguments, done](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        qWarning() << "Sleex: cannot run" << m_binary << arguments;
+        done();
+    });
+
+    process->start(m_binary, arguments);
+    if (!input.isEmpty()) process->write(input);
+    process->closeWriteChannel();
+}
+
+void ClipboardHistory::remove(const QString &line)
+{
+    bool ok = false;
+    const quint64 id = idOf(line, &ok);
+    if (!ok) return;
+
+    // cliphist delete takes list lines on stdin
+    QByteArray input = QByteArray::number(id) + '\t';
+    const int i = indexOfId(id);
+    if (i >= 0) {
+        input = m_entries.at(i).line.toUtf8();
+        const int row = m_entries.size() - 1 - i;
+        beginRemoveRows(QModelIndex(), row, row);
+        m_ids.removeAt(i);
+        m_entries.removeAt(i);
+        endRemoveRows();
+        emit countChanged();
+    }
+
+    m_pendingDeletes.insert(id);
+    runCliphist({ QStringLiteral("delete") }, input + '\n', [this, id]() { m_pendingDeletes.remove(id); });
+}
+
+void ClipboardHistory::wipe()
+{
+    if (!m_entries.isEmpty()) {
+        beginResetModel();
+        m_entries.clear();
+        m_ids.clear();
+        endResetModel();
+        emit countChanged();
+    }
+
+    m_wiping = true;
+    runCliphist({ QStringLiteral("wipe") }, QByteArray(), [this]() { m_wiping = false; });
+}
+
+QStringList ClipboardHistory::lines(int limit, bool imagesOnly) const
+{
+    QStringList result;
+    result.reserve(limit < 0 ? m_entries.size() : qMin(limit, int(m_entries.size())));
+    for (int i = m_entries.size() - 1; i >= 0 && (limit < 0 || result.size() < limit); --i) {
+        if (imagesOnly && !m_entries.at(i).image) continue;
+        result.append(m_entries.at(i).line);
+    }
+    return result;
+}
+
+QStringList ClipboardHistory::search(const QString &query) const
+{
+    const QString needle = query.trimmed().toLower();
+    if (needle.isEmpty()) return lines();
+
+    QStringList contained, scattered;
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        const Entry &entry = m_entries.at(i);
+        if (entry.folded.contains(needle)) contained.append(entry.line);
+        else if (isSubsequence(needle, entry.folded)) scattered.append(entry.line);
+    }
+    return contained + scattered;
+}
+
+QString ClipboardHistory::imageSource(const QString &line) const
+{
+    bool ok = false;
+    const quint64 id = idOf(line, &ok);
+    if (!ok) return QString();
+    return QStringLiteral("image://%1/%2/%3").arg(PROVIDER).arg(id).arg(QString::fromLatin1(QUrl::toPercentEncoding(m_dbPath)));
+}
+
+int ClipboardHistory::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.size();
+}
+
+QVariant ClipboardHistory::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.size()) return QVariant();
+    const Entry &entry = m_entries.at(m_entries.size() - 1 - index.row());
+
+    switch (role) {
+        case IdRole: return entry.id;
+        case Qt::DisplayRole:
+        case LineRole: return entry.line;
+        case PreviewRole: return entry.line.section(QLatin1Char('\t'), 1);
+        case IsImageRole: return entry.image;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> ClipboardHistory::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[IdRole] = "entryId";
+    roles[LineRole] = "line";
+    roles[PreviewRole] = "preview";
+    roles[IsImageRole] = "isImage";
+    return roles;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QFileSystemWatcher>
+#include <QQmlParserStatus>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+#include <functional>
+
+// cliphist history read straight from its bbolt database, newest first.
+// The database file is watched: a change walks the key list on a worker
+// and only entries that are new get a preview built, they are inserted at
+// the top without touching the other rows. Images are decoded when a view
+// asks for them, through the "cliphist" image provider (see imageSource()).
+// Writes still go through the cliphist binary, the database is never
+// modified here.
+class ClipboardHistory : public QAbstractListModel, public QQmlParserStatus {
+    Q_OBJECT
+    QML_ELEMENT
+    Q_INTERFACES(QQmlParserStatus)
+
+    // Defaults to $CLIPHIST_DB_PATH, then ~/.cache/cliphist/db
+    Q_PROPERTY(QString dbPath READ dbPath WRITE setDbPath NOTIFY dbPathChanged FINAL)
+    Q_PROPERTY(QString binary READ binary WRITE setBinary NOTIFY binaryChanged FINAL)
+
+    Q_PROPERTY(bool available READ available NOTIFY availableChanged FINAL)
+    Q_PROPERTY(int  count     READ count     NOTIFY countChanged FINAL)
+    // Bumped on any change of the entries, also those keeping count the same
+    // (a copy once the history is full, a copy moving an entry to the top)
+    Q_PROPERTY(int  revision  READ revision  NOTIFY revisionChanged FINAL)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        LineRole,
+        PreviewRole,
+        IsImageRole
+    };
+
+    struct Entry {
+        quint64 id = 0;
+        // "id\tpreview", the same line `cliphist list` prints
+        QString line;
+        // Lowercased preview, for search()
+        QString folded;
+        bool    image = false;
+    };
+
+    explicit ClipboardHistory(QObject *parent = nullptr);
+    ~ClipboardHistory() override;
+
+    void classBegin() override {}
+    void componentComplete() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString dbPath() const { return m_dbPath; }
+    QString binary() const { return m_binary; }
+    void setDbPath(const QString &v);
+    void setBinary(const QString &v);
+
+    bool available() const { return m_available; }
+    int  count()     const { return m_entries.size(); }
+    int  revision()  const { return m_revision; }
+
+    // Newest first, optionally only images, limit < 0 returns all of them
+    Q_INVOKABLE QStringList lines(int limit = -1, bool imagesOnly = false) const;
+    // Lines whose preview contains the query, then those matching it as a
+    // subsequence, both in history order
+    Q_INVOKABLE QStringList search(const QString &query) const;
+    // Accepts a cliphist line or a bare id
+    Q_INVOKABLE void remove(const QString &line);
+    Q_INVOKABLE void wipe();
+    Q_INVOKABLE void refresh();
+    Q_INVOKABLE QString imageSource(const QString &line) const;
+
+signals:
+    void dbPathChanged();
+    void binaryChanged();
+    void availableChanged();
+    void countChanged();
+    void revisionChanged();
+
+private:
+    struct Snapshot {
+        bool ok = false;
+        // The database was locked by a writer, try again shortly
+        bool busy = false;
+        // Every id in the database, ascending
+        QVector<quint64> ids;
+        // Entries for ids that were not known yet, ascending
+        QVector<Entry> added;
+    };
+
+    static Snapshot read(const QString &path, const QVector<quint64> &known);
+    void apply(const Snapshot &snapshot);
+    void scheduleRefresh(int delay = 30);
+    void watch();
+    void runCliphist(const QStringList &arguments, const QByteArray &input, const std::function<void()> &finished);
+    int indexOfId(quint64 id) const;
+
+    QString m_dbPath;
+    QString m_binary = QStringLiteral("cliphist");
+    bool    m_available = false;
+    int     m_revision = 0;
+    bool    m_complete = false;
+    // Reads finishing before cliphist wipe does would bring the entries back
+    bool    m_wiping = false;
+
+    QFileSystemWatcher m_watcher;
+    QTimer      m_refreshTimer;
+    QThreadPool m_pool;
+    quint64     m_generation = 0;
+    bool        m_reading = false;
+    bool        m_readQueued = false;
+
+    // Oldest first, row r is m_entries[count() - 1 - r] so new entries append
+    QVector<Entry>   m_entries;
+    // Same order as m_entries, handed to the worker as the known set
+    QVector<quint64> m_ids;
+    // Removed here while cliphist delete is still running
+    QSet<quint64>    m_pendingDeletes;
+};
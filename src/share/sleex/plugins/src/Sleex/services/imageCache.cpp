@@ -0,0 +1,320 @@
+#include "imageCache.hpp"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QQuickImageProvider>
+#include <QThread>
+#include <QUrl>
+#include <cmath>
+
+namespace {
+const QString PROVIDER = QStringLiteral("sleex-cache");
+const QString SCHEME = QStringLiteral("image://");
+
+constexpr int DEFAULT_MAX_SIZE = 48 * 1024 * 1024;
+
+// Smallest size that still covers the requested box, never larger than the
+// image. Covering rather than fitting keeps cropped views (the usual
+// PreserveAspectCrop avatar and cover art) sharp.
+QSize coverSize(const QSize &original, const QSize &requested)
+{
+    if (!original.isValid() || original.isEmpty()) return original;
+    const bool width = requested.width() > 0;
+    const bool height = requested.height() > 0;
+    if (!width && !height) return original;
+
+    const double sx = width ? double(requested.width()) / original.width() : 0.0;
+    const double sy = height ? double(requested.height()) / original.height() : 0.0;
+    const double scale = width && height ? qMax(sx, sy) : (width ? sx : sy);
+    if (scale >= 1.0) return original;
+    return QSize(qMax(1, int(std::lround(original.width() * scale))),
+                 qMax(1, int(std::lround(original.height() * scale))));
+}
+
+// "image://host/id" split into the provider id and the rest
+bool splitProviderUrl(const QString &source, QString &host, QString &id)
+{
+    if (!source.startsWith(SCHEME)) return false;
+    const qsizetype slash = source.indexOf(QLatin1Char('/'), SCHEME.size());
+    if (slash < 0) return false;
+    host = source.mid(SCHEME.size(), slash - SCHEME.size()).toLower();
+    id = source.mid(slash + 1);
+    return true;
+}
+
+QString localPath(const QString &source)
+{
+    return source.startsWith(QStringLiteral("file:")) ? QUrl(source).toLocalFile() : source;
+}
+
+QQuickImageProvider *imageProvider(QQmlEngine *engine, const QString &host)
+{
+    if (!engine || host == PROVIDER) return nullptr;
+    auto *provider = dynamic_cast<QQuickImageProvider *>(engine->imageProvider(host));
+    // Pixmaps and textures are GUI thread things, those stay with their provider
+    return provider && provider->imageType() == QQmlImageProviderBase::Image ? provider : nullptr;
+}
+}
+
+class ImageCacheResponse : public QQuickImageResponse
+{
+public:
+    ~ImageCacheResponse() override
+    {
+        ImageCache::instance()->forget(this);
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    QString errorString() const override { return m_error; }
+
+    void cancel() override
+    {
+        ImageCache::instance()->forget(this);
+        done(QImage(), QStringLiteral("Cancelled"));
+    }
+
+    // From any thread, finished() goes out on the response's own
+    void deliver(const QImage &image)
+    {
+        QMetaObject::invokeMethod(this, [this, image]() {
+            done(image, image.isNull() ? QStringLiteral("Cannot decode image") : QString());
+        }, Qt::QueuedConnection);
+    }
+
+private:
+    void done(const QImage &image, const QString &error)
+    {
+        // A decode posted just before a cancel must not finish twice
+        if (m_done) return;
+        m_done = true;
+        m_image = image;
+        m_error = error;
+        emit finished();
+    }
+
+    QImage  m_image;
+    QString m_error;
+    bool    m_done = false;
+};
+
+namespace {
+class ImageCacheProvider : public QQuickAsyncImageProvider
+{
+public:
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override
+    {
+        return ImageCache::instance()->request(QUrl::fromPercentEncoding(id.toUtf8()), requestedSize);
+    }
+};
+}
+
+ImageCache *ImageCache::instance()
+{
+    static ImageCache *cache = new ImageCache();
+    return cache;
+}
+
+ImageCache *ImageCache::create(QQmlEngine *engine, QJSEngine *)
+{
+    ImageCache *cache = instance();
+    QJSEngine::setObjectOwnership(cache, QJSEngine::CppOwnership);
+    if (engine) {
+        // url() is the only way in, so the provider is there before its first request
+        if (!engine->imageProvider(PROVIDER)) engine->addImageProvider(PROVIDER, new ImageCacheProvider);
+        QMutexLocker locker(&cache->m_mutex);
+        if (!cache->m_engine) cache->m_engine = engine;
+    }
+    return cache;
+}
+
+ImageCache::ImageCache(QObject *parent)
+    : QObject(parent)
+{
+    m_cache.setMaxCost(DEFAULT_MAX_SIZE);
+    // Decoding is memory hungry, a few workers are plenty for a desktop
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+}
+
+ImageCache::~ImageCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QString ImageCache::url(const QString &source) const
+{
+    if (source.isEmpty()) return source;
+
+    QString host, id;
+    if (splitProviderUrl(source, host, id)) {
+        if (host == PROVIDER) return source;
+        QMutexLocker locker(&m_mutex);
+        if (!imageProvider(m_engine, host)) return source;
+    } else if (!source.startsWith(QLatin1Char('/')) && !source.startsWith(QStringLiteral("file:"))) {
+        // Remote and data URLs, Image loads them itself
+        return source;
+    }
+    return SCHEME + PROVIDER + QLatin1Char('/') + QString::fromLatin1(QUrl::toPercentEncoding(source));
+}
+
+ImageCacheResponse *ImageCache::request(const QString &source, const QSize &requestedSize)
+{
+    QString key = QStringLiteral("%1x%2 %3").arg(requestedSize.width()).arg(requestedSize.height()).arg(source);
+    if (!source.startsWith(SCHEME)) {
+        // A file rewritten in place (a fixed cover path, a screenshot) is another image
+        const QFileInfo info(localPath(source));
+        key += QStringLiteral(" %1 %2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+    }
+    auto *response = new ImageCacheResponse;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QImage *cached = m_cache.object(key)) {
+            ++m_hits;
+            response->deliver(*cached);
+        } else {
+            ++m_misses;
+            QVector<ImageCacheResponse *> &waiting = m_waiting[key];
+            waiting.append(response);
+            // The first one starts the decode, later ones wait for the same result
+            if (waiting.size() == 1) {
+                m_pool.start([this, key, source, requestedSize]() {
+                    {
+                        QMutexLocker locker(&m_mutex);
+                        if (m_waiting.value(key).isEmpty()) {
+                            m_waiting.remove(key);
+                            return;
+                        }
+                    }
+                    finish(key, decode(source, requestedSize));
+                });
+            }
+        }
+    }
+    changed();
+    return response;
+}
+
+void ImageCache::forget(ImageCacheResponse *response)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_waiting.begin(); it != m_waiting.end(); ++it) {
+        // Left empty, the queued decode sees nobody waits and skips
+        if (it->removeOne(response)) break;
+    }
+}
+
+QImage ImageCache::decode(const QString &source, const QSize &requestedSize) const
+{
+    QImage image;
+    QString host, id;
+    if (splitProviderUrl(source, host, id)) {
+        QQuickImageProvider *provider = nullptr;
+        {
+            QMutexLocker locker(&m_mutex);
+            provider = imageProvider(m_engine, host);
+        }
+        if (!provider) return image;
+        QSize size;
+        image = provider->requestImage(id, &size, requestedSize);
+    } else {
+        QImageReader reader(localPath(source));
+        reader.setAutoTransform(true);
+        const bool rotated = reader.transformation() & QImageIOHandler::TransformationRotate90;
+        QSize original = reader.size();
+        if (rotated) original.transpose();
+        // Let the decoder downscale instead of decoding full size first
+        QSize scaled = coverSize(original, requestedSize);
+        if (scaled.isValid() && scaled != original) {
+            if (rotated) scaled.transpose();
+            reader.setScaledSize(scaled);
+        }
+        image = reader.read();
+    }
+
+    // Providers and formats that ignored the size
+    const QSize scaled = coverSize(image.size(), requestedSize);
+    if (!image.isNull() && scaled != image.size())
+        image = image.scaled(scaled, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+void ImageCache::finish(const QString &key, const QImage &image)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        // Delivered under the lock, a response cannot be deleted halfway through
+        for (ImageCacheResponse *response : m_waiting.take(key)) response->deliver(image);
+        // Too large for the whole cache, QCache drops it right away
+        if (!image.isNull()) m_cache.insert(key, new QImage(image), image.sizeInBytes());
+    }
+    changed();
+}
+
+void ImageCache::changed()
+{
+    QMetaObject::invokeMethod(this, &ImageCache::statsChanged, Qt::QueuedConnection);
+}
+
+void ImageCache::clear()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cache.clear();
+        m_hits = 0;
+        m_misses = 0;
+    }
+    emit statsChanged();
+}
+
+int ImageCache::maxSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_cache.maxCost());
+}
+
+void ImageCache::setMaxSize(int v)
+{
+    v = qMax(v, 0);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_cache.maxCost() == v) return;
+        m_cache.setMaxCost(v);
+    }
+    emit maxSizeChanged();
+    emit statsChanged();
+}
+
+int ImageCache::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_cache.totalCost());
+}
+
+int ImageCache::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_cache.count());
+}
+
+int ImageCache::hits() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int ImageCache::misses() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+int ImageCache::inFlight() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_waiting.size());
+}
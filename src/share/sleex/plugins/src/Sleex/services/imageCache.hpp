@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QThreadPool>
+#include <QVector>
+
+class ImageCacheResponse;
+
+// Decoded images shared by every view, behind the "sleex-cache" image
+// provider: url() wraps a local file or an image provider URL, the Image
+// showing it sets sourceSize as usual. Decoding and downscaling happen on
+// a small pool, each source and size once however many delegates ask at
+// the same time, and the results stay in an LRU cache bounded in bytes.
+class ImageCache : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+    // Bytes of decoded pixels kept around, least recently used go first
+    Q_PROPERTY(int maxSize READ maxSize WRITE setMaxSize NOTIFY maxSizeChanged FINAL)
+    Q_PROPERTY(int size     READ size     NOTIFY statsChanged FINAL)
+    Q_PROPERTY(int count    READ count    NOTIFY statsChanged FINAL)
+    Q_PROPERTY(int hits     READ hits     NOTIFY statsChanged FINAL)
+    Q_PROPERTY(int misses   READ misses   NOTIFY statsChanged FINAL)
+    // Decodes running or queued
+    Q_PROPERTY(int inFlight READ inFlight NOTIFY statsChanged FINAL)
+
+public:
+    static ImageCache *instance();
+    static ImageCache *create(QQmlEngine *engine, QJSEngine *);
+
+    ~ImageCache() override;
+
+    // image://sleex-cache/... for sources it can decode, anything else
+    // (remote URLs, pixmap and texture providers) is handed back unchanged
+    Q_INVOKABLE QString url(const QString &source) const;
+    Q_INVOKABLE void clear();
+
+    int maxSize() const;
+    void setMaxSize(int v);
+    int size() const;
+    int count() const;
+    int hits() const;
+    int misses() const;
+    int inFlight() const;
+
+    // For the image provider, from its loader thread
+    ImageCacheResponse *request(const QString &source, const QSize &requestedSize);
+    // The response is cancelled or gone, it must not be answered anymore
+    void forget(ImageCacheResponse *response);
+
+signals:
+    void maxSizeChanged();
+    void statsChanged();
+
+private:
+    explicit ImageCache(QObject *parent = nullptr);
+
+    QImage decode(const QString &source, const QSize &requestedSize) const;
+    void finish(const QString &key, const QImage &image);
+    void changed();
+
+    mutable QMutex m_mutex;
+    QCache<QString, QImage> m_cache;
+    // Responses waiting per key, the first one started the decode
+    QHash<QString, QVector<ImageCacheResponse *>> m_waiting;
+    int m_hits = 0;
+    int m_misses = 0;
+
+    QThreadPool m_pool;
+    // Other image providers are decoded through, when they hand out QImages
+    QPointer<QQmlEngine> m_engine;
+};
@@ -0,0 +1,542 @@
+#include "notificationStore.hpp"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Appends are batched, a burst of notifications is one write
+constexpr int FLUSH_DELAY_MS = 500;
+// Dead lines tolerated beyond the live ones before the log is rewritten
+constexpr int COMPACT_SLACK = 256;
+
+QString defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + "/sleex/notifications/notifications.log";
+}
+
+QJsonObject toJson(const NotificationStore::Record &record)
+{
+    return QJsonObject {
+        { "notificationId", record.id },
+        { "actions", QJsonArray::fromVariantList(record.actions) },
+        { "appIcon", record.appIcon },
+        { "appName", record.appName },
+        { "body", record.body },
+        { "image", record.image },
+        { "summary", record.summary },
+        { "time", record.time },
+        { "urgency", record.urgency },
+    };
+}
+
+NotificationStore::Record fromJson(const QJsonObject &object)
+{
+    NotificationStore::Record record;
+    record.id = object.value("notificationId").toInt();
+    record.appIcon = object.value("appIcon").toString();
+    record.appName = object.value("appName").toString();
+    record.body = object.value("body").toString();
+    record.image = object.value("image").toString();
+    record.summary = object.value("summary").toString();
+    record.time = object.value("time").toDouble();
+    record.urgency = object.value("urgency").toString();
+    // Actions of a past session are meaningless, the sender is gone or no longer tracks them
+    return record;
+}
+
+QVariantMap toVariant(const NotificationStore::Record &record)
+{
+    return QVariantMap {
+        { "notificationId", record.id },
+        { "actions", record.actions },
+        { "appIcon", record.appIcon },
+        { "appName", record.appName },
+        { "body", record.body },
+        { "image", record.image },
+        { "summary", record.summary },
+        { "time", record.time },
+        { "urgency", record.urgency },
+    };
+}
+
+QByteArray toLine(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+}
+
+NotificationStore::NotificationStore(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_path(defaultPath())
+{
+    m_writer.setMaxThreadCount(1);
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, &NotificationStore::flush);
+
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &NotificationStore::flush);
+}
+
+NotificationStore::~NotificationStore()
+{
+    ++m_generation;
+    flush();
+    m_writer.waitForDone();
+}
+
+void NotificationStore::componentComplete()
+{
+    m_complete = true;
+    load();
+}
+
+void NotificationStore::setPath(const QString &v)
+{
+    const QString path = v.isEmpty() ? defaultPath() : v;
+    if (m_path == path) return;
+    flush();
+    m_path = path;
+    emit pathChanged();
+    if (m_complete) load();
+}
+
+void NotificationStore::setLegacyPath(const QString &v)
+{
+    if (m_legacyPath == v) return;
+    m_legacyPath = v;
+    emit legacyPathChanged();
+}
+
+void NotificationStore::setPageSize(int v)
+{
+    v = qMax(1, v);
+    if (m_pageSize == v) return;
+    m_pageSize = v;
+    emit pageSizeChanged();
+    settle(m_pageSize);
+}
+
+void NotificationStore::setGroupLimit(int v)
+{
+    v = qMax(1, v);
+    if (m_groupLimit == v) return;
+    m_groupLimit = v;
+    emit groupLimitChanged();
+    if (m_rows > 0) emit dataChanged(index(0), index(m_rows - 1), { NotificationsRole });
+}
+
+void NotificationStore::load()
+{
+    const quint64 generation = ++m_generation;
+    if (m_loaded) {
+        m_loaded = false;
+        emit loadedChanged();
+    }
+    if (!m_groups.isEmpty()) {
+        beginResetModel();
+        m_groups.clear();
+        m_rows = 0;
+        endResetModel();
+    }
+    m_count = 0;
+    m_maxId = 0;
+    m_logLines = 0;
+    m_buffer.clear();
+    m_pendingClear = false;
+    m_pendingDismissals.clear();
+    emit countChanged();
+
+    const QString path = m_path;
+    const QString legacyPath = m_legacyPath;
+    // Queued on the writer, so it reads the file before anything appended from now on lands
+    m_writer.start([this, generation, path, legacyPath]() {
+        const Replay result = replay(path, legacyPath);
+        QMetaObject::invokeMethod(this, [this, generation, result]() {
+            if (generation == m_generation) apply(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+NotificationStore::Replay NotificationStore::replay(const QString &path, const QString &legacyPath)
+{
+    Replay result;
+    QFile file(path);
+    if (!file.exists() && !legacyPath.isEmpty()) {
+        QFile legacy(legacyPath);
+        if (legacy.open(QIODevice::ReadOnly)) {
+            const QJsonArray array = QJsonDocument::fromJson(legacy.readAll()).array();
+            for (const QJsonValue &value : array) result.records.append(fromJson(value.toObject()));
+            result.imported = true;
+        }
+        return result;
+    }
+    if (!file.open(QIODevice::ReadOnly)) return result;
+
+    // Dismissed records are flagged and dropped at the end, replaying stays linear
+    QVector<Record> records;
+    QVector<bool> dismissed;
+    QHash<int, int> rowOfId;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        ++result.lines;
+        // A line cut short by a crash is skipped like any other bad one
+        const QJsonObject object = QJsonDocument::fromJson(line).object();
+        if (object.contains("add")) {
+            rowOfId.insert(object.value("add").toObject().value("notificationId").toInt(), records.size());
+            records.append(fromJson(object.value("add").toObject()));
+            dismissed.append(false);
+        } else if (object.contains("dismiss")) {
+            for (const QJsonValue &id : object.value("dismiss").toArray()) {
+                const auto it = rowOfId.constFind(id.toInt());
+                if (it != rowOfId.cend()) dismissed[it.value()] = true;
+            }
+        } else if (object.contains("clear")) {
+            records.clear();
+            dismissed.clear();
+            rowOfId.clear();
+        }
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        if (!dismissed.at(i)) result.records.append(records.at(i));
+    }
+    return result;
+}
+
+void NotificationStore::apply(const Replay &result)
+{
+    // Written while loading, after everything the replay read
+    QVector<Record> replayed = result.records;
+    if (m_pendingClear)
+        replayed.clear();
+    else if (!m_pendingDismissals.isEmpty())
+        replayed.removeIf([this](const Record &record) { return m_pendingDismissals.contains(record.id); });
+    m_pendingClear = false;
+    m_pendingDismissals.clear();
+
+    // Notifications that came in while loading are newer than the whole log
+    QVector<Record> all = replayed + allRecords();
+
+    QVector<Group> groups;
+    QHash<QString, int> groupOf;
+    for (const Record &record : std::as_const(all)) {
+        int index = groupOf.value(record.appName, -1);
+        if (index < 0) {
+            index = groups.size();
+            groupOf.insert(record.appName, index);
+            groups.append(Group { record.appName, record.appIcon, record.time, {} });
+        }
+        Group &group = groups[index];
+        group.notifications.append(record);
+        group.time = qMax(group.time, record.time);
+    }
+    std::stable_sort(groups.begin(), groups.end(), [](const Group &a, const Group &b) { return a.time > b.time; });
+
+    beginResetModel();
+    m_groups = groups;
+    m_rows = qMin(m_pageSize, int(m_groups.size()));
+    endResetModel();
+
+    m_count = all.size();
+    m_maxId = 0;
+    for (const Record &record : std::as_const(all)) m_maxId = qMax(m_maxId, record.id);
+    m_logLines += result.lines;
+    m_loaded = true;
+    emit countChanged();
+    emit loadedChanged();
+
+    if (result.imported || m_logLines > 2 * m_count + COMPACT_SLACK) compact();
+}
+
+void NotificationStore::append(const QVariantMap &notification)
+{
+    Record record = fromJson(QJsonObject::fromVariantMap(notification));
+    record.actions = notification.value("actions").toList();
+
+    const int rows = m_rows;
+    int index = groupIndex(record.appName);
+    if (index < 0) {
+        index = m_groups.size();
+        m_groups.append(Group { record.appName, record.appIcon, record.time, {} });
+    }
+    Group &group = m_groups[index];
+    group.notifications.append(record);
+    group.time = qMax(group.time, record.time);
+    reposition(index);
+    settle(qMax(rows, m_pageSize));
+
+    ++m_count;
+    m_maxId = qMax(m_maxId, record.id);
+    emit countChanged();
+
+    write(QJsonObject { { "add", toJson(record) } });
+}
+
+void NotificationStore::dismiss(const QVariantList &ids)
+{
+    QSet<int> set;
+    for (const QVariant &id : ids) set.insert(id.toInt());
+    if (set.isEmpty()) return;
+    // Until the replay is in, an id missing here may still be in the log
+    if (removeIds(set) == 0 && m_loaded) return;
+    if (!m_loaded) m_pendingDismissals.unite(set);
+
+    QJsonArray array;
+    for (const int id : std::as_const(set)) array.append(id);
+    write(QJsonObject { { "dismiss", array } });
+}
+
+void NotificationStore::dismissApp(const QString &appName)
+{
+    const int index = groupIndex(appName);
+    if (index < 0) return;
+    QVariantList ids;
+    for (const Record &record : m_groups.at(index).notifications) ids.append(record.id);
+    dismiss(ids);
+}
+
+void NotificationStore::clear()
+{
+    // Written even when nothing is shown, the log may hold records not replayed yet
+    if (!m_loaded) m_pendingClear = true;
+    if (!m_groups.isEmpty()) {
+        beginResetModel();
+        m_groups.clear();
+        m_rows = 0;
+        endResetModel();
+    }
+    if (m_count != 0) {
+        m_count = 0;
+        emit countChanged();
+    }
+    write(QJsonObject { { "clear", true } });
+}
+
+int NotificationStore::removeIds(const QSet<int> &ids)
+{
+    const int rows = m_rows;
+    int removed = 0;
+    QStringList touched;
+    for (const Group &group : std::as_const(m_groups)) {
+        for (const Record &record : group.notifications) {
+            if (ids.contains(record.id)) {
+                touched.append(group.appName);
+                break;
+            }
+        }
+    }
+
+    for (const QString &appName : std::as_const(touched)) {
+        const int index = groupIndex(appName);
+        Group &group = m_groups[index];
+        removed += group.notifications.removeIf([&ids](const Record &record) { return ids.contains(record.id); });
+        if (group.notifications.isEmpty()) {
+            takeGroup(index);
+            continue;
+        }
+        group.time = 0;
+        for (const Record &record : std::as_const(group.notifications)) group.time = qMax(group.time, record.time);
+        reposition(index);
+    }
+    settle(qMax(rows, m_pageSize));
+
+    if (removed > 0) {
+        m_count -= removed;
+        emit countChanged();
+    }
+    return removed;
+}
+
+int NotificationStore::groupIndex(const QString &appName) const
+{
+    for (int i = 0; i < m_groups.size(); ++i) {
+        if (m_groups.at(i).appName == appName) return i;
+    }
+    return -1;
+}
+
+void NotificationStore::takeGroup(int row)
+{
+    if (row < m_rows) {
+        beginRemoveRows(QModelIndex(), row, row);
+        m_groups.removeAt(row);
+        --m_rows;
+        endRemoveRows();
+    } else {
+        m_groups.removeAt(row);
+    }
+}
+
+void NotificationStore::reposition(int row)
+{
+    const double time = m_groups.at(row).time;
+    int target = 0;
+    for (int i = 0; i < m_groups.size(); ++i) {
+        if (i != row && m_groups.at(i).time > time) ++target;
+    }
+
+    const bool visible = row < m_rows;
+    const bool lands = target < m_rows;
+    if (target == row) {
+        if (visible) emit dataChanged(index(row), index(row));
+    } else if (visible && lands) {
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), target > row ? target + 1 : target);
+        m_groups.move(row, target);
+        endMoveRows();
+        emit dataChanged(index(target), index(target));
+    } else if (visible) {
+        // Fell behind the page, settle() brings in the group that takes its place
+        beginRemoveRows(QModelIndex(), row, row);
+        m_groups.move(row, target);
+        --m_rows;
+        endRemoveRows();
+    } else if (lands) {
+        beginInsertRows(QModelIndex(), target, target);
+        m_groups.move(row, target);
+        ++m_rows;
+        endInsertRows();
+    } else {
+        m_groups.move(row, target);
+    }
+}
+
+void NotificationStore::settle(int target)
+{
+    target = qMin(target, int(m_groups.size()));
+    if (m_rows >= target) return;
+    beginInsertRows(QModelIndex(), m_rows, target - 1);
+    m_rows = target;
+    endInsertRows();
+}
+
+QVector<NotificationStore::Record> NotificationStore::allRecords() const
+{
+    QVector<Record> all;
+    all.reserve(m_count);
+    for (const Group &group : m_groups) all += group.notifications;
+    std::stable_sort(all.begin(), all.end(), [](const Record &a, const Record &b) {
+        return a.time != b.time ? a.time < b.time : a.id < b.id;
+    });
+    return all;
+}
+
+QVariantList NotificationStore::records() const
+{
+    QVariantList list;
+    list.reserve(m_count);
+    for (const Record &record : allRecords()) list.append(toVariant(record));
+    return list;
+}
+
+QVariantList NotificationStore::notifications(const QString &appName, int offset, int limit) const
+{
+    QVariantList list;
+    const int index = groupIndex(appName);
+    if (index < 0 || offset < 0 || limit <= 0) return list;
+
+    const QVector<Record> &records = m_groups.at(index).notifications;
+    const int end = qMax(0, int(records.size()) - offset);
+    for (int i = qMax(0, end - limit); i < end; ++i) list.append(toVariant(records.at(i)));
+    return list;
+}
+
+void NotificationStore::write(const QJsonObject &line)
+{
+    m_buffer += toLine(line);
+    ++m_logLines;
+    // Not restarted, a steady stream still reaches the disk every interval
+    if (!m_flushTimer.isActive()) m_flushTimer.start();
+    if (m_loaded && m_logLines > 2 * m_count + COMPACT_SLACK) compact();
+}
+
+void NotificationStore::flush()
+{
+    m_flushTimer.stop();
+    if (m_buffer.isEmpty()) return;
+    const QByteArray data = std::exchange(m_buffer, QByteArray());
+    const QString path = m_path;
+    m_writer.start([path, data]() {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "Sleex: Cannot append to" << path << ":" << file.errorString();
+            return;
+        }
+        file.write(data);
+    });
+}
+
+void NotificationStore::compact()
+{
+    // The snapshot covers everything buffered, it replaces the file after queued appends
+    m_flushTimer.stop();
+    m_buffer.clear();
+    QByteArray data;
+    for (const Record &record : allRecords()) data += toLine(QJsonObject { { "add", toJson(record) } });
+    m_logLines = m_count;
+
+    const QString path = m_path;
+    m_writer.start([path, data]() {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "Sleex: Cannot compact" << path << ":" << file.errorString();
+            return;
+        }
+        file.write(data);
+        file.commit();
+    });
+}
+
+bool NotificationStore::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_rows < m_groups.size();
+}
+
+void NotificationStore::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid()) return;
+    settle(m_rows + m_pageSize);
+}
+
+int NotificationStore::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+QVariant NotificationStore::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows) return QVariant();
+    const Group &group = m_groups.at(index.row());
+
+    switch (role) {
+        case Qt::DisplayRole:
+        case AppNameRole: return group.appName;
+        case AppIconRole: return group.appIcon;
+        case TimeRole: return group.time;
+        case CountRole: return int(group.notifications.size());
+        case NotificationsRole: return notifications(group.appName, 0, m_groupLimit);
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> NotificationStore::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[AppNameRole] = "appName";
+    roles[AppIconRole] = "appIcon";
+    roles[TimeRole] = "time";
+    roles[CountRole] = "count";
+    roles[NotificationsRole] = "notifications";
+    return roles;
+}
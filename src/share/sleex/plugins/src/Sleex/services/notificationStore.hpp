@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QJsonObject>
+#include <QQmlParserStatus>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+// Notification history kept as an append-only log of JSON lines: a new
+// notification, a dismissal (of any number of ids) or a clear is one line
+// handed to a writer thread, nothing is ever rewritten on the GUI thread.
+// Once dead lines outnumber the live notifications the log is compacted
+// into a fresh file on that same thread. The model lists one row per app,
+// latest activity first, a page at a time through fetchMore().
+class NotificationStore : public QAbstractListModel, public QQmlParserStatus {
+    Q_OBJECT
+    QML_ELEMENT
+    Q_INTERFACES(QQmlParserStatus)
+
+    // Defaults to ~/.cache/sleex/notifications/notifications.log
+    Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged FINAL)
+    // JSON array of the old store, imported when the log does not exist yet
+    Q_PROPERTY(QString legacyPath READ legacyPath WRITE setLegacyPath NOTIFY legacyPathChanged FINAL)
+    // Groups added to the model per fetchMore()
+    Q_PROPERTY(int pageSize READ pageSize WRITE setPageSize NOTIFY pageSizeChanged FINAL)
+    // Newest notifications a group row carries, the rest through notifications()
+    Q_PROPERTY(int groupLimit READ groupLimit WRITE setGroupLimit NOTIFY groupLimitChanged FINAL)
+
+    Q_PROPERTY(bool loaded     READ loaded     NOTIFY loadedChanged FINAL)
+    Q_PROPERTY(int  count      READ count      NOTIFY countChanged FINAL)
+    Q_PROPERTY(int  groupCount READ groupCount NOTIFY countChanged FINAL)
+    // Highest id in the history, new ids have to start above it
+    Q_PROPERTY(int  maxId      READ maxId      NOTIFY countChanged FINAL)
+
+public:
+    enum Roles {
+        AppNameRole = Qt::UserRole + 1,
+        AppIconRole,
+        TimeRole,
+        CountRole,
+        NotificationsRole
+    };
+
+    struct Record {
+        int     id = 0;
+        QString appName;
+        QString appIcon;
+        QString summary;
+        QString body;
+        QString image;
+        QString urgency;
+        double  time = 0;
+        QVariantList actions;
+    };
+
+    explicit NotificationStore(QObject *parent = nullptr);
+    ~NotificationStore() override;
+
+    void classBegin() override {}
+    void componentComplete() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    QString path() const { return m_path; }
+    void setPath(const QString &v);
+    QString legacyPath() const { return m_legacyPath; }
+    void setLegacyPath(const QString &v);
+    int pageSize() const { return m_pageSize; }
+    void setPageSize(int v);
+    int groupLimit() const { return m_groupLimit; }
+    void setGroupLimit(int v);
+
+    bool loaded()     const { return m_loaded; }
+    int  count()      const { return m_count; }
+    int  groupCount() const { return m_groups.size(); }
+    int  maxId()      const { return m_maxId; }
+
+    // Keys of Notifications.qml's notifToJSON(): notificationId, appName,
+    // appIcon, summary, body, image, urgency, time and actions
+    Q_INVOKABLE void append(const QVariantMap &notification);
+    Q_INVOKABLE void dismiss(const QVariantList &ids);
+    Q_INVOKABLE void dismissApp(const QString &appName);
+    Q_INVOKABLE void clear();
+    // Every notification, oldest first, in the shape append() takes
+    Q_INVOKABLE QVariantList records() const;
+    // A page of one app's notifications counted from the newest, oldest first
+    Q_INVOKABLE QVariantList notifications(const QString &appName, int offset, int limit) const;
+    Q_INVOKABLE void flush();
+
+signals:
+    void pathChanged();
+    void legacyPathChanged();
+    void pageSizeChanged();
+    void groupLimitChanged();
+    void loadedChanged();
+    void countChanged();
+
+private:
+    struct Group {
+        QString appName;
+        QString appIcon;
+        double  time = 0;
+        // Oldest first
+        QVector<Record> notifications;
+    };
+
+    struct Replay {
+        // Oldest first
+        QVector<Record> records;
+        int  lines = 0;
+        // Came from legacyPath, the log still has to be written
+        bool imported = false;
+    };
+
+    static Replay replay(const QString &path, const QString &legacyPath);
+    void apply(const Replay &result);
+    void load();
+    void write(const QJsonObject &line);
+    void compact();
+
+    // Oldest first
+    QVector<Record> allRecords() const;
+    int  groupIndex(const QString &appName) const;
+    void takeGroup(int row);
+    // Moves a group whose time changed back into order, rows follow it in and out of the page
+    void reposition(int row);
+    // Shows rows up to at least target, or as many groups as there are
+    void settle(int target);
+    int  removeIds(const QSet<int> &ids);
+
+    QString m_path;
+    QString m_legacyPath;
+    int  m_pageSize = 20;
+    int  m_groupLimit = 50;
+    bool m_complete = false;
+    bool m_loaded = false;
+
+    // Latest activity first, the first m_rows are in the model
+    QVector<Group> m_groups;
+    int m_rows = 0;
+    int m_count = 0;
+    int m_maxId = 0;
+
+    // A clear or dismissals made while the log was still being replayed,
+    // apply() drops what they cover from the replayed records
+    bool m_pendingClear = false;
+    QSet<int> m_pendingDismissals;
+
+    // Lines in the log file, live or not, once everything buffered is written
+    int m_logLines = 0;
+    QByteArray m_buffer;
+    // One thread, so appends and compactions reach the file in order
+    QThreadPool m_writer;
+    QTimer   m_flushTimer;
+    quint64  m_generation = 0;
+};
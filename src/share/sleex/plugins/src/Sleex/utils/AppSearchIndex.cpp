@@ -0,0 +1,449 @@
+#include "AppSearchIndex.hpp"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+const QString CONNECTION_NAME = QStringLiteral("appsearch_conn");
+
+// Field weights, a name hit beats the same hit in the keywords
+constexpr float NAME_WEIGHT = 1.0f;
+constexpr float GENERIC_NAME_WEIGHT = 0.75f;
+constexpr float KEYWORDS_WEIGHT = 0.65f;
+constexpr float EXEC_WEIGHT = 0.5f;
+
+// Launch counts lose half their weight every two weeks
+constexpr double FRECENCY_HALF_LIFE_DAYS = 14.0;
+// Upper bound of the frecency multiplier is 1 + this
+constexpr float FRECENCY_MAX_BOOST = 0.5f;
+
+// Start positions tried per field, the first few cover real names
+constexpr int MAX_MATCH_STARTS = 8;
+constexpr int MAX_SLOPPY_LENGTH = 64;
+
+QSqlDatabase database() {
+    return QSqlDatabase::database(CONNECTION_NAME);
+}
+
+inline int charBit(char16_t c) {
+    if (c >= u'a' && c <= u'z') return c - u'a';
+    if (c >= u'0' && c <= u'9') return 26 + (c - u'0');
+    return 36 + (c % 28);
+}
+
+inline int bigramBit(char16_t a, char16_t b) {
+    return (a * 31u + b) & 63u;
+}
+
+quint64 charMaskOf(const QString &text) {
+    quint64 mask = 0;
+    for (const QChar c : text) mask |= quint64(1) << charBit(c.unicode());
+    return mask;
+}
+
+quint64 bigramMaskOf(const QString &text) {
+    quint64 mask = 0;
+    const char16_t *s = reinterpret_cast<const char16_t *>(text.utf16());
+    for (qsizetype i = 1; i < text.size(); ++i) mask |= quint64(1) << bigramBit(s[i - 1], s[i]);
+    return mask;
+}
+
+inline bool isSeparator(char16_t c) {
+    return c == u' ' || c == u'-' || c == u'_' || c == u'.' || c == u'/';
+}
+
+// Subsequence score of query in text, both lowercase; < 0 when it does not match.
+// Per matched character: 1, +2 at a word start, +1.5 when it follows the
+// previous match. Later starts cost a little, prefix and exact hits add on top.
+float subsequenceScore(const char16_t *t, int n, const char16_t *q, int m) {
+    if (m == 0) return 0.0f;
+    if (m > n) return -1.0f;
+
+    float best = -1.0f;
+    int starts = 0;
+    for (int start = 0; start <= n - m && starts < MAX_MATCH_STARTS; ++start) {
+        if (t[start] != q[0]) continue;
+        ++starts;
+
+        float score = 1.0f + ((start == 0 || isSeparator(t[start - 1])) ? 2.0f : 0.0f);
+        int j = 1;
+        int prev = start;
+        for (int i = start + 1; i < n && j < m; ++i) {
+            if (t[i] != q[j]) continue;
+            score += 1.0f;
+            if (isSeparator(t[i - 1])) score += 2.0f;
+            if (i == prev + 1) score += 1.5f;
+            prev = i;
+            ++j;
+        }
+        if (j < m) break; // Later starts cannot match either
+
+        score -= std::min(start * 0.05f, 1.0f);
+        best = std::max(best, score);
+    }
+    if (best < 0.0f) return best;
+
+    float normalized = best / (m * 4.5f);
+    if (n == m && std::equal(t, t + n, q)) normalized += 0.5f;
+    else if (std::equal(q, q + m, t)) normalized += 0.3f;
+    return normalized;
+}
+
+int levenshtein(const char16_t *a, int n, const char16_t *b, int m) {
+    quint16 rowA[MAX_SLOPPY_LENGTH + 1];
+    quint16 rowB[MAX_SLOPPY_LENGTH + 1];
+    quint16 *prev = rowA;
+    quint16 *curr = rowB;
+
+    for (int j = 0; j <= m; ++j) prev[j] = j;
+    for (int i = 1; i <= n; ++i) {
+        curr[0] = i;
+        for (int j = 1; j <= m; ++j) {
+            const quint16 substitution = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            curr[j] = std::min<quint16>({ quint16(prev[j] + 1), quint16(curr[j - 1] + 1), substitution });
+        }
+        std::swap(prev, curr);
+    }
+    return prev[m];
+}
+}
+
+AppSearchIndex::AppSearchIndex(QObject *parent) : QAbstractListModel(parent) {
+    loadHistory();
+}
+
+QList<QObject *> AppSearchIndex::entries() const {
+    QList<QObject *> list;
+    list.reserve(m_records.size());
+    for (const Record &record : m_records) list.append(record.entry.data());
+    return list;
+}
+
+void AppSearchIndex::setEntries(const QList<QObject *> &entries) {
+    QVector<Record> records;
+    QHash<QObject *, int> recordIndex;
+    records.reserve(entries.size());
+
+    for (QObject *entry : entries) {
+        if (!entry || recordIndex.contains(entry)) continue;
+        // Entries keep their identity across DesktopEntries updates, reuse
+        // the prepared fields unless the name moved under us
+        const int previous = m_recordIndex.value(entry, -1);
+        if (previous >= 0 && m_records.at(previous).entry == entry
+            && m_records.at(previous).name == entry->property("name").toString()) {
+            records.append(m_records.at(previous));
+        } else {
+            records.append(prepare(entry));
+            updateFrecency(records.last());
+        }
+        recordIndex.insert(entry, records.size() - 1);
+    }
+
+    m_records = records;
+    m_recordIndex = recordIndex;
+    rankNames();
+    m_refinedQuery.clear();
+    m_refinedCandidates.clear();
+    emit entriesChanged();
+    run();
+}
+
+void AppSearchIndex::setQuery(const QString &query) {
+    if (m_query == query) return;
+    m_query = query;
+    emit queryChanged();
+    run();
+}
+
+void AppSearchIndex::setSloppy(bool v) {
+    if (m_sloppy == v) return;
+    m_sloppy = v;
+    emit optionsChanged();
+    run();
+}
+
+void AppSearchIndex::setScoreThreshold(qreal v) {
+    if (qFuzzyCompare(m_scoreThreshold, v)) return;
+    m_scoreThreshold = v;
+    emit optionsChanged();
+    if (m_sloppy) run();
+}
+
+QList<QObject *> AppSearchIndex::search(const QString &query) {
+    setQuery(query);
+
+    QList<QObject *> list;
+    list.reserve(m_results.size());
+    for (const Result &result : std::as_const(m_results)) {
+        if (QObject *entry = m_records.at(result.record).entry) list.append(entry);
+    }
+    return list;
+}
+
+QObject *AppSearchIndex::bestMatch(const QString &text) const {
+    const QString query = text.trimmed().toLower();
+    if (query.isEmpty()) return nullptr;
+    const quint64 queryMask = charMaskOf(query);
+    const quint64 queryBigrams = bigramMaskOf(query);
+
+    const Record *found = nullptr;
+    float best = -1.0f;
+    for (const Record &record : m_records) {
+        if (!record.entry || (record.charMask & queryMask) != queryMask) continue;
+        const float score = scoreStrict(record, query, queryMask, queryBigrams);
+        if (score < 0.0f) continue;
+        if (score * frecencyBoost(record) > best) {
+            best = score * frecencyBoost(record);
+            found = &record;
+        }
+    }
+    return found ? found->entry.data() : nullptr;
+}
+
+AppSearchIndex::Record AppSearchIndex::prepare(QObject *entry) {
+    Record record;
+    record.entry = entry;
+    record.id = entry->property("id").toString();
+    record.name = entry->property("name").toString();
+
+    // Only the program of the exec line, arguments and field codes are noise
+    const QString exec = entry->property("execString").toString().section(' ', 0, 0).section('/', -1);
+    const QString sources[] = {
+        record.name,
+        entry->property("genericName").toString(),
+        entry->property("keywords").toStringList().join(' '),
+        exec
+    };
+    const float weights[] = { NAME_WEIGHT, GENERIC_NAME_WEIGHT, KEYWORDS_WEIGHT, EXEC_WEIGHT };
+
+    for (int i = 0; i < 4; ++i) {
+        if (sources[i].isEmpty()) continue;
+        Field field;
+        field.text = sources[i].toLower();
+        field.charMask = charMaskOf(field.text);
+        field.bigramMask = bigramMaskOf(field.text);
+        field.weight = weights[i];
+        record.charMask |= field.charMask;
+        record.fields.append(field);
+    }
+    return record;
+}
+
+void AppSearchIndex::rankNames() {
+    // One sort key per name, then every tie in run() is an int comparison
+    QVector<QPair<QCollatorSortKey, int>> keys;
+    keys.reserve(m_records.size());
+    for (int i = 0; i < m_records.size(); ++i) keys.append({ m_collator.sortKey(m_records.at(i).name), i });
+    std::sort(keys.begin(), keys.end(), [](const auto &a, const auto &b) {
+        return a.first.compare(b.first) < 0;
+    });
+    for (int rank = 0; rank < keys.size(); ++rank) m_records[keys.at(rank).second].collationRank = rank;
+}
+
+float AppSearchIndex::scoreStrict(const Record &record, const QString &query, quint64 queryMask,
+                                  quint64 queryBigrams) const {
+    const char16_t *q = reinterpret_cast<const char16_t *>(query.utf16());
+    const int m = query.size();
+
+    float best = -1.0f;
+    for (const Field &field : record.fields) {
+        // A subsequence needs every query character somewhere in the field
+        if ((field.charMask & queryMask) != queryMask) continue;
+
+        const char16_t *t = reinterpret_cast<const char16_t *>(field.text.utf16());
+        float score = subsequenceScore(t, field.text.size(), q, m);
+        if (score < 0.0f) continue;
+
+        // Contiguous hits rank above scattered ones. The bloom only lets
+        // fields through that can contain every query bigram.
+        if (m > 1 && (field.bigramMask & queryBigrams) == queryBigrams && field.text.contains(query))
+            score += 0.2f;
+
+        best = std::max(best, score * field.weight);
+    }
+    return best;
+}
+
+float AppSearchIndex::scoreSloppy(const Record &record, const QString &query, quint64 queryMask) const {
+    if (record.fields.isEmpty() || record.fields.first().weight != NAME_WEIGHT) return -1.0f;
+    const Field &name = record.fields.first();
+
+    const int n = std::min<int>(name.text.size(), MAX_SLOPPY_LENGTH);
+    const int m = std::min<int>(query.size(), MAX_SLOPPY_LENGTH);
+    const int longest = std::max(n, m);
+    if (longest == 0) return -1.0f;
+
+    // Cheap lower bound on the distance: every query character missing from
+    // the name costs an edit, and so does the length difference
+    const int missing = qPopulationCount(queryMask & ~name.charMask);
+    const int bound = std::max(missing, std::abs(n - m));
+    if (1.0 - double(bound) / longest < m_scoreThreshold) return -1.0f;
+
+    const int distance = levenshtein(reinterpret_cast<const char16_t *>(name.text.utf16()), n,
+                                     reinterpret_cast<const char16_t *>(query.utf16()), m);
+    const float similarity = 1.0f - float(distance) / longest;
+    return similarity >= m_scoreThreshold ? similarity : -1.0f;
+}
+
+float AppSearchIndex::frecencyBoost(const Record &record) const {
+    return 1.0f + FRECENCY_MAX_BOOST * record.frecency / (record.frecency + 3.0f);
+}
+
+void AppSearchIndex::run() {
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString query = m_query.trimmed().toLower();
+    const quint64 queryMask = charMaskOf(query);
+    const quint64 queryBigrams = bigramMaskOf(query);
+
+    // Every match of the extended query also matched the shorter one
+    const bool refine = !m_sloppy && !m_refinedQuery.isEmpty() && query.startsWith(m_refinedQuery);
+
+    QVector<Result> results;
+    QVector<int> matched;
+    const auto consider = [&](int i) {
+        const Record &record = m_records.at(i);
+        if (!record.entry) return;
+        if (query.isEmpty()) {
+            results.append({ i, frecencyBoost(record) });
+            return;
+        }
+        if (!m_sloppy && (record.charMask & queryMask) != queryMask) return;
+
+        const float score = m_sloppy ? scoreSloppy(record, query, queryMask)
+                                     : scoreStrict(record, query, queryMask, queryBigrams);
+        if (score < 0.0f) return;
+        results.append({ i, score * frecencyBoost(record) });
+        matched.append(i);
+    };
+
+    if (refine) {
+        for (int i : std::as_const(m_refinedCandidates)) consider(i);
+    } else {
+        for (int i = 0; i < m_records.size(); ++i) consider(i);
+    }
+
+    std::sort(results.begin(), results.end(), [this](const Result &a, const Result &b) {
+        if (a.score != b.score) return a.score > b.score;
+        return m_records.at(a.record).collationRank < m_records.at(b.record).collationRank;
+    });
+
+    if (m_sloppy || query.isEmpty()) {
+        m_refinedQuery.clear();
+        m_refinedCandidates.clear();
+    } else {
+        m_refinedQuery = query;
+        m_refinedCandidates = matched;
+    }
+
+    beginResetModel();
+    m_results = results;
+    endResetModel();
+
+    m_lastQueryMicros = int(timer.nsecsElapsed() / 1000);
+    emit resultsChanged();
+}
+
+void AppSearchIndex::recordLaunch(const QString &id) {
+    if (id.isEmpty()) return;
+
+    Launches &launches = m_launches[id];
+    ++launches.count;
+    launches.last = QDateTime::currentDateTime();
+
+    for (Record &record : m_records) {
+        if (record.id == id) updateFrecency(record);
+    }
+    saveLaunch(id);
+    // The boost changed, the visible ranking follows it
+    run();
+}
+
+void AppSearchIndex::updateFrecency(Record &record) const {
+    const auto it = m_launches.constFind(record.id);
+    if (it == m_launches.cend() || !it->last.isValid()) {
+        record.frecency = 0.0f;
+        return;
+    }
+    const double ageDays = it->last.secsTo(QDateTime::currentDateTime()) / 86400.0;
+    record.frecency = float(it->count * std::pow(0.5, std::max(0.0, ageDays) / FRECENCY_HALF_LIFE_DAYS));
+}
+
+void AppSearchIndex::loadHistory() {
+    if (!QSqlDatabase::contains(CONNECTION_NAME)) {
+        // Same state database as the post-it notes
+        QString stateDir = QDir::homePath() + "/.local/state/sleex";
+        QDir().mkpath(stateDir);
+
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+        db.setDatabaseName(stateDir + "/sleex_state.db");
+        if (!db.open()) {
+            qCritical() << "Sleex: app launch history DB error:" << db.lastError().text();
+            return;
+        }
+
+        QSqlQuery query(db);
+        query.exec("PRAGMA journal_mode=WAL;");
+        query.exec("CREATE TABLE IF NOT EXISTS sleex_app_launches ("
+                   "id TEXT PRIMARY KEY, count INTEGER, last INTEGER)");
+    }
+
+    QSqlQuery query(database());
+    if (!query.exec("SELECT id, count, last FROM sleex_app_launches")) return;
+    while (query.next()) {
+        Launches launches;
+        launches.count = query.value(1).toInt();
+        launches.last = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
+        m_launches.insert(query.value(0).toString(), launches);
+    }
+}
+
+void AppSearchIndex::saveLaunch(const QString &id) const {
+    QSqlDatabase db = database();
+    if (!db.isOpen()) return;
+
+    const Launches launches = m_launches.value(id);
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO sleex_app_launches (id, count, last) VALUES (?, ?, ?) "
+                  "ON CONFLICT(id) DO UPDATE SET count = excluded.count, last = excluded.last");
+    query.addBindValue(id);
+    query.addBindValue(launches.count);
+    query.addBindValue(launches.last.toSecsSinceEpoch());
+    if (!query.exec())
+        qWarning() << "Sleex: failed to store app launch:" << query.lastError().text();
+}
+
+int AppSearchIndex::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : m_results.size();
+}
+
+QVariant AppSearchIndex::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_results.size()) return QVariant();
+    const Result &result = m_results.at(index.row());
+    const Record &record = m_records.at(result.record);
+
+    switch (role) {
+        case EntryRole: return QVariant::fromValue(record.entry.data());
+        case IdRole: return record.id;
+        case Qt::DisplayRole:
+        case NameRole: return record.name;
+        case ScoreRole: return result.score;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> AppSearchIndex::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[EntryRole] = "entry";
+    roles[IdRole] = "id";
+    roles[NameRole] = "name";
+    roles[ScoreRole] = "score";
+    return roles;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QCollator>
+#include <QDateTime>
+#include <QHash>
+#include <QPointer>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+// Ranked fuzzy search over desktop entries. Every entry is prepared once:
+// lowercased fields (name, generic name, keywords, exec) plus a character
+// bitmask and a bigram bloom, so most entries are rejected with two AND
+// operations before any scoring. A query that extends the previous one only
+// rescores the previous matches. Launches recorded through recordLaunch()
+// feed a frecency boost that is kept across sessions.
+class AppSearchIndex : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+
+    // DesktopEntry objects, read through their QML properties
+    Q_PROPERTY(QList<QObject *> entries READ entries WRITE setEntries NOTIFY entriesChanged FINAL)
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged FINAL)
+    // Typo tolerant matching on the name instead of subsequence matching
+    Q_PROPERTY(bool  sloppy         READ sloppy         WRITE setSloppy         NOTIFY optionsChanged FINAL)
+    Q_PROPERTY(qreal scoreThreshold READ scoreThreshold WRITE setScoreThreshold NOTIFY optionsChanged FINAL)
+
+    Q_PROPERTY(int count READ count NOTIFY resultsChanged FINAL)
+    // Duration of the last query, for keeping an eye on the budget
+    Q_PROPERTY(int lastQueryMicros READ lastQueryMicros NOTIFY resultsChanged FINAL)
+
+public:
+    enum Roles {
+        EntryRole = Qt::UserRole + 1,
+        IdRole,
+        NameRole,
+        ScoreRole
+    };
+
+    explicit AppSearchIndex(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QList<QObject *> entries() const;
+    void setEntries(const QList<QObject *> &entries);
+
+    QString query() const { return m_query; }
+    void setQuery(const QString &query);
+
+    bool  sloppy()         const { return m_sloppy; }
+    qreal scoreThreshold() const { return m_scoreThreshold; }
+    void setSloppy(bool v);
+    void setScoreThreshold(qreal v);
+
+    int count() const { return m_results.size(); }
+    int lastQueryMicros() const { return m_lastQueryMicros; }
+
+    // Runs the query and returns the ranked entries, for callers mapping over an array
+    Q_INVOKABLE QList<QObject *> search(const QString &query);
+    Q_INVOKABLE void recordLaunch(const QString &id);
+    // Highest scoring entry for a strict query, leaves the model untouched
+    QObject *bestMatch(const QString &query) const;
+
+signals:
+    void entriesChanged();
+    void queryChanged();
+    void optionsChanged();
+    void resultsChanged();
+
+private:
+    struct Field {
+        QString text;
+        quint64 charMask = 0;
+        quint64 bigramMask = 0;
+        float   weight = 1.0f;
+    };
+
+    struct Record {
+        QPointer<QObject> entry;
+        QString id;
+        QString name;
+        QVector<Field> fields;
+        quint64 charMask = 0;
+        float   frecency = 0.0f;
+        // Position of the name in locale order, breaks score ties without collating
+        int     collationRank = 0;
+    };
+
+    struct Result {
+        int   record;
+        float score;
+    };
+
+    struct Launches {
+        int       count = 0;
+        QDateTime last;
+    };
+
+    static Record prepare(QObject *entry);
+    void rankNames();
+    float scoreStrict(const Record &record, const QString &query, quint64 queryMask, quint64 queryBigrams) const;
+    float scoreSloppy(const Record &record, const QString &query, quint64 queryMask) const;
+    float frecencyBoost(const Record &record) const;
+
+    void run();
+    void updateFrecency(Record &record) const;
+    void loadHistory();
+    void saveLaunch(const QString &id) const;
+
+    QCollator m_collator;
+    QVector<Record> m_records;
+    // Entries seen before keep their prepared record when the list changes
+    QHash<QObject *, int> m_recordIndex;
+
+    QString m_query;
+    bool    m_sloppy = false;
+    qreal   m_scoreThreshold = 0.2;
+
+    QVector<Result> m_results;
+    int m_lastQueryMicros = 0;
+
+    // Matches of the last strict query, the candidates when it is extended
+    QString      m_refinedQuery;
+    QVector<int> m_refinedCandidates;
+
+    QHash<QString, Launches> m_launches;
+};
@@ -0,0 +1,85 @@
+#include "DesktopGrid.hpp"
+#include <bit>
+#include <limits>
+
+DesktopGrid::DesktopGrid(int rows, int maxCol)
+    : m_rows(qMax(1, rows)), m_maxCol(maxCol) {
+    if (m_maxCol >= 0)
+        m_words.resize((qsizetype(m_maxCol + 1) * m_rows + 63) / 64, 0);
+}
+
+bool DesktopGrid::contains(int x, int y) const {
+    return x >= 0 && y >= 0 && y < m_rows && (m_maxCol < 0 || x <= m_maxCol);
+}
+
+bool DesktopGrid::isOccupied(int x, int y) const {
+    if (!contains(x, y)) return false;
+    const qsizetype bit = bitIndex(x, y);
+    const qsizetype word = bit / 64;
+    if (word >= qsizetype(m_words.size())) return false;
+    return (m_words[word] >> (bit % 64)) & 1;
+}
+
+void DesktopGrid::occupy(int x, int y) {
+    if (!contains(x, y)) return;
+    const qsizetype bit = bitIndex(x, y);
+    const qsizetype word = bit / 64;
+    if (word >= qsizetype(m_words.size()))
+        m_words.resize(word + 1, 0);
+    m_words[word] |= quint64(1) << (bit % 64);
+}
+
+void DesktopGrid::release(int x, int y) {
+    if (!contains(x, y)) return;
+    const qsizetype bit = bitIndex(x, y);
+    const qsizetype word = bit / 64;
+    if (word >= qsizetype(m_words.size())) return;
+    m_words[word] &= ~(quint64(1) << (bit % 64));
+}
+
+QPoint DesktopGrid::firstFree() const {
+    qsizetype bit = qsizetype(m_words.size()) * 64;
+    for (qsizetype i = 0; i < qsizetype(m_words.size()); ++i) {
+        if (m_words[i] != std::numeric_limits<quint64>::max()) {
+            bit = i * 64 + std::countr_one(m_words[i]);
+            break;
+        }
+    }
+
+    const int x = int(bit / m_rows);
+    const int y = int(bit % m_rows);
+    if (m_maxCol >= 0 && x > m_maxCol) return QPoint(-1, -1);
+    return QPoint(x, y);
+}
+
+QPoint DesktopGrid::nearestFree(int x, int y) const {
+    const int maxX = m_maxCol >= 0 ? m_maxCol : qMax(x, 0) + m_rows;
+    x = qBound(0, x, maxX);
+    y = qBound(0, y, m_rows - 1);
+
+    if (!isOccupied(x, y)) return QPoint(x, y);
+
+    QPoint best(-1, -1);
+    int bestDist = std::numeric_limits<int>::max();
+    const int maxRing = qMax(maxX + 1, m_rows);
+
+    // Walk square rings outwards. Every cell on ring r is at least r away,
+    // so once r^2 exceeds the best squared distance nothing closer remains.
+    for (int r = 1; r <= maxRing && r * r <= bestDist; ++r) {
+        for (int dx = -r; dx <= r; ++dx) {
+            const int step = (dx == -r || dx == r) ? 1 : 2 * r;
+            for (int dy = -r; dy <= r; dy += step) {
+                const int cx = x + dx;
+                const int cy = y + dy;
+                if (cx > maxX || !contains(cx, cy) || isOccupied(cx, cy)) continue;
+
+                const int dist = dx * dx + dy * dy;
+                if (dist < bestDist) {
+                    bestDist = dist;
+                    best = QPoint(cx, cy);
+                }
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QPoint>
+#include <QtGlobal>
+#include <vector>
+
+// Dense occupancy bitmap for the desktop icon grid. Cells are stored
+// column-major (bit = x * rows + y) so the natural fill order of the
+// desktop, top to bottom then left to right, is a linear bit scan.
+class DesktopGrid {
+public:
+    // maxCol < 0 leaves the grid unbounded to the right
+    explicit DesktopGrid(int rows, int maxCol = -1);
+
+    bool contains(int x, int y) const;
+    bool isOccupied(int x, int y) const;
+    void occupy(int x, int y);
+    void release(int x, int y);
+
+    // First free cell in fill order, or (-1, -1) when a bounded grid is full
+    QPoint firstFree() const;
+    // Free cell closest to (x, y), clamped into the grid first
+    QPoint nearestFree(int x, int y) const;
+
+private:
+    qsizetype bitIndex(int x, int y) const { return qsizetype(x) * m_rows + y; }
+
+    int m_rows;
+    int m_maxCol;
+    std::vector<quint64> m_words;
+};
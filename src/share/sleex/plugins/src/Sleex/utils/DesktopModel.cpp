@@ -1,10 +1,28 @@
 #include "DesktopModel.hpp"
 #include "DesktopStateManager.hpp"
+#include "DesktopGrid.hpp"
+#include "ThumbnailService.hpp"
+#include <QBitArray>
+#include <algorithm>
 #include <QDir>
 #include <QFileInfoList>
 #include <QPoint>
 
-DesktopModel::DesktopModel(QObject *parent) : QAbstractListModel(parent) {}
+DesktopModel::DesktopModel(QObject *parent) : QAbstractListModel(parent) {
+    connect(&m_watcher, &DesktopWatcher::entryCreated, this, &DesktopModel::onEntryCreated);
+    connect(&m_watcher, &DesktopWatcher::entryRemoved, this, &DesktopModel::onEntryRemoved);
+    connect(&m_watcher, &DesktopWatcher::entryModified, this, &DesktopModel::onEntryModified);
+    connect(&m_watcher, &DesktopWatcher::entryRenamed, this, &DesktopModel::onEntryRenamed);
+    // Queued: the rescan re-arms the watcher, which must not happen while it is still reading
+    connect(&m_watcher, &DesktopWatcher::resyncRequired, this, [this]() {
+        loadDirectory(m_watchedPath);
+    }, Qt::QueuedConnection);
+
+    connect(ThumbnailService::instance(), &ThumbnailService::thumbnailReady,
+            this, &DesktopModel::onThumbnailReady);
+    connect(ThumbnailService::instance(), &ThumbnailService::thumbnailFailed,
+            this, &DesktopModel::onThumbnailFailed);
+}
 
 int DesktopModel::rowCount(const QModelIndex &parent) const {
     if (parent.isValid()) return 0;
@@ -21,6 +39,13 @@ QVariant DesktopModel::data(const QModelIndex &index, int role) const {
         case IsDirRole: return item.isDir;
         case GridXRole: return item.gridX;
         case GridYRole: return item.gridY;
+        case ThumbnailRole:
+            // Only rows that are actually shown ever reach the worker pool
+            if (!item.thumbnailRequested && !item.isDir) {
+                item.thumbnailRequested = true;
+                item.thumbnail = ThumbnailService::instance()->request(item.filePath);
+            }
+            return item.thumbnail;
         default: return QVariant();
     }
 }
@@ -32,50 +57,47 @@ QHash<int, QByteArray> DesktopModel::roleNames() const {
     roles[IsDirRole] = "isDir";
     roles[GridXRole] = "gridX";
     roles[GridYRole] = "gridY";
+    roles[ThumbnailRole] = "thumbnail";
     return roles;
 }
 
-QPoint DesktopModel::getEmptySpot(const QSet<QString> &occupied) const {
-    for (int x = 0; ; ++x) {
-        for (int y = 0; y < m_rows; ++y) {
-            QString key = QString::number(x) + "," + QString::number(y);
-            if (!occupied.contains(key)) {
-                return QPoint(x, y);
-            }
-        }
+void DesktopModel::rebuildPathIndex() {
+    m_pathIndex.clear();
+    m_pathIndex.reserve(m_items.size());
+    for (int i = 0; i < m_items.size(); ++i) {
+        m_pathIndex.insert(m_items[i].filePath, i);
     }
 }
 
 void DesktopModel::loadDirectory(const QString &path) {
     m_watchedPath = path;
 
-    if (!m_watcher.directories().isEmpty())
-        m_watcher.removePaths(m_watcher.directories());
-
-    m_watcher.addPath(path);
-
-    connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
-            this, &DesktopModel::onDirectoryChanged,
-            Qt::UniqueConnection);
+    // Arm the watcher before listing so nothing created in between is missed,
+    // the handlers below tolerate events for entries the listing already has.
+    m_watcher.watch(path);
 
     beginResetModel();
+    for (const auto& item : m_items) {
+        ThumbnailService::instance()->cancel(item.filePath);
+    }
     m_items.clear();
 
     QDir dir(path);
     dir.setFilter(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
     QFileInfoList list = dir.entryInfoList();
 
-    DesktopStateManager sm;
-    QVariantMap savedLayout = sm.getLayout();
+    QVariantMap savedLayout = DesktopStateManager::instance()->getLayout();
 
-    QSet<QString> occupied;
+    DesktopGrid occupied(m_rows);
     for (const QFileInfo &fileInfo : list) {
         if (savedLayout.contains(fileInfo.fileName())) {
             QVariantMap pos = savedLayout[fileInfo.fileName()].toMap();
-            occupied.insert(QString::number(pos["x"].toInt()) + "," + QString::number(pos["y"].toInt()));
+            occupied.occupy(pos["x"].toInt(), pos["y"].toInt());
         }
     }
 
+    m_items.reserve(list.size());
+
     for (const QFileInfo &fileInfo : list) {
         DesktopItem item;
         item.fileName = fileInfo.fileName();
@@ -87,18 +109,158 @@ void DesktopModel::loadDirectory(const QString &path) {
             item.gridX = pos["x"].toInt();
             item.gridY = pos["y"].toInt();
         } else {
-            QPoint spot = getEmptySpot(occupied);
+            QPoint spot = occupied.firstFree();
             item.gridX = spot.x();
             item.gridY = spot.y();
-            occupied.insert(QString::number(item.gridX) + "," + QString::number(item.gridY));
+            occupied.occupy(item.gridX, item.gridY);
         }
         m_items.append(item);
     }
+    rebuildPathIndex();
     endResetModel();
 }
 
-void DesktopModel::onDirectoryChanged() {
-    loadDirectory(m_watchedPath);
+int DesktopModel::indexOfName(const QString &fileName) const {
+    return m_pathIndex.value(QFileInfo(QDir(m_watchedPath), fileName).absoluteFilePath(), -1);
+}
+
+void DesktopModel::onEntryCreated(const QString &name) {
+    // Hidden files stay off the desktop, as in loadDirectory() without QDir::Hidden
+    if (name.startsWith('.')) return;
+
+    if (indexOfName(name) != -1) {
+        onEntryModified(name);
+        return;
+    }
+
+    QFileInfo fileInfo(QDir(m_watchedPath), name);
+    // Short-lived temp files can be gone again before the event is handled
+    if (!fileInfo.exists()) return;
+
+    DesktopItem item;
+    item.fileName = fileInfo.fileName();
+    item.filePath = fileInfo.absoluteFilePath();
+    item.isDir = fileInfo.isDir();
+
+    DesktopGrid occupied(m_rows);
+    for (const auto& other : m_items) {
+        occupied.occupy(other.gridX, other.gridY);
+    }
+
+    QVariantMap savedLayout = DesktopStateManager::instance()->getLayout();
+    bool placed = false;
+    if (savedLayout.contains(item.fileName)) {
+        QVariantMap pos = savedLayout[item.fileName].toMap();
+        item.gridX = pos["x"].toInt();
+        item.gridY = pos["y"].toInt();
+        placed = !occupied.isOccupied(item.gridX, item.gridY);
+    }
+
+    if (!placed) {
+        QPoint spot = occupied.firstFree();
+        item.gridX = spot.x();
+        item.gridY = spot.y();
+    }
+
+    const int row = m_items.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_items.append(item);
+    m_pathIndex.insert(item.filePath, row);
+    endInsertRows();
+}
+
+void DesktopModel::onEntryRemoved(const QString &name) {
+    const int row = indexOfName(name);
+    if (row == -1) return;
+
+    ThumbnailService::instance()->invalidate(m_items[row].filePath);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_pathIndex.remove(m_items[row].filePath);
+    m_items.removeAt(row);
+    // Only the rows after it moved up, no rehash of the whole index
+    for (int i = row; i < m_items.size(); ++i) m_pathIndex[m_items[i].filePath] = i;
+    endRemoveRows();
+}
+
+void DesktopModel::onEntryModified(const QString &name) {
+    const int row = indexOfName(name);
+    if (row == -1) return;
+
+    // New content, the next read of the role queues a fresh thumbnail
+    DesktopItem &item = m_items[row];
+    ThumbnailService::instance()->invalidate(item.filePath);
+    item.thumbnail.clear();
+    item.thumbnailRequested = false;
+    item.thumbnailFailed = false;
+
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {ThumbnailRole});
+}
+
+void DesktopModel::releaseThumbnail(const QString &path) {
+    const int row = m_pathIndex.value(path, -1);
+    if (row == -1 || !m_items[row].thumbnail.isEmpty() || m_items[row].thumbnailFailed) return;
+
+    ThumbnailService::instance()->cancel(path);
+    m_items[row].thumbnailRequested = false;
+}
+
+void DesktopModel::onThumbnailReady(const QString &path, const QString &url) {
+    const int row = m_pathIndex.value(path, -1);
+    if (row == -1) return;
+
+    m_items[row].thumbnail = url;
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {ThumbnailRole});
+}
+
+void DesktopModel::onThumbnailFailed(const QString &path) {
+    const int row = m_pathIndex.value(path, -1);
+    if (row == -1) return;
+
+    // Keeps the delegate on its icon without queueing the same file every
+    // time it scrolls back into view
+    m_items[row].thumbnailFailed = true;
+}
+
+void DesktopModel::onEntryRenamed(const QString &oldName, const QString &newName) {
+    // Hidden by the rename, it leaves the desktop like a removed file
+    if (newName.startsWith('.')) {
+        onEntryRemoved(oldName);
+        return;
+    }
+
+    int row = indexOfName(oldName);
+    if (row == -1) {
+        onEntryCreated(newName);
+        return;
+    }
+
+    // Renaming over an existing entry replaces it
+    const int replaced = indexOfName(newName);
+    if (replaced != -1 && replaced != row) {
+        onEntryRemoved(newName);
+        if (replaced < row) --row;
+    }
+
+    QFileInfo fileInfo(QDir(m_watchedPath), newName);
+    DesktopItem &item = m_items[row];
+    ThumbnailService::instance()->invalidate(item.filePath);
+    item.thumbnail.clear();
+    item.thumbnailRequested = false;
+    item.thumbnailFailed = false;
+    m_pathIndex.remove(item.filePath);
+    item.fileName = fileInfo.fileName();
+    item.filePath = fileInfo.absoluteFilePath();
+    item.isDir = fileInfo.isDir();
+    m_pathIndex.insert(item.filePath, row);
+
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {FileNameRole, FilePathRole, IsDirRole, ThumbnailRole});
+
+    // The layout is keyed by file name, keep the icon where the user put it
+    saveCurrentLayout();
 }
 
 void DesktopModel::moveIcon(int index, int newX, int newY) {
@@ -122,25 +284,28 @@ void DesktopModel::saveCurrentLayout() {
         layout[item.fileName] = pos;
     }
     
-    DesktopStateManager sm;
-    sm.saveLayout(layout);
+    DesktopStateManager::instance()->saveLayout(layout);
 }
 
 void DesktopModel::massMove(const QVariantList& selectedPathsList, const QString& leaderPath, int targetX, int targetY, int maxCol, int maxRow) {
-    QStringList selectedPaths;
+    QList<int> movingRows;
+    QBitArray isMoving(m_items.size());
+    movingRows.reserve(selectedPathsList.size());
     for (const QVariant& v : selectedPathsList) {
-        selectedPaths << v.toString();
+        const int row = m_pathIndex.value(v.toString(), -1);
+        if (row != -1 && !isMoving.testBit(row)) {
+            isMoving.setBit(row);
+            movingRows.append(row);
+        }
     }
 
-    if (selectedPaths.isEmpty()) return;
+    if (movingRows.isEmpty()) return;
 
     int oldX = 0, oldY = 0;
-    for (const auto& item : m_items) {
-        if (item.filePath == leaderPath) {
-            oldX = item.gridX;
-            oldY = item.gridY;
-            break;
-        }
+    const int leaderRow = m_pathIndex.value(leaderPath, -1);
+    if (leaderRow != -1) {
+        oldX = m_items[leaderRow].gridX;
+        oldY = m_items[leaderRow].gridY;
     }
 
     int deltaX = targetX - oldX;
@@ -148,20 +313,18 @@ void DesktopModel::massMove(const QVariantList& selectedPathsList, const QString
 
     if (deltaX == 0 && deltaY == 0) return;
 
-    if (selectedPaths.size() == 1 && targetX >= 0 && targetX <= maxCol && targetY >= 0 && targetY <= maxRow) {
-        QString movingPath = selectedPaths.first();
-        int movingIndex = -1;
+    if (movingRows.size() == 1 && targetX >= 0 && targetX <= maxCol && targetY >= 0 && targetY <= maxRow) {
+        const int movingIndex = movingRows.first();
         int targetIndex = -1;
 
         for (int i = 0; i < m_items.size(); ++i) {
-            if (m_items[i].filePath == movingPath) {
-                movingIndex = i;
-            } else if (m_items[i].gridX == targetX && m_items[i].gridY == targetY) {
+            if (i != movingIndex && m_items[i].gridX == targetX && m_items[i].gridY == targetY) {
                 targetIndex = i;
+                break;
             }
         }
 
-        if (targetIndex != -1 && movingIndex != -1) {
+        if (targetIndex != -1) {
             m_items[targetIndex].gridX = oldX;
             m_items[targetIndex].gridY = oldY;
             m_items[movingIndex].gridX = targetX;
@@ -173,45 +336,58 @@ void DesktopModel::massMove(const QVariantList& selectedPathsList, const QString
         }
     }
 
-    QList<DesktopItem*> movingItems;
-    QSet<QString> occupied;
-
+    DesktopGrid occupied(maxRow + 1, maxCol);
     for (int i = 0; i < m_items.size(); ++i) {
-        if (selectedPaths.contains(m_items[i].filePath)) {
-            movingItems.append(&m_items[i]);
-        } else {
-            occupied.insert(QString::number(m_items[i].gridX) + "," + QString::number(m_items[i].gridY));
+        if (!isMoving.testBit(i)) {
+            occupied.occupy(m_items[i].gridX, m_items[i].gridY);
         }
     }
 
-    for (auto* item : movingItems) {
-        int newX = item->gridX + deltaX;
-        int newY = item->gridY + deltaY;
-
-        bool outOfBounds = newX < 0 || newX > maxCol || newY < 0 || newY > maxRow;
-        bool collision = occupied.contains(QString::number(newX) + "," + QString::number(newY));
-
-        if (outOfBounds || collision) {
-            bool found = false;
-            for (int x = 0; x <= maxCol && !found; ++x) {
-                for (int y = 0; y <= maxRow && !found; ++y) {
-                    QString key = QString::number(x) + "," + QString::number(y);
-                    if (!occupied.contains(key)) {
-                        newX = x;
-                        newY = y;
-                        occupied.insert(key);
-                        found = true;
-                    }
-                }
-            }
+    // Icons whose shifted cell is free keep the group's shape and claim
+    // their cells first, so displaced icons can never steal them.
+    QList<int> displaced;
+    for (int row : movingRows) {
+        DesktopItem &item = m_items[row];
+        const int newX = item.gridX + deltaX;
+        const int newY = item.gridY + deltaY;
+
+        if (occupied.contains(newX, newY) && !occupied.isOccupied(newX, newY)) {
+            item.gridX = newX;
+            item.gridY = newY;
+            occupied.occupy(newX, newY);
         } else {
-            occupied.insert(QString::number(newX) + "," + QString::number(newY));
+            displaced.append(row);
         }
+    }
 
-        item->gridX = newX;
-        item->gridY = newY;
+    // The rest land on the free cell nearest to where they were aimed,
+    // closest to the drop point first so the group stays compact.
+    auto distanceToDrop = [&](int row) {
+        const int dx = m_items[row].gridX + deltaX - targetX;
+        const int dy = m_items[row].gridY + deltaY - targetY;
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(displaced.begin(), displaced.end(), [&](int a, int b) {
+        return distanceToDrop(a) < distanceToDrop(b);
+    });
+
+    for (int row : displaced) {
+        DesktopItem &item = m_items[row];
+        const int wantedX = item.gridX + deltaX;
+        const int wantedY = item.gridY + deltaY;
+        const QPoint spot = occupied.nearestFree(wantedX, wantedY);
+
+        if (spot.x() < 0) {
+            // Grid is full, keep the original behaviour of dropping it as aimed
+            item.gridX = wantedX;
+            item.gridY = wantedY;
+            continue;
+        }
+        item.gridX = spot.x();
+        item.gridY = spot.y();
+        occupied.occupy(spot.x(), spot.y());
     }
 
     emit dataChanged(index(0, 0), index(m_items.size() - 1, 0), {GridXRole, GridYRole});
     saveCurrentLayout();
-}
\ No newline at end of file
+}
@@ -2,9 +2,10 @@
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QHash>
 #include <QString>
 #include <QQmlEngine>
-#include <QFileSystemWatcher>
+#include "DesktopWatcher.hpp"
 
 struct DesktopItem {
     QString fileName;
@@ -12,6 +13,11 @@ struct DesktopItem {
     bool isDir;
     int gridX;
     int gridY;
+    // Filled in lazily once a delegate asks for it
+    mutable QString thumbnail;
+    mutable bool thumbnailRequested = false;
+    // Nothing to preview, not asked for again until the file changes
+    bool thumbnailFailed = false;
 };
 
 class DesktopModel : public QAbstractListModel {
@@ -24,7 +30,8 @@ public:
         FilePathRole,
         IsDirRole,
         GridXRole,
-        GridYRole
+        GridYRole,
+        ThumbnailRole
     };
 
     explicit DesktopModel(QObject *parent = nullptr);
@@ -35,6 +42,8 @@ public:
 
     Q_INVOKABLE void loadDirectory(const QString &path);
     Q_INVOKABLE void moveIcon(int index, int newX, int newY);
+    // Stops a pending thumbnail job for a delegate that is going away
+    Q_INVOKABLE void releaseThumbnail(const QString &path);
     Q_INVOKABLE void massMove(const QVariantList &selectedPathsList, const QString &leaderPath, int targetX, int targetY, int maxCol, int maxRow);
 
     Q_PROPERTY(int rows READ rows WRITE setRows NOTIFY rowsChanged)
@@ -51,9 +60,17 @@ signals:
 private:
     int m_rows = 1;
     QList<DesktopItem> m_items;
+    QHash<QString, int> m_pathIndex;
     QString m_watchedPath;
-    QFileSystemWatcher m_watcher;
+    DesktopWatcher m_watcher;
     void saveCurrentLayout();
-    QPoint getEmptySpot(const QSet<QString> &occupied) const;
-    void onDirectoryChanged();
+    void rebuildPathIndex();
+    void onThumbnailReady(const QString &path, const QString &url);
+    void onThumbnailFailed(const QString &path);
+    int indexOfName(const QString &fileName) const;
+
+    void onEntryCreated(const QString &name);
+    void onEntryRemoved(const QString &name);
+    void onEntryModified(const QString &name);
+    void onEntryRenamed(const QString &oldName, const QString &newName);
 };
\ No newline at end of file
@@ -2,12 +2,43 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
+#include <QCoreApplication>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDebug>
-#include <QJsonArray>
 
-DesktopStateManager::DesktopStateManager(QObject *parent) : QObject(parent) {}
+namespace {
+// Drags and mass moves come in bursts, one write per burst is enough
+constexpr int LAYOUT_SAVE_DELAY_MS = 500;
+}
+
+DesktopStateManager *DesktopStateManager::instance() {
+    static DesktopStateManager *manager = new DesktopStateManager();
+    return manager;
+}
+
+DesktopStateManager *DesktopStateManager::create(QQmlEngine *, QJSEngine *) {
+    DesktopStateManager *manager = instance();
+    QJSEngine::setObjectOwnership(manager, QJSEngine::CppOwnership);
+    return manager;
+}
+
+DesktopStateManager::DesktopStateManager(QObject *parent) : QObject(parent) {
+    m_writer.setMaxThreadCount(1);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(LAYOUT_SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &DesktopStateManager::writeLayout);
+
+    // Don't lose the last moves of the session to the debounce window
+    if (QCoreApplication::instance())
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &DesktopStateManager::flush);
+}
+
+DesktopStateManager::~DesktopStateManager() {
+    flush();
+}
 
 QString DesktopStateManager::getConfigFilePath() const {
     QString configDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex";
@@ -18,24 +49,14 @@ QString DesktopStateManager::getConfigFilePath() const {
     return configDir + "/desktop_layout.json"; 
 }
 
-void DesktopStateManager::saveLayout(const QVariantMap& layout) {
-    QJsonObject jsonObj = QJsonObject::fromVariantMap(layout);
-    QJsonDocument doc(jsonObj);
-    QFile file(getConfigFilePath());
-    
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
-    } else {
-        qWarning() << "Sleex: Cannot save desktop layout to" << getConfigFilePath();
-    }
-}
+void DesktopStateManager::ensureLayoutLoaded() {
+    if (m_layoutLoaded) return;
+    m_layoutLoaded = true;
 
-QVariantMap DesktopStateManager::getLayout() {
     QFile file(getConfigFilePath());
     
     if (!file.open(QIODevice::ReadOnly)) {
-        return QVariantMap();
+        return;
     }
 
     QByteArray data = file.readAll();
@@ -43,47 +64,49 @@ QVariantMap DesktopStateManager::getLayout() {
 
     QJsonDocument doc = QJsonDocument::fromJson(data);
     if (doc.isObject()) {
-        return doc.object().toVariantMap();
+        m_layout = doc.object().toVariantMap();
     }
-
-    return QVariantMap();
 }
 
-QString DesktopStateManager::getPostItsFilePath() const {
-    QString configDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex";
-    QDir dir(configDir);
-    if (!dir.exists()) dir.mkpath(".");
-    
-    return configDir + "/postits.json"; 
+void DesktopStateManager::saveLayout(const QVariantMap& layout) {
+    m_layoutLoaded = true;
+    if (m_layout == layout) return;
+
+    m_layout = layout;
+    m_layoutDirty = true;
+    m_saveTimer.start();
 }
 
-void DesktopStateManager::savePostIts(const QVariantList& postits) {
-    QJsonArray jsonArr = QJsonArray::fromVariantList(postits);
-    QJsonDocument doc(jsonArr);
-    QFile file(getPostItsFilePath());
-    
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
-    } else {
-        qWarning() << "Sleex: Cannot save post-its to" << getPostItsFilePath();
-    }
+QVariantMap DesktopStateManager::getLayout() {
+    ensureLayoutLoaded();
+    return m_layout;
 }
 
-QVariantList DesktopStateManager::getPostIts() {
-    QFile file(getPostItsFilePath());
-    
-    if (!file.open(QIODevice::ReadOnly)) {
-        return QVariantList();
-    }
+void DesktopStateManager::writeLayout() {
+    m_saveTimer.stop();
+    if (!m_layoutDirty) return;
+    m_layoutDirty = false;
 
-    QByteArray data = file.readAll();
-    file.close();
+    const QVariantMap snapshot = m_layout;
+    const QString path = getConfigFilePath();
+    const quint64 generation = ++m_layoutGeneration;
 
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isArray()) {
-        return doc.array().toVariantList();
-    }
+    m_writer.start([this, snapshot, path, generation]() {
+        // A newer snapshot is already queued behind us
+        if (generation != m_layoutGeneration) return;
 
-    return QVariantList();
-}
\ No newline at end of file
+        const QByteArray data = QJsonDocument(QJsonObject::fromVariantMap(snapshot)).toJson(QJsonDocument::Compact);
+
+        // QSaveFile writes to a temporary file and renames it over the old
+        // one on commit, so a crash mid-write leaves the previous layout intact
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning() << "Sleex: Cannot save desktop layout to" << path;
+        }
+    });
+}
+
+void DesktopStateManager::flush() {
+    writeLayout();
+    m_writer.waitForDone();
+}
@@ -2,8 +2,10 @@
 
 #include <QObject>
 #include <QVariantMap>
-#include <QVariantList>
 #include <QQmlEngine>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
 
 class DesktopStateManager : public QObject {
     Q_OBJECT
@@ -11,15 +13,30 @@ class DesktopStateManager : public QObject {
     QML_SINGLETON
 
 public:
-    explicit DesktopStateManager(QObject *parent = nullptr);
+    // One shared instance so QML and DesktopModel see the same cached layout
+    static DesktopStateManager *instance();
+    static DesktopStateManager *create(QQmlEngine *, QJSEngine *);
+
+    ~DesktopStateManager() override;
 
     Q_INVOKABLE void saveLayout(const QVariantMap& layout);
     Q_INVOKABLE QVariantMap getLayout();
-    
-    Q_INVOKABLE void savePostIts(const QVariantList& postits);
-    Q_INVOKABLE QVariantList getPostIts();
+    // Writes any pending layout change right away and waits for it
+    Q_INVOKABLE void flush();
 
 private:
+    explicit DesktopStateManager(QObject *parent = nullptr);
+
     QString getConfigFilePath() const;
-    QString getPostItsFilePath() const;
+
+    void ensureLayoutLoaded();
+    void writeLayout();
+
+    QVariantMap m_layout;
+    bool m_layoutLoaded = false;
+    bool m_layoutDirty = false;
+    QTimer m_saveTimer;
+    // Single writer thread, so snapshots hit the disk in the order they were taken
+    QThreadPool m_writer;
+    std::atomic<quint64> m_layoutGeneration = 0;
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "DesktopWatcher.hpp"
+#include <QSocketNotifier>
+#include <QFile>
+#include <QDebug>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace {
+// Long enough for the kernel to hand over both halves of a rename, short
+// enough that a file dragged out of ~/Desktop disappears without lag.
+constexpr int MOVE_PAIR_TIMEOUT_MS = 50;
+
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                              | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF;
+}
+
+DesktopWatcher::DesktopWatcher(QObject *parent) : QObject(parent) {
+    m_moveTimer.setSingleShot(true);
+    m_moveTimer.setInterval(MOVE_PAIR_TIMEOUT_MS);
+    connect(&m_moveTimer, &QTimer::timeout, this, &DesktopWatcher::flushPendingMoves);
+}
+
+DesktopWatcher::~DesktopWatcher() {
+    stop();
+}
+
+bool DesktopWatcher::watch(const QString &path) {
+    stop();
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        qWarning() << "Sleex: inotify_init1 failed:" << strerror(errno);
+        return false;
+    }
+
+    m_wd = inotify_add_watch(m_fd, QFile::encodeName(path).constData(), WATCH_MASK | IN_ONLYDIR);
+    if (m_wd < 0) {
+        qWarning() << "Sleex: Cannot watch" << path << ":" << strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_path = path;
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &DesktopWatcher::readEvents);
+    return true;
+}
+
+void DesktopWatcher::stop() {
+    m_moveTimer.stop();
+    m_pendingMoves.clear();
+
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_fd >= 0) {
+        if (m_wd >= 0) inotify_rm_watch(m_fd, m_wd);
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_wd = -1;
+    m_path.clear();
+}
+
+void DesktopWatcher::readEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+    bool resync = false;
+
+    for (;;) {
+        const ssize_t len = ::read(m_fd, buffer, sizeof(buffer));
+        if (len <= 0) break;
+
+        for (char *ptr = buffer; ptr < buffer + len; ) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                resync = true;
+                continue;
+            }
+            if (event->len == 0) continue;
+
+            const QString name = QFile::decodeName(event->name);
+
+            if (event->mask & IN_MOVED_FROM) {
+                m_pendingMoves.insert(event->cookie, name);
+                m_moveTimer.start();
+            } else if (event->mask & IN_MOVED_TO) {
+                const QString oldName = m_pendingMoves.take(event->cookie);
+                if (oldName.isEmpty())
+                    emit entryCreated(name);
+                else
+                    emit entryRenamed(oldName, name);
+            } else if (event->mask & IN_CREATE) {
+                emit entryCreated(name);
+            } else if (event->mask & IN_DELETE) {
+                emit entryRemoved(name);
+            } else if (event->mask & IN_CLOSE_WRITE) {
+                emit entryModified(name);
+            }
+        }
+    }
+
+    if (resync) {
+        // Stale cookies are meaningless after a rescan
+        m_moveTimer.stop();
+        m_pendingMoves.clear();
+        emit resyncRequired();
+    }
+}
+
+void DesktopWatcher::flushPendingMoves() {
+    const auto pending = std::exchange(m_pendingMoves, {});
+    for (const QString &name : pending)
+        emit entryRemoved(name);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// Thin inotify wrapper reporting the exact entry names that changed in a
+// single directory, so the model can patch rows instead of re-listing.
+class DesktopWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DesktopWatcher(QObject *parent = nullptr);
+    ~DesktopWatcher() override;
+
+    bool watch(const QString &path);
+    void stop();
+
+    QString path() const { return m_path; }
+
+signals:
+    void entryCreated(const QString &name);
+    void entryRemoved(const QString &name);
+    void entryModified(const QString &name);
+    void entryRenamed(const QString &oldName, const QString &newName);
+    // The directory itself went away or the kernel queue overflowed,
+    // the listener has to rescan from scratch.
+    void resyncRequired();
+
+private:
+    void readEvents();
+    void flushPendingMoves();
+
+    int m_fd = -1;
+    int m_wd = -1;
+    QString m_path;
+    QSocketNotifier *m_notifier = nullptr;
+
+    // IN_MOVED_FROM halves waiting for their IN_MOVED_TO, keyed by cookie.
+    // Anything still unmatched when the timer fires was moved out of the
+    // directory and is reported as a removal.
+    QHash<quint32, QString> m_pendingMoves;
+    QTimer m_moveTimer;
+};
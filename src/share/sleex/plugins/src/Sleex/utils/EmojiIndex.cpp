@@ -0,0 +1,269 @@
+#include "EmojiIndex.hpp"
+#include <QFile>
+#include <QHash>
+#include <QDebug>
+#include <algorithm>
+#include <map>
+
+namespace {
+const QByteArray DATA_MARKER = QByteArrayLiteral("### DATA ###");
+
+// A fuzzy hit has to cover at least this share of the keyword
+constexpr float MIN_FUZZY_COVERAGE = 0.34f;
+
+bool isSubsequence(const char *needle, int m, const char *haystack, int n) {
+    int j = 0;
+    for (int i = 0; i < n && j < m; ++i) {
+        if (haystack[i] == needle[j]) ++j;
+    }
+    return j == m;
+}
+
+std::shared_ptr<const EmojiData> parse(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Sleex: cannot read emoji data from" << path;
+        return nullptr;
+    }
+    const QByteArray content = file.readAll();
+
+    qsizetype pos = content.indexOf("\n" + DATA_MARKER + "\n");
+    if (pos < 0) {
+        qWarning() << "Sleex: no data section in" << path;
+        return nullptr;
+    }
+    pos += DATA_MARKER.size() + 2;
+
+    auto data = std::make_shared<EmojiData>();
+    data->arena.reserve(content.size() - pos);
+
+    // keyword -> emoji ids, ordered so the flattened list can be binary searched
+    std::map<QByteArray, QVector<quint16>> keywords;
+
+    while (pos < content.size()) {
+        qsizetype end = content.indexOf('\n', pos);
+        if (end < 0) end = content.size();
+        const QByteArray line = content.mid(pos, end - pos).trimmed();
+        pos = end + 1;
+        if (line.isEmpty() || data->count() >= 0xffff) continue;
+
+        const int emoji = data->count();
+        const qsizetype space = line.indexOf(' ');
+        data->lineOffsets.append(quint32(data->arena.size()));
+        data->glyphLengths.append(quint8(qMin<qsizetype>(space < 0 ? line.size() : space, 255)));
+        data->arena.append(line);
+
+        if (space < 0) continue;
+        const QString description = QString::fromUtf8(line.mid(space + 1)).toLower();
+        for (const QString &word : description.split(' ', Qt::SkipEmptyParts)) {
+            QVector<quint16> &ids = keywords[word.toUtf8()];
+            if (ids.isEmpty() || ids.last() != emoji) ids.append(quint16(emoji));
+        }
+    }
+    data->lineOffsets.append(quint32(data->arena.size()));
+
+    data->keywords.reserve(int(keywords.size()));
+    for (const auto &[word, ids] : keywords) {
+        EmojiData::Keyword keyword;
+        keyword.offset = quint32(data->keywordArena.size());
+        keyword.length = quint16(word.size());
+        keyword.postingsBegin = quint32(data->postings.size());
+        keyword.postingsCount = quint16(ids.size());
+        data->keywordArena.append(word);
+        data->postings.append(ids);
+        data->keywords.append(keyword);
+    }
+    data->arena.squeeze();
+    data->keywordArena.squeeze();
+    return data;
+}
+}
+
+QString EmojiData::line(int emoji) const {
+    return QString::fromUtf8(arena.constData() + lineOffsets.at(emoji), lineOffsets.at(emoji + 1) - lineOffsets.at(emoji));
+}
+
+QString EmojiData::glyph(int emoji) const {
+    return QString::fromUtf8(arena.constData() + lineOffsets.at(emoji), glyphLengths.at(emoji));
+}
+
+QString EmojiData::description(int emoji) const {
+    const int start = lineOffsets.at(emoji) + glyphLengths.at(emoji) + 1;
+    const int end = lineOffsets.at(emoji + 1);
+    return start < end ? QString::fromUtf8(arena.constData() + start, end - start) : QString();
+}
+
+QVector<EmojiData::Hit> EmojiData::query(const QString &text) const {
+    QVector<Hit> hits;
+    const QStringList words = text.toLower().split(' ', Qt::SkipEmptyParts);
+    if (words.isEmpty()) {
+        hits.reserve(count());
+        for (int i = 0; i < count(); ++i) hits.append({ i, 0.0f });
+        return hits;
+    }
+
+    const char *base = keywordArena.constData();
+    const auto keywordView = [base](const Keyword &keyword) {
+        return QByteArrayView(base + keyword.offset, keyword.length);
+    };
+
+    QHash<int, float> scores;
+    for (int w = 0; w < words.size(); ++w) {
+        const QByteArray word = words.at(w).toUtf8();
+        QHash<int, float> wordScores;
+        const auto credit = [&](const Keyword &keyword, float score) {
+            for (quint32 p = keyword.postingsBegin; p < keyword.postingsBegin + keyword.postingsCount; ++p) {
+                float &best = wordScores[postings.at(p)];
+                best = std::max(best, score);
+            }
+        };
+
+        // Prefix hits form one contiguous run of the sorted keywords
+        auto it = std::lower_bound(keywords.cbegin(), keywords.cend(), word, [&](const Keyword &keyword, const QByteArray &needle) {
+            return keywordView(keyword) < QByteArrayView(needle);
+        });
+        for (; it != keywords.cend() && keywordView(*it).startsWith(word); ++it) {
+            // Exact 3, otherwise 2 plus how much of the keyword was typed
+            const float score = it->length == word.size() ? 3.0f : 2.0f + float(word.size()) / it->length;
+            credit(*it, score);
+        }
+
+        if (wordScores.isEmpty()) {
+            for (const Keyword &keyword : keywords) {
+                const float coverage = float(word.size()) / keyword.length;
+                if (coverage < MIN_FUZZY_COVERAGE || coverage > 1.0f) continue;
+                if (isSubsequence(word.constData(), word.size(), base + keyword.offset, keyword.length))
+                    credit(keyword, coverage);
+            }
+        }
+
+        // Every word has to match
+        if (w == 0) {
+            scores = wordScores;
+        } else {
+            for (auto s = scores.begin(); s != scores.end();) {
+                const auto found = wordScores.constFind(s.key());
+                if (found == wordScores.cend()) {
+                    s = scores.erase(s);
+                } else {
+                    s.value() += found.value();
+                    ++s;
+                }
+            }
+        }
+        if (scores.isEmpty()) break;
+    }
+
+    hits.reserve(scores.size());
+    for (auto it = scores.cbegin(); it != scores.cend(); ++it) hits.append({ it.key(), it.value() });
+    // Data order is rough popularity, keep it among equal scores
+    std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) {
+        return a.score != b.score ? a.score > b.score : a.emoji < b.emoji;
+    });
+    return hits;
+}
+
+EmojiIndex::EmojiIndex(QObject *parent) : QAbstractListModel(parent) {
+    // One worker, a parse and the queries after it run in order
+    m_pool.setMaxThreadCount(1);
+    // Queued, so a source set from QML is in place before the first parse
+    QMetaObject::invokeMethod(this, &EmojiIndex::load, Qt::QueuedConnection);
+}
+
+EmojiIndex::~EmojiIndex() {
+    ++m_loadGeneration;
+    ++m_queryGeneration;
+    m_pool.waitForDone();
+}
+
+void EmojiIndex::setSource(const QString &v) {
+    if (m_source == v) return;
+    m_source = v;
+    emit sourceChanged();
+    if (m_loadGeneration > 0) load();
+}
+
+void EmojiIndex::setQuery(const QString &v) {
+    if (m_query == v) return;
+    m_query = v;
+    emit queryChanged();
+    runQuery();
+}
+
+void EmojiIndex::load() {
+    const quint64 generation = ++m_loadGeneration;
+    const QString source = m_source;
+
+    m_pool.start([this, generation, source]() {
+        std::shared_ptr<const EmojiData> data = parse(source);
+        QMetaObject::invokeMethod(this, [this, generation, data]() {
+            if (generation != m_loadGeneration) return;
+            m_data = data;
+            emit readyChanged();
+            runQuery();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void EmojiIndex::runQuery() {
+    const quint64 generation = ++m_queryGeneration;
+    const std::shared_ptr<const EmojiData> data = m_data;
+    if (!data) return;
+    const QString query = m_query;
+
+    m_pool.start([this, generation, data, query]() {
+        if (generation != m_queryGeneration) return; // Superseded while queued
+        const QVector<EmojiData::Hit> hits = data->query(query);
+        QMetaObject::invokeMethod(this, [this, generation, data, hits]() {
+            if (generation != m_queryGeneration) return;
+            beginResetModel();
+            m_hitsData = data;
+            m_hits = hits;
+            endResetModel();
+            emit resultsChanged();
+        }, Qt::QueuedConnection);
+    });
+}
+
+QStringList EmojiIndex::results() const {
+    QStringList lines;
+    lines.reserve(m_hits.size());
+    for (const EmojiData::Hit &hit : m_hits) lines.append(m_hitsData->line(hit.emoji));
+    return lines;
+}
+
+QStringList EmojiIndex::search(const QString &query) const {
+    QStringList lines;
+    if (!m_data) return lines;
+    const QVector<EmojiData::Hit> hits = m_data->query(query);
+    lines.reserve(hits.size());
+    for (const EmojiData::Hit &hit : hits) lines.append(m_data->line(hit.emoji));
+    return lines;
+}
+
+int EmojiIndex::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : m_hits.size();
+}
+
+QVariant EmojiIndex::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_hits.size()) return QVariant();
+    const EmojiData::Hit &hit = m_hits.at(index.row());
+
+    switch (role) {
+        case GlyphRole: return m_hitsData->glyph(hit.emoji);
+        case Qt::DisplayRole:
+        case DescriptionRole: return m_hitsData->description(hit.emoji);
+        case LineRole: return m_hitsData->line(hit.emoji);
+        case ScoreRole: return hit.score;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> EmojiIndex::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[GlyphRole] = "glyph";
+    roles[DescriptionRole] = "description";
+    roles[LineRole] = "line";
+    roles[ScoreRole] = "score";
+    return roles;
+}
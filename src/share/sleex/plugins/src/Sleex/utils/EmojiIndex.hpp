@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+#include <memory>
+
+// Emoji data parsed once into flat arrays: every line sits in one UTF-8
+// arena, keywords in another, sorted, each pointing at a run of emoji ids.
+// Immutable after it is built, so queries on the worker share it freely.
+struct EmojiData {
+    struct Keyword {
+        quint32 offset;
+        quint16 length;
+        quint32 postingsBegin;
+        quint16 postingsCount;
+    };
+
+    struct Hit {
+        int   emoji;
+        float score;
+    };
+
+    QByteArray       arena;
+    // count() + 1 entries, line i is arena[lineOffsets[i], lineOffsets[i + 1])
+    QVector<quint32> lineOffsets;
+    // Bytes of the glyph at the start of each line
+    QVector<quint8>  glyphLengths;
+
+    QByteArray       keywordArena;
+    QVector<Keyword> keywords;
+    QVector<quint16> postings;
+
+    int count() const { return glyphLengths.size(); }
+    QString line(int emoji) const;
+    QString glyph(int emoji) const;
+    QString description(int emoji) const;
+
+    QVector<Hit> query(const QString &text) const;
+};
+
+// Emoji picker search. The data section of the fuzzel-emoji script is
+// parsed on a worker thread, the UI never pays for it. Each query word
+// matches keyword prefixes through a binary search, falling back to
+// subsequence matching over the keyword list when no prefix hits; an emoji
+// has to match every word. Setting query ranks on the worker and fills the
+// model and results once the newest query is done, older ones are dropped.
+class EmojiIndex : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged FINAL)
+    Q_PROPERTY(QString query  READ query  WRITE setQuery  NOTIFY queryChanged FINAL)
+    Q_PROPERTY(bool ready      READ ready      NOTIFY readyChanged FINAL)
+    Q_PROPERTY(int  emojiCount READ emojiCount NOTIFY readyChanged FINAL)
+    Q_PROPERTY(int  count      READ count      NOTIFY resultsChanged FINAL)
+    // Ranked "glyph description" lines of the model, for callers mapping over an array
+    Q_PROPERTY(QStringList results READ results NOTIFY resultsChanged FINAL)
+
+public:
+    enum Roles {
+        GlyphRole = Qt::UserRole + 1,
+        DescriptionRole,
+        LineRole,
+        ScoreRole
+    };
+
+    explicit EmojiIndex(QObject *parent = nullptr);
+    ~EmojiIndex() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString source() const { return m_source; }
+    void setSource(const QString &v);
+
+    QString query() const { return m_query; }
+    void setQuery(const QString &v);
+
+    bool ready()      const { return m_data != nullptr; }
+    int  emojiCount() const { return m_data ? m_data->count() : 0; }
+    int  count()      const { return m_hits.size(); }
+    QStringList results() const;
+
+    // Ranks on the calling thread, empty until the data is loaded
+    Q_INVOKABLE QStringList search(const QString &query) const;
+
+signals:
+    void sourceChanged();
+    void queryChanged();
+    void readyChanged();
+    void resultsChanged();
+
+private:
+    void load();
+    void runQuery();
+
+    QString m_source = QStringLiteral("/bin/fuzzel-emoji");
+    QString m_query;
+
+    QThreadPool m_pool;
+    quint64 m_loadGeneration = 0;
+    quint64 m_queryGeneration = 0;
+
+    std::shared_ptr<const EmojiData> m_data;
+    // The hits index the data they were ranked on, which a reload may have replaced
+    std::shared_ptr<const EmojiData> m_hitsData;
+    QVector<EmojiData::Hit> m_hits;
+};
@@ -0,0 +1,415 @@
+#include "IconResolver.hpp"
+#include "AppSearchIndex.hpp"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QIcon>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <climits>
+
+namespace {
+// Bump when the on-disk layout changes
+constexpr quint32 INDEX_MAGIC = 0x534c4958; // "SLIX"
+constexpr quint32 INDEX_VERSION = 1;
+
+const QString MISSING_ICON = QStringLiteral("image-missing");
+
+QStringList dataDirs() {
+    QStringList dirs;
+    const QString home = qEnvironmentVariable("XDG_DATA_HOME", QDir::homePath() + "/.local/share");
+    dirs << home;
+    const QString system = qEnvironmentVariable("XDG_DATA_DIRS", "/usr/local/share:/usr/share");
+    dirs << system.split(':', Qt::SkipEmptyParts);
+    return dirs;
+}
+
+// Base directories in lookup order, as in the icon theme spec
+QStringList iconRoots() {
+    QStringList roots;
+    roots << QDir::homePath() + "/.icons";
+    for (const QString &dir : dataDirs()) roots << dir + "/icons";
+    return roots;
+}
+
+QStringList pixmapDirs() {
+    QStringList dirs;
+    for (const QString &dir : dataDirs()) dirs << dir + "/pixmaps";
+    return dirs;
+}
+
+qint64 stampOf(const QString &path) {
+    const QFileInfo info(path);
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+// Minimal desktop-entry style ini reader, index.theme only needs groups and keys
+QHash<QString, QHash<QString, QString>> parseIndexTheme(const QString &path) {
+    QHash<QString, QHash<QString, QString>> groups;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return groups;
+
+    QString group;
+    while (!file.atEnd()) {
+        const QString line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        if (line.startsWith('[') && line.endsWith(']')) {
+            group = line.mid(1, line.size() - 2);
+            continue;
+        }
+        const int eq = line.indexOf('=');
+        if (eq > 0) groups[group].insert(line.left(eq).trimmed(), line.mid(eq + 1).trimmed());
+    }
+    return groups;
+}
+
+QString themeDir(const QString &root, const QString &theme) {
+    const QString dir = root + '/' + theme;
+    return QFileInfo::exists(dir + "/index.theme") ? dir : QString();
+}
+
+// theme, its Inherits breadth-first, hicolor always last
+QStringList themeChain(const QString &theme, const QStringList &roots) {
+    QStringList chain;
+    QStringList queue { theme };
+    while (!queue.isEmpty()) {
+        const QString name = queue.takeFirst();
+        if (name.isEmpty() || chain.contains(name) || name == "hicolor") continue;
+        chain << name;
+
+        for (const QString &root : roots) {
+            const QString dir = themeDir(root, name);
+            if (dir.isEmpty()) continue;
+            const QString inherits = parseIndexTheme(dir + "/index.theme").value("Icon Theme").value("Inherits");
+            queue << inherits.split(',', Qt::SkipEmptyParts);
+            break;
+        }
+    }
+    chain << "hicolor";
+    return chain;
+}
+
+QString iconName(const QString &fileName) {
+    const int dot = fileName.lastIndexOf('.');
+    return dot > 0 ? fileName.left(dot) : fileName;
+}
+
+IconIndex buildIndex(const QString &theme) {
+    IconIndex index;
+    index.theme = theme;
+
+    const QStringList roots = iconRoots();
+    for (const QString &root : roots) index.stamps.append({ root, stampOf(root) });
+
+    const QStringList filters { "*.png", "*.svg", "*.xpm" };
+    for (const QString &name : themeChain(theme, roots)) {
+        // The first theme of the chain providing a name owns all its sizes
+        QHash<QString, QVector<IconFile>> themeIcons;
+
+        for (const QString &root : roots) {
+            const QString dir = root + '/' + name;
+            const qint64 stamp = stampOf(dir);
+            if (stamp < 0) continue;
+            index.stamps.append({ dir, stamp });
+
+            const auto groups = parseIndexTheme(dir + "/index.theme");
+            const QHash<QString, QString> header = groups.value("Icon Theme");
+            QStringList subdirs = header.value("Directories").split(',', Qt::SkipEmptyParts);
+            subdirs << header.value("ScaledDirectories").split(',', Qt::SkipEmptyParts);
+
+            for (const QString &subdir : std::as_const(subdirs)) {
+                const QString path = dir + '/' + subdir;
+                const qint64 subStamp = stampOf(path);
+                if (subStamp < 0) continue;
+                index.stamps.append({ path, subStamp });
+
+                const QHash<QString, QString> info = groups.value(subdir);
+                IconFile file;
+                file.size = quint16(info.value("Size").toInt() * qMax(1, info.value("Scale", "1").toInt()));
+                file.scalable = info.value("Type").compare("Scalable", Qt::CaseInsensitive) == 0;
+
+                const QStringList files = QDir(path).entryList(filters, QDir::Files);
+                for (const QString &fileName : files) {
+                    file.path = path + '/' + fileName;
+                    themeIcons[iconName(fileName)].append(file);
+                }
+            }
+        }
+
+        for (auto it = themeIcons.cbegin(); it != themeIcons.cend(); ++it) {
+            if (!index.icons.contains(it.key())) index.icons.insert(it.key(), it.value());
+        }
+    }
+
+    // Unthemed fallback
+    for (const QString &dir : pixmapDirs()) {
+        const qint64 stamp = stampOf(dir);
+        index.stamps.append({ dir, stamp });
+        if (stamp < 0) continue;
+
+        const QStringList files = QDir(dir).entryList(filters, QDir::Files);
+        for (const QString &fileName : files) {
+            const QString name = iconName(fileName);
+            if (index.icons.contains(name)) continue;
+            IconFile file;
+            file.scalable = fileName.endsWith(".svg");
+            file.path = dir + '/' + fileName;
+            index.icons[name].append(file);
+        }
+    }
+    return index;
+}
+
+QString cachePath(const QString &theme) {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + "/sleex/icon-index-" + theme + ".bin";
+}
+
+bool loadIndex(const QString &theme, IconIndex &index) {
+    QFile file(cachePath(theme));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) return false;
+
+    in >> index.theme;
+    if (index.theme != theme) return false;
+
+    quint32 stampCount = 0;
+    in >> stampCount;
+    for (quint32 i = 0; i < stampCount && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        qint64 stamp = 0;
+        in >> path >> stamp;
+        // Any directory that changed (or appeared / vanished) means a rebuild
+        if (stampOf(path) != stamp) return false;
+        index.stamps.append({ path, stamp });
+    }
+
+    quint32 iconCount = 0;
+    in >> iconCount;
+    index.icons.reserve(iconCount);
+    for (quint32 i = 0; i < iconCount && in.status() == QDataStream::Ok; ++i) {
+        QString name;
+        quint32 fileCount = 0;
+        in >> name >> fileCount;
+        if (fileCount > 1024) return false; // Corrupt
+        QVector<IconFile> files(fileCount);
+        for (IconFile &file : files) in >> file.size >> file.scalable >> file.path;
+        index.icons.insert(name, files);
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void saveIndex(const IconIndex &index) {
+    const QString path = cachePath(index.theme);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    QDataStream out(&file);
+    out << INDEX_MAGIC << INDEX_VERSION << index.theme;
+    out << quint32(index.stamps.size());
+    for (const auto &stamp : index.stamps) out << stamp.first << stamp.second;
+    out << quint32(index.icons.size());
+    for (auto it = index.icons.cbegin(); it != index.icons.cend(); ++it) {
+        out << it.key() << quint32(it.value().size());
+        for (const IconFile &file : it.value()) out << file.size << file.scalable << file.path;
+    }
+    file.commit();
+}
+
+// JS replacement syntax ($1, $&) to QRegularExpression captures
+QString expandReplacement(const QString &replace, const QRegularExpressionMatch &match) {
+    QString out;
+    for (int i = 0; i < replace.size(); ++i) {
+        const QChar c = replace.at(i);
+        if (c == '$' && i + 1 < replace.size()) {
+            const QChar next = replace.at(i + 1);
+            if (next.isDigit()) {
+                out += match.captured(next.digitValue());
+                ++i;
+                continue;
+            }
+            if (next == '&') {
+                out += match.captured(0);
+                ++i;
+                continue;
+            }
+        }
+        out += c;
+    }
+    return out;
+}
+}
+
+IconResolver::IconResolver(QObject *parent) : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+    const QString theme = QIcon::themeName();
+    setThemeName(theme.isEmpty() ? QStringLiteral("hicolor") : theme);
+}
+
+IconResolver::~IconResolver() {
+    ++m_generation;
+    m_pool.waitForDone();
+}
+
+void IconResolver::setThemeName(const QString &v) {
+    if (m_themeName == v || v.isEmpty()) return;
+    m_themeName = v;
+    emit themeNameChanged();
+    refresh();
+}
+
+void IconResolver::setSubstitutions(const QVariantMap &v) {
+    if (m_substitutions == v) return;
+    m_substitutions = v;
+    emit rulesChanged();
+    invalidate();
+}
+
+void IconResolver::setRegexSubstitutions(const QVariantList &v) {
+    if (m_regexSubstitutions == v) return;
+    m_regexSubstitutions = v;
+
+    m_rules.clear();
+    for (const QVariant &rule : v) {
+        const QVariantMap map = rule.toMap();
+        const QRegularExpression regex(map.value("regex").toString());
+        if (!regex.isValid()) {
+            qWarning() << "Sleex: invalid icon regex" << regex.pattern() << regex.errorString();
+            continue;
+        }
+        m_rules.append({ regex, map.value("replace").toString() });
+    }
+    emit rulesChanged();
+    invalidate();
+}
+
+void IconResolver::setSearchIndex(AppSearchIndex *v) {
+    if (m_searchIndex == v) return;
+    if (m_searchIndex) m_searchIndex->disconnect(this);
+    m_searchIndex = v;
+    // Fallback answers depend on the installed applications, and new
+    // applications usually bring icons, so re-check the stamps as well
+    if (m_searchIndex) connect(m_searchIndex, &AppSearchIndex::entriesChanged, this, &IconResolver::refresh);
+    emit searchIndexChanged();
+    invalidate();
+}
+
+void IconResolver::refresh() {
+    const quint64 generation = ++m_generation;
+    const QString theme = m_themeName;
+
+    m_pool.start([this, generation, theme]() {
+        IconIndex index;
+        if (!loadIndex(theme, index)) {
+            index = buildIndex(theme);
+            saveIndex(index);
+        }
+        QMetaObject::invokeMethod(this, [this, generation, index]() {
+            onIndexLoaded(generation, index);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void IconResolver::onIndexLoaded(quint64 generation, const IconIndex &index) {
+    if (generation != m_generation) return;
+    m_index = index;
+    m_ready = true;
+    invalidate();
+}
+
+void IconResolver::invalidate() {
+    m_decisions.clear();
+    ++m_revision;
+    emit revisionChanged();
+}
+
+bool IconResolver::iconExists(const QString &name) const {
+    if (name.isEmpty() || name.contains(MISSING_ICON)) return false;
+    if (name.startsWith('/')) return QFileInfo::exists(name);
+    return m_index.icons.contains(name);
+}
+
+QString IconResolver::lookup(const QString &name, int size) const {
+    if (name.startsWith('/')) return QFileInfo::exists(name) ? name : QString();
+    const auto it = m_index.icons.constFind(name);
+    if (it == m_index.icons.cend() || it->isEmpty()) return QString();
+
+    const IconFile *best = nullptr;
+    int bestDistance = INT_MAX;
+    for (const IconFile &file : *it) {
+        int distance;
+        if (size <= 0)
+            distance = file.scalable ? INT_MIN : -int(file.size);
+        else if (file.size == size)
+            distance = INT_MIN;
+        else if (file.scalable)
+            distance = INT_MIN + 1;
+        else
+            // Downscaling looks better than upscaling
+            distance = file.size > size ? file.size - size : 2 * (size - file.size);
+
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = &file;
+        }
+    }
+    return best ? best->path : QString();
+}
+
+QString IconResolver::guessIcon(const QString &className) {
+    if (className.isEmpty()) return MISSING_ICON;
+
+    const auto memo = m_decisions.constFind(className);
+    if (memo != m_decisions.cend()) return *memo;
+
+    QString icon;
+    if (m_substitutions.contains(className)) {
+        icon = m_substitutions.value(className).toString();
+    } else {
+        for (const auto &rule : std::as_const(m_rules)) {
+            const QRegularExpressionMatch match = rule.first.match(className);
+            if (!match.hasMatch()) continue;
+            const QString replaced = className.left(match.capturedStart())
+                + expandReplacement(rule.second, match)
+                + className.mid(match.capturedEnd());
+            if (replaced != className) {
+                icon = replaced;
+                break;
+            }
+        }
+    }
+
+    // Rules do not need the index, everything below waits for it
+    if (icon.isEmpty() && !m_ready) return className;
+
+    if (icon.isEmpty() && iconExists(className)) icon = className;
+    if (icon.isEmpty()) {
+        // Last part of reverse domain name notation
+        const QString guess = className.section('.', -1).toLower();
+        if (iconExists(guess)) icon = guess;
+    }
+    if (icon.isEmpty()) {
+        static const QRegularExpression whitespace(QStringLiteral("\\s+"));
+        const QString guess = className.toLower().replace(whitespace, QStringLiteral("-"));
+        if (iconExists(guess)) icon = guess;
+    }
+    if (icon.isEmpty() && m_searchIndex) {
+        if (QObject *entry = m_searchIndex->bestMatch(className)) {
+            const QString guess = entry->property("icon").toString();
+            if (iconExists(guess)) icon = guess;
+        }
+    }
+    // Give up, the caller's own lookup gets the raw class
+    if (icon.isEmpty()) icon = className;
+
+    m_decisions.insert(className, icon);
+    return icon;
+}
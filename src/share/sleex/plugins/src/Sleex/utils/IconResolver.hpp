@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+class AppSearchIndex;
+
+struct IconFile {
+    quint16 size = 0;
+    bool    scalable = false;
+    QString path;
+};
+
+// Icon names of the active theme chain (theme, its Inherits, hicolor, then
+// pixmaps), each with every size the winning theme ships. Kept on disk in
+// ~/.cache/sleex and reused while none of the scanned directories changed
+// their mtime.
+struct IconIndex {
+    QString theme;
+    QVector<QPair<QString, qint64>> stamps;
+    QHash<QString, QVector<IconFile>> icons;
+};
+
+// Window class -> icon name guessing for the dock, bar and overview.
+// Existence checks are hash lookups in the icon index and every decision,
+// substitution and regex rules included, is memoised until the index or
+// the rules change.
+class IconResolver : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+
+    // Defaults to QIcon::themeName()
+    Q_PROPERTY(QString themeName READ themeName WRITE setThemeName NOTIFY themeNameChanged FINAL)
+    // { className: iconName }
+    Q_PROPERTY(QVariantMap  substitutions      READ substitutions      WRITE setSubstitutions      NOTIFY rulesChanged FINAL)
+    // [{ regex: "pattern", replace: "text with $1" }], first match is replaced like String.replace()
+    Q_PROPERTY(QVariantList regexSubstitutions READ regexSubstitutions WRITE setRegexSubstitutions NOTIFY rulesChanged FINAL)
+    // Last resort: icon of the best matching desktop entry
+    Q_PROPERTY(AppSearchIndex *searchIndex READ searchIndex WRITE setSearchIndex NOTIFY searchIndexChanged FINAL)
+
+    Q_PROPERTY(bool ready     READ ready     NOTIFY revisionChanged FINAL)
+    // Bumped whenever earlier answers may have changed, read it to re-evaluate bindings
+    Q_PROPERTY(int  revision  READ revision  NOTIFY revisionChanged FINAL)
+    Q_PROPERTY(int  iconCount READ iconCount NOTIFY revisionChanged FINAL)
+
+public:
+    explicit IconResolver(QObject *parent = nullptr);
+    ~IconResolver() override;
+
+    QString themeName() const { return m_themeName; }
+    void setThemeName(const QString &v);
+
+    QVariantMap  substitutions()      const { return m_substitutions; }
+    QVariantList regexSubstitutions() const { return m_regexSubstitutions; }
+    void setSubstitutions(const QVariantMap &v);
+    void setRegexSubstitutions(const QVariantList &v);
+
+    AppSearchIndex *searchIndex() const { return m_searchIndex; }
+    void setSearchIndex(AppSearchIndex *v);
+
+    bool ready()     const { return m_ready; }
+    int  revision()  const { return m_revision; }
+    int  iconCount() const { return m_index.icons.size(); }
+
+    Q_INVOKABLE QString guessIcon(const QString &className);
+    Q_INVOKABLE bool iconExists(const QString &name) const;
+    // Best file for the requested pixel size, 0 prefers scalable / the largest
+    Q_INVOKABLE QString lookup(const QString &name, int size = 0) const;
+    // Re-checks the directory stamps and rebuilds the index if needed
+    Q_INVOKABLE void refresh();
+
+signals:
+    void themeNameChanged();
+    void rulesChanged();
+    void searchIndexChanged();
+    void revisionChanged();
+
+private:
+    void onIndexLoaded(quint64 generation, const IconIndex &index);
+    void invalidate();
+
+    QString m_themeName;
+    QVariantMap  m_substitutions;
+    QVariantList m_regexSubstitutions;
+    QVector<QPair<QRegularExpression, QString>> m_rules;
+    QPointer<AppSearchIndex> m_searchIndex;
+
+    QThreadPool m_pool;
+    IconIndex m_index;
+    bool      m_ready = false;
+    int       m_revision = 0;
+    quint64   m_generation = 0;
+
+    QHash<QString, QString> m_decisions;
+};
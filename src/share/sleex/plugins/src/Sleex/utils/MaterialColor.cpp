@@ -0,0 +1,1164 @@
+#include "MaterialColor.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace MaterialColor {
+
+namespace {
+constexpr double PI = 3.141592653589793;
+
+constexpr double SRGB_TO_XYZ[3][3] = {
+    { 0.41233895, 0.35762064, 0.18051042 },
+    { 0.2126, 0.7152, 0.0722 },
+    { 0.01932141, 0.11916382, 0.95034478 },
+};
+
+constexpr double WHITE_POINT_D65[3] = { 95.047, 100.0, 108.883 };
+
+constexpr double SCALED_DISCOUNT_FROM_LINRGB[3][3] = {
+    { 0.001200833568784504, 0.002389694492170889, 0.0002795742885861124 },
+    { 0.0005891086651375999, 0.0029785502573438758, 0.0003270666104008398 },
+    { 0.00010146692491640572, 0.0005364214359186694, 0.0032979401770712076 },
+};
+
+constexpr double LINRGB_FROM_SCALED_DISCOUNT[3][3] = {
+    { 1373.2198709594231, -1100.4251190754821, -7.278681089101213 },
+    { -271.815969077903, 559.6580465940733, -32.46047482791194 },
+    { 1.9622899599665666, -57.173814538844006, 308.7233197812385 },
+};
+
+constexpr double Y_FROM_LINRGB[3] = { 0.2126, 0.7152, 0.0722 };
+
+using Vec3 = std::array<double, 3>;
+
+// Python's round(), halves go to the even neighbour
+double roundHalfEven(double v) {
+    return std::nearbyint(v);
+}
+
+double signum(double v) {
+    return v < 0.0 ? -1.0 : (v == 0.0 ? 0.0 : 1.0);
+}
+
+double lerp(double start, double stop, double amount) {
+    return (1.0 - amount) * start + amount * stop;
+}
+
+Vec3 matrixMultiply(const Vec3 &row, const double (&matrix)[3][3]) {
+    return {
+        row[0] * matrix[0][0] + row[1] * matrix[0][1] + row[2] * matrix[0][2],
+        row[0] * matrix[1][0] + row[1] * matrix[1][1] + row[2] * matrix[1][2],
+        row[0] * matrix[2][0] + row[1] * matrix[2][1] + row[2] * matrix[2][2],
+    };
+}
+
+quint32 argbFromRgb(int red, int green, int blue) {
+    return 0xff000000u | (quint32(red & 255) << 16) | (quint32(green & 255) << 8) | quint32(blue & 255);
+}
+
+int redOf(quint32 argb) { return (argb >> 16) & 255; }
+int greenOf(quint32 argb) { return (argb >> 8) & 255; }
+int blueOf(quint32 argb) { return argb & 255; }
+
+double linearized(double rgbComponent) {
+    const double normalized = rgbComponent / 255.0;
+    if (normalized <= 0.040449936) return normalized / 12.92 * 100.0;
+    return std::pow((normalized + 0.055) / 1.055, 2.4) * 100.0;
+}
+
+double trueDelinearized(double rgbComponent) {
+    const double normalized = rgbComponent / 100.0;
+    const double delinearized = normalized <= 0.0031308
+        ? normalized * 12.92
+        : 1.055 * std::pow(normalized, 1.0 / 2.4) - 0.055;
+    return delinearized * 255.0;
+}
+
+int delinearized(double rgbComponent) {
+    return std::clamp(int(roundHalfEven(trueDelinearized(rgbComponent))), 0, 255);
+}
+
+quint32 argbFromLinrgb(const Vec3 &linrgb) {
+    return argbFromRgb(delinearized(linrgb[0]), delinearized(linrgb[1]), delinearized(linrgb[2]));
+}
+
+Vec3 xyzFromArgb(quint32 argb) {
+    const Vec3 linear = { linearized(redOf(argb)), linearized(greenOf(argb)), linearized(blueOf(argb)) };
+    return matrixMultiply(linear, SRGB_TO_XYZ);
+}
+
+double labF(double t) {
+    constexpr double e = 216.0 / 24389.0;
+    constexpr double kappa = 24389.0 / 27.0;
+    return t > e ? std::pow(t, 1.0 / 3.0) : (kappa * t + 16.0) / 116.0;
+}
+
+double labInvf(double ft) {
+    constexpr double e = 216.0 / 24389.0;
+    constexpr double kappa = 24389.0 / 27.0;
+    const double ft3 = ft * ft * ft;
+    return ft3 > e ? ft3 : (116.0 * ft - 16.0) / kappa;
+}
+
+double yFromLstar(double lstar) {
+    return 100.0 * labInvf((lstar + 16.0) / 116.0);
+}
+
+double lstarFromY(double y) {
+    return labF(y / 100.0) * 116.0 - 16.0;
+}
+
+double lstarFromArgb(quint32 argb) {
+    return 116.0 * labF(xyzFromArgb(argb)[1] / 100.0) - 16.0;
+}
+
+quint32 argbFromLstar(double lstar) {
+    const int component = delinearized(yFromLstar(lstar));
+    return argbFromRgb(component, component, component);
+}
+
+Vec3 labFromArgb(quint32 argb) {
+    const Vec3 xyz = xyzFromArgb(argb);
+    const double fx = labF(xyz[0] / WHITE_POINT_D65[0]);
+    const double fy = labF(xyz[1] / WHITE_POINT_D65[1]);
+    const double fz = labF(xyz[2] / WHITE_POINT_D65[2]);
+    return { 116.0 * fy - 16.0, 500.0 * (fx - fy), 200.0 * (fy - fz) };
+}
+
+// Default CAM16 viewing conditions: D65, 200 / pi nits of adapting
+// luminance over a mid grey background, average surround
+struct ViewingConditions {
+    double n, aw, nbb, ncb, c, nc, fl, flRoot, z;
+    Vec3   rgbD;
+
+    static const ViewingConditions &standard() {
+        static const ViewingConditions conditions = make();
+        return conditions;
+    }
+
+private:
+    static ViewingConditions make() {
+        const double adaptingLuminance = (200.0 / PI) * yFromLstar(50.0) / 100.0;
+        const double backgroundLstar = 50.0;
+        const double surround = 2.0;
+        const double *xyz = WHITE_POINT_D65;
+
+        const double rW = xyz[0] * 0.401288 + xyz[1] * 0.650173 + xyz[2] * -0.051461;
+        const double gW = xyz[0] * -0.250268 + xyz[1] * 1.204414 + xyz[2] * 0.045854;
+        const double bW = xyz[0] * -0.002079 + xyz[1] * 0.048952 + xyz[2] * 0.953127;
+
+        ViewingConditions vc;
+        const double f = 0.8 + surround / 10.0;
+        vc.c = f >= 0.9 ? lerp(0.59, 0.69, (f - 0.9) * 10.0) : lerp(0.525, 0.59, (f - 0.8) * 10.0);
+        double d = f * (1.0 - (1.0 / 3.6) * std::exp((-adaptingLuminance - 42.0) / 92.0));
+        d = std::clamp(d, 0.0, 1.0);
+        vc.nc = f;
+        vc.rgbD = { d * (100.0 / rW) + 1.0 - d, d * (100.0 / gW) + 1.0 - d, d * (100.0 / bW) + 1.0 - d };
+
+        const double k = 1.0 / (5.0 * adaptingLuminance + 1.0);
+        const double k4 = k * k * k * k;
+        const double k4F = 1.0 - k4;
+        vc.fl = k4 * adaptingLuminance + 0.1 * k4F * k4F * std::pow(5.0 * adaptingLuminance, 1.0 / 3.0);
+        vc.flRoot = std::pow(vc.fl, 0.25);
+        vc.n = yFromLstar(backgroundLstar) / WHITE_POINT_D65[1];
+        vc.z = 1.48 + std::sqrt(vc.n);
+        vc.nbb = 0.725 / std::pow(vc.n, 0.2);
+        vc.ncb = vc.nbb;
+
+        const double rgbAFactors[3] = {
+            std::pow(vc.fl * vc.rgbD[0] * rW / 100.0, 0.42),
+            std::pow(vc.fl * vc.rgbD[1] * gW / 100.0, 0.42),
+            std::pow(vc.fl * vc.rgbD[2] * bW / 100.0, 0.42),
+        };
+        double rgbA[3];
+        for (int i = 0; i < 3; ++i) rgbA[i] = 400.0 * rgbAFactors[i] / (rgbAFactors[i] + 27.13);
+        vc.aw = (2.0 * rgbA[0] + rgbA[1] + 0.05 * rgbA[2]) * vc.nbb;
+        return vc;
+    }
+};
+
+// CAM16 hue and chroma, the only appearance correlates HCT keeps
+void cam16HueChroma(quint32 argb, double &hue, double &chroma) {
+    const ViewingConditions &vc = ViewingConditions::standard();
+    const Vec3 xyz = xyzFromArgb(argb);
+    const double x = xyz[0], y = xyz[1], z = xyz[2];
+
+    const double rC = 0.401288 * x + 0.650173 * y - 0.051461 * z;
+    const double gC = -0.250268 * x + 1.204414 * y + 0.045854 * z;
+    const double bC = -0.002079 * x + 0.048952 * y + 0.953127 * z;
+
+    const double rD = vc.rgbD[0] * rC;
+    const double gD = vc.rgbD[1] * gC;
+    const double bD = vc.rgbD[2] * bC;
+
+    const double rAF = std::pow(vc.fl * std::abs(rD) / 100.0, 0.42);
+    const double gAF = std::pow(vc.fl * std::abs(gD) / 100.0, 0.42);
+    const double bAF = std::pow(vc.fl * std::abs(bD) / 100.0, 0.42);
+
+    const double rA = signum(rD) * 400.0 * rAF / (rAF + 27.13);
+    const double gA = signum(gD) * 400.0 * gAF / (gAF + 27.13);
+    const double bA = signum(bD) * 400.0 * bAF / (bAF + 27.13);
+
+    const double a = (11.0 * rA + -12.0 * gA + bA) / 11.0;
+    const double b = (rA + gA - 2.0 * bA) / 9.0;
+    const double u = (20.0 * rA + 20.0 * gA + 21.0 * bA) / 20.0;
+    const double p2 = (40.0 * rA + 20.0 * gA + bA) / 20.0;
+
+    const double atanDegrees = std::atan2(b, a) * 180.0 / PI;
+    hue = atanDegrees < 0.0 ? atanDegrees + 360.0 : (atanDegrees >= 360.0 ? atanDegrees - 360.0 : atanDegrees);
+
+    const double ac = p2 * vc.nbb;
+    const double j = 100.0 * std::pow(ac / vc.aw, vc.c * vc.z);
+
+    const double huePrime = hue < 20.14 ? hue + 360.0 : hue;
+    const double eHue = 0.25 * (std::cos(huePrime * PI / 180.0 + 2.0) + 3.8);
+    const double p1 = 50000.0 / 13.0 * eHue * vc.nc * vc.ncb;
+    const double t = p1 * std::hypot(a, b) / (u + 0.305);
+    const double alpha = std::pow(1.64 - std::pow(0.29, vc.n), 0.73) * std::pow(t, 0.9);
+    chroma = alpha * std::sqrt(j / 100.0);
+}
+
+// HCT -> sRGB solver
+
+const std::array<double, 255> &criticalPlanes() {
+    static const std::array<double, 255> planes = [] {
+        std::array<double, 255> values {};
+        for (int i = 0; i < 255; ++i) values[i] = linearized(i + 0.5);
+        return values;
+    }();
+    return planes;
+}
+
+double sanitizeRadians(double angle) {
+    return std::fmod(angle + PI * 8.0, PI * 2.0);
+}
+
+double chromaticAdaptation(double component) {
+    const double af = std::pow(std::abs(component), 0.42);
+    return signum(component) * 400.0 * af / (af + 27.13);
+}
+
+double hueOf(const Vec3 &linrgb) {
+    const Vec3 scaledDiscount = matrixMultiply(linrgb, SCALED_DISCOUNT_FROM_LINRGB);
+    const double rA = chromaticAdaptation(scaledDiscount[0]);
+    const double gA = chromaticAdaptation(scaledDiscount[1]);
+    const double bA = chromaticAdaptation(scaledDiscount[2]);
+    const double a = (11.0 * rA + -12.0 * gA + bA) / 11.0;
+    const double b = (rA + gA - 2.0 * bA) / 9.0;
+    return std::atan2(b, a);
+}
+
+bool areInCyclicOrder(double a, double b, double c) {
+    return sanitizeRadians(b - a) < sanitizeRadians(c - a);
+}
+
+Vec3 setCoordinate(const Vec3 &source, double coordinate, const Vec3 &target, int axis) {
+    const double t = (coordinate - source[axis]) / (target[axis] - source[axis]);
+    return {
+        source[0] + (target[0] - source[0]) * t,
+        source[1] + (target[1] - source[1]) * t,
+        source[2] + (target[2] - source[2]) * t,
+    };
+}
+
+bool isBounded(double x) {
+    return 0.0 <= x && x <= 100.0;
+}
+
+// Corner n of the cube face cut by the plane of constant y, or -1s
+Vec3 nthVertex(double y, int n) {
+    const double kR = Y_FROM_LINRGB[0];
+    const double kG = Y_FROM_LINRGB[1];
+    const double kB = Y_FROM_LINRGB[2];
+    const double coordA = n % 4 <= 1 ? 0.0 : 100.0;
+    const double coordB = n % 2 == 0 ? 0.0 : 100.0;
+    if (n < 4) {
+        const double g = coordA, b = coordB;
+        const double r = (y - g * kG - b * kB) / kR;
+        if (isBounded(r)) return { r, g, b };
+    } else if (n < 8) {
+        const double b = coordA, r = coordB;
+        const double g = (y - r * kR - b * kB) / kG;
+        if (isBounded(g)) return { r, g, b };
+    } else {
+        const double r = coordA, g = coordB;
+        const double b = (y - r * kR - g * kG) / kB;
+        if (isBounded(b)) return { r, g, b };
+    }
+    return { -1.0, -1.0, -1.0 };
+}
+
+std::pair<Vec3, Vec3> bisectToSegment(double y, double targetHue) {
+    Vec3 left = { -1.0, -1.0, -1.0 };
+    Vec3 right = left;
+    double leftHue = 0.0;
+    double rightHue = 0.0;
+    bool initialized = false;
+    bool uncut = true;
+    for (int n = 0; n < 12; ++n) {
+        const Vec3 mid = nthVertex(y, n);
+        if (mid[0] < 0) continue;
+        const double midHue = hueOf(mid);
+        if (!initialized) {
+            left = right = mid;
+            leftHue = rightHue = midHue;
+            initialized = true;
+            continue;
+        }
+        if (uncut || areInCyclicOrder(leftHue, midHue, rightHue)) {
+            uncut = false;
+            if (areInCyclicOrder(leftHue, targetHue, midHue)) {
+                right = mid;
+                rightHue = midHue;
+            } else {
+                left = mid;
+                leftHue = midHue;
+            }
+        }
+    }
+    return { left, right };
+}
+
+Vec3 bisectToLimit(double y, double targetHue) {
+    auto [left, right] = bisectToSegment(y, targetHue);
+    double leftHue = hueOf(left);
+    for (int axis = 0; axis < 3; ++axis) {
+        if (left[axis] == right[axis]) continue;
+        int lPlane, rPlane;
+        if (left[axis] < right[axis]) {
+            lPlane = int(std::floor(trueDelinearized(left[axis]) - 0.5));
+            rPlane = int(std::ceil(trueDelinearized(right[axis]) - 0.5));
+        } else {
+            lPlane = int(std::ceil(trueDelinearized(left[axis]) - 0.5));
+            rPlane = int(std::floor(trueDelinearized(right[axis]) - 0.5));
+        }
+        for (int i = 0; i < 8; ++i) {
+            if (std::abs(rPlane - lPlane) <= 1) break;
+            const int mPlane = int(std::floor((lPlane + rPlane) / 2.0));
+            const Vec3 mid = setCoordinate(left, criticalPlanes()[mPlane], right, axis);
+            const double midHue = hueOf(mid);
+            if (areInCyclicOrder(leftHue, targetHue, midHue)) {
+                right = mid;
+                rPlane = mPlane;
+            } else {
+                left = mid;
+                leftHue = midHue;
+                lPlane = mPlane;
+            }
+        }
+    }
+    return { (left[0] + right[0]) / 2.0, (left[1] + right[1]) / 2.0, (left[2] + right[2]) / 2.0 };
+}
+
+double inverseChromaticAdaptation(double adapted) {
+    const double adaptedAbs = std::abs(adapted);
+    const double base = std::max(0.0, 27.13 * adaptedAbs / (400.0 - adaptedAbs));
+    return signum(adapted) * std::pow(base, 1.0 / 0.42);
+}
+
+// Newton iteration on J, 0 when the colour falls outside sRGB
+quint32 findResultByJ(double hueRadians, double chroma, double y) {
+    const ViewingConditions &vc = ViewingConditions::standard();
+    double j = std::sqrt(y) * 11.0;
+    const double tInnerCoeff = 1.0 / std::pow(1.64 - std::pow(0.29, vc.n), 0.73);
+    const double eHue = 0.25 * (std::cos(hueRadians + 2.0) + 3.8);
+    const double p1 = eHue * (50000.0 / 13.0) * vc.nc * vc.ncb;
+    const double hSin = std::sin(hueRadians);
+    const double hCos = std::cos(hueRadians);
+
+    for (int round = 0; round < 5; ++round) {
+        const double jNormalized = j / 100.0;
+        const double alpha = chroma == 0.0 || j == 0.0 ? 0.0 : chroma / std::sqrt(jNormalized);
+        const double t = std::pow(alpha * tInnerCoeff, 1.0 / 0.9);
+        const double ac = vc.aw * std::pow(jNormalized, 1.0 / vc.c / vc.z);
+        const double p2 = ac / vc.nbb;
+        const double gamma = 23.0 * (p2 + 0.305) * t / (23.0 * p1 + 11.0 * t * hCos + 108.0 * t * hSin);
+        const double a = gamma * hCos;
+        const double b = gamma * hSin;
+        const double rA = (460.0 * p2 + 451.0 * a + 288.0 * b) / 1403.0;
+        const double gA = (460.0 * p2 - 891.0 * a - 261.0 * b) / 1403.0;
+        const double bA = (460.0 * p2 - 220.0 * a - 6300.0 * b) / 1403.0;
+        const Vec3 scaled = { inverseChromaticAdaptation(rA), inverseChromaticAdaptation(gA), inverseChromaticAdaptation(bA) };
+        const Vec3 linrgb = matrixMultiply(scaled, LINRGB_FROM_SCALED_DISCOUNT);
+        if (linrgb[0] < 0 || linrgb[1] < 0 || linrgb[2] < 0) return 0;
+
+        const double fnj = Y_FROM_LINRGB[0] * linrgb[0] + Y_FROM_LINRGB[1] * linrgb[1] + Y_FROM_LINRGB[2] * linrgb[2];
+        if (fnj <= 0) return 0;
+        if (round == 4 || std::abs(fnj - y) < 0.002) {
+            if (linrgb[0] > 100.01 || linrgb[1] > 100.01 || linrgb[2] > 100.01) return 0;
+            return argbFromLinrgb(linrgb);
+        }
+        j = j - (fnj - y) * j / (2.0 * fnj);
+    }
+    return 0;
+}
+
+quint32 solveToArgb(double hueDegrees, double chroma, double lstar) {
+    if (chroma < 0.0001 || lstar < 0.0001 || lstar > 99.9999) return argbFromLstar(lstar);
+    hueDegrees = sanitizeDegrees(hueDegrees);
+    const double hueRadians = hueDegrees / 180.0 * PI;
+    const double y = yFromLstar(lstar);
+    const quint32 exact = findResultByJ(hueRadians, chroma, y);
+    if (exact != 0) return exact;
+    return argbFromLinrgb(bisectToLimit(y, hueRadians));
+}
+
+// Contrast
+
+double ratioOfYs(double y1, double y2) {
+    const double lighter = std::max(y1, y2);
+    const double darker = lighter == y2 ? y1 : y2;
+    return (lighter + 5.0) / (darker + 5.0);
+}
+
+double ratioOfTones(double toneA, double toneB) {
+    toneA = std::clamp(toneA, 0.0, 100.0);
+    toneB = std::clamp(toneB, 0.0, 100.0);
+    return ratioOfYs(yFromLstar(toneA), yFromLstar(toneB));
+}
+
+double lighterTone(double tone, double ratio) {
+    if (tone < 0.0 || tone > 100.0) return -1.0;
+    const double darkY = yFromLstar(tone);
+    const double lightY = ratio * (darkY + 5.0) - 5.0;
+    const double realContrast = ratioOfYs(lightY, darkY);
+    const double delta = std::abs(realContrast - ratio);
+    if (realContrast < ratio && delta > 0.04) return -1.0;
+    const double value = lstarFromY(lightY) + 0.4;
+    if (value < 0.0 || value > 100.0) return -1.0;
+    return value;
+}
+
+double darkerTone(double tone, double ratio) {
+    if (tone < 0.0 || tone > 100.0) return -1.0;
+    const double lightY = yFromLstar(tone);
+    const double darkY = ((lightY + 5.0) / ratio) - 5.0;
+    const double realContrast = ratioOfYs(lightY, darkY);
+    const double delta = std::abs(realContrast - ratio);
+    if (realContrast < ratio && delta > 0.04) return -1.0;
+    const double value = lstarFromY(darkY) - 0.4;
+    if (value < 0.0 || value > 100.0) return -1.0;
+    return value;
+}
+
+double lighterToneUnsafe(double tone, double ratio) {
+    const double safe = lighterTone(tone, ratio);
+    return safe < 0.0 ? 100.0 : safe;
+}
+
+double darkerToneUnsafe(double tone, double ratio) {
+    const double safe = darkerTone(tone, ratio);
+    return safe < 0.0 ? 0.0 : safe;
+}
+
+bool tonePrefersLightForeground(double tone) {
+    return roundHalfEven(tone) < 60.0;
+}
+
+double foregroundTone(double bgTone, double ratio) {
+    const double lighter = lighterToneUnsafe(bgTone, ratio);
+    const double darker = darkerToneUnsafe(bgTone, ratio);
+    const double lighterRatio = ratioOfTones(lighter, bgTone);
+    const double darkerRatio = ratioOfTones(darker, bgTone);
+    if (tonePrefersLightForeground(bgTone)) {
+        const bool negligibleDifference = std::abs(lighterRatio - darkerRatio) < 0.1 && lighterRatio < ratio && darkerRatio < ratio;
+        return lighterRatio >= ratio || lighterRatio >= darkerRatio || negligibleDifference ? lighter : darker;
+    }
+    return darkerRatio >= ratio || darkerRatio >= lighterRatio ? darker : lighter;
+}
+
+// Content and fidelity schemes
+
+bool isDisliked(const Hct &hct) {
+    const double hue = roundHalfEven(hct.hue);
+    return hue >= 90.0 && hue <= 111.0 && roundHalfEven(hct.chroma) > 16.0 && roundHalfEven(hct.tone) < 65.0;
+}
+
+Hct fixIfDisliked(const Hct &hct) {
+    return isDisliked(hct) ? Hct::from(hct.hue, hct.chroma, 70.0) : hct;
+}
+
+double rawTemperature(const Hct &color) {
+    const Vec3 lab = labFromArgb(color.argb);
+    const double hue = sanitizeDegrees(std::atan2(lab[2], lab[1]) * 180.0 / PI);
+    const double chroma = std::sqrt(lab[1] * lab[1] + lab[2] * lab[2]);
+    return -0.5 + 0.02 * std::pow(chroma, 1.07) * std::cos(sanitizeDegrees(hue - 50.0) * PI / 180.0);
+}
+
+int sanitizeDegreesInt(int degrees) {
+    degrees %= 360;
+    return degrees < 0 ? degrees + 360 : degrees;
+}
+
+// TemperatureCache.analogous(): count colours spread over divisions equal
+// steps of relative temperature around the hue circle
+std::vector<Hct> analogous(const Hct &input, int count, int divisions) {
+    std::vector<Hct> byHue;
+    byHue.reserve(361);
+    for (int hue = 0; hue <= 360; ++hue) byHue.push_back(Hct::from(hue, input.chroma, input.tone));
+
+    std::vector<double> temps;
+    temps.reserve(byHue.size());
+    for (const Hct &hct : byHue) temps.push_back(rawTemperature(hct));
+    const double inputTemp = rawTemperature(input);
+    const double coldest = std::min(*std::min_element(temps.begin(), temps.end()), inputTemp);
+    const double warmest = std::max(*std::max_element(temps.begin(), temps.end()), inputTemp);
+    const double range = warmest - coldest;
+    const auto relative = [&](int hue) {
+        return range == 0.0 ? 0.5 : (temps[hue] - coldest) / range;
+    };
+
+    const int startHue = int(roundHalfEven(input.hue));
+    std::vector<Hct> allColors = { byHue[startHue] };
+
+    double lastTemp = relative(startHue);
+    double absoluteTotalTempDelta = 0.0;
+    for (int i = 0; i < 360; ++i) {
+        const double temp = relative(sanitizeDegreesInt(startHue + i));
+        absoluteTotalTempDelta += std::abs(temp - lastTemp);
+        lastTemp = temp;
+    }
+
+    int hueAddend = 1;
+    const double tempStep = absoluteTotalTempDelta / divisions;
+    double totalTempDelta = 0.0;
+    lastTemp = relative(startHue);
+    while (int(allColors.size()) < divisions) {
+        const int hue = sanitizeDegreesInt(startHue + hueAddend);
+        const double temp = relative(hue);
+        totalTempDelta += std::abs(temp - lastTemp);
+
+        bool indexSatisfied = totalTempDelta >= allColors.size() * tempStep;
+        int indexAddend = 1;
+        while (indexSatisfied && int(allColors.size()) < divisions) {
+            allColors.push_back(byHue[hue]);
+            indexSatisfied = totalTempDelta >= (allColors.size() + indexAddend) * tempStep;
+            ++indexAddend;
+        }
+        lastTemp = temp;
+        ++hueAddend;
+        if (hueAddend > 360) {
+            while (int(allColors.size()) < divisions) allColors.push_back(byHue[hue]);
+            break;
+        }
+    }
+
+    const int size = int(allColors.size());
+    const auto wrapped = [size](int index) {
+        while (index < 0) index += size;
+        return index % size;
+    };
+    std::vector<Hct> answers = { input };
+    const int ccwCount = (count - 1) / 2;
+    for (int i = 1; i <= ccwCount; ++i) answers.insert(answers.begin(), allColors[wrapped(-i)]);
+    const int cwCount = count - ccwCount - 1;
+    for (int i = 1; i <= cwCount; ++i) answers.push_back(allColors[wrapped(i)]);
+    return answers;
+}
+
+double rotatedHue(double sourceHue, const double (&hues)[9], const double (&rotations)[9]) {
+    for (int i = 0; i < 8; ++i) {
+        if (hues[i] < sourceHue && sourceHue < hues[i + 1]) return sanitizeDegrees(sourceHue + rotations[i]);
+    }
+    return sourceHue;
+}
+
+// Dynamic colour roles
+
+enum Role {
+    PrimaryPaletteKeyColor,
+    SecondaryPaletteKeyColor,
+    TertiaryPaletteKeyColor,
+    NeutralPaletteKeyColor,
+    NeutralVariantPaletteKeyColor,
+    Background,
+    OnBackground,
+    Surface,
+    SurfaceDim,
+    SurfaceBright,
+    SurfaceContainerLowest,
+    SurfaceContainerLow,
+    SurfaceContainer,
+    SurfaceContainerHigh,
+    SurfaceContainerHighest,
+    OnSurface,
+    SurfaceVariant,
+    OnSurfaceVariant,
+    InverseSurface,
+    InverseOnSurface,
+    Outline,
+    OutlineVariant,
+    Shadow,
+    Scrim,
+    SurfaceTint,
+    Primary,
+    OnPrimary,
+    PrimaryContainer,
+    OnPrimaryContainer,
+    InversePrimary,
+    Secondary,
+    OnSecondary,
+    SecondaryContainer,
+    OnSecondaryContainer,
+    Tertiary,
+    OnTertiary,
+    TertiaryContainer,
+    OnTertiaryContainer,
+    Error,
+    OnError,
+    ErrorContainer,
+    OnErrorContainer,
+    PrimaryFixed,
+    PrimaryFixedDim,
+    OnPrimaryFixed,
+    OnPrimaryFixedVariant,
+    SecondaryFixed,
+    SecondaryFixedDim,
+    OnSecondaryFixed,
+    OnSecondaryFixedVariant,
+    TertiaryFixed,
+    TertiaryFixedDim,
+    OnTertiaryFixed,
+    OnTertiaryFixedVariant,
+    RoleCount,
+    NoRole = RoleCount,
+    // Resolved per scheme: surfaceBright when dark, surfaceDim otherwise
+    HighestSurface
+};
+
+enum class Polarity { Nearer, Farther, Lighter, Darker };
+
+struct ContrastCurve {
+    double low = 0.0, normal = 0.0, medium = 0.0, high = 0.0;
+
+    double get(double level) const {
+        if (level <= -1.0) return low;
+        if (level < 0.0) return lerp(low, normal, level + 1.0);
+        if (level < 0.5) return lerp(normal, medium, level / 0.5);
+        if (level < 1.0) return lerp(medium, high, (level - 0.5) / 0.5);
+        return high;
+    }
+};
+
+struct ToneDeltaPair {
+    Role     a = NoRole;
+    Role     b = NoRole;
+    double   delta = 0.0;
+    Polarity polarity = Polarity::Nearer;
+    bool     stayTogether = false;
+};
+
+using PaletteFn = const TonalPalette &(*)(const DynamicScheme &);
+using ToneFn = double (*)(const DynamicScheme &);
+
+struct RoleSpec {
+    const char   *name;
+    PaletteFn     palette;
+    ToneFn        tone;
+    bool          isBackground = false;
+    Role          background = NoRole;
+    Role          secondBackground = NoRole;
+    ContrastCurve curve;
+    ToneDeltaPair pair;
+};
+
+const TonalPalette &primaryPalette(const DynamicScheme &s) { return s.primary; }
+const TonalPalette &secondaryPalette(const DynamicScheme &s) { return s.secondary; }
+const TonalPalette &tertiaryPalette(const DynamicScheme &s) { return s.tertiary; }
+const TonalPalette &neutralPalette(const DynamicScheme &s) { return s.neutral; }
+const TonalPalette &neutralVariantPalette(const DynamicScheme &s) { return s.neutralVariant; }
+const TonalPalette &errorPalette(const DynamicScheme &s) { return s.error; }
+
+bool isFidelity(const DynamicScheme &s) {
+    return s.variant == Variant::Fidelity || s.variant == Variant::Content;
+}
+
+bool isMonochrome(const DynamicScheme &s) {
+    return s.variant == Variant::Monochrome;
+}
+
+double findDesiredChromaByTone(double hue, double chroma, double tone, bool byDecreasingTone) {
+    double answer = tone;
+    Hct closest = Hct::from(hue, chroma, tone);
+    if (closest.chroma < chroma) {
+        double chromaPeak = closest.chroma;
+        while (closest.chroma < chroma) {
+            answer += byDecreasingTone ? -1.0 : 1.0;
+            const Hct potential = Hct::from(hue, chroma, answer);
+            if (chromaPeak > potential.chroma) break;
+            if (std::abs(potential.chroma - chroma) < 0.4) break;
+            if (std::abs(potential.chroma - chroma) < std::abs(closest.chroma - chroma)) closest = potential;
+            chromaPeak = std::max(chromaPeak, potential.chroma);
+        }
+    }
+    return answer;
+}
+
+double rawTone(Role role, const DynamicScheme &s);
+
+constexpr ContrastCurve TEXT_CURVE = { 4.5, 7.0, 11.0, 21.0 };
+constexpr ContrastCurve ACCENT_CURVE = { 3.0, 4.5, 7.0, 7.0 };
+constexpr ContrastCurve CONTAINER_CURVE = { 1.0, 1.0, 3.0, 4.5 };
+constexpr ContrastCurve VARIANT_CURVE = { 3.0, 4.5, 7.0, 11.0 };
+
+const std::array<RoleSpec, RoleCount> &roleSpecs() {
+    static const std::array<RoleSpec, RoleCount> specs = [] {
+        std::array<RoleSpec, RoleCount> r {};
+        const auto set = [&r](Role role, RoleSpec spec) { r[role] = spec; };
+
+        set(PrimaryPaletteKeyColor, { "primary_paletteKeyColor", primaryPalette,
+            [](const DynamicScheme &s) { return s.primary.keyColor().tone; } });
+        set(SecondaryPaletteKeyColor, { "secondary_paletteKeyColor", secondaryPalette,
+            [](const DynamicScheme &s) { return s.secondary.keyColor().tone; } });
+        set(TertiaryPaletteKeyColor, { "tertiary_paletteKeyColor", tertiaryPalette,
+            [](const DynamicScheme &s) { return s.tertiary.keyColor().tone; } });
+        set(NeutralPaletteKeyColor, { "neutral_paletteKeyColor", neutralPalette,
+            [](const DynamicScheme &s) { return s.neutral.keyColor().tone; } });
+        set(NeutralVariantPaletteKeyColor, { "neutral_variant_paletteKeyColor", neutralVariantPalette,
+            [](const DynamicScheme &s) { return s.neutralVariant.keyColor().tone; } });
+
+        set(Background, { "background", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 6.0 : 98.0; }, true });
+        set(OnBackground, { "onBackground", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 90.0 : 10.0; }, false, Background, NoRole, { 3.0, 3.0, 4.5, 7.0 } });
+        set(Surface, { "surface", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 6.0 : 98.0; }, true });
+        set(SurfaceDim, { "surfaceDim", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 6.0 : 87.0; }, true });
+        set(SurfaceBright, { "surfaceBright", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 24.0 : 98.0; }, true });
+        set(SurfaceContainerLowest, { "surfaceContainerLowest", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 4.0 : 100.0; }, true });
+        set(SurfaceContainerLow, { "surfaceContainerLow", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 10.0 : 96.0; }, true });
+        set(SurfaceContainer, { "surfaceContainer", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 12.0 : 94.0; }, true });
+        set(SurfaceContainerHigh, { "surfaceContainerHigh", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 17.0 : 92.0; }, true });
+        set(SurfaceContainerHighest, { "surfaceContainerHighest", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 22.0 : 90.0; }, true });
+        set(OnSurface, { "onSurface", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 90.0 : 10.0; }, false, HighestSurface, NoRole, TEXT_CURVE });
+        set(SurfaceVariant, { "surfaceVariant", neutralVariantPalette,
+            [](const DynamicScheme &s) { return s.dark ? 30.0 : 90.0; }, true });
+        set(OnSurfaceVariant, { "onSurfaceVariant", neutralVariantPalette,
+            [](const DynamicScheme &s) { return s.dark ? 80.0 : 30.0; }, false, HighestSurface, NoRole, VARIANT_CURVE });
+        set(InverseSurface, { "inverseSurface", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 90.0 : 20.0; } });
+        set(InverseOnSurface, { "inverseOnSurface", neutralPalette,
+            [](const DynamicScheme &s) { return s.dark ? 20.0 : 95.0; }, false, InverseSurface, NoRole, TEXT_CURVE });
+        set(Outline, { "outline", neutralVariantPalette,
+            [](const DynamicScheme &s) { return s.dark ? 60.0 : 50.0; }, false, HighestSurface, NoRole, { 1.5, 3.0, 4.5, 7.0 } });
+        set(OutlineVariant, { "outlineVariant", neutralVariantPalette,
+            [](const DynamicScheme &s) { return s.dark ? 30.0 : 80.0; }, false, HighestSurface, NoRole, CONTAINER_CURVE });
+        set(Shadow, { "shadow", neutralPalette, [](const DynamicScheme &) { return 0.0; } });
+        set(Scrim, { "scrim", neutralPalette, [](const DynamicScheme &) { return 0.0; } });
+        set(SurfaceTint, { "surfaceTint", primaryPalette,
+            [](const DynamicScheme &s) { return s.dark ? 80.0 : 40.0; }, true });
+
+        const ToneDeltaPair primaryPair = { PrimaryContainer, Primary, 10.0, Polarity::Nearer, false };
+        set(Primary, { "primary", primaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 100.0 : 0.0;
+                return s.dark ? 80.0 : 40.0;
+            }, true, HighestSurface, NoRole, ACCENT_CURVE, primaryPair });
+        set(OnPrimary, { "onPrimary", primaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 10.0 : 90.0;
+                return s.dark ? 20.0 : 100.0;
+            }, false, Primary, NoRole, TEXT_CURVE });
+        set(PrimaryContainer, { "primaryContainer", primaryPalette,
+            [](const DynamicScheme &s) {
+                if (isFidelity(s)) return s.source.tone;
+                if (isMonochrome(s)) return s.dark ? 85.0 : 25.0;
+                return s.dark ? 30.0 : 90.0;
+            }, true, HighestSurface, NoRole, CONTAINER_CURVE, primaryPair });
+        set(OnPrimaryContainer, { "onPrimaryContainer", primaryPalette,
+            [](const DynamicScheme &s) {
+                if (isFidelity(s)) return foregroundTone(rawTone(PrimaryContainer, s), 4.5);
+                if (isMonochrome(s)) return s.dark ? 0.0 : 100.0;
+                return s.dark ? 90.0 : 10.0;
+            }, false, PrimaryContainer, NoRole, TEXT_CURVE });
+        set(InversePrimary, { "inversePrimary", primaryPalette,
+            [](const DynamicScheme &s) { return s.dark ? 40.0 : 80.0; }, false, InverseSurface, NoRole, ACCENT_CURVE });
+
+        const ToneDeltaPair secondaryPair = { SecondaryContainer, Secondary, 10.0, Polarity::Nearer, false };
+        set(Secondary, { "secondary", secondaryPalette,
+            [](const DynamicScheme &s) { return s.dark ? 80.0 : 40.0; }, true, HighestSurface, NoRole, ACCENT_CURVE, secondaryPair });
+        set(OnSecondary, { "onSecondary", secondaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 10.0 : 100.0;
+                return s.dark ? 20.0 : 100.0;
+            }, false, Secondary, NoRole, TEXT_CURVE });
+        set(SecondaryContainer, { "secondaryContainer", secondaryPalette,
+            [](const DynamicScheme &s) {
+                const double initialTone = s.dark ? 30.0 : 90.0;
+                if (isMonochrome(s)) return s.dark ? 30.0 : 85.0;
+                if (!isFidelity(s)) return initialTone;
+                return findDesiredChromaByTone(s.secondary.hue(), s.secondary.chroma(), initialTone, !s.dark);
+            }, true, HighestSurface, NoRole, CONTAINER_CURVE, secondaryPair });
+        set(OnSecondaryContainer, { "onSecondaryContainer", secondaryPalette,
+            [](const DynamicScheme &s) {
+                if (!isFidelity(s)) return s.dark ? 90.0 : 10.0;
+                return foregroundTone(rawTone(SecondaryContainer, s), 4.5);
+            }, false, SecondaryContainer, NoRole, TEXT_CURVE });
+
+        const ToneDeltaPair tertiaryPair = { TertiaryContainer, Tertiary, 10.0, Polarity::Nearer, false };
+        set(Tertiary, { "tertiary", tertiaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 90.0 : 25.0;
+                return s.dark ? 80.0 : 40.0;
+            }, true, HighestSurface, NoRole, ACCENT_CURVE, tertiaryPair });
+        set(OnTertiary, { "onTertiary", tertiaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 10.0 : 90.0;
+                return s.dark ? 20.0 : 100.0;
+            }, false, Tertiary, NoRole, TEXT_CURVE });
+        set(TertiaryContainer, { "tertiaryContainer", tertiaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 60.0 : 49.0;
+                if (!isFidelity(s)) return s.dark ? 30.0 : 90.0;
+                return fixIfDisliked(s.tertiary.hct(s.source.tone)).tone;
+            }, true, HighestSurface, NoRole, CONTAINER_CURVE, tertiaryPair });
+        set(OnTertiaryContainer, { "onTertiaryContainer", tertiaryPalette,
+            [](const DynamicScheme &s) {
+                if (isMonochrome(s)) return s.dark ? 0.0 : 100.0;
+                if (!isFidelity(s)) return s.dark ? 90.0 : 10.0;
+                return foregroundTone(rawTone(TertiaryContainer, s), 4.5);
+            }, false, TertiaryContainer, NoRole, TEXT_CURVE });
+
+        const ToneDeltaPair errorPair = { ErrorContainer, Error, 10.0, Polarity::Nearer, false };
+        set(Error, { "error", errorPalette,
+            [](const DynamicScheme &s) { return s.dark ? 80.0 : 40.0; }, true, HighestSurface, NoRole, ACCENT_CURVE, errorPair });
+        set(OnError, { "onError", errorPalette,
+            [](const DynamicScheme &s) { return s.dark ? 20.0 : 100.0; }, false, Error, NoRole, TEXT_CURVE });
+        set(ErrorContainer, { "errorContainer", errorPalette,
+            [](const DynamicScheme &s) { return s.dark ? 30.0 : 90.0; }, true, HighestSurface, NoRole, CONTAINER_CURVE, errorPair });
+        set(OnErrorContainer, { "onErrorContainer", errorPalette,
+            [](const DynamicScheme &s) { return s.dark ? 90.0 : 10.0; }, false, ErrorContainer, NoRole, TEXT_CURVE });
+
+        const ToneDeltaPair primaryFixedPair = { PrimaryFixed, PrimaryFixedDim, 10.0, Polarity::Lighter, true };
+        set(PrimaryFixed, { "primaryFixed", primaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 40.0 : 90.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, primaryFixedPair });
+        set(PrimaryFixedDim, { "primaryFixedDim", primaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 30.0 : 80.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, primaryFixedPair });
+        set(OnPrimaryFixed, { "onPrimaryFixed", primaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 100.0 : 10.0; },
+            false, PrimaryFixedDim, PrimaryFixed, TEXT_CURVE });
+        set(OnPrimaryFixedVariant, { "onPrimaryFixedVariant", primaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 90.0 : 30.0; },
+            false, PrimaryFixedDim, PrimaryFixed, VARIANT_CURVE });
+
+        const ToneDeltaPair secondaryFixedPair = { SecondaryFixed, SecondaryFixedDim, 10.0, Polarity::Lighter, true };
+        set(SecondaryFixed, { "secondaryFixed", secondaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 80.0 : 90.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, secondaryFixedPair });
+        set(SecondaryFixedDim, { "secondaryFixedDim", secondaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 70.0 : 80.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, secondaryFixedPair });
+        set(OnSecondaryFixed, { "onSecondaryFixed", secondaryPalette,
+            [](const DynamicScheme &) { return 10.0; },
+            false, SecondaryFixedDim, SecondaryFixed, TEXT_CURVE });
+        set(OnSecondaryFixedVariant, { "onSecondaryFixedVariant", secondaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 25.0 : 30.0; },
+            false, SecondaryFixedDim, SecondaryFixed, VARIANT_CURVE });
+
+        const ToneDeltaPair tertiaryFixedPair = { TertiaryFixed, TertiaryFixedDim, 10.0, Polarity::Lighter, true };
+        set(TertiaryFixed, { "tertiaryFixed", tertiaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 40.0 : 90.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, tertiaryFixedPair });
+        set(TertiaryFixedDim, { "tertiaryFixedDim", tertiaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 30.0 : 80.0; },
+            true, HighestSurface, NoRole, CONTAINER_CURVE, tertiaryFixedPair });
+        set(OnTertiaryFixed, { "onTertiaryFixed", tertiaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 100.0 : 10.0; },
+            false, TertiaryFixedDim, TertiaryFixed, TEXT_CURVE });
+        set(OnTertiaryFixedVariant, { "onTertiaryFixedVariant", tertiaryPalette,
+            [](const DynamicScheme &s) { return isMonochrome(s) ? 90.0 : 30.0; },
+            false, TertiaryFixedDim, TertiaryFixed, VARIANT_CURVE });
+        return r;
+    }();
+    return specs;
+}
+
+double rawTone(Role role, const DynamicScheme &s) {
+    return roleSpecs()[role].tone(s);
+}
+
+// DynamicColor.getTone(), memoised per role for one scheme
+class ToneResolver {
+public:
+    explicit ToneResolver(const DynamicScheme &scheme) : m_scheme(scheme) {
+        m_tones.fill(-1.0);
+    }
+
+    double tone(Role role) {
+        if (role == HighestSurface) role = m_scheme.dark ? SurfaceBright : SurfaceDim;
+        if (m_tones[role] < 0.0) m_tones[role] = solve(role);
+        return m_tones[role];
+    }
+
+private:
+    double solve(Role role) {
+        const RoleSpec &spec = roleSpecs()[role];
+        const DynamicScheme &s = m_scheme;
+        const bool decreasingContrast = s.contrastLevel < 0.0;
+
+        if (spec.pair.a != NoRole) {
+            const ToneDeltaPair &pair = spec.pair;
+            const double bgTone = tone(spec.background);
+            const bool aIsNearer = pair.polarity == Polarity::Nearer
+                || (pair.polarity == Polarity::Lighter && !s.dark)
+                || (pair.polarity == Polarity::Darker && s.dark);
+            const RoleSpec &nearer = roleSpecs()[aIsNearer ? pair.a : pair.b];
+            const RoleSpec &farther = roleSpecs()[aIsNearer ? pair.b : pair.a];
+            const bool amNearer = std::strcmp(spec.name, nearer.name) == 0;
+            const double expansionDir = s.dark ? 1.0 : -1.0;
+            const double delta = pair.delta;
+
+            const double nContrast = nearer.curve.get(s.contrastLevel);
+            const double fContrast = farther.curve.get(s.contrastLevel);
+
+            const double nInitialTone = nearer.tone(s);
+            double nTone = ratioOfTones(bgTone, nInitialTone) >= nContrast ? nInitialTone : foregroundTone(bgTone, nContrast);
+            const double fInitialTone = farther.tone(s);
+            double fTone = ratioOfTones(bgTone, fInitialTone) >= fContrast ? fInitialTone : foregroundTone(bgTone, fContrast);
+
+            if (decreasingContrast) {
+                nTone = foregroundTone(bgTone, nContrast);
+                fTone = foregroundTone(bgTone, fContrast);
+            }
+
+            if ((fTone - nTone) * expansionDir < delta) {
+                fTone = std::clamp(nTone + delta * expansionDir, 0.0, 100.0);
+                if ((fTone - nTone) * expansionDir < delta) {
+                    nTone = std::clamp(fTone - delta * expansionDir, 0.0, 100.0);
+                }
+            }
+
+            // Keeps out of the 50-59 tones, light and dark text both fail there
+            if (50.0 <= nTone && nTone < 60.0) {
+                if (expansionDir > 0) {
+                    nTone = 60.0;
+                    fTone = std::max(fTone, nTone + delta * expansionDir);
+                } else {
+                    nTone = 49.0;
+                    fTone = std::min(fTone, nTone + delta * expansionDir);
+                }
+            } else if (50.0 <= fTone && fTone < 60.0) {
+                if (pair.stayTogether) {
+                    if (expansionDir > 0) {
+                        nTone = 60.0;
+                        fTone = std::max(fTone, nTone + delta * expansionDir);
+                    } else {
+                        nTone = 49.0;
+                        fTone = std::min(fTone, nTone + delta * expansionDir);
+                    }
+                } else {
+                    fTone = expansionDir > 0 ? 60.0 : 49.0;
+                }
+            }
+            return amNearer ? nTone : fTone;
+        }
+
+        double answer = spec.tone(s);
+        if (spec.background == NoRole) return answer;
+
+        const double bgTone = tone(spec.background);
+        const double desiredRatio = spec.curve.get(s.contrastLevel);
+        if (ratioOfTones(bgTone, answer) < desiredRatio) answer = foregroundTone(bgTone, desiredRatio);
+        if (decreasingContrast) answer = foregroundTone(bgTone, desiredRatio);
+
+        if (spec.isBackground && 50.0 <= answer && answer < 60.0) {
+            answer = ratioOfTones(49.0, bgTone) >= desiredRatio ? 49.0 : 60.0;
+        }
+
+        if (spec.secondBackground != NoRole) {
+            const double bgTone1 = tone(spec.background);
+            const double bgTone2 = tone(spec.secondBackground);
+            const double upper = std::max(bgTone1, bgTone2);
+            const double lower = std::min(bgTone1, bgTone2);
+            if (ratioOfTones(upper, answer) >= desiredRatio && ratioOfTones(lower, answer) >= desiredRatio) return answer;
+
+            const double lightOption = lighterTone(upper, desiredRatio);
+            const double darkOption = darkerTone(lower, desiredRatio);
+            int available = 0;
+            if (lightOption != -1.0) ++available;
+            if (darkOption != -1.0) ++available;
+
+            if (tonePrefersLightForeground(bgTone1) || tonePrefersLightForeground(bgTone2)) {
+                return lightOption < 0.0 ? 100.0 : lightOption;
+            }
+            if (available == 1) return lightOption != -1.0 ? lightOption : darkOption;
+            return darkOption < 0.0 ? 0.0 : darkOption;
+        }
+        return answer;
+    }
+
+    const DynamicScheme &m_scheme;
+    std::array<double, RoleCount> m_tones;
+};
+}
+
+Hct Hct::fromArgb(quint32 argb) {
+    Hct hct;
+    cam16HueChroma(argb, hct.hue, hct.chroma);
+    hct.tone = lstarFromArgb(argb);
+    hct.argb = argb;
+    return hct;
+}
+
+Hct Hct::from(double hue, double chroma, double tone) {
+    return fromArgb(solveToArgb(hue, chroma, tone));
+}
+
+TonalPalette TonalPalette::fromHct(const Hct &hct) {
+    return TonalPalette(hct.hue, hct.chroma, hct);
+}
+
+TonalPalette TonalPalette::fromHueAndChroma(double hue, double chroma) {
+    // Key colour: the tone closest to 50 that still reaches the chroma
+    Hct smallestDeltaHct = Hct::from(hue, chroma, 50.0);
+    double smallestDelta = std::abs(smallestDeltaHct.chroma - chroma);
+    for (double delta = 1.0; delta < 50.0; delta += 1.0) {
+        if (roundHalfEven(chroma) == roundHalfEven(smallestDeltaHct.chroma)) break;
+
+        const Hct hctAdd = Hct::from(hue, chroma, 50.0 + delta);
+        const double hctAddDelta = std::abs(hctAdd.chroma - chroma);
+        if (hctAddDelta < smallestDelta) {
+            smallestDelta = hctAddDelta;
+            smallestDeltaHct = hctAdd;
+        }
+
+        const Hct hctSubtract = Hct::from(hue, chroma, 50.0 - delta);
+        const double hctSubtractDelta = std::abs(hctSubtract.chroma - chroma);
+        if (hctSubtractDelta < smallestDelta) {
+            smallestDelta = hctSubtractDelta;
+            smallestDeltaHct = hctSubtract;
+        }
+    }
+    return TonalPalette(hue, chroma, smallestDeltaHct);
+}
+
+DynamicScheme DynamicScheme::make(const Hct &source, Variant variant, bool dark, double contrastLevel) {
+    static constexpr double VIBRANT_HUES[9] = { 0, 41, 61, 101, 131, 181, 251, 301, 360 };
+    static constexpr double VIBRANT_SECONDARY_ROTATIONS[9] = { 18, 15, 10, 12, 15, 18, 15, 12, 12 };
+    static constexpr double VIBRANT_TERTIARY_ROTATIONS[9] = { 35, 30, 20, 25, 30, 35, 30, 25, 25 };
+    static constexpr double EXPRESSIVE_HUES[9] = { 0, 21, 51, 121, 151, 191, 271, 321, 360 };
+    static constexpr double EXPRESSIVE_SECONDARY_ROTATIONS[9] = { 45, 95, 45, 20, 45, 90, 45, 45, 45 };
+    static constexpr double EXPRESSIVE_TERTIARY_ROTATIONS[9] = { 120, 120, 20, 45, 20, 15, 20, 120, 120 };
+
+    DynamicScheme s;
+    s.source = source;
+    s.variant = variant;
+    s.dark = dark;
+    s.contrastLevel = contrastLevel;
+
+    const double hue = source.hue;
+    const double chroma = source.chroma;
+    switch (variant) {
+        case Variant::Monochrome:
+            s.primary = TonalPalette::fromHueAndChroma(hue, 0.0);
+            s.secondary = TonalPalette::fromHueAndChroma(hue, 0.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(hue, 0.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 0.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 0.0);
+            break;
+        case Variant::Neutral:
+            s.primary = TonalPalette::fromHueAndChroma(hue, 12.0);
+            s.secondary = TonalPalette::fromHueAndChroma(hue, 8.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(hue, 16.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 2.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 2.0);
+            break;
+        case Variant::TonalSpot:
+            s.primary = TonalPalette::fromHueAndChroma(hue, 36.0);
+            s.secondary = TonalPalette::fromHueAndChroma(hue, 16.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue + 60.0), 24.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 6.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 8.0);
+            break;
+        case Variant::Vibrant:
+            s.primary = TonalPalette::fromHueAndChroma(hue, 200.0);
+            s.secondary = TonalPalette::fromHueAndChroma(rotatedHue(hue, VIBRANT_HUES, VIBRANT_SECONDARY_ROTATIONS), 24.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(rotatedHue(hue, VIBRANT_HUES, VIBRANT_TERTIARY_ROTATIONS), 32.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 10.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 12.0);
+            break;
+        case Variant::Expressive:
+            s.primary = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue + 240.0), 40.0);
+            s.secondary = TonalPalette::fromHueAndChroma(rotatedHue(hue, EXPRESSIVE_HUES, EXPRESSIVE_SECONDARY_ROTATIONS), 24.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(rotatedHue(hue, EXPRESSIVE_HUES, EXPRESSIVE_TERTIARY_ROTATIONS), 32.0);
+            s.neutral = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue + 15.0), 8.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue + 15.0), 12.0);
+            break;
+        case Variant::Fidelity:
+        case Variant::Content:
+            s.primary = TonalPalette::fromHueAndChroma(hue, chroma);
+            s.secondary = TonalPalette::fromHueAndChroma(hue, std::max(chroma - 32.0, chroma * 0.5));
+            s.tertiary = TonalPalette::fromHct(fixIfDisliked(analogous(source, 3, 6)[2]));
+            s.neutral = TonalPalette::fromHueAndChroma(hue, chroma / 8.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, chroma / 8.0 + 4.0);
+            break;
+        case Variant::Rainbow:
+            s.primary = TonalPalette::fromHueAndChroma(hue, 48.0);
+            s.secondary = TonalPalette::fromHueAndChroma(hue, 16.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue + 60.0), 24.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 0.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 0.0);
+            break;
+        case Variant::FruitSalad:
+            s.primary = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue - 50.0), 48.0);
+            s.secondary = TonalPalette::fromHueAndChroma(sanitizeDegrees(hue - 50.0), 36.0);
+            s.tertiary = TonalPalette::fromHueAndChroma(hue, 36.0);
+            s.neutral = TonalPalette::fromHueAndChroma(hue, 10.0);
+            s.neutralVariant = TonalPalette::fromHueAndChroma(hue, 16.0);
+            break;
+    }
+    s.error = TonalPalette::fromHueAndChroma(25.0, 84.0);
+    return s;
+}
+
+std::vector<std::pair<const char *, quint32>> dynamicColors(const DynamicScheme &scheme) {
+    ToneResolver resolver(scheme);
+    std::vector<std::pair<const char *, quint32>> colors;
+    colors.reserve(RoleCount);
+    for (int role = 0; role < RoleCount; ++role) {
+        const RoleSpec &spec = roleSpecs()[role];
+        const double tone = resolver.tone(Role(role));
+        colors.emplace_back(spec.name, spec.palette(scheme).hct(tone).argb);
+    }
+    // dir() order: plain byte comparison of the attribute names
+    std::sort(colors.begin(), colors.end(), [](const auto &a, const auto &b) {
+        return std::strcmp(a.first, b.first) < 0;
+    });
+    return colors;
+}
+
+double sanitizeDegrees(double degrees) {
+    degrees = std::fmod(degrees, 360.0);
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+double differenceDegrees(double a, double b) {
+    return 180.0 - std::abs(std::abs(a - b) - 180.0);
+}
+
+quint32 harmonize(quint32 designColor, quint32 sourceColor, double threshold, double harmony) {
+    const Hct from = Hct::fromArgb(designColor);
+    const Hct to = Hct::fromArgb(sourceColor);
+    const double rotation = std::min(differenceDegrees(from.hue, to.hue) * harmony, threshold);
+    const double direction = sanitizeDegrees(to.hue - from.hue) <= 180.0 ? 1.0 : -1.0;
+    return Hct::from(sanitizeDegrees(from.hue + rotation * direction), from.chroma, from.tone).argb;
+}
+
+quint32 boostChromaTone(quint32 argb, double chroma, double tone) {
+    const Hct hct = Hct::fromArgb(argb);
+    return Hct::from(hct.hue, hct.chroma * chroma, hct.tone * tone).argb;
+}
+
+} // namespace MaterialColor
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QtGlobal>
+#include <utility>
+#include <vector>
+
+// The parts of material-color-utilities the colour scripts rely on: HCT,
+// tonal palettes, scheme variants and the Material dynamic colour roles.
+// Follows the materialyoucolor package used by generate_colors_material.py
+// step for step, rounding included, so both produce the same palette.
+namespace MaterialColor {
+
+struct Hct {
+    double  hue = 0.0;
+    double  chroma = 0.0;
+    double  tone = 0.0;
+    quint32 argb = 0xff000000;
+
+    static Hct fromArgb(quint32 argb);
+    // Closest displayable colour, hue, chroma and tone are measured again from it
+    static Hct from(double hue, double chroma, double tone);
+};
+
+class TonalPalette {
+public:
+    TonalPalette() = default;
+    static TonalPalette fromHct(const Hct &hct);
+    static TonalPalette fromHueAndChroma(double hue, double chroma);
+
+    double hue() const { return m_hue; }
+    double chroma() const { return m_chroma; }
+    const Hct &keyColor() const { return m_keyColor; }
+    Hct hct(double tone) const { return Hct::from(m_hue, m_chroma, tone); }
+
+private:
+    TonalPalette(double hue, double chroma, const Hct &keyColor)
+        : m_hue(hue), m_chroma(chroma), m_keyColor(keyColor) {}
+
+    double m_hue = 0.0;
+    double m_chroma = 0.0;
+    Hct    m_keyColor;
+};
+
+enum class Variant {
+    Monochrome,
+    Neutral,
+    TonalSpot,
+    Vibrant,
+    Expressive,
+    Fidelity,
+    Content,
+    Rainbow,
+    FruitSalad
+};
+
+struct DynamicScheme {
+    Hct     source;
+    Variant variant = Variant::TonalSpot;
+    bool    dark = true;
+    double  contrastLevel = 0.0;
+
+    TonalPalette primary;
+    TonalPalette secondary;
+    TonalPalette tertiary;
+    TonalPalette neutral;
+    TonalPalette neutralVariant;
+    TonalPalette error;
+
+    static DynamicScheme make(const Hct &source, Variant variant, bool dark, double contrastLevel = 0.0);
+};
+
+// Every dynamic colour of the scheme, named and sorted like the attributes
+// of materialyoucolor's MaterialDynamicColors
+std::vector<std::pair<const char *, quint32>> dynamicColors(const DynamicScheme &scheme);
+
+// Rotates the hue of designColor towards sourceColor by harmony of their
+// difference, at most threshold degrees
+quint32 harmonize(quint32 designColor, quint32 sourceColor, double threshold, double harmony);
+quint32 boostChromaTone(quint32 argb, double chroma, double tone);
+
+double sanitizeDegrees(double degrees);
+double differenceDegrees(double a, double b);
+
+} // namespace MaterialColor
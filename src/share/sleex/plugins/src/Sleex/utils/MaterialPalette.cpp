@@ -0,0 +1,546 @@
+#include "MaterialPalette.hpp"
+#include "MaterialColor.hpp"
+#include "MaterialQuantizer.hpp"
+#include "SchemeCache.hpp"
+#include <QColor>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+using MaterialColor::Hct;
+
+namespace {
+// Pillow resamples 8-bit images in fixed point with this many fraction bits
+constexpr int PRECISION_BITS = 32 - 8 - 2;
+
+struct Options {
+    QString path;
+    int     size = 128;
+    QString color;
+    bool    dark = true;
+    QString scheme = QStringLiteral("vibrant");
+    bool    smart = false;
+    bool    transparent = false;
+    QString termscheme;
+    double  harmony = 0.8;
+    double  harmonizeThreshold = 100.0;
+    double  termFgBoost = 0.35;
+    bool    blendBgFg = false;
+    QString cache;
+};
+
+std::optional<Options> parseOptions(const QStringList &arguments) {
+    QCommandLineParser parser;
+    const QCommandLineOption path("path", QString(), "path");
+    const QCommandLineOption size("size", QString(), "size", "128");
+    const QCommandLineOption color("color", QString(), "color");
+    const QCommandLineOption mode("mode", QString(), "mode", "dark");
+    const QCommandLineOption scheme("scheme", QString(), "scheme", "vibrant");
+    const QCommandLineOption smart("smart");
+    const QCommandLineOption transparency("transparency", QString(), "transparency", "opaque");
+    const QCommandLineOption termscheme("termscheme", QString(), "termscheme");
+    const QCommandLineOption harmony("harmony", QString(), "harmony", "0.8");
+    const QCommandLineOption threshold("harmonize_threshold", QString(), "threshold", "100");
+    const QCommandLineOption boost("term_fg_boost", QString(), "boost", "0.35");
+    const QCommandLineOption blend("blend_bg_fg");
+    const QCommandLineOption cache("cache", QString(), "cache");
+    const QCommandLineOption debug("debug");
+    parser.addOptions({ path, size, color, mode, scheme, smart, transparency, termscheme,
+                        harmony, threshold, boost, blend, cache, debug });
+
+    // The parser expects the program name first
+    if (!parser.parse(QStringList { QStringLiteral("generate_colors_material") } + arguments)) {
+        qWarning() << "Sleex: material palette:" << parser.errorText();
+        return std::nullopt;
+    }
+
+    Options options;
+    bool ok = true;
+    const auto toDouble = [&](const QCommandLineOption &option) {
+        bool valid = false;
+        const double value = parser.value(option).toDouble(&valid);
+        ok = ok && valid;
+        return value;
+    };
+    options.path = parser.value(path);
+    options.size = parser.value(size).toInt(&ok);
+    options.color = parser.value(color);
+    options.scheme = parser.value(scheme);
+    options.smart = parser.isSet(smart);
+    options.termscheme = parser.value(termscheme);
+    options.harmony = toDouble(harmony);
+    options.harmonizeThreshold = toDouble(threshold);
+    options.termFgBoost = toDouble(boost);
+    options.blendBgFg = parser.isSet(blend);
+    options.cache = parser.value(cache);
+
+    const QString modeValue = parser.value(mode);
+    const QString transparencyValue = parser.value(transparency);
+    if (!ok || (modeValue != "dark" && modeValue != "light")
+        || (transparencyValue != "opaque" && transparencyValue != "transparent")) {
+        qWarning() << "Sleex: material palette: invalid arguments" << arguments;
+        return std::nullopt;
+    }
+    options.dark = modeValue == "dark";
+    options.transparent = transparencyValue == "transparent";
+    return options;
+}
+
+// Unknown names, the script's default "vibrant" included, fall back to tonal spot like it does
+MaterialColor::Variant variantFor(const QString &scheme) {
+    using MaterialColor::Variant;
+    static const QHash<QString, Variant> variants = {
+        { "scheme-fruit-salad", Variant::FruitSalad },
+        { "scheme-expressive", Variant::Expressive },
+        { "scheme-monochrome", Variant::Monochrome },
+        { "scheme-rainbow", Variant::Rainbow },
+        { "scheme-tonal-spot", Variant::TonalSpot },
+        { "scheme-neutral", Variant::Neutral },
+        { "scheme-fidelity", Variant::Fidelity },
+        { "scheme-content", Variant::Content },
+        { "scheme-vibrant", Variant::Vibrant },
+    };
+    return variants.value(scheme, Variant::TonalSpot);
+}
+
+QString hexOf(quint32 argb) {
+    return QStringLiteral("#%1").arg(argb & 0xffffff, 6, 16, QLatin1Char('0')).toUpper();
+}
+
+std::optional<quint32> argbOf(const QString &hex) {
+    bool ok = false;
+    const uint rgb = hex.mid(1, 6).toUInt(&ok, 16);
+    if (!ok || !hex.startsWith('#') || hex.size() != 7) return std::nullopt;
+    return 0xff000000u | rgb;
+}
+
+// Pillow's image size for --size, the area is brought down to size squared
+QSize optimalSize(const QSize &image, int bitmapSize) {
+    const double imageArea = double(image.width()) * image.height();
+    const double bitmapArea = double(bitmapSize) * bitmapSize;
+    const double scale = imageArea > bitmapArea ? std::sqrt(bitmapArea / imageArea) : 1.0;
+    // Python's round(), halves to even
+    const int width = int(std::nearbyint(image.width() * scale));
+    const int height = int(std::nearbyint(image.height() * scale));
+    return QSize(std::max(width, 1), std::max(height, 1));
+}
+
+double bicubic(double x) {
+    constexpr double a = -0.5;
+    x = std::abs(x);
+    if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1;
+    if (x < 2.0) return (((x - 5) * x + 8) * x - 4) * a;
+    return 0.0;
+}
+
+// Fixed point filter taps of one axis, laid out like Pillow's precompute_coeffs()
+struct Kernel {
+    int ksize = 0;
+    // First input index and tap count, per output index
+    std::vector<int> bounds;
+    std::vector<int> taps;
+};
+
+Kernel kernelFor(int inSize, int outSize) {
+    const double scale = double(inSize) / outSize;
+    const double filterScale = std::max(scale, 1.0);
+    const double support = 2.0 * filterScale;
+
+    Kernel kernel;
+    kernel.ksize = int(std::ceil(support)) * 2 + 1;
+    kernel.bounds.resize(size_t(outSize) * 2);
+    kernel.taps.assign(size_t(outSize) * kernel.ksize, 0);
+
+    const double reciprocal = 1.0 / filterScale;
+    std::vector<double> weights(kernel.ksize);
+    for (int out = 0; out < outSize; ++out) {
+        const double center = (out + 0.5) * scale;
+        const int first = std::max(int(center - support + 0.5), 0);
+        const int count = std::min(int(center + support + 0.5), inSize) - first;
+
+        double total = 0.0;
+        for (int i = 0; i < count; ++i) {
+            weights[i] = bicubic((i + first - center + 0.5) * reciprocal);
+            total += weights[i];
+        }
+        int *taps = kernel.taps.data() + size_t(out) * kernel.ksize;
+        for (int i = 0; i < count; ++i) {
+            const double weight = (total != 0.0 ? weights[i] / total : weights[i]) * (1 << PRECISION_BITS);
+            taps[i] = int(weight < 0 ? weight - 0.5 : weight + 0.5);
+        }
+        kernel.bounds[out * 2] = first;
+        kernel.bounds[out * 2 + 1] = count;
+    }
+    return kernel;
+}
+
+uchar clip8(int value) {
+    return uchar(std::clamp(value >> PRECISION_BITS, 0, 255));
+}
+
+// Image.resize(size, Image.Resampling.BICUBIC) on RGBA8888 data: a
+// horizontal pass over the rows the vertical pass needs, then the vertical one
+QImage resizeBicubic(QImage image, const QSize &size) {
+    const int width = size.width();
+    const int height = size.height();
+    const bool needVertical = height != image.height();
+    Kernel vertical = kernelFor(image.height(), height);
+
+    if (width != image.width()) {
+        const Kernel horizontal = kernelFor(image.width(), width);
+        const int firstRow = vertical.bounds[0];
+        const int lastRow = vertical.bounds[height * 2 - 2] + vertical.bounds[height * 2 - 1];
+        for (int y = 0; y < height; ++y) vertical.bounds[y * 2] -= firstRow;
+
+        QImage temp(width, lastRow - firstRow, QImage::Format_RGBA8888);
+        for (int y = 0; y < temp.height(); ++y) {
+            const uchar *in = image.constScanLine(y + firstRow);
+            uchar *out = temp.scanLine(y);
+            for (int x = 0; x < width; ++x) {
+                const int first = horizontal.bounds[x * 2];
+                const int count = horizontal.bounds[x * 2 + 1];
+                const int *taps = horizontal.taps.data() + size_t(x) * horizontal.ksize;
+                const uchar *source = in + first * 4;
+                int sums[4] = { 1 << (PRECISION_BITS - 1), 1 << (PRECISION_BITS - 1), 1 << (PRECISION_BITS - 1), 1 << (PRECISION_BITS - 1) };
+                for (int i = 0; i < count; ++i) {
+                    for (int c = 0; c < 4; ++c) sums[c] += source[i * 4 + c] * taps[i];
+                }
+                for (int c = 0; c < 4; ++c) out[x * 4 + c] = clip8(sums[c]);
+            }
+        }
+        image = temp;
+    }
+
+    if (needVertical) {
+        QImage out(width, height, QImage::Format_RGBA8888);
+        std::vector<int> sums(size_t(width) * 4);
+        for (int y = 0; y < height; ++y) {
+            const int first = vertical.bounds[y * 2];
+            const int count = vertical.bounds[y * 2 + 1];
+            const int *taps = vertical.taps.data() + size_t(y) * vertical.ksize;
+            std::fill(sums.begin(), sums.end(), 1 << (PRECISION_BITS - 1));
+            // Row by row, the inner loop runs over contiguous bytes
+            for (int i = 0; i < count; ++i) {
+                const uchar *in = image.constScanLine(first + i);
+                const int tap = taps[i];
+                for (int x = 0; x < width * 4; ++x) sums[x] += in[x] * tap;
+            }
+            uchar *line = out.scanLine(y);
+            for (int x = 0; x < width * 4; ++x) line[x] = clip8(sums[x]);
+        }
+        image = out;
+    }
+    return image;
+}
+
+// Pillow resizes RGBA as premultiplied RGBa and converts back afterwards
+void premultiply(QImage &image) {
+    for (int y = 0; y < image.height(); ++y) {
+        uchar *p = image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x, p += 4) {
+            for (int c = 0; c < 3; ++c) {
+                const int tmp = p[c] * p[3] + 128;
+                p[c] = uchar(((tmp >> 8) + tmp) >> 8);
+            }
+        }
+    }
+}
+
+void unpremultiply(QImage &image) {
+    for (int y = 0; y < image.height(); ++y) {
+        uchar *p = image.scanLine(y);
+        for (int x = 0; x < image.width(); ++x, p += 4) {
+            if (p[3] == 0 || p[3] == 255) continue;
+            for (int c = 0; c < 3; ++c) p[c] = uchar(std::min(255 * p[c] / p[3], 255));
+        }
+    }
+}
+
+// Pixels Score sees in the script, ARGB, alpha kept for images that have it
+std::optional<std::vector<quint32>> loadPixels(const QString &path, int bitmapSize) {
+    QImageReader reader(path);
+    reader.setAutoTransform(false);
+    QImage image = reader.read();
+    // The script seeks to the second frame of a GIF
+    if (reader.format() == "gif" && reader.canRead()) {
+        const QImage second = reader.read();
+        if (!second.isNull()) image = second;
+    }
+    if (image.isNull()) {
+        qWarning() << "Sleex: material palette: cannot read" << path << reader.errorString();
+        return std::nullopt;
+    }
+
+    // Palette and grey images are converted to RGB first, dropping alpha
+    const bool alpha = image.hasAlphaChannel() && image.format() != QImage::Format_Indexed8
+        && image.format() != QImage::Format_Grayscale8 && image.format() != QImage::Format_Grayscale16;
+    image = image.convertToFormat(alpha ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888);
+    image.reinterpretAsFormat(QImage::Format_RGBA8888);
+
+    const QSize size = optimalSize(image.size(), bitmapSize);
+    if (size.width() < image.width() || size.height() < image.height()) {
+        if (alpha) premultiply(image);
+        image = resizeBicubic(image, size);
+        if (alpha) unpremultiply(image);
+    }
+
+    std::vector<quint32> pixels;
+    pixels.reserve(size_t(image.width()) * image.height());
+    for (int y = 0; y < image.height(); ++y) {
+        const uchar *p = image.constScanLine(y);
+        for (int x = 0; x < image.width(); ++x, p += 4) {
+            const quint32 a = alpha ? p[3] : 255;
+            pixels.push_back((a << 24) | (quint32(p[0]) << 16) | (quint32(p[1]) << 8) | p[2]);
+        }
+    }
+    return pixels;
+}
+
+std::optional<quint32> sourceOf(const QString &path, int bitmapSize, bool parallel) {
+    const std::optional<std::vector<quint32>> pixels = loadPixels(path, bitmapSize);
+    if (!pixels) return std::nullopt;
+    return MaterialQuantizer::score(MaterialQuantizer::quantizeCelebi(*pixels, 128, parallel)).front();
+}
+
+// The source colour only depends on the pixels and the bitmap size
+QByteArray sourceKey(const QByteArray &hash, int bitmapSize) {
+    return hash + "|source|" + QByteArray::number(bitmapSize);
+}
+
+// Every option but --path and --cache shapes the output. The terminal
+// scheme is a file, an edit to it has to miss
+QByteArray schemeKey(const QByteArray &hash, const Options &options) {
+    QByteArray key = hash;
+    const auto add = [&key](const QByteArray &value) { key += '|' + value; };
+    add(QByteArray::number(options.size));
+    add(options.dark ? "dark" : "light");
+    add(options.scheme.toUtf8());
+    add(options.smart ? "smart" : "");
+    add(options.transparent ? "transparent" : "opaque");
+    add(QByteArray::number(options.harmony, 'g', 17));
+    add(QByteArray::number(options.harmonizeThreshold, 'g', 17));
+    add(QByteArray::number(options.termFgBoost, 'g', 17));
+    add(options.blendBgFg ? "blend" : "");
+    if (!options.termscheme.isEmpty()) {
+        const QFileInfo termscheme(options.termscheme);
+        add(QFile::encodeName(termscheme.absoluteFilePath()));
+        add(QByteArray::number(termscheme.lastModified().toMSecsSinceEpoch()));
+    } else {
+        add(QByteArray());
+    }
+    return key;
+}
+
+void writeSourceColor(const QString &path, quint32 argb) {
+    if (path.isEmpty()) return;
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(hexOf(argb).toUtf8());
+        file.commit();
+    }
+}
+
+// "term0".."term15" of the mode, in file order
+QVector<QPair<QString, QString>> terminalColors(const QString &path, bool dark) {
+    QVector<QPair<QString, QString>> colors;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Sleex: material palette: cannot read" << path;
+        return colors;
+    }
+    const QByteArray content = file.readAll();
+    const QJsonObject scheme = QJsonDocument::fromJson(content).object().value(dark ? "dark" : "light").toObject();
+
+    QStringList keys = scheme.keys();
+    // QJsonObject sorts its keys, the script keeps them as written
+    std::stable_sort(keys.begin(), keys.end(), [&content](const QString &a, const QString &b) {
+        return content.indexOf('"' + a.toUtf8() + '"') < content.indexOf('"' + b.toUtf8() + '"');
+    });
+    for (const QString &key : keys) colors.append({ key, scheme.value(key).toString() });
+    return colors;
+}
+}
+
+MaterialPalette::MaterialPalette(QObject *parent) : QObject(parent) {}
+
+QString MaterialPalette::sourceColor(const QString &path, int size) const {
+    const std::optional<quint32> argb = sourceOf(path, size, true);
+    return argb ? hexOf(*argb) : QString();
+}
+
+QVariantMap MaterialPalette::preview(const QString &path, const QStringList &arguments) const {
+    QVariantMap colors;
+    const std::optional<Options> options = parseOptions(QStringList { "--path", path } + arguments);
+    if (!options) return colors;
+
+    SchemeCache *cache = SchemeCache::instance();
+    // Only hashes already known, reading the file is for the worker
+    const QByteArray hash = cache->contentHash(options->path, false);
+    const std::optional<SchemeCache::Entry> entry =
+        hash.isEmpty() ? std::nullopt : cache->find(schemeKey(hash, *options));
+    if (!entry) {
+        cache->request(path, arguments);
+        return colors;
+    }
+
+    for (const QString &line : entry->scss.split('\n')) {
+        // "$name: #RRGGBB;", the booleans are skipped
+        const int colon = line.indexOf(QLatin1String(": "));
+        if (!line.startsWith('$') || !line.endsWith(';') || colon < 0) continue;
+        const QString value = line.mid(colon + 2, line.size() - colon - 3);
+        if (value.startsWith('#')) colors.insert(line.mid(1, colon - 1), QColor::fromString(value));
+    }
+    return colors;
+}
+
+QString MaterialPalette::cached(const QStringList &arguments) const {
+    const std::optional<Options> options = parseOptions(arguments);
+    if (!options) return QString();
+    // A colour skips the quantizer, it is cheap enough to make right away
+    if (options->path.isEmpty()) return generateScss(arguments);
+
+    SchemeCache *cache = SchemeCache::instance();
+    // Sampled, not the whole file
+    const QByteArray hash = cache->contentHash(options->path);
+    const std::optional<SchemeCache::Entry> entry =
+        hash.isEmpty() ? std::nullopt : cache->find(schemeKey(hash, *options));
+    if (entry) {
+        writeSourceColor(options->cache, entry->source);
+        return entry->scss;
+    }
+
+    // The caller writes --cache itself on a miss, the worker must not race it
+    QStringList rest;
+    for (qsizetype i = 0; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        if (argument == "--path" || argument == "--cache") ++i;
+        else if (!argument.startsWith("--path=") && !argument.startsWith("--cache=")) rest << argument;
+    }
+    cache->request(options->path, rest);
+    return QString();
+}
+
+void MaterialPalette::cacheSource(const QString &path) {
+    SchemeCache *cache = SchemeCache::instance();
+    const QByteArray hash = cache->contentHash(path);
+    if (hash.isEmpty()) return;
+    // The size generate_colors_material.py quantizes at unless told otherwise
+    const int size = Options().size;
+    const QByteArray key = sourceKey(hash, size);
+    if (cache->find(key, false)) return;
+    if (const std::optional<quint32> source = sourceOf(path, size, false)) cache->insert(key, { *source, QString() });
+}
+
+QString MaterialPalette::generate(const QStringList &arguments) const {
+    return generateScss(arguments);
+}
+
+QString MaterialPalette::generateScss(const QStringList &arguments, bool background) {
+    std::optional<Options> parsed = parseOptions(arguments);
+    if (!parsed) return QString();
+    Options &options = *parsed;
+
+    quint32 argb = 0;
+    QByteArray key;
+    SchemeCache *cache = SchemeCache::instance();
+    if (!options.path.isEmpty()) {
+        const QByteArray hash = cache->contentHash(options.path);
+        if (!hash.isEmpty()) {
+            key = schemeKey(hash, options);
+            if (const std::optional<SchemeCache::Entry> entry = cache->find(key, !background)) {
+                writeSourceColor(options.cache, entry->source);
+                return entry->scss;
+            }
+        }
+
+        // Another mode or scheme of the same picture skips the quantizer
+        const std::optional<SchemeCache::Entry> known =
+            hash.isEmpty() ? std::nullopt : cache->find(sourceKey(hash, options.size), false);
+        if (known) {
+            argb = known->source;
+        } else {
+            const std::optional<quint32> source = sourceOf(options.path, options.size, !background);
+            if (!source) return QString();
+            argb = *source;
+            if (!hash.isEmpty()) cache->insert(sourceKey(hash, options.size), { argb, QString() });
+        }
+
+        writeSourceColor(options.cache, argb);
+        if (options.smart && Hct::fromArgb(argb).chroma < 20.0) options.scheme = QStringLiteral("neutral");
+    } else if (!options.color.isEmpty()) {
+        const std::optional<quint32> color = argbOf(options.color);
+        if (!color) {
+            qWarning() << "Sleex: material palette: invalid colour" << options.color;
+            return QString();
+        }
+        argb = *color;
+    } else {
+        qWarning() << "Sleex: material palette: needs --path or --color";
+        return QString();
+    }
+
+    const MaterialColor::DynamicScheme scheme =
+        MaterialColor::DynamicScheme::make(Hct::fromArgb(argb), variantFor(options.scheme), options.dark, 0.0);
+
+    QVector<QPair<QString, quint32>> colors;
+    for (const auto &[name, value] : MaterialColor::dynamicColors(scheme)) colors.append({ QString::fromLatin1(name), value });
+    const auto colorNamed = [&colors](const QString &name) -> quint32 {
+        for (const auto &[key, value] : colors) {
+            if (key == name) return value;
+        }
+        return 0;
+    };
+
+    QStringList lines;
+    // Python's bool spelling
+    const auto boolean = [](bool value) { return value ? QStringLiteral("True") : QStringLiteral("False"); };
+    lines << QStringLiteral("$darkmode: %1;").arg(boolean(options.dark));
+    lines << QStringLiteral("$transparent: %1;").arg(boolean(options.transparent));
+    for (const auto &[name, value] : colors) lines << QStringLiteral("$%1: %2;").arg(name, hexOf(value));
+
+    if (options.dark) {
+        lines << "$success: #B5CCBA;" << "$onSuccess: #213528;"
+              << "$successContainer: #374B3E;" << "$onSuccessContainer: #D1E9D6;";
+    } else {
+        lines << "$success: #4F6354;" << "$onSuccess: #FFFFFF;"
+              << "$successContainer: #D1E8D5;" << "$onSuccessContainer: #0C1F13;";
+    }
+
+    if (!options.termscheme.isEmpty()) {
+        const quint32 primary = scheme.primary.hct(40.0).argb;
+        for (const auto &[name, value] : terminalColors(options.termscheme, options.dark)) {
+            // Mirrors the script, which compares against a scheme name it never receives
+            if (options.scheme == "monochrome") {
+                lines << QStringLiteral("$%1: %2;").arg(name, value);
+                continue;
+            }
+            quint32 harmonized;
+            if (options.blendBgFg && name == "term0") {
+                harmonized = MaterialColor::boostChromaTone(colorNamed("surfaceContainerLow"), 1.2, 0.95);
+            } else if (options.blendBgFg && name == "term15") {
+                harmonized = MaterialColor::boostChromaTone(colorNamed("onSurface"), 3.0, 1.0);
+            } else {
+                const std::optional<quint32> design = argbOf(value);
+                if (!design) continue;
+                harmonized = MaterialColor::harmonize(*design, primary, options.harmonizeThreshold, options.harmony);
+                harmonized = MaterialColor::boostChromaTone(harmonized, 1.0, 1.0 + options.termFgBoost * (options.dark ? 1.0 : -1.0));
+            }
+            lines << QStringLiteral("$%1: %2;").arg(name, hexOf(harmonized));
+        }
+    }
+
+    const QString scss = lines.join('\n');
+    if (!key.isEmpty()) cache->insert(key, { argb, scss });
+    return scss;
+}
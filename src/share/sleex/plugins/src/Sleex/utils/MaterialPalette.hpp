@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+#include <QtQml/qqmlregistration.h>
+
+// Material You colours for a wallpaper or a colour, computed in process.
+// Takes the command line of generate_colors_material.py and returns what
+// that script prints, so applycolor.sh and the kvantum and terminal scripts
+// keep reading the same SCSS variables. The image goes through the same
+// bicubic downscale Pillow does before quantization. Wallpapers go
+// through SchemeCache, a palette made once is looked up from then on.
+class MaterialPalette : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+
+public:
+    explicit MaterialPalette(QObject *parent = nullptr);
+
+    // e.g. ["--path", "/wall.png", "--mode", "dark", "--termscheme", "scheme-base.json"].
+    // Empty when the arguments are wrong or the image cannot be read
+    Q_INVOKABLE QString generate(const QStringList &arguments) const;
+    // Source colour the image yields, "#RRGGBB", empty when it cannot be read
+    Q_INVOKABLE QString sourceColor(const QString &path, int size = 128) const;
+    // generate() without the work: the output when it is cached, empty
+    // otherwise. A wallpaper missing from the cache is generated on
+    // SchemeCache's worker, so the next call for it is a hit
+    Q_INVOKABLE QString cached(const QStringList &arguments) const;
+    // Colours by SCSS name for a cached wallpaper, e.g. { primary: "#D0BCFF" }.
+    // Empty on a miss, SchemeCache reports with ready() once it is generated
+    Q_INVOKABLE QVariantMap preview(const QString &path, const QStringList &arguments) const;
+
+    // generate() from any thread. Background callers keep the quantizer to
+    // their own thread and do not count towards the cache hit rate
+    static QString generateScss(const QStringList &arguments, bool background = false);
+    // Quantizes the wallpaper into SchemeCache's source colours only, from
+    // any thread. generateScss() for it then starts at the scheme
+    static void cacheSource(const QString &path);
+};
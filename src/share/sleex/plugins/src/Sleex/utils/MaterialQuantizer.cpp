@@ -0,0 +1,553 @@
+#include "MaterialQuantizer.hpp"
+#include "MaterialColor.hpp"
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+namespace MaterialQuantizer {
+
+namespace {
+constexpr double WHITE_POINT_D65[3] = { 95.047, 100.0, 108.883 };
+
+// Points handed to one reassignment task
+constexpr int POINTS_PER_TASK = 2048;
+
+int redOf(quint32 argb) { return (argb >> 16) & 255; }
+int greenOf(quint32 argb) { return (argb >> 8) & 255; }
+int blueOf(quint32 argb) { return argb & 255; }
+
+quint32 argbFromRgb(int red, int green, int blue) {
+    return 0xff000000u | (quint32(red & 255) << 16) | (quint32(green & 255) << 8) | quint32(blue & 255);
+}
+
+const std::array<double, 256> &linearTable() {
+    static const std::array<double, 256> table = [] {
+        std::array<double, 256> values {};
+        for (int i = 0; i < 256; ++i) {
+            const double normalized = i / 255.0;
+            values[i] = normalized <= 0.040449936
+                ? normalized / 12.92 * 100.0
+                : std::pow((normalized + 0.055) / 1.055, 2.4) * 100.0;
+        }
+        return values;
+    }();
+    return table;
+}
+
+int delinearized(double rgbComponent) {
+    const double normalized = rgbComponent / 100.0;
+    const double value = normalized <= 0.0031308 ? normalized * 12.92 : 1.055 * std::pow(normalized, 1.0 / 2.4) - 0.055;
+    return std::clamp(int(std::round(value * 255.0)), 0, 255);
+}
+
+struct Lab {
+    double l = 0.0, a = 0.0, b = 0.0;
+
+    // Squared distance, the quantizer never needs the root
+    double deltaE(const Lab &other) const {
+        const double dl = l - other.l, da = a - other.a, db = b - other.b;
+        return dl * dl + da * da + db * db;
+    }
+};
+
+Lab labFromArgb(quint32 argb) {
+    const std::array<double, 256> &linear = linearTable();
+    const double r = linear[redOf(argb)], g = linear[greenOf(argb)], b = linear[blueOf(argb)];
+    const double x = 0.41233895 * r + 0.35762064 * g + 0.18051042 * b;
+    const double y = 0.2126 * r + 0.7152 * g + 0.0722 * b;
+    const double z = 0.01932141 * r + 0.11916382 * g + 0.95034478 * b;
+
+    constexpr double e = 216.0 / 24389.0;
+    constexpr double kappa = 24389.0 / 27.0;
+    const auto f = [](double t) { return t > e ? std::pow(t, 1.0 / 3.0) : (kappa * t + 16) / 116; };
+    const double fx = f(x / WHITE_POINT_D65[0]);
+    const double fy = f(y / WHITE_POINT_D65[1]);
+    const double fz = f(z / WHITE_POINT_D65[2]);
+    return { 116.0 * fy - 16, 500.0 * (fx - fy), 200.0 * (fy - fz) };
+}
+
+quint32 argbFromLab(const Lab &lab) {
+    constexpr double e = 216.0 / 24389.0;
+    constexpr double kappa = 24389.0 / 27.0;
+    constexpr double ke = 8.0;
+    const double fy = (lab.l + 16.0) / 116.0;
+    const double fx = (lab.a / 500.0) + fy;
+    const double fz = fy - (lab.b / 200.0);
+    const double fx3 = fx * fx * fx;
+    const double fz3 = fz * fz * fz;
+    const double x = (fx3 > e ? fx3 : (116.0 * fx - 16.0) / kappa) * WHITE_POINT_D65[0];
+    const double y = (lab.l > ke ? fy * fy * fy : lab.l / kappa) * WHITE_POINT_D65[1];
+    const double z = (fz3 > e ? fz3 : (116.0 * fz - 16.0) / kappa) * WHITE_POINT_D65[2];
+
+    const double rL = 3.2406 * x - 1.5372 * y - 0.4986 * z;
+    const double gL = -0.9689 * x + 1.8758 * y + 0.0415 * z;
+    const double bL = 0.0557 * x - 0.2040 * y + 1.0570 * z;
+    return argbFromRgb(delinearized(rL), delinearized(gL), delinearized(bL));
+}
+
+// glibc's rand() after srand(seed), the upstream quantizer draws its
+// initial assignment from it and the result depends on that sequence
+class GlibcRandom {
+public:
+    explicit GlibcRandom(quint32 seed) {
+        qint64 r[34];
+        r[0] = seed == 0 ? 1 : seed;
+        for (int i = 1; i < 31; ++i) r[i] = (16807 * r[i - 1]) % 2147483647;
+        for (int i = 31; i < 34; ++i) r[i] = r[i - 31];
+        for (int i = 0; i < 34; ++i) m_state[i] = quint32(r[i]);
+        m_index = 34;
+        for (int i = 0; i < 310; ++i) next();
+    }
+
+    int next() {
+        const quint32 value = m_state[(m_index + 3) % 34] + m_state[(m_index + 31) % 34];
+        m_state[m_index % 34] = value;
+        ++m_index;
+        return int(value >> 1);
+    }
+
+private:
+    std::array<quint32, 34> m_state {};
+    int m_index = 0;
+};
+
+// Wu
+
+constexpr int INDEX_BITS = 5;
+constexpr int INDEX_COUNT = (1 << INDEX_BITS) + 1;
+constexpr int TOTAL_SIZE = INDEX_COUNT * INDEX_COUNT * INDEX_COUNT;
+constexpr int MAX_COLORS = 256;
+
+enum class Direction { Red, Green, Blue };
+
+struct Box {
+    int r0 = 0, r1 = 0, g0 = 0, g1 = 0, b0 = 0, b1 = 0, vol = 0;
+};
+
+int indexOf(int r, int g, int b) {
+    return (r << (INDEX_BITS * 2)) + (r << (INDEX_BITS + 1)) + (g << INDEX_BITS) + r + g + b;
+}
+
+struct Moments {
+    std::vector<qint64> weights = std::vector<qint64>(TOTAL_SIZE, 0);
+    std::vector<qint64> r = std::vector<qint64>(TOTAL_SIZE, 0);
+    std::vector<qint64> g = std::vector<qint64>(TOTAL_SIZE, 0);
+    std::vector<qint64> b = std::vector<qint64>(TOTAL_SIZE, 0);
+    std::vector<double> squares = std::vector<double>(TOTAL_SIZE, 0.0);
+};
+
+template <typename T>
+T volume(const Box &cube, const std::vector<T> &moment) {
+    return moment[indexOf(cube.r1, cube.g1, cube.b1)] - moment[indexOf(cube.r1, cube.g1, cube.b0)]
+         - moment[indexOf(cube.r1, cube.g0, cube.b1)] + moment[indexOf(cube.r1, cube.g0, cube.b0)]
+         - moment[indexOf(cube.r0, cube.g1, cube.b1)] + moment[indexOf(cube.r0, cube.g1, cube.b0)]
+         + moment[indexOf(cube.r0, cube.g0, cube.b1)] - moment[indexOf(cube.r0, cube.g0, cube.b0)];
+}
+
+qint64 bottom(const Box &cube, Direction direction, const std::vector<qint64> &moment) {
+    switch (direction) {
+        case Direction::Red:
+            return -moment[indexOf(cube.r0, cube.g1, cube.b1)] + moment[indexOf(cube.r0, cube.g1, cube.b0)]
+                   + moment[indexOf(cube.r0, cube.g0, cube.b1)] - moment[indexOf(cube.r0, cube.g0, cube.b0)];
+        case Direction::Green:
+            return -moment[indexOf(cube.r1, cube.g0, cube.b1)] + moment[indexOf(cube.r1, cube.g0, cube.b0)]
+                   + moment[indexOf(cube.r0, cube.g0, cube.b1)] - moment[indexOf(cube.r0, cube.g0, cube.b0)];
+        case Direction::Blue:
+            return -moment[indexOf(cube.r1, cube.g1, cube.b0)] + moment[indexOf(cube.r1, cube.g0, cube.b0)]
+                   + moment[indexOf(cube.r0, cube.g1, cube.b0)] - moment[indexOf(cube.r0, cube.g0, cube.b0)];
+    }
+    return 0;
+}
+
+qint64 top(const Box &cube, Direction direction, int position, const std::vector<qint64> &moment) {
+    switch (direction) {
+        case Direction::Red:
+            return moment[indexOf(position, cube.g1, cube.b1)] - moment[indexOf(position, cube.g1, cube.b0)]
+                   - moment[indexOf(position, cube.g0, cube.b1)] + moment[indexOf(position, cube.g0, cube.b0)];
+        case Direction::Green:
+            return moment[indexOf(cube.r1, position, cube.b1)] - moment[indexOf(cube.r1, position, cube.b0)]
+                   - moment[indexOf(cube.r0, position, cube.b1)] + moment[indexOf(cube.r0, position, cube.b0)];
+        case Direction::Blue:
+            return moment[indexOf(cube.r1, cube.g1, position)] - moment[indexOf(cube.r1, cube.g0, position)]
+                   - moment[indexOf(cube.r0, cube.g1, position)] + moment[indexOf(cube.r0, cube.g0, position)];
+    }
+    return 0;
+}
+
+Moments buildMoments(const std::vector<quint32> &pixels) {
+    Moments m;
+    constexpr int bitsToRemove = 8 - INDEX_BITS;
+    for (const quint32 pixel : pixels) {
+        const int red = redOf(pixel), green = greenOf(pixel), blue = blueOf(pixel);
+        const int index = indexOf((red >> bitsToRemove) + 1, (green >> bitsToRemove) + 1, (blue >> bitsToRemove) + 1);
+        m.weights[index]++;
+        m.r[index] += red;
+        m.g[index] += green;
+        m.b[index] += blue;
+        m.squares[index] += red * red + green * green + blue * blue;
+    }
+
+    // Cumulative sums, any box is then eight lookups
+    for (int r = 1; r < INDEX_COUNT; ++r) {
+        qint64 area[INDEX_COUNT] = {}, areaR[INDEX_COUNT] = {}, areaG[INDEX_COUNT] = {}, areaB[INDEX_COUNT] = {};
+        double area2[INDEX_COUNT] = {};
+        for (int g = 1; g < INDEX_COUNT; ++g) {
+            qint64 line = 0, lineR = 0, lineG = 0, lineB = 0;
+            double line2 = 0.0;
+            for (int b = 1; b < INDEX_COUNT; ++b) {
+                const int index = indexOf(r, g, b);
+                line += m.weights[index];
+                lineR += m.r[index];
+                lineG += m.g[index];
+                lineB += m.b[index];
+                line2 += m.squares[index];
+
+                area[b] += line;
+                areaR[b] += lineR;
+                areaG[b] += lineG;
+                areaB[b] += lineB;
+                area2[b] += line2;
+
+                const int previous = indexOf(r - 1, g, b);
+                m.weights[index] = m.weights[previous] + area[b];
+                m.r[index] = m.r[previous] + areaR[b];
+                m.g[index] = m.g[previous] + areaG[b];
+                m.b[index] = m.b[previous] + areaB[b];
+                m.squares[index] = m.squares[previous] + area2[b];
+            }
+        }
+    }
+    return m;
+}
+
+double variance(const Box &cube, const Moments &m) {
+    const double dr = volume(cube, m.r);
+    const double dg = volume(cube, m.g);
+    const double db = volume(cube, m.b);
+    const double xx = volume(cube, m.squares);
+    const double hypotenuse = dr * dr + dg * dg + db * db;
+    return xx - hypotenuse / double(volume(cube, m.weights));
+}
+
+struct Maximum {
+    int    cut = -1;
+    double value = 0.0;
+};
+
+Maximum maximize(const Box &cube, Direction direction, int first, int last,
+                 qint64 wholeR, qint64 wholeG, qint64 wholeB, qint64 wholeW, const Moments &m) {
+    const qint64 bottomR = bottom(cube, direction, m.r);
+    const qint64 bottomG = bottom(cube, direction, m.g);
+    const qint64 bottomB = bottom(cube, direction, m.b);
+    const qint64 bottomW = bottom(cube, direction, m.weights);
+
+    Maximum result;
+    for (int i = first; i < last; ++i) {
+        qint64 halfR = bottomR + top(cube, direction, i, m.r);
+        qint64 halfG = bottomG + top(cube, direction, i, m.g);
+        qint64 halfB = bottomB + top(cube, direction, i, m.b);
+        qint64 halfW = bottomW + top(cube, direction, i, m.weights);
+        if (halfW == 0) continue;
+        double temp = (double(halfR) * halfR + double(halfG) * halfG + double(halfB) * halfB) / double(halfW);
+
+        halfR = wholeR - halfR;
+        halfG = wholeG - halfG;
+        halfB = wholeB - halfB;
+        halfW = wholeW - halfW;
+        if (halfW == 0) continue;
+        temp += (double(halfR) * halfR + double(halfG) * halfG + double(halfB) * halfB) / double(halfW);
+
+        if (temp > result.value) {
+            result.value = temp;
+            result.cut = i;
+        }
+    }
+    return result;
+}
+
+bool cut(Box &one, Box &two, const Moments &m) {
+    const qint64 wholeR = volume(one, m.r);
+    const qint64 wholeG = volume(one, m.g);
+    const qint64 wholeB = volume(one, m.b);
+    const qint64 wholeW = volume(one, m.weights);
+
+    const Maximum maxR = maximize(one, Direction::Red, one.r0 + 1, one.r1, wholeR, wholeG, wholeB, wholeW, m);
+    const Maximum maxG = maximize(one, Direction::Green, one.g0 + 1, one.g1, wholeR, wholeG, wholeB, wholeW, m);
+    const Maximum maxB = maximize(one, Direction::Blue, one.b0 + 1, one.b1, wholeR, wholeG, wholeB, wholeW, m);
+
+    Direction direction;
+    if (maxR.value >= maxG.value && maxR.value >= maxB.value) {
+        // Upstream only gives up when red wins without a cut, kept as is
+        if (maxR.cut < 0) return false;
+        direction = Direction::Red;
+    } else if (maxG.value >= maxR.value && maxG.value >= maxB.value) {
+        direction = Direction::Green;
+    } else {
+        direction = Direction::Blue;
+    }
+
+    two.r1 = one.r1;
+    two.g1 = one.g1;
+    two.b1 = one.b1;
+    switch (direction) {
+        case Direction::Red:
+            one.r1 = maxR.cut;
+            two.r0 = one.r1;
+            two.g0 = one.g0;
+            two.b0 = one.b0;
+            break;
+        case Direction::Green:
+            one.g1 = maxG.cut;
+            two.r0 = one.r0;
+            two.g0 = one.g1;
+            two.b0 = one.b0;
+            break;
+        case Direction::Blue:
+            one.b1 = maxB.cut;
+            two.r0 = one.r0;
+            two.g0 = one.g0;
+            two.b0 = one.b1;
+            break;
+    }
+    one.vol = (one.r1 - one.r0) * (one.g1 - one.g0) * (one.b1 - one.b0);
+    two.vol = (two.r1 - two.r0) * (two.g1 - two.g0) * (two.b1 - two.b0);
+    return true;
+}
+
+std::vector<quint32> quantizeWu(const std::vector<quint32> &pixels, int maxColors) {
+    std::vector<quint32> colors;
+    if (maxColors <= 0 || maxColors > MAX_COLORS || pixels.empty()) return colors;
+
+    const Moments m = buildMoments(pixels);
+    std::vector<Box> cubes(MAX_COLORS);
+    cubes[0].r1 = cubes[0].g1 = cubes[0].b1 = INDEX_COUNT - 1;
+
+    std::vector<double> volumeVariance(MAX_COLORS, 0.0);
+    int next = 0;
+    for (int i = 1; i < maxColors; ++i) {
+        if (cut(cubes[next], cubes[i], m)) {
+            volumeVariance[next] = cubes[next].vol > 1 ? variance(cubes[next], m) : 0.0;
+            volumeVariance[i] = cubes[i].vol > 1 ? variance(cubes[i], m) : 0.0;
+        } else {
+            volumeVariance[next] = 0.0;
+            --i;
+        }
+
+        next = 0;
+        double temp = volumeVariance[0];
+        for (int j = 1; j <= i; ++j) {
+            if (volumeVariance[j] > temp) {
+                temp = volumeVariance[j];
+                next = j;
+            }
+        }
+        if (temp <= 0.0) {
+            maxColors = i + 1;
+            break;
+        }
+    }
+
+    for (int i = 0; i < maxColors; ++i) {
+        const qint64 weight = volume(cubes[i], m.weights);
+        if (weight <= 0) continue;
+        colors.push_back(argbFromRgb(int(volume(cubes[i], m.r) / weight),
+                                     int(volume(cubes[i], m.g) / weight),
+                                     int(volume(cubes[i], m.b) / weight)));
+    }
+    return colors;
+}
+
+// Weighted k-means
+
+constexpr int MAX_ITERATIONS = 100;
+constexpr double MIN_DELTA_E = 3.0;
+
+std::map<quint32, quint32> quantizeWsmeans(const std::vector<quint32> &inputPixels,
+                                           const std::vector<quint32> &startingClusters, int maxColors, bool parallel) {
+    std::map<quint32, quint32> result;
+    if (maxColors <= 0 || inputPixels.empty()) return result;
+    maxColors = std::min(maxColors, MAX_COLORS);
+
+    // Unique colours in first-seen order, k-means runs on those with weights
+    std::unordered_map<quint32, int> pixelToCount;
+    std::vector<quint32> pixels;
+    std::vector<Lab> points;
+    for (const quint32 pixel : inputPixels) {
+        auto [it, inserted] = pixelToCount.try_emplace(pixel, 0);
+        if (inserted) {
+            pixels.push_back(pixel);
+            points.push_back(labFromArgb(pixel));
+        }
+        ++it->second;
+    }
+    std::vector<int> counts(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i) counts[i] = pixelToCount[pixels[i]];
+
+    int clusterCount = std::min(maxColors, int(points.size()));
+    if (!startingClusters.empty()) clusterCount = std::min(clusterCount, int(startingClusters.size()));
+
+    std::vector<Lab> clusters;
+    for (const quint32 argb : startingClusters) clusters.push_back(labFromArgb(argb));
+    if (startingClusters.empty()) {
+        GlibcRandom random(42688);
+        while (int(clusters.size()) < clusterCount) {
+            const double l = random.next() / 2147483647.0 * 100.0;
+            const double a = random.next() / 2147483647.0 * 200.0 - 100.0;
+            const double b = random.next() / 2147483647.0 * 200.0 - 100.0;
+            clusters.push_back({ l, a, b });
+        }
+    }
+
+    std::vector<int> clusterIndices(points.size());
+    GlibcRandom random(42688);
+    for (int &index : clusterIndices) index = random.next() % clusterCount;
+
+    std::vector<double> distances(size_t(clusterCount) * clusterCount, 0.0);
+    std::vector<int> pixelCountSums(clusterCount, 0);
+
+    // Reassignment reads clusters and distances only, every point is independent
+    struct Range {
+        size_t begin, end;
+        bool   moved;
+    };
+    std::vector<Range> ranges;
+    for (size_t begin = 0; begin < points.size(); begin += POINTS_PER_TASK)
+        ranges.push_back({ begin, std::min(points.size(), begin + POINTS_PER_TASK), false });
+
+    for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+        for (int i = 0; i < clusterCount; ++i) {
+            distances[size_t(i) * clusterCount + i] = 0.0;
+            for (int j = i + 1; j < clusterCount; ++j) {
+                const double distance = clusters[i].deltaE(clusters[j]);
+                distances[size_t(j) * clusterCount + i] = distance;
+                distances[size_t(i) * clusterCount + j] = distance;
+            }
+        }
+
+        const auto reassign = [&](Range &range) {
+            range.moved = false;
+            for (size_t i = range.begin; i < range.end; ++i) {
+                const Lab &point = points[i];
+                const int previousIndex = clusterIndices[i];
+                const double previousDistance = point.deltaE(clusters[previousIndex]);
+                const double *fromPrevious = distances.data() + size_t(previousIndex) * clusterCount;
+                double minimumDistance = previousDistance;
+                int newIndex = -1;
+                for (int j = 0; j < clusterCount; ++j) {
+                    // Triangle inequality, j cannot be closer than the current cluster
+                    if (fromPrevious[j] >= 4 * previousDistance) continue;
+                    const double distance = point.deltaE(clusters[j]);
+                    if (distance < minimumDistance) {
+                        minimumDistance = distance;
+                        newIndex = j;
+                    }
+                }
+                if (newIndex != -1 && std::abs(std::sqrt(minimumDistance) - std::sqrt(previousDistance)) > MIN_DELTA_E) {
+                    range.moved = true;
+                    clusterIndices[i] = newIndex;
+                }
+            }
+        };
+        if (parallel) QtConcurrent::blockingMap(ranges, reassign);
+        else std::for_each(ranges.begin(), ranges.end(), reassign);
+        const bool moved = std::any_of(ranges.cbegin(), ranges.cend(), [](const Range &range) { return range.moved; });
+        if (!moved && iteration != 0) break;
+
+        // Serial and in point order, the sums must round exactly like upstream
+        std::vector<double> sumL(clusterCount, 0.0), sumA(clusterCount, 0.0), sumB(clusterCount, 0.0);
+        std::fill(pixelCountSums.begin(), pixelCountSums.end(), 0);
+        for (size_t i = 0; i < points.size(); ++i) {
+            const int cluster = clusterIndices[i];
+            const int count = counts[i];
+            pixelCountSums[cluster] += count;
+            sumL[cluster] += points[i].l * count;
+            sumA[cluster] += points[i].a * count;
+            sumB[cluster] += points[i].b * count;
+        }
+        for (int i = 0; i < clusterCount; ++i) {
+            const int count = pixelCountSums[i];
+            clusters[i] = count == 0 ? Lab() : Lab { sumL[i] / count, sumA[i] / count, sumB[i] / count };
+        }
+    }
+
+    for (int i = 0; i < clusterCount; ++i) {
+        if (pixelCountSums[i] == 0) continue;
+        result[argbFromLab(clusters[i])] += quint32(pixelCountSums[i]);
+    }
+    return result;
+}
+}
+
+std::map<quint32, quint32> quantizeCelebi(const std::vector<quint32> &pixels, int maxColors, bool parallel) {
+    if (maxColors <= 0 || pixels.empty()) return {};
+    maxColors = std::min(maxColors, MAX_COLORS);
+
+    std::vector<quint32> opaque;
+    opaque.reserve(pixels.size());
+    for (const quint32 pixel : pixels) {
+        if ((pixel >> 24) == 255) opaque.push_back(pixel);
+    }
+    return quantizeWsmeans(opaque, quantizeWu(opaque, maxColors), maxColors, parallel);
+}
+
+std::vector<quint32> score(const std::map<quint32, quint32> &colorsToPopulation, int desired, quint32 fallback, bool filter) {
+    constexpr double TARGET_CHROMA = 48.0;
+    constexpr double WEIGHT_PROPORTION = 0.7;
+    constexpr double WEIGHT_CHROMA_ABOVE = 0.3;
+    constexpr double WEIGHT_CHROMA_BELOW = 0.1;
+    constexpr double CUTOFF_CHROMA = 5.0;
+    constexpr double CUTOFF_EXCITED_PROPORTION = 0.01;
+
+    std::vector<MaterialColor::Hct> colors;
+    std::array<double, 360> huePopulation {};
+    double populationSum = 0.0;
+    for (const auto &[argb, population] : colorsToPopulation) {
+        const MaterialColor::Hct hct = MaterialColor::Hct::fromArgb(argb);
+        colors.push_back(hct);
+        huePopulation[int(std::floor(hct.hue)) % 360] += population;
+        populationSum += population;
+    }
+
+    std::array<double, 360> hueExcitedProportions {};
+    for (int hue = 0; hue < 360; ++hue) {
+        const double proportion = huePopulation[hue] / populationSum;
+        for (int i = hue - 14; i < hue + 16; ++i) hueExcitedProportions[(i + 360) % 360] += proportion;
+    }
+
+    struct Scored {
+        MaterialColor::Hct hct;
+        double score;
+    };
+    std::vector<Scored> scored;
+    for (const MaterialColor::Hct &hct : colors) {
+        const double proportion = hueExcitedProportions[int(std::nearbyint(hct.hue)) % 360];
+        if (filter && (hct.chroma < CUTOFF_CHROMA || proportion <= CUTOFF_EXCITED_PROPORTION)) continue;
+        const double proportionScore = proportion * 100.0 * WEIGHT_PROPORTION;
+        const double chromaWeight = hct.chroma < TARGET_CHROMA ? WEIGHT_CHROMA_BELOW : WEIGHT_CHROMA_ABOVE;
+        scored.push_back({ hct, proportionScore + (hct.chroma - TARGET_CHROMA) * chromaWeight });
+    }
+    std::stable_sort(scored.begin(), scored.end(), [](const Scored &a, const Scored &b) { return a.score > b.score; });
+
+    // Widest hue spread that still yields the desired count
+    std::vector<MaterialColor::Hct> chosen;
+    for (int difference = 90; difference >= 15; --difference) {
+        chosen.clear();
+        for (const Scored &item : scored) {
+            const bool duplicateHue = std::any_of(chosen.cbegin(), chosen.cend(), [&](const MaterialColor::Hct &c) {
+                return MaterialColor::differenceDegrees(item.hct.hue, c.hue) < difference;
+            });
+            if (!duplicateHue) chosen.push_back(item.hct);
+            if (int(chosen.size()) >= desired) break;
+        }
+        if (int(chosen.size()) >= desired) break;
+    }
+
+    std::vector<quint32> result;
+    if (chosen.empty()) result.push_back(fallback);
+    for (const MaterialColor::Hct &hct : chosen) result.push_back(hct.argb);
+    return result;
+}
+
+} // namespace MaterialQuantizer
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QtGlobal>
+#include <map>
+#include <vector>
+
+// Colour extraction of material-color-utilities: Wu quantization seeding a
+// weighted k-means in L*a*b*, then Material's scoring of the clusters.
+// Matches the C++ quantizer the materialyoucolor package wraps, including
+// its fixed random seed, so a wallpaper picks the same source colour here
+// and in generate_colors_material.py.
+namespace MaterialQuantizer {
+
+// Opaque pixels only, ARGB. Cluster colour -> pixel count, at most maxColors entries.
+// parallel spreads k-means over the global thread pool, off for background work
+std::map<quint32, quint32> quantizeCelebi(const std::vector<quint32> &pixels, int maxColors, bool parallel = true);
+
+// Colours fit for a theme, best first. Never empty, falls back to Google blue
+std::vector<quint32> score(const std::map<quint32, quint32> &colorsToPopulation, int desired = 4,
+                           quint32 fallback = 0xff4285f4, bool filter = true);
+
+} // namespace MaterialQuantizer
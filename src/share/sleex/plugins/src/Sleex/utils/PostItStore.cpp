@@ -0,0 +1,282 @@
+#include "PostItStore.hpp"
+#include <QCoreApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+// Own connection to the same WAL database DatabaseManager keeps in Sleex.Core
+const QString CONNECTION_NAME = QStringLiteral("postits_conn");
+
+constexpr qreal DEFAULT_SIZE = 200;
+// Quiet time after the last keystroke before the text is written
+constexpr int TEXT_SAVE_DELAY_MS = 500;
+
+QSqlDatabase database() {
+    return QSqlDatabase::database(CONNECTION_NAME);
+}
+}
+
+PostItStore::PostItStore(QObject *parent) : QAbstractListModel(parent) {
+    openDatabase();
+    migrateLegacyJson();
+    loadNotes();
+
+    m_textTimer.setSingleShot(true);
+    m_textTimer.setInterval(TEXT_SAVE_DELAY_MS);
+    connect(&m_textTimer, &QTimer::timeout, this, &PostItStore::flushText);
+    // The engine may not delete singletons on the way out, so don't rely on the destructor alone
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &PostItStore::flushText);
+}
+
+PostItStore::~PostItStore() {
+    flushText();
+}
+
+void PostItStore::openDatabase() {
+    if (QSqlDatabase::contains(CONNECTION_NAME)) return;
+
+    QString stateDir = QDir::homePath() + "/.local/state/sleex";
+    QDir().mkpath(stateDir);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+    db.setDatabaseName(stateDir + "/sleex_state.db");
+
+    if (!db.open()) {
+        qCritical() << "Sleex: post-it DB error:" << db.lastError().text();
+        return;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode=WAL;");
+    query.exec("PRAGMA synchronous=NORMAL;");
+    query.exec("CREATE TABLE IF NOT EXISTS sleex_postits ("
+               "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+               "x REAL, y REAL, width REAL, height REAL, text TEXT)");
+}
+
+void PostItStore::migrateLegacyJson() {
+    QString jsonPath = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex/postits.json";
+    if (!QFile::exists(jsonPath)) return;
+
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonArray notes = QJsonDocument::fromJson(file.readAll()).array();
+    file.close();
+
+    QSqlDatabase db = database();
+    QString error;
+    if (!db.transaction()) error = db.lastError().text();
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO sleex_postits (x, y, width, height, text) VALUES (:x, :y, :w, :h, :text)");
+    for (auto it = notes.begin(); error.isEmpty() && it != notes.end(); ++it) {
+        const QJsonObject note = it->toObject();
+        query.bindValue(":x", note["posX"].toDouble());
+        query.bindValue(":y", note["posY"].toDouble());
+        query.bindValue(":w", DEFAULT_SIZE);
+        query.bindValue(":h", DEFAULT_SIZE);
+        query.bindValue(":text", note["text"].toString());
+        if (!query.exec()) error = query.lastError().text();
+    }
+    query.finish();
+    if (error.isEmpty() && !db.commit()) error = db.lastError().text();
+
+    if (!error.isEmpty()) {
+        // All or nothing, the JSON stays and is migrated again on the next start
+        qWarning() << "Sleex: Post-it migration failed, keeping" << jsonPath << ":" << error;
+        db.rollback();
+        return;
+    }
+
+    // Same as the settings migration, keep the old file around just in case
+    QFile::rename(jsonPath, jsonPath + ".bak");
+    qInfo() << "Sleex: Migrated" << notes.size() << "post-its to the state DB";
+}
+
+void PostItStore::loadNotes() {
+    QSqlQuery query(database());
+    query.exec("SELECT id, x, y, width, height, text FROM sleex_postits ORDER BY id");
+
+    beginResetModel();
+    m_notes.clear();
+    while (query.next()) {
+        m_notes.append({
+            query.value(0).toLongLong(),
+            query.value(1).toReal(),
+            query.value(2).toReal(),
+            query.value(3).toReal(),
+            query.value(4).toReal(),
+            query.value(5).toString()
+        });
+    }
+    endResetModel();
+}
+
+int PostItStore::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return m_notes.count();
+}
+
+QVariant PostItStore::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_notes.size()) return QVariant();
+
+    const PostItNote &note = m_notes[index.row()];
+    switch (role) {
+        case NoteIdRole: return note.id;
+        case PosXRole: return note.x;
+        case PosYRole: return note.y;
+        case NoteWidthRole: return note.width;
+        case NoteHeightRole: return note.height;
+        case TextRole: return note.text;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> PostItStore::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[NoteIdRole] = "noteId";
+    roles[PosXRole] = "posX";
+    roles[PosYRole] = "posY";
+    roles[NoteWidthRole] = "noteWidth";
+    roles[NoteHeightRole] = "noteHeight";
+    roles[TextRole] = "text";
+    return roles;
+}
+
+int PostItStore::rowOf(qint64 id) const {
+    for (int i = 0; i < m_notes.size(); ++i) {
+        if (m_notes[i].id == id) return i;
+    }
+    return -1;
+}
+
+qint64 PostItStore::createNote(qreal x, qreal y) {
+    QSqlQuery query(database());
+    query.prepare("INSERT INTO sleex_postits (x, y, width, height, text) VALUES (:x, :y, :w, :h, '')");
+    query.bindValue(":x", x);
+    query.bindValue(":y", y);
+    query.bindValue(":w", DEFAULT_SIZE);
+    query.bindValue(":h", DEFAULT_SIZE);
+
+    if (!query.exec()) {
+        qWarning() << "Sleex: Cannot create post-it:" << query.lastError().text();
+        return -1;
+    }
+
+    const qint64 id = query.lastInsertId().toLongLong();
+    const int row = m_notes.size();
+    beginInsertRows(QModelIndex(), row, row);
+    m_notes.append({ id, x, y, DEFAULT_SIZE, DEFAULT_SIZE, QString() });
+    endInsertRows();
+    return id;
+}
+
+void PostItStore::moveNote(qint64 id, qreal x, qreal y) {
+    const int row = rowOf(id);
+    if (row == -1) return;
+
+    PostItNote &note = m_notes[row];
+    if (note.x == x && note.y == y) return;
+
+    QSqlQuery query(database());
+    query.prepare("UPDATE sleex_postits SET x = :x, y = :y WHERE id = :id");
+    query.bindValue(":x", x);
+    query.bindValue(":y", y);
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        qWarning() << "Sleex: Cannot move post-it:" << query.lastError().text();
+        return;
+    }
+
+    note.x = x;
+    note.y = y;
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {PosXRole, PosYRole});
+}
+
+void PostItStore::resizeNote(qint64 id, qreal width, qreal height) {
+    const int row = rowOf(id);
+    if (row == -1) return;
+
+    PostItNote &note = m_notes[row];
+    if (note.width == width && note.height == height) return;
+
+    QSqlQuery query(database());
+    query.prepare("UPDATE sleex_postits SET width = :w, height = :h WHERE id = :id");
+    query.bindValue(":w", width);
+    query.bindValue(":h", height);
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        qWarning() << "Sleex: Cannot resize post-it:" << query.lastError().text();
+        return;
+    }
+
+    note.width = width;
+    note.height = height;
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {NoteWidthRole, NoteHeightRole});
+}
+
+void PostItStore::setNoteText(qint64 id, const QString &text) {
+    const int row = rowOf(id);
+    if (row == -1) return;
+
+    PostItNote &note = m_notes[row];
+    if (note.text == text) return;
+
+    note.text = text;
+    m_pendingText.insert(id, text);
+    // Restarted by every keystroke, a burst of typing is one write
+    m_textTimer.start();
+
+    QModelIndex modelIndex = createIndex(row, 0);
+    emit dataChanged(modelIndex, modelIndex, {TextRole});
+}
+
+void PostItStore::flushText() {
+    m_textTimer.stop();
+    if (m_pendingText.isEmpty()) return;
+
+    QSqlDatabase db = database();
+    db.transaction();
+    QSqlQuery query(db);
+    query.prepare("UPDATE sleex_postits SET text = :text WHERE id = :id");
+    for (auto it = m_pendingText.cbegin(); it != m_pendingText.cend(); ++it) {
+        query.bindValue(":text", it.value());
+        query.bindValue(":id", it.key());
+        if (!query.exec()) qWarning() << "Sleex: Cannot save post-it text:" << query.lastError().text();
+    }
+
+    if (!db.commit()) {
+        qWarning() << "Sleex: Cannot save post-it text:" << db.lastError().text();
+        db.rollback();
+        // Kept for the next keystroke or the flush on quit
+        return;
+    }
+    m_pendingText.clear();
+}
+
+void PostItStore::removeNote(qint64 id) {
+    const int row = rowOf(id);
+    if (row == -1) return;
+
+    QSqlQuery query(database());
+    query.prepare("DELETE FROM sleex_postits WHERE id = :id");
+    query.bindValue(":id", id);
+    if (!query.exec()) {
+        qWarning() << "Sleex: Cannot delete post-it:" << query.lastError().text();
+        return;
+    }
+    m_pendingText.remove(id);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_notes.removeAt(row);
+    endRemoveRows();
+}
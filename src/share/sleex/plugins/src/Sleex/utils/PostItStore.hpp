@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <QQmlEngine>
+
+struct PostItNote {
+    qint64 id;
+    qreal x;
+    qreal y;
+    qreal width;
+    qreal height;
+    QString text;
+};
+
+// Desktop post-it notes backed by the sleex_state database. Every edit
+// touches a single row, so moving, resizing or typing into one note never rewrites
+// the others. Typing is written once the note has been quiet for a moment
+// instead of on every keystroke.
+class PostItStore : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+public:
+    enum PostItRoles {
+        NoteIdRole = Qt::UserRole + 1,
+        PosXRole,
+        PosYRole,
+        NoteWidthRole,
+        NoteHeightRole,
+        TextRole
+    };
+
+    explicit PostItStore(QObject *parent = nullptr);
+    ~PostItStore() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE qint64 createNote(qreal x, qreal y);
+    Q_INVOKABLE void moveNote(qint64 id, qreal x, qreal y);
+    Q_INVOKABLE void resizeNote(qint64 id, qreal width, qreal height);
+    Q_INVOKABLE void setNoteText(qint64 id, const QString &text);
+    Q_INVOKABLE void removeNote(qint64 id);
+
+private:
+    void openDatabase();
+    void migrateLegacyJson();
+    void loadNotes();
+    int rowOf(qint64 id) const;
+    void flushText();
+
+    QList<PostItNote> m_notes;
+    // Note id to its latest text, not in the DB yet
+    QHash<qint64, QString> m_pendingText;
+    QTimer m_textTimer;
+};
@@ -0,0 +1,346 @@
+#include "SchemeCache.hpp"
+#include "MaterialPalette.hpp"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+// Bump when the on-disk layout or the generator output changes
+constexpr quint32 CACHE_MAGIC = 0x534c5343; // "SLSC"
+constexpr quint32 CACHE_VERSION = 1;
+
+constexpr int SAVE_DELAY_MS = 5000;
+
+// Queue order of m_pool, loading and saving go ahead of the fill
+constexpr int LOAD_PRIORITY = 2;
+constexpr int REQUEST_PRIORITY = 1;
+constexpr int FILL_PRIORITY = 0;
+
+// Hash buckets and list nodes of an entry, roughly
+constexpr qint64 ENTRY_OVERHEAD = 96;
+// Cost of a full palette before any is cached to measure
+constexpr qint64 TYPICAL_ENTRY_COST = 5 * 1024;
+// A source colour entry is its key and the overhead
+constexpr qint64 SOURCE_ENTRY_COST = 64 + ENTRY_OVERHEAD;
+
+QString cachePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/sleex/schemes.bin";
+}
+
+qint64 costOf(const QByteArray &key, const SchemeCache::Entry &entry) {
+    return key.size() + entry.scss.size() * qint64(sizeof(QChar)) + ENTRY_OVERHEAD;
+}
+}
+
+SchemeCache *SchemeCache::instance() {
+    static SchemeCache *cache = []() {
+        auto *created = new SchemeCache();
+        // The first caller may be a worker, the save timer and the queued
+        // signals belong on the GUI thread
+        if (QCoreApplication::instance()) created->moveToThread(QCoreApplication::instance()->thread());
+        return created;
+    }();
+    return cache;
+}
+
+SchemeCache *SchemeCache::create(QQmlEngine *, QJSEngine *) {
+    SchemeCache *cache = instance();
+    QJSEngine::setObjectOwnership(cache, QJSEngine::CppOwnership);
+    return cache;
+}
+
+SchemeCache::SchemeCache(QObject *parent) : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+    // Palettes for later must not take the CPU from what the user is doing
+    m_pool.setThreadPriority(QThread::IdlePriority);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SchemeCache::save);
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            ++m_generation;
+            // Drops the fill, and possibly a save that was queued behind a running job
+            m_pool.clear();
+            m_pool.waitForDone();
+            m_saveTimer.stop();
+            // Whatever the last completed write missed is written here and now
+            if (m_savedRevision != m_revision) write(serialize(), m_revision);
+        });
+    }
+
+    m_pool.start([this]() { load(); }, LOAD_PRIORITY);
+}
+
+SchemeCache::~SchemeCache() {
+    ++m_generation;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+std::optional<SchemeCache::Entry> SchemeCache::find(const QByteArray &key, bool counted) {
+    std::optional<Entry> found;
+    {
+        QMutexLocker locker(&m_mutex);
+        const auto it = m_slots.find(key);
+        if (it != m_slots.end()) {
+            if (counted) m_uses.splice(m_uses.begin(), m_uses, it->use);
+            found = it->entry;
+        }
+        if (counted && found) ++m_hits;
+        else if (counted) ++m_misses;
+    }
+    if (counted) changed(false);
+    return found;
+}
+
+void SchemeCache::insert(const QByteArray &key, const Entry &entry) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_slots.find(key);
+        if (it != m_slots.end()) {
+            m_size -= it->cost;
+            m_uses.erase(it->use);
+            m_slots.erase(it);
+        }
+        m_uses.push_front(key);
+        const qint64 cost = costOf(key, entry);
+        m_slots.insert(key, Slot { entry, cost, m_uses.begin() });
+        m_size += cost;
+        evict();
+    }
+    changed(true);
+}
+
+void SchemeCache::evict() {
+    while (m_size > m_maxSize && !m_uses.empty()) {
+        const auto it = m_slots.find(m_uses.back());
+        m_size -= it->cost;
+        m_slots.erase(it);
+        m_uses.pop_back();
+    }
+}
+
+void SchemeCache::changed(bool modified) {
+    if (modified) ++m_revision;
+    QMetaObject::invokeMethod(this, [this, modified]() {
+        if (modified) m_saveTimer.start();
+        emit statsChanged();
+    }, Qt::QueuedConnection);
+}
+
+QByteArray SchemeCache::contentHash(const QString &path, bool compute) {
+    const QFileInfo info(path);
+    if (!info.isFile()) return QByteArray();
+    const qint64 size = info.size();
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&m_mutex);
+        const auto it = m_hashes.constFind(info.absoluteFilePath());
+        if (it != m_hashes.cend() && it->size == size && it->mtime == mtime) return it->hash;
+    }
+    if (!compute) return QByteArray();
+
+    const QByteArray hash = WallpaperLibrary::contentHash(path, size);
+    if (!hash.isEmpty()) remember(info.absoluteFilePath(), size, mtime, hash);
+    return hash;
+}
+
+void SchemeCache::remember(const QString &path, qint64 size, qint64 mtime, const QByteArray &hash) {
+    QMutexLocker locker(&m_mutex);
+    m_hashes.insert(path, HashedFile { size, mtime, hash });
+}
+
+void SchemeCache::prefetch(WallpaperLibrary *library, const QStringList &arguments) {
+    qint64 cost = TYPICAL_ENTRY_COST;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_slots.isEmpty()) cost = qMax(m_size / m_slots.size(), cost);
+    }
+    fill(library, cost, [arguments](const QString &path) {
+        MaterialPalette::generateScss(QStringList { "--path", path } + arguments, true);
+    });
+}
+
+void SchemeCache::prefetchSources(WallpaperLibrary *library) {
+    fill(library, SOURCE_ENTRY_COST, [](const QString &path) { MaterialPalette::cacheSource(path); });
+}
+
+void SchemeCache::fill(WallpaperLibrary *library, qint64 entryCost, const std::function<void(const QString &)> &generate) {
+    if (!library) return;
+    // Jobs of the previous fill still queued skip themselves
+    const quint64 generation = ++m_generation;
+
+    const QString root = library->path();
+    const QVector<WallpaperInfo> &items = library->items();
+
+    // Past three quarters of maxSize the fill would evict its own output and
+    // go round again on the next prefetch, the rest is generated on demand
+    const qsizetype count = qMin<qsizetype>(items.size(), qint64(maxSize()) * 3 / 4 / entryCost);
+    if (count < items.size())
+        qInfo() << "Sleex: scheme cache fills" << count << "of" << items.size() << "wallpapers, raise maxSize for all";
+    m_pending = int(count);
+    emit pendingChanged();
+
+    for (const WallpaperInfo &info : items.first(count)) {
+        const QString path = QFileInfo(root + "/" + info.relativePath).absoluteFilePath();
+        // The library hashed most of them already
+        if (!info.hash.isEmpty()) remember(path, info.size, info.mtime, info.hash);
+
+        m_pool.start([this, generation, path, generate]() {
+            if (generation != m_generation) return;
+            generate(path);
+            QMetaObject::invokeMethod(this, [this, generation, path]() {
+                if (generation != m_generation) return;
+                --m_pending;
+                emit pendingChanged();
+                emit ready(path);
+            }, Qt::QueuedConnection);
+        }, FILL_PRIORITY);
+    }
+}
+
+void SchemeCache::request(const QString &path, const QStringList &arguments) {
+    // preview() asks again on every miss, one job per palette is enough
+    const QString key = (QStringList { path } + arguments).join(QChar(0));
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_requested.contains(key)) return;
+        m_requested.insert(key);
+    }
+    m_pool.start([this, path, arguments, key]() {
+        MaterialPalette::generateScss(QStringList { "--path", path } + arguments, true);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_requested.remove(key);
+        }
+        QMetaObject::invokeMethod(this, [this, path]() { emit ready(path); }, Qt::QueuedConnection);
+    }, REQUEST_PRIORITY);
+}
+
+void SchemeCache::clear() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_slots.clear();
+        m_uses.clear();
+        m_size = 0;
+        m_hits = 0;
+        m_misses = 0;
+    }
+    m_saveTimer.start();
+    emit statsChanged();
+}
+
+void SchemeCache::load() {
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION || count > 1000000) return;
+
+    QVector<QPair<QByteArray, Entry>> loaded;
+    loaded.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        QPair<QByteArray, Entry> item;
+        in >> item.first >> item.second.source >> item.second.scss;
+        loaded.append(item);
+    }
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Sleex: Discarding corrupt scheme cache" << cachePath();
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        // Saved most recent first, and older than whatever this session added
+        for (const auto &[key, entry] : std::as_const(loaded)) {
+            if (m_slots.contains(key)) continue;
+            m_uses.push_back(key);
+            const qint64 cost = costOf(key, entry);
+            m_slots.insert(key, Slot { entry, cost, std::prev(m_uses.end()) });
+            m_size += cost;
+        }
+        evict();
+    }
+    changed(false);
+}
+
+void SchemeCache::save() {
+    m_saveTimer.stop();
+    const quint64 revision = m_revision;
+    const QByteArray data = serialize();
+    m_pool.start([this, data, revision]() { write(data, revision); }, LOAD_PRIORITY);
+}
+
+QByteArray SchemeCache::serialize() const {
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    QMutexLocker locker(&m_mutex);
+    out << CACHE_MAGIC << CACHE_VERSION << quint32(m_uses.size());
+    for (const QByteArray &key : m_uses) {
+        const Entry &entry = m_slots.constFind(key)->entry;
+        out << key << entry.source << entry.scss;
+    }
+    return data;
+}
+
+void SchemeCache::write(const QByteArray &data, quint64 revision) {
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(data);
+    if (file.commit()) m_savedRevision = revision;
+}
+
+int SchemeCache::maxSize() const {
+    QMutexLocker locker(&m_mutex);
+    return m_maxSize;
+}
+
+void SchemeCache::setMaxSize(int v) {
+    v = qMax(v, 0);
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_maxSize == v) return;
+        m_maxSize = v;
+        evict();
+    }
+    emit maxSizeChanged();
+    changed(true);
+}
+
+int SchemeCache::size() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_size);
+}
+
+int SchemeCache::entries() const {
+    QMutexLocker locker(&m_mutex);
+    return m_slots.size();
+}
+
+int SchemeCache::hits() const {
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int SchemeCache::misses() const {
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+qreal SchemeCache::hitRate() const {
+    QMutexLocker locker(&m_mutex);
+    const int lookups = m_hits + m_misses;
+    return lookups > 0 ? qreal(m_hits) / lookups : 0.0;
+}
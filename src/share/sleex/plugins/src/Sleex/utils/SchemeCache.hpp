@@ -0,0 +1,135 @@
+#pragma once
+
+#include "WallpaperLibrary.hpp"
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QQmlEngine>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <optional>
+
+// Material palettes already generated, keyed by image contents and the
+// generator arguments that change the output, see MaterialPalette. A
+// worker at idle priority fills it for the whole wallpaper library, so
+// applying or previewing a wallpaper's theme is a lookup. Least recently
+// used entries go past maxSize and the rest is kept in ~/.cache/sleex
+// between sessions. Lookups and inserts are safe from any thread.
+class SchemeCache : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+    // Bytes of cached output before the least recently used entries go
+    Q_PROPERTY(int maxSize READ maxSize WRITE setMaxSize NOTIFY maxSizeChanged FINAL)
+    Q_PROPERTY(int size    READ size    NOTIFY statsChanged FINAL)
+    Q_PROPERTY(int entries READ entries NOTIFY statsChanged FINAL)
+    // Lookups of this session, background fills excluded
+    Q_PROPERTY(int   hits    READ hits    NOTIFY statsChanged FINAL)
+    Q_PROPERTY(int   misses  READ misses  NOTIFY statsChanged FINAL)
+    Q_PROPERTY(qreal hitRate READ hitRate NOTIFY statsChanged FINAL)
+    // Wallpapers the background fill has yet to go through
+    Q_PROPERTY(int pending READ pending NOTIFY pendingChanged FINAL)
+
+public:
+    struct Entry {
+        quint32 source = 0;
+        // Generator output, empty for entries holding only the source colour
+        QString scss;
+    };
+
+    static SchemeCache *instance();
+    static SchemeCache *create(QQmlEngine *, QJSEngine *);
+
+    ~SchemeCache() override;
+
+    // counted lookups make up the hit rate and refresh the entry
+    std::optional<Entry> find(const QByteArray &key, bool counted = true);
+    void insert(const QByteArray &key, const Entry &entry);
+    // WallpaperLibrary::contentHash remembered by size and mtime. Without
+    // compute an unknown file gives an empty hash instead of being read
+    QByteArray contentHash(const QString &path, bool compute = true);
+
+    int   maxSize() const;
+    void  setMaxSize(int v);
+    int   size() const;
+    int   entries() const;
+    int   hits() const;
+    int   misses() const;
+    qreal hitRate() const;
+    int   pending() const { return m_pending; }
+
+    // Generates every wallpaper of the library with the arguments of
+    // generate_colors_material.py, --path aside. Replaces a fill in progress
+    Q_INVOKABLE void prefetch(WallpaperLibrary *library, const QStringList &arguments);
+    // Only the source colour of every wallpaper, for when the scheme is
+    // picked at apply time. Any scheme generated later skips the quantizer
+    Q_INVOKABLE void prefetchSources(WallpaperLibrary *library);
+    // One wallpaper ahead of the fill, reported through ready()
+    Q_INVOKABLE void request(const QString &path, const QStringList &arguments);
+    Q_INVOKABLE void clear();
+
+signals:
+    void maxSizeChanged();
+    void statsChanged();
+    void pendingChanged();
+    void ready(const QString &path);
+
+private:
+    explicit SchemeCache(QObject *parent = nullptr);
+
+    struct Slot {
+        Entry entry;
+        qint64 cost = 0;
+        std::list<QByteArray>::iterator use;
+    };
+
+    struct HashedFile {
+        qint64 size = 0;
+        qint64 mtime = 0;
+        QByteArray hash;
+    };
+
+    // Runs generate for each wallpaper of the library at idle priority
+    void fill(WallpaperLibrary *library, qint64 entryCost, const std::function<void(const QString &)> &generate);
+    void load();
+    // Snapshots the entries on the calling thread, writes them on the pool
+    void save();
+    QByteArray serialize() const;
+    void write(const QByteArray &data, quint64 revision);
+    // Caller holds m_mutex
+    void evict();
+    // Saving and change signals happen on the GUI thread
+    void changed(bool modified);
+    void remember(const QString &path, qint64 size, qint64 mtime, const QByteArray &hash);
+
+    mutable QMutex m_mutex;
+    QHash<QByteArray, Slot> m_slots;
+    // Most recently used first
+    std::list<QByteArray> m_uses;
+    QHash<QString, HashedFile> m_hashes;
+    // Path and arguments of the requests queued or running
+    QSet<QString> m_requested;
+    qint64 m_size = 0;
+    // An entry is some 80 SCSS lines in UTF-16, about 5 KB. 16 MiB holds
+    // around 3000: a 2000 wallpaper library in one mode, with room for the
+    // other mode and previews of the wallpapers used most
+    int m_maxSize = 16 * 1024 * 1024;
+    int m_hits = 0;
+    int m_misses = 0;
+
+    // Loading, saving and the fill, one job at a time at idle priority
+    QThreadPool m_pool;
+    std::atomic<quint64> m_generation { 0 };
+    // Modifications so far, and how many of them the cache file holds
+    std::atomic<quint64> m_revision { 0 };
+    std::atomic<quint64> m_savedRevision { 0 };
+    int m_pending = 0;
+    // Parented, so it follows the cache to the GUI thread
+    QTimer m_saveTimer { this };
+};
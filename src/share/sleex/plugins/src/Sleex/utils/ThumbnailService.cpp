@@ -0,0 +1,236 @@
+#include "ThumbnailService.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QMimeDatabase>
+#include <QProcess>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QUrl>
+#include <functional>
+
+namespace {
+
+QString cacheRoot() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails";
+}
+
+QString cacheKey(const QString &uri) {
+    return QString::fromLatin1(QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5).toHex()) + ".png";
+}
+
+// Spec flavours: "normal" is 128px, "large" is 256px
+QString flavourFor(int size) {
+    return size <= 128 ? QStringLiteral("normal") : QStringLiteral("large");
+}
+
+bool isFreshThumbnail(const QString &thumbPath, const QString &uri, qint64 mtime) {
+    QImageReader reader(thumbPath);
+    if (!reader.canRead()) return false;
+    return reader.text("Thumb::URI") == uri
+        && reader.text("Thumb::MTime") == QString::number(mtime);
+}
+
+bool writeThumbnail(QImage image, const QString &thumbPath, const QString &uri, qint64 mtime) {
+    image.setText("Thumb::URI", uri);
+    image.setText("Thumb::MTime", QString::number(mtime));
+    image.setText("Software", "Sleex");
+
+    QDir().mkpath(QFileInfo(thumbPath).absolutePath());
+    QSaveFile file(thumbPath);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    if (!image.save(&file, "PNG") || !file.commit()) return false;
+
+    QFile::setPermissions(thumbPath, QFile::ReadOwner | QFile::WriteOwner);
+    return true;
+}
+
+// Runs an external thumbnailer, bailing out as soon as the job is cancelled
+bool runTool(const QString &program, const QStringList &args, const std::atomic_bool &cancelled) {
+    QProcess process;
+    process.start(program, args);
+    if (!process.waitForStarted()) return false;
+
+    while (!process.waitForFinished(100)) {
+        if (cancelled || process.state() == QProcess::NotRunning) break;
+    }
+    if (process.state() != QProcess::NotRunning) {
+        process.kill();
+        process.waitForFinished();
+        return false;
+    }
+    return process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+}
+
+QImage generate(const QString &path, const QString &mime, int size, const std::atomic_bool &cancelled) {
+    if (mime.startsWith("image/")) {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        const QSize original = reader.size();
+        // Let the decoder downscale instead of decoding full size first
+        if (original.isValid() && (original.width() > size || original.height() > size))
+            reader.setScaledSize(original.scaled(size, size, Qt::KeepAspectRatio));
+        return reader.read();
+    }
+
+    QTemporaryDir tmp;
+    if (!tmp.isValid()) return QImage();
+
+    QString output;
+    if (mime.startsWith("video/")) {
+        output = tmp.filePath("poster.png");
+        if (!runTool("ffmpegthumbnailer", {"-i", path, "-o", output, "-s", QString::number(size), "-c", "png"}, cancelled))
+            return QImage();
+    } else if (mime == "application/pdf") {
+        output = tmp.filePath("page.png");
+        if (!runTool("pdftoppm", {"-png", "-singlefile", "-f", "1", "-l", "1",
+                                  "-scale-to", QString::number(size), path, tmp.filePath("page")}, cancelled))
+            return QImage();
+    } else {
+        return QImage();
+    }
+
+    QImage image(output);
+    if (image.width() > size || image.height() > size)
+        image = image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+class ThumbnailJob : public QRunnable {
+public:
+    ThumbnailJob(const QString &path, int size,
+                 std::function<void(const QString &)> done,
+                 std::shared_ptr<ThumbnailJobState> state)
+        : m_path(path), m_size(size),
+          m_done(std::move(done)), m_state(std::move(state)) {}
+
+    void run() override {
+        m_state->started = true;
+        if (m_state->cancelled) return;
+
+        const QFileInfo info(m_path);
+        const QString uri = QUrl::fromLocalFile(info.absoluteFilePath()).toString(QUrl::FullyEncoded);
+        const qint64 mtime = info.lastModified().toSecsSinceEpoch();
+        const QString key = cacheKey(uri);
+        const QString thumbPath = cacheRoot() + "/" + flavourFor(m_size) + "/" + key;
+        const QString failPath = cacheRoot() + "/fail/sleex/" + key;
+
+        if (isFreshThumbnail(thumbPath, uri, mtime)) {
+            m_done(thumbPath);
+            return;
+        }
+        // A previous attempt on this exact version of the file already failed
+        if (isFreshThumbnail(failPath, uri, mtime)) {
+            m_done(QString());
+            return;
+        }
+
+        const QString mime = QMimeDatabase().mimeTypeForFile(info).name();
+        const QImage image = generate(m_path, mime, m_size, m_state->cancelled);
+        if (m_state->cancelled) return;
+
+        if (image.isNull()) {
+            QImage marker(1, 1, QImage::Format_ARGB32);
+            marker.fill(Qt::transparent);
+            writeThumbnail(marker, failPath, uri, mtime);
+            m_done(QString());
+            return;
+        }
+
+        m_done(writeThumbnail(image, thumbPath, uri, mtime) ? thumbPath : QString());
+    }
+
+private:
+    QString m_path;
+    int m_size;
+    std::function<void(const QString &)> m_done;
+    std::shared_ptr<ThumbnailJobState> m_state;
+};
+
+} // namespace
+
+ThumbnailService *ThumbnailService::instance() {
+    static ThumbnailService *service = new ThumbnailService();
+    return service;
+}
+
+ThumbnailService *ThumbnailService::create(QQmlEngine *, QJSEngine *) {
+    ThumbnailService *service = instance();
+    QJSEngine::setObjectOwnership(service, QJSEngine::CppOwnership);
+    return service;
+}
+
+ThumbnailService::ThumbnailService(QObject *parent) : QObject(parent) {
+    // Decoding is memory hungry, a few workers are plenty for a desktop
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+}
+
+ThumbnailService::~ThumbnailService() {
+    for (const Pending &pending : std::as_const(m_pending))
+        pending.state->cancelled = true;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+bool ThumbnailService::canThumbnail(const QString &path) {
+    const QString mime = QMimeDatabase().mimeTypeForFile(path, QMimeDatabase::MatchExtension).name();
+    return mime.startsWith("image/") || mime.startsWith("video/") || mime == "application/pdf";
+}
+
+QString ThumbnailService::request(const QString &path, int size) {
+    const auto ready = m_ready.constFind(path);
+    if (ready != m_ready.constEnd()) return ready.value();
+
+    if (m_pending.contains(path) || !canThumbnail(path)) return QString();
+
+    auto state = std::make_shared<ThumbnailJobState>();
+    auto done = [this, path, state](const QString &thumbPath) {
+        QMetaObject::invokeMethod(this, [this, path, thumbPath, state]() {
+            finish(path, thumbPath, state);
+        }, Qt::QueuedConnection);
+    };
+    auto *job = new ThumbnailJob(path, size, std::move(done), state);
+    m_pending.insert(path, {state, job});
+    m_pool.start(job);
+    return QString();
+}
+
+void ThumbnailService::cancel(const QString &path) {
+    const Pending pending = m_pending.take(path);
+    if (!pending.state) return;
+    pending.state->cancelled = true;
+
+    // Still queued: take it out rather than leave a dead job in line. A started
+    // job belongs to the pool, and only this thread queues new ones, so the
+    // pointer cannot match something else in the queue.
+    if (!pending.state->started && m_pool.tryTake(pending.job)) delete pending.job;
+}
+
+void ThumbnailService::invalidate(const QString &path) {
+    cancel(path);
+    m_ready.remove(path);
+}
+
+void ThumbnailService::finish(const QString &path, const QString &thumbPath,
+                              const std::shared_ptr<ThumbnailJobState> &state) {
+    // A newer request for the same path may have replaced this one
+    if (state->cancelled || m_pending.value(path).state != state) return;
+    m_pending.remove(path);
+
+    if (thumbPath.isEmpty()) {
+        emit thumbnailFailed(path);
+        return;
+    }
+
+    // Same cache file after a regeneration, the query tells the views apart
+    QUrl thumbUrl = QUrl::fromLocalFile(thumbPath);
+    thumbUrl.setQuery(QStringLiteral("mtime=%1").arg(QFileInfo(thumbPath).lastModified().toMSecsSinceEpoch()));
+    const QString url = thumbUrl.toString();
+    m_ready.insert(path, url);
+    emit thumbnailReady(path, url);
+}
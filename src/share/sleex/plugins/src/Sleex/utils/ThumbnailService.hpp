@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <QQmlEngine>
+#include <atomic>
+#include <memory>
+
+class QRunnable;
+
+// Shared between a queued job and the service
+struct ThumbnailJobState {
+    std::atomic_bool cancelled = false;
+    // Set once the pool hands the job to a worker, which then owns it
+    std::atomic_bool started = false;
+};
+
+// Generates file previews off the GUI thread and shares them with other
+// applications through the freedesktop thumbnail cache (~/.cache/thumbnails).
+// Cache entries are named after the MD5 of the file URI and are only reused
+// while their Thumb::MTime matches the file on disk.
+class ThumbnailService : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+public:
+    static ThumbnailService *instance();
+    static ThumbnailService *create(QQmlEngine *, QJSEngine *);
+
+    ~ThumbnailService() override;
+
+    // Returns a file:// URL when a thumbnail is already known, otherwise
+    // queues a job and reports back through thumbnailReady(). The URL carries
+    // the thumbnail's mtime, a regenerated one does not hit the old pixmap.
+    Q_INVOKABLE QString request(const QString &path, int size = 128);
+    // Drops a queued or running job, e.g. when its delegate goes away
+    Q_INVOKABLE void cancel(const QString &path);
+    // Forgets the known thumbnail so the next request regenerates it
+    Q_INVOKABLE void invalidate(const QString &path);
+
+    Q_INVOKABLE static bool canThumbnail(const QString &path);
+
+signals:
+    void thumbnailReady(const QString &path, const QString &url);
+    void thumbnailFailed(const QString &path);
+
+private:
+    explicit ThumbnailService(QObject *parent = nullptr);
+
+    struct Pending {
+        std::shared_ptr<ThumbnailJobState> state;
+        QRunnable *job = nullptr;
+    };
+
+    void finish(const QString &path, const QString &thumbPath,
+                const std::shared_ptr<ThumbnailJobState> &state);
+
+    QThreadPool m_pool;
+    QHash<QString, Pending> m_pending;
+    QHash<QString, QString> m_ready;
+};
@@ -0,0 +1,530 @@
+#include "WallpaperLibrary.hpp"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
+#include <QDebug>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+// Bump when the on-disk layout changes
+constexpr quint32 INDEX_MAGIC = 0x534c5750; // "SLWP"
+constexpr quint32 INDEX_VERSION = 2;
+
+// Bytes hashed at the start, middle and end of a file. Enough to tell
+// wallpapers apart without reading 2000 4K images on every start.
+constexpr qint64 HASH_SAMPLE = 64 * 1024;
+
+// Editors and copies fire bursts of events, one rescan covers them all
+constexpr int RESCAN_DELAY_MS = 400;
+constexpr int SAVE_DELAY_MS = 2000;
+
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                              | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+const QStringList NAME_FILTERS = { "*.jpg", "*.jpeg", "*.png", "*.gif", "*.webp" };
+
+QString cacheRoot() {
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/sleex/wallpapers";
+}
+
+QString indexPath(const QString &root) {
+    const QByteArray key = QCryptographicHash::hash(QFile::encodeName(root), QCryptographicHash::Md5).toHex();
+    return cacheRoot() + "/index-" + QString::fromLatin1(key) + ".bin";
+}
+
+QString thumbnailFile(const QByteArray &hash, int size) {
+    return cacheRoot() + "/thumbnails/" + QString::fromLatin1(hash) + "-" + QString::number(size) + ".jpg";
+}
+
+// Case insensitive with a case sensitive tie break, a total order for merging
+bool lessPath(const QString &a, const QString &b) {
+    const int c = QString::compare(a, b, Qt::CaseInsensitive);
+    return c != 0 ? c < 0 : a < b;
+}
+
+// Centre of the most populated 4-bit-per-channel bucket, transparent pixels skipped
+QColor dominantColor(const QImage &thumbnail) {
+    const QImage image = thumbnail.scaled(32, 32, Qt::IgnoreAspectRatio, Qt::FastTransformation)
+                             .convertToFormat(QImage::Format_ARGB32);
+    QVector<int> counts(4096, 0);
+    QVector<quint64> sums(4096 * 3, 0);
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const QRgb px = line[x];
+            if (qAlpha(px) < 128) continue;
+            const int bucket = ((qRed(px) >> 4) << 8) | ((qGreen(px) >> 4) << 4) | (qBlue(px) >> 4);
+            ++counts[bucket];
+            sums[bucket * 3] += qRed(px);
+            sums[bucket * 3 + 1] += qGreen(px);
+            sums[bucket * 3 + 2] += qBlue(px);
+        }
+    }
+    const int best = int(std::max_element(counts.cbegin(), counts.cend()) - counts.cbegin());
+    const int n = counts.at(best);
+    if (n == 0) return QColor();
+    return QColor(int(sums[best * 3] / n), int(sums[best * 3 + 1] / n), int(sums[best * 3 + 2] / n));
+}
+
+bool saveThumbnail(const QImage &image, const QString &path) {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    return image.save(&file, "JPG", 85) && file.commit();
+}
+
+// Hash, dimensions, thumbnail and colour of one wallpaper
+WallpaperInfo process(const QString &root, WallpaperInfo info, int size, const std::atomic_bool &cancelled) {
+    const QString path = root + "/" + info.relativePath;
+    if (info.hash.isEmpty()) info.hash = WallpaperLibrary::contentHash(path, info.size);
+    if (cancelled) return info;
+    if (info.hash.isEmpty()) {
+        info.failed = true;
+        return info;
+    }
+
+    const QString thumbPath = thumbnailFile(info.hash, size);
+    QImage thumbnail;
+    if (QFile::exists(thumbPath)) {
+        // Same contents seen under another name, only the metadata is missing
+        if (!info.dimensions.isValid()) info.dimensions = QImageReader(path).size();
+        if (!info.dominantColor.isValid()) thumbnail.load(thumbPath);
+        info.thumbnailed = true;
+    } else {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        QSize original = reader.size();
+        if (reader.transformation() & QImageIOHandler::TransformationRotate90) original.transpose();
+        info.dimensions = original;
+        // Let the decoder downscale instead of decoding full size first
+        if (original.isValid() && (original.width() > size || original.height() > size)) {
+            QSize scaled = original.scaled(size, size, Qt::KeepAspectRatio);
+            if (reader.transformation() & QImageIOHandler::TransformationRotate90) scaled.transpose();
+            reader.setScaledSize(scaled);
+        }
+        thumbnail = reader.read();
+        if (cancelled) return info;
+        if (thumbnail.isNull()) {
+            info.failed = true;
+            return info;
+        }
+        info.thumbnailed = saveThumbnail(thumbnail, thumbPath);
+    }
+    if (!thumbnail.isNull()) info.dominantColor = dominantColor(thumbnail);
+    return info;
+}
+
+QVector<WallpaperInfo> loadIndex(const QString &root) {
+    QVector<WallpaperInfo> items;
+    QFile file(indexPath(root));
+    if (!file.open(QIODevice::ReadOnly)) return items;
+
+    QDataStream in(&file);
+    quint32 magic = 0, version = 0, count = 0;
+    QString indexedRoot;
+    in >> magic >> version >> indexedRoot >> count;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION || indexedRoot != root || count > 1000000) return items;
+
+    items.resize(count);
+    for (WallpaperInfo &info : items) {
+        quint32 rgb = 0;
+        bool hasColor = false;
+        in >> info.relativePath >> info.size >> info.mtime >> info.hash >> info.dimensions >> hasColor >> rgb
+           >> info.failed;
+        if (hasColor) info.dominantColor = QColor::fromRgb(rgb);
+    }
+    if (in.status() != QDataStream::Ok) items.clear();
+    return items;
+}
+
+void writeIndex(const QString &root, const QVector<WallpaperInfo> &items) {
+    const QString path = indexPath(root);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    QDataStream out(&file);
+    out << INDEX_MAGIC << INDEX_VERSION << root << quint32(items.size());
+    for (const WallpaperInfo &info : items) {
+        out << info.relativePath << info.size << info.mtime << info.hash << info.dimensions
+            << info.dominantColor.isValid() << quint32(info.dominantColor.rgb()) << info.failed;
+    }
+    file.commit();
+}
+}
+
+WallpaperLibrary::WallpaperLibrary(QObject *parent) : QAbstractListModel(parent) {
+    m_pool.setMaxThreadCount(1);
+    // Decoding is memory hungry, a few workers are plenty for a desktop
+    m_thumbnailPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    m_token = std::make_shared<std::atomic_bool>(false);
+
+    m_rescanTimer.setSingleShot(true);
+    m_rescanTimer.setInterval(RESCAN_DELAY_MS);
+    connect(&m_rescanTimer, &QTimer::timeout, this, &WallpaperLibrary::rescan);
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, &WallpaperLibrary::saveIndex);
+
+    // Queued, so a path set from QML is in place before the first scan
+    QMetaObject::invokeMethod(this, [this]() {
+        m_started = true;
+        rescan();
+    }, Qt::QueuedConnection);
+}
+
+WallpaperLibrary::~WallpaperLibrary() {
+    *m_token = true;
+    ++m_generation;
+    m_thumbnailPool.clear();
+    m_thumbnailPool.waitForDone();
+    if (m_saveTimer.isActive()) saveIndex();
+    m_pool.waitForDone();
+    clearWatches();
+}
+
+void WallpaperLibrary::setPath(const QString &v) {
+    const QString path = QDir::cleanPath(v);
+    if (m_path == path) return;
+    if (m_saveTimer.isActive()) saveIndex();
+    m_path = path;
+    emit pathChanged();
+
+    restart();
+    m_indexRead = false;
+    if (!m_items.isEmpty()) {
+        beginResetModel();
+        m_items.clear();
+        endResetModel();
+        emit countChanged();
+    }
+    clearWatches();
+    if (m_started) rescan();
+}
+
+void WallpaperLibrary::setThumbnailSize(int v) {
+    v = qBound(32, v, 1024);
+    if (m_thumbnailSize == v) return;
+    m_thumbnailSize = v;
+    emit thumbnailSizeChanged();
+
+    restart();
+    if (m_started) rescan();
+}
+
+void WallpaperLibrary::restart() {
+    // Jobs already running finish, their results are dropped
+    *m_token = true;
+    m_token = std::make_shared<std::atomic_bool>(false);
+    m_thumbnailPool.clear();
+    ++m_generation;
+    if (!m_queued.isEmpty()) {
+        m_queued.clear();
+        emit pendingChanged();
+    }
+}
+
+void WallpaperLibrary::rescan() {
+    if (m_path.isEmpty()) return;
+    if (m_scanning) {
+        m_rescanQueued = true;
+        return;
+    }
+    m_scanning = true;
+    emit scanningChanged();
+
+    const quint64 generation = ++m_generation;
+    const QString root = m_path;
+    const int size = m_thumbnailSize;
+    const QVector<WallpaperInfo> known = m_items;
+    const bool readIndex = !m_indexRead;
+    m_indexRead = true;
+
+    m_pool.start([this, generation, root, size, known, readIndex]() {
+        const ScanResult result = scan(root, size, known, readIndex);
+        QMetaObject::invokeMethod(this, [this, generation, result]() {
+            m_scanning = false;
+            if (generation == m_generation) apply(result);
+            emit scanningChanged();
+            if (m_rescanQueued) {
+                m_rescanQueued = false;
+                rescan();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+WallpaperLibrary::ScanResult WallpaperLibrary::scan(const QString &root, int thumbnailSize,
+                                                    const QVector<WallpaperInfo> &known, bool readIndex) {
+    ScanResult result;
+    QHash<QString, WallpaperInfo> previous;
+    if (readIndex) {
+        for (const WallpaperInfo &info : loadIndex(root)) previous.insert(info.relativePath, info);
+    }
+    for (const WallpaperInfo &info : known) previous.insert(info.relativePath, info);
+
+    const QDir base(root);
+    if (!base.exists()) return result;
+    result.directories << base.absolutePath();
+
+    QDirIterator dirs(root, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (dirs.hasNext()) result.directories << dirs.next();
+
+    QDirIterator files(root, NAME_FILTERS, QDir::Files, QDirIterator::Subdirectories);
+    while (files.hasNext()) {
+        files.next();
+        const QFileInfo fileInfo = files.fileInfo();
+
+        WallpaperInfo info;
+        info.relativePath = base.relativeFilePath(fileInfo.filePath());
+        info.size = fileInfo.size();
+        info.mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+
+        // Unchanged files keep everything but the thumbnail check
+        const auto it = previous.constFind(info.relativePath);
+        if (it != previous.cend() && it->size == info.size && it->mtime == info.mtime) {
+            info = it.value();
+            info.thumbnailed = !info.hash.isEmpty() && QFile::exists(thumbnailFile(info.hash, thumbnailSize));
+        }
+        result.items.append(info);
+    }
+
+    std::sort(result.items.begin(), result.items.end(), [](const WallpaperInfo &a, const WallpaperInfo &b) {
+        return lessPath(a.relativePath, b.relativePath);
+    });
+    return result;
+}
+
+void WallpaperLibrary::apply(const ScanResult &result) {
+    updateWatches(result.directories);
+    const int before = m_items.size();
+
+    if (m_items.isEmpty()) {
+        if (!result.items.isEmpty()) {
+            beginResetModel();
+            m_items = result.items;
+            endResetModel();
+        }
+    } else {
+        // Both sides are sorted, walk them together and patch the differences
+        const QVector<WallpaperInfo> &items = result.items;
+        int i = 0, j = 0;
+        while (i < m_items.size() || j < items.size()) {
+            if (j == items.size() || (i < m_items.size() && lessPath(m_items.at(i).relativePath, items.at(j).relativePath))) {
+                beginRemoveRows(QModelIndex(), i, i);
+                m_items.removeAt(i);
+                endRemoveRows();
+            } else if (i == m_items.size() || lessPath(items.at(j).relativePath, m_items.at(i).relativePath)) {
+                beginInsertRows(QModelIndex(), i, i);
+                m_items.insert(i, items.at(j));
+                endInsertRows();
+                ++i;
+                ++j;
+            } else {
+                // Thumbnails may have landed since the scan started, they stay
+                WallpaperInfo &current = m_items[i];
+                if (current.size != items.at(j).size || current.mtime != items.at(j).mtime) {
+                    current = items.at(j);
+                    emit dataChanged(index(i), index(i));
+                }
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    if (m_items.size() != before) emit countChanged();
+    queueThumbnails();
+    m_saveTimer.start();
+}
+
+void WallpaperLibrary::queueThumbnails() {
+    const int before = m_queued.size();
+    const QString root = m_path;
+    const int size = m_thumbnailSize;
+    const std::shared_ptr<std::atomic_bool> token = m_token;
+
+    for (const WallpaperInfo &info : std::as_const(m_items)) {
+        // Failures stay skipped, a rewrite comes back from the scan with a fresh entry
+        if ((info.thumbnailed && info.dominantColor.isValid()) || info.failed || m_queued.contains(info.relativePath))
+            continue;
+        m_queued.insert(info.relativePath);
+        m_thumbnailPool.start([this, root, size, token, info]() {
+            if (*token) return;
+            const WallpaperInfo done = process(root, info, size, *token);
+            QMetaObject::invokeMethod(this, [this, token, done]() {
+                onThumbnail(token, done);
+            }, Qt::QueuedConnection);
+        });
+    }
+    if (m_queued.size() != before) emit pendingChanged();
+}
+
+void WallpaperLibrary::onThumbnail(const std::shared_ptr<std::atomic_bool> &token, const WallpaperInfo &info) {
+    if (*token || token != m_token) return;
+    if (m_queued.remove(info.relativePath)) emit pendingChanged();
+
+    const int row = rowOf(info.relativePath);
+    // Gone or rewritten meanwhile, the next scan queues it again
+    if (row < 0 || m_items.at(row).size != info.size || m_items.at(row).mtime != info.mtime) return;
+
+    WallpaperInfo &current = m_items[row];
+    current.hash = info.hash;
+    current.dimensions = info.dimensions;
+    current.dominantColor = info.dominantColor;
+    current.thumbnailed = info.thumbnailed;
+    current.failed = info.failed;
+    emit dataChanged(index(row), index(row));
+    m_saveTimer.start();
+}
+
+void WallpaperLibrary::saveIndex() {
+    m_saveTimer.stop();
+    if (m_path.isEmpty()) return;
+    const QString root = m_path;
+    const QVector<WallpaperInfo> items = m_items;
+    m_pool.start([root, items]() { writeIndex(root, items); });
+}
+
+void WallpaperLibrary::updateWatches(const QStringList &directories) {
+    if (m_inotifyFd < 0) {
+        m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotifyFd < 0) {
+            qWarning() << "Sleex: inotify_init1 failed:" << strerror(errno);
+            return;
+        }
+        m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &WallpaperLibrary::readEvents);
+    }
+
+    // Adding a watched directory again hands back its existing descriptor
+    QHash<int, QString> watches;
+    for (const QString &dir : directories) {
+        const int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(dir).constData(), WATCH_MASK);
+        if (wd < 0) {
+            qWarning() << "Sleex: Cannot watch" << dir << ":" << strerror(errno);
+            continue;
+        }
+        watches.insert(wd, dir);
+    }
+    for (auto it = m_watches.cbegin(); it != m_watches.cend(); ++it) {
+        if (!watches.contains(it.key())) inotify_rm_watch(m_inotifyFd, it.key());
+    }
+    m_watches = watches;
+}
+
+void WallpaperLibrary::clearWatches() {
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_inotifyFd >= 0) ::close(m_inotifyFd);
+    m_inotifyFd = -1;
+    m_watches.clear();
+}
+
+void WallpaperLibrary::readEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    for (;;) {
+        const ssize_t len = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0) break;
+
+        for (char *ptr = buffer; ptr < buffer + len; ) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_IGNORED) {
+                m_watches.remove(event->wd);
+                continue;
+            }
+            changed = true;
+        }
+    }
+
+    // Overflow included, the scan works out what actually changed
+    if (changed) m_rescanTimer.start();
+}
+
+int WallpaperLibrary::rowOf(const QString &relativePath) const {
+    const auto it = std::lower_bound(m_items.cbegin(), m_items.cend(), relativePath,
+        [](const WallpaperInfo &info, const QString &path) { return lessPath(info.relativePath, path); });
+    return it != m_items.cend() && it->relativePath == relativePath ? int(it - m_items.cbegin()) : -1;
+}
+
+QByteArray WallpaperLibrary::contentHash(const QString &path, qint64 size) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(size));
+    if (size <= 3 * HASH_SAMPLE) {
+        hash.addData(&file);
+    } else {
+        for (const qint64 offset : { qint64(0), (size - HASH_SAMPLE) / 2, size - HASH_SAMPLE }) {
+            if (!file.seek(offset)) return QByteArray();
+            hash.addData(file.read(HASH_SAMPLE));
+        }
+    }
+    return hash.result().toHex();
+}
+
+QString WallpaperLibrary::thumbnailPath(const WallpaperInfo &info) const {
+    return info.thumbnailed ? thumbnailFile(info.hash, m_thumbnailSize) : QString();
+}
+
+QStringList WallpaperLibrary::relativePaths() const {
+    QStringList paths;
+    paths.reserve(m_items.size());
+    for (const WallpaperInfo &info : m_items) paths.append(info.relativePath);
+    return paths;
+}
+
+int WallpaperLibrary::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : m_items.size();
+}
+
+QVariant WallpaperLibrary::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_items.size()) return QVariant();
+    const WallpaperInfo &info = m_items.at(index.row());
+
+    switch (role) {
+        case PathRole: return QString(m_path + "/" + info.relativePath);
+        case RelativePathRole: return info.relativePath;
+        case Qt::DisplayRole:
+        case NameRole: return QFileInfo(info.relativePath).completeBaseName();
+        case ThumbnailRole: {
+            const QString thumb = thumbnailPath(info);
+            return thumb.isEmpty() ? QString() : QUrl::fromLocalFile(thumb).toString();
+        }
+        case WidthRole: return info.dimensions.width();
+        case HeightRole: return info.dimensions.height();
+        case DominantColorRole: return info.dominantColor;
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> WallpaperLibrary::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[PathRole] = "path";
+    roles[RelativePathRole] = "relativePath";
+    roles[NameRole] = "name";
+    roles[ThumbnailRole] = "thumbnail";
+    roles[WidthRole] = "imageWidth";
+    roles[HeightRole] = "imageHeight";
+    roles[DominantColorRole] = "dominantColor";
+    return roles;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QColor>
+#include <QHash>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+#include <atomic>
+#include <memory>
+
+class QSocketNotifier;
+
+struct WallpaperInfo {
+    QString    relativePath;
+    qint64     size = 0;
+    qint64     mtime = 0;
+    // Sampled content hash naming the thumbnail, empty until the file was read
+    QByteArray hash;
+    QSize      dimensions;
+    QColor     dominantColor;
+    bool       thumbnailed = false;
+    // Unreadable or undecodable at this size and mtime, not retried until either changes
+    bool       failed = false;
+};
+
+// Wallpaper directory as a list model. The tree is walked on a worker and
+// matched against an index kept in ~/.cache/sleex/wallpapers, so only new
+// or changed files are ever read. Thumbnails are made on a small pool and
+// named after the file contents, a renamed or duplicated wallpaper reuses
+// its thumbnail. One inotify instance watches every directory of the tree
+// and a change rescans, which patches rows instead of resetting the model.
+class WallpaperLibrary : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged FINAL)
+    // Longest thumbnail edge in pixels
+    Q_PROPERTY(int thumbnailSize READ thumbnailSize WRITE setThumbnailSize NOTIFY thumbnailSizeChanged FINAL)
+
+    Q_PROPERTY(bool scanning READ scanning NOTIFY scanningChanged FINAL)
+    Q_PROPERTY(int  count    READ count    NOTIFY countChanged FINAL)
+    // Wallpapers still waiting for their thumbnail
+    Q_PROPERTY(int  pending  READ pending  NOTIFY pendingChanged FINAL)
+
+public:
+    enum Roles {
+        PathRole = Qt::UserRole + 1,
+        RelativePathRole,
+        NameRole,
+        ThumbnailRole,
+        WidthRole,
+        HeightRole,
+        DominantColorRole
+    };
+
+    explicit WallpaperLibrary(QObject *parent = nullptr);
+    ~WallpaperLibrary() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString path() const { return m_path; }
+    void setPath(const QString &v);
+
+    int thumbnailSize() const { return m_thumbnailSize; }
+    void setThumbnailSize(int v);
+
+    bool scanning() const { return m_scanning; }
+    int  count()    const { return m_items.size(); }
+    int  pending()  const { return m_queued.size(); }
+
+    Q_INVOKABLE void rescan();
+    // Paths relative to path, in model order
+    Q_INVOKABLE QStringList relativePaths() const;
+    const QVector<WallpaperInfo> &items() const { return m_items; }
+
+    // Sampled SHA1 naming thumbnails and colour schemes, empty when the file cannot be read
+    static QByteArray contentHash(const QString &path, qint64 size);
+
+signals:
+    void pathChanged();
+    void thumbnailSizeChanged();
+    void scanningChanged();
+    void countChanged();
+    void pendingChanged();
+
+private:
+    struct ScanResult {
+        QVector<WallpaperInfo> items;
+        QStringList directories;
+    };
+
+    static ScanResult scan(const QString &root, int thumbnailSize, const QVector<WallpaperInfo> &known, bool readIndex);
+    void apply(const ScanResult &result);
+    void queueThumbnails();
+    void onThumbnail(const std::shared_ptr<std::atomic_bool> &token, const WallpaperInfo &info);
+    void restart();
+    void saveIndex();
+
+    void updateWatches(const QStringList &directories);
+    void clearWatches();
+    void readEvents();
+
+    int rowOf(const QString &relativePath) const;
+    QString thumbnailPath(const WallpaperInfo &info) const;
+
+    QString m_path;
+    int     m_thumbnailSize = 256;
+    bool    m_scanning = false;
+    bool    m_started = false;
+
+    // Scans and index writes, one at a time
+    QThreadPool m_pool;
+    // Thumbnail decoding, a few at a time
+    QThreadPool m_thumbnailPool;
+    quint64     m_generation = 0;
+    bool        m_rescanQueued = false;
+    bool        m_indexRead = false;
+    // Flipped when path or size change, jobs of the old set bail out
+    std::shared_ptr<std::atomic_bool> m_token;
+
+    // Sorted by relativePath, case insensitive first
+    QVector<WallpaperInfo> m_items;
+    QSet<QString>          m_queued;
+
+    int              m_inotifyFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<int, QString> m_watches;
+    QTimer m_rescanTimer;
+    QTimer m_saveTimer;
+};
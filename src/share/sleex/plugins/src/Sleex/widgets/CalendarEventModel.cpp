@@ -0,0 +1,877 @@
+#include "CalendarEventModel.hpp"
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSet>
+#include <QTimeZone>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+// Fetched around the visible week, moving within it needs no new fetch
+constexpr int FETCH_MONTHS = 3;
+
+// Hard stop for malformed or endless recurrence rules
+constexpr int MAX_RECURRENCE_STEPS = 5000;
+
+constexpr int KHAL_TIMEOUT_MS = 30 * 1000;
+
+QDateTime startOfDay(const QDate &date)
+{
+    return QDateTime(date, QTime(0, 0));
+}
+
+// khal ------------------------------------------------------------------------
+
+QDate parseKhalDate(const QString &text)
+{
+    // khal prints dates in its configured format, the dashboard always used dd/MM/yyyy
+    static const char *formats[] = { "dd/MM/yyyy", "yyyy-MM-dd", "dd.MM.yyyy", "dd/MM/yy" };
+    for (const char *format : formats) {
+        const QDate date = QDate::fromString(text, QString::fromLatin1(format));
+        if (date.isValid()) return date;
+    }
+    return QDate();
+}
+
+QTime parseKhalTime(const QString &text)
+{
+    static const char *formats[] = { "HH:mm", "H:mm", "hh:mm AP", "h:mm AP" };
+    for (const char *format : formats) {
+        const QTime time = QTime::fromString(text, QString::fromLatin1(format));
+        if (time.isValid()) return time;
+    }
+    return QTime();
+}
+
+QVector<CalendarOccurrence> fetchKhal(QDate from, QDate to, const std::shared_ptr<std::atomic_bool> &cancel,
+                                      bool *available, QString *error)
+{
+    QVector<CalendarOccurrence> events;
+
+    // khal expands recurrences itself, one JSON array per listed day
+    QProcess khal;
+    khal.start(QStringLiteral("khal"), {
+        "list",
+        "--json", "title",
+        "--json", "start-date", "--json", "start-time",
+        "--json", "end-date", "--json", "end-time",
+        "--json", "all-day",
+        "--json", "uid",
+        from.toString("dd/MM/yyyy"), to.toString("dd/MM/yyyy")
+    });
+    if (!khal.waitForStarted()) {
+        *available = false;
+        *error = QStringLiteral("khal is not installed");
+        return events;
+    }
+
+    int waited = 0;
+    while (!khal.waitForFinished(100)) {
+        waited += 100;
+        if (cancel->load() || waited >= KHAL_TIMEOUT_MS) {
+            khal.kill();
+            khal.waitForFinished();
+            *error = cancel->load() ? QString() : QStringLiteral("khal timed out");
+            return events;
+        }
+    }
+
+    if (khal.exitStatus() != QProcess::NormalExit || khal.exitCode() != 0) {
+        *available = false;
+        *error = QString::fromUtf8(khal.readAllStandardError()).trimmed();
+        return events;
+    }
+
+    // Events spanning several days are listed under each of them
+    QSet<QString> seen;
+    const QList<QByteArray> lines = khal.readAllStandardOutput().split('\n');
+    for (const QByteArray &line : lines) {
+        const QJsonArray dayEvents = QJsonDocument::fromJson(line.trimmed()).array();
+        for (const QJsonValue &value : dayEvents) {
+            const QJsonObject entry = value.toObject();
+
+            const QDate startDate = parseKhalDate(entry.value("start-date").toString());
+            if (!startDate.isValid()) continue;
+            QDate endDate = parseKhalDate(entry.value("end-date").toString());
+            if (!endDate.isValid()) endDate = startDate;
+
+            const QTime startTime = parseKhalTime(entry.value("start-time").toString());
+            const QTime endTime = parseKhalTime(entry.value("end-time").toString());
+            const QString allDayText = entry.value("all-day").toString();
+
+            CalendarOccurrence event;
+            event.uid = entry.value("uid").toString();
+            event.title = entry.value("title").toString();
+            event.allDay = allDayText.compare("True", Qt::CaseInsensitive) == 0 || !startTime.isValid();
+            if (event.allDay) {
+                event.start = startOfDay(startDate);
+                event.end = startOfDay(endDate.addDays(1));
+            } else {
+                event.start = QDateTime(startDate, startTime);
+                event.end = endTime.isValid() ? QDateTime(endDate, endTime) : QDateTime(startDate, QTime(23, 59));
+                if (event.end < event.start) event.end = event.start;
+            }
+
+            const QString key = event.uid + event.start.toString(Qt::ISODate) + event.end.toString(Qt::ISODate);
+            if (seen.contains(key)) continue;
+            seen.insert(key);
+            events.append(event);
+        }
+    }
+
+    *available = true;
+    return events;
+}
+
+// iCalendar -------------------------------------------------------------------
+
+struct IcsProperty {
+    QString name;
+    QHash<QString, QString> params;
+    QString value;
+};
+
+struct RecurrenceRule {
+    QString   freq;
+    int       interval = 1;
+    int       count = -1;
+    QDateTime until;
+    // (ordinal, weekday), ordinal 0 means every such weekday
+    QVector<QPair<int, int>> byDay;
+};
+
+struct VEvent {
+    QString   uid;
+    QString   summary;
+    QDateTime start;
+    QDateTime end;
+    bool      allDay = false;
+    bool      hasRule = false;
+    bool      cancelled = false;
+    RecurrenceRule rule;
+    QDateTime recurrenceId;
+    QSet<qint64> exdates;
+};
+
+IcsProperty parseProperty(const QString &line)
+{
+    IcsProperty property;
+
+    // Parameter values may be quoted and contain ':' or ';'
+    int colon = -1;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line.at(i);
+        if (c == '"') quoted = !quoted;
+        else if (c == ':' && !quoted) { colon = i; break; }
+    }
+    if (colon < 0) return property;
+
+    property.value = line.mid(colon + 1);
+    const QStringList parts = line.left(colon).split(';');
+    property.name = parts.first().toUpper();
+    for (int i = 1; i < parts.size(); ++i) {
+        const int eq = parts.at(i).indexOf('=');
+        if (eq < 0) continue;
+        QString value = parts.at(i).mid(eq + 1);
+        if (value.startsWith('"') && value.endsWith('"')) value = value.mid(1, value.size() - 2);
+        property.params.insert(parts.at(i).left(eq).toUpper(), value);
+    }
+    return property;
+}
+
+QString unescapeText(const QString &text)
+{
+    QString out;
+    out.reserve(text.size());
+    for (int i = 0; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (c != '\\' || i + 1 >= text.size()) {
+            out.append(c);
+            continue;
+        }
+        const QChar next = text.at(++i);
+        out.append((next == 'n' || next == 'N') ? QChar('\n') : next);
+    }
+    return out;
+}
+
+// Keeps the zone the event was written in, recurrences step in wall-clock time there
+QDateTime parseIcsDateTime(const QString &value, const QHash<QString, QString> &params, bool *isDate = nullptr)
+{
+    if (params.value("VALUE") == "DATE" || value.size() == 8) {
+        if (isDate) *isDate = true;
+        return startOfDay(QDate::fromString(value.left(8), "yyyyMMdd"));
+    }
+    if (isDate) *isDate = false;
+
+    QDateTime dateTime = QDateTime::fromString(value.left(15), "yyyyMMdd'T'HHmmss");
+    if (!dateTime.isValid()) return dateTime;
+
+    if (value.endsWith('Z')) {
+        dateTime.setTimeZone(QTimeZone::UTC);
+    } else if (params.contains("TZID")) {
+        const QTimeZone zone(params.value("TZID").toUtf8());
+        if (zone.isValid()) dateTime.setTimeZone(zone);
+    }
+    return dateTime;
+}
+
+qint64 parseDurationSecs(const QString &value)
+{
+    static const QRegularExpression re(
+        QStringLiteral("^([+-])?P(?:(\\d+)W)?(?:(\\d+)D)?(?:T(?:(\\d+)H)?(?:(\\d+)M)?(?:(\\d+)S)?)?$"));
+    const QRegularExpressionMatch m = re.match(value);
+    if (!m.hasMatch()) return 0;
+
+    const qint64 secs = m.captured(2).toLongLong() * 7 * 86400
+        + m.captured(3).toLongLong() * 86400
+        + m.captured(4).toLongLong() * 3600
+        + m.captured(5).toLongLong() * 60
+        + m.captured(6).toLongLong();
+    return m.captured(1) == "-" ? -secs : secs;
+}
+
+int weekdayFromIcs(const QString &code)
+{
+    static const QStringList days = { "MO", "TU", "WE", "TH", "FR", "SA", "SU" };
+    return days.indexOf(code) + 1;
+}
+
+RecurrenceRule parseRule(const QString &value)
+{
+    RecurrenceRule rule;
+    for (const QString &part : value.split(';', Qt::SkipEmptyParts)) {
+        const int eq = part.indexOf('=');
+        if (eq < 0) continue;
+        const QString key = part.left(eq).toUpper();
+        const QString val = part.mid(eq + 1);
+
+        if (key == "FREQ") {
+            rule.freq = val.toUpper();
+        } else if (key == "INTERVAL") {
+            rule.interval = qMax(1, val.toInt());
+        } else if (key == "COUNT") {
+            rule.count = val.toInt();
+        } else if (key == "UNTIL") {
+            rule.until = parseIcsDateTime(val, {});
+            // A date-only UNTIL includes that whole day
+            if (val.size() == 8) rule.until = rule.until.addDays(1).addSecs(-1);
+        } else if (key == "BYDAY") {
+            for (const QString &day : val.split(',', Qt::SkipEmptyParts)) {
+                const int weekday = weekdayFromIcs(day.right(2).toUpper());
+                if (weekday == 0) continue;
+                rule.byDay.append({ day.chopped(2).toInt(), weekday });
+            }
+        }
+    }
+    return rule;
+}
+
+QVector<VEvent> parseIcsFile(const QString &path)
+{
+    QVector<VEvent> events;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return events;
+
+    // Unfold continuation lines first (RFC 5545 3.1)
+    QStringList lines;
+    for (const QByteArray &raw : file.readAll().split('\n')) {
+        QString line = QString::fromUtf8(raw);
+        if (line.endsWith('\r')) line.chop(1);
+        if ((line.startsWith(' ') || line.startsWith('\t')) && !lines.isEmpty())
+            lines.last().append(line.mid(1));
+        else
+            lines.append(line);
+    }
+
+    VEvent event;
+    bool inEvent = false;
+    int nested = 0;
+    bool endIsDuration = false;
+    qint64 durationSecs = 0;
+
+    for (const QString &line : std::as_const(lines)) {
+        if (line.startsWith("BEGIN:", Qt::CaseInsensitive)) {
+            if (line.mid(6).compare("VEVENT", Qt::CaseInsensitive) == 0 && !inEvent) {
+                event = VEvent();
+                inEvent = true;
+                endIsDuration = false;
+                durationSecs = 0;
+            } else if (inEvent) {
+                ++nested; // VALARM and friends
+            }
+            continue;
+        }
+        if (line.startsWith("END:", Qt::CaseInsensitive) && inEvent) {
+            if (nested > 0) {
+                --nested;
+                continue;
+            }
+            inEvent = false;
+            if (!event.start.isValid() || event.cancelled) continue;
+            if (endIsDuration || !event.end.isValid()) {
+                const qint64 secs = endIsDuration ? durationSecs : (event.allDay ? 86400 : 0);
+                event.end = event.start.addSecs(secs);
+            }
+            events.append(event);
+            continue;
+        }
+        if (!inEvent || nested > 0) continue;
+
+        const IcsProperty property = parseProperty(line);
+        if (property.name == "UID") {
+            event.uid = property.value;
+        } else if (property.name == "SUMMARY") {
+            event.summary = unescapeText(property.value);
+        } else if (property.name == "DTSTART") {
+            event.start = parseIcsDateTime(property.value, property.params, &event.allDay);
+        } else if (property.name == "DTEND") {
+            event.end = parseIcsDateTime(property.value, property.params);
+        } else if (property.name == "DURATION") {
+            endIsDuration = true;
+            durationSecs = parseDurationSecs(property.value);
+        } else if (property.name == "RRULE") {
+            event.hasRule = true;
+            event.rule = parseRule(property.value);
+        } else if (property.name == "EXDATE") {
+            for (const QString &value : property.value.split(',', Qt::SkipEmptyParts))
+                event.exdates.insert(parseIcsDateTime(value, property.params).toMSecsSinceEpoch());
+        } else if (property.name == "RECURRENCE-ID") {
+            event.recurrenceId = parseIcsDateTime(property.value, property.params);
+        } else if (property.name == "STATUS") {
+            event.cancelled = property.value.compare("CANCELLED", Qt::CaseInsensitive) == 0;
+        }
+    }
+    return events;
+}
+
+// Nth (or -Nth) given weekday of the month, invalid if the month has none
+QDate nthWeekdayOfMonth(int year, int month, int ordinal, int weekday)
+{
+    const QDate first(year, month, 1);
+    if (ordinal > 0) {
+        const QDate date = first.addDays((weekday - first.dayOfWeek() + 7) % 7 + 7 * (ordinal - 1));
+        return date.month() == month ? date : QDate();
+    }
+    const QDate last = first.addMonths(1).addDays(-1);
+    const QDate date = last.addDays(-((last.dayOfWeek() - weekday + 7) % 7) + 7 * (ordinal + 1));
+    return date.month() == month ? date : QDate();
+}
+
+void expandEvent(const VEvent &event, const QSet<qint64> &overridden,
+                 const QDateTime &windowStart, const QDateTime &windowEnd,
+                 QVector<CalendarOccurrence> &out)
+{
+    const qint64 duration = event.start.secsTo(event.end);
+
+    const auto emitAt = [&](const QDateTime &start) {
+        const qint64 key = start.toMSecsSinceEpoch();
+        if (event.exdates.contains(key) || overridden.contains(key)) return;
+
+        CalendarOccurrence occurrence;
+        occurrence.uid = event.uid;
+        occurrence.title = event.summary;
+        occurrence.allDay = event.allDay;
+        occurrence.start = event.allDay ? start : start.toLocalTime();
+        // Whole days, so a DST change inside the event does not shift its end
+        occurrence.end = event.allDay ? start.addDays(event.start.date().daysTo(event.end.date()))
+                                      : start.addSecs(duration).toLocalTime();
+        if (occurrence.end > windowStart && occurrence.start < windowEnd)
+            out.append(occurrence);
+    };
+
+    if (!event.hasRule) {
+        emitAt(event.start);
+        return;
+    }
+
+    const RecurrenceRule &rule = event.rule;
+    int produced = 0;
+    // Returns false once the rule or the window is exhausted
+    const auto accept = [&](const QDate &date) {
+        const QDateTime start(date, event.start.time(), event.start.timeZone());
+        if (rule.until.isValid() && start > rule.until) return false;
+        if (rule.count >= 0 && produced >= rule.count) return false;
+        if (start >= windowEnd) return false;
+        ++produced;
+        emitAt(start);
+        return true;
+    };
+
+    const QDate first = event.start.date();
+    // Without COUNT, occurrences before the window don't matter: whole
+    // periods ending before it (and before the longest overlap into it) are
+    // skipped arithmetically, however old the series is
+    int firstStep = 0;
+    const QDate from = windowStart.date().addDays(-(duration / 86400 + 2));
+    if (rule.count < 0 && from > first) {
+        qint64 periods = 0;
+        if (rule.freq == "DAILY")
+            periods = first.daysTo(from);
+        else if (rule.freq == "WEEKLY")
+            periods = first.addDays(1 - first.dayOfWeek()).daysTo(from) / 7;
+        else if (rule.freq == "MONTHLY")
+            periods = (from.year() - first.year()) * 12 + from.month() - first.month();
+        else if (rule.freq == "YEARLY")
+            periods = from.year() - first.year();
+        firstStep = int(periods / rule.interval);
+    }
+
+    for (int step = firstStep; step < firstStep + MAX_RECURRENCE_STEPS; ++step) {
+        const int k = step * rule.interval;
+
+        if (rule.freq == "DAILY") {
+            if (!accept(first.addDays(k))) return;
+        } else if (rule.freq == "WEEKLY") {
+            const QDate week = first.addDays(1 - first.dayOfWeek()).addDays(7 * k);
+            QVector<int> weekdays;
+            for (const auto &day : rule.byDay) weekdays.append(day.second);
+            if (weekdays.isEmpty()) weekdays.append(first.dayOfWeek());
+            std::sort(weekdays.begin(), weekdays.end());
+            for (int weekday : std::as_const(weekdays)) {
+                const QDate date = week.addDays(weekday - 1);
+                if (date < first) continue;
+                if (!accept(date)) return;
+            }
+        } else if (rule.freq == "MONTHLY") {
+            const QDate month = QDate(first.year(), first.month(), 1).addMonths(k);
+            if (rule.byDay.isEmpty()) {
+                // Months without that day are skipped, not clamped
+                const QDate date(month.year(), month.month(), first.day());
+                if (date.isValid() && !accept(date)) return;
+                continue;
+            }
+            QVector<QDate> dates;
+            for (const auto &day : rule.byDay) {
+                if (day.first == 0) {
+                    for (int ordinal = 1; ordinal <= 5; ++ordinal) {
+                        const QDate date = nthWeekdayOfMonth(month.year(), month.month(), ordinal, day.second);
+                        if (date.isValid()) dates.append(date);
+                    }
+                } else {
+                    const QDate date = nthWeekdayOfMonth(month.year(), month.month(), day.first, day.second);
+                    if (date.isValid()) dates.append(date);
+                }
+            }
+            std::sort(dates.begin(), dates.end());
+            for (const QDate &date : std::as_const(dates)) {
+                if (date < first) continue;
+                if (!accept(date)) return;
+            }
+        } else if (rule.freq == "YEARLY") {
+            const QDate date(first.year() + k, first.month(), first.day());
+            if (date.isValid() && !accept(date)) return;
+        } else {
+            // Unsupported frequency, show the first occurrence only
+            emitAt(event.start);
+            return;
+        }
+    }
+    qWarning() << "Sleex: recurrence of" << event.uid << "cut off after" << MAX_RECURRENCE_STEPS << "steps";
+}
+
+QVector<CalendarOccurrence> fetchIcs(const QStringList &paths, QDate from, QDate to,
+                                     const std::shared_ptr<std::atomic_bool> &cancel)
+{
+    QVector<VEvent> events;
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, { "*.ics" }, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext() && !cancel->load()) events += parseIcsFile(it.next());
+        } else {
+            events += parseIcsFile(path);
+        }
+    }
+
+    // Instances moved or edited on their own replace the generated ones
+    QHash<QString, QSet<qint64>> overrides;
+    for (const VEvent &event : std::as_const(events)) {
+        if (event.recurrenceId.isValid())
+            overrides[event.uid].insert(event.recurrenceId.toMSecsSinceEpoch());
+    }
+
+    const QDateTime windowStart = startOfDay(from);
+    const QDateTime windowEnd = startOfDay(to.addDays(1));
+    QVector<CalendarOccurrence> out;
+    for (const VEvent &event : std::as_const(events)) {
+        if (cancel->load()) break;
+        const QSet<qint64> none;
+        expandEvent(event, event.recurrenceId.isValid() ? none : overrides.value(event.uid),
+                    windowStart, windowEnd, out);
+    }
+    return out;
+}
+}
+
+bool CalendarEventModel::EventRow::operator==(const EventRow &o) const
+{
+    return event.uid == o.event.uid
+        && event.title == o.event.title
+        && event.start == o.event.start
+        && event.end == o.event.end
+        && event.allDay == o.event.allDay
+        && segmentStart == o.segmentStart
+        && segmentEnd == o.segmentEnd
+        && day == o.day
+        && column == o.column
+        && columnCount == o.columnCount;
+}
+
+CalendarEventModel::CalendarEventModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_dayRows.resize(m_dayCount);
+    // reload() defers the fetch, the properties QML sets right after construction are in by then
+    reload();
+}
+
+CalendarEventModel::~CalendarEventModel()
+{
+    if (m_cancel) m_cancel->store(true);
+    m_pool.waitForDone();
+}
+
+QDate CalendarEventModel::weekStart() const
+{
+    const QDate today = QDate::currentDate();
+    const int daysFromStart = (today.dayOfWeek() - m_firstDayOfWeek + 7) % 7;
+    return today.addDays(-daysFromStart + 7 * m_weekOffset);
+}
+
+void CalendarEventModel::setWeekOffset(int v)
+{
+    if (m_weekOffset == v) return;
+    m_weekOffset = v;
+    emit windowChanged();
+
+    const QDate start = weekStart();
+    if (m_fetchedFrom.isValid() && start >= m_fetchedFrom && start.addDays(m_dayCount) <= m_fetchedTo)
+        relayout();
+    else
+        reload();
+}
+
+void CalendarEventModel::setFirstDayOfWeek(int v)
+{
+    v = qBound(1, v, 7);
+    if (m_firstDayOfWeek == v) return;
+    m_firstDayOfWeek = v;
+    emit windowChanged();
+    relayout();
+}
+
+void CalendarEventModel::setDayCount(int v)
+{
+    v = qMax(1, v);
+    if (m_dayCount == v) return;
+    m_dayCount = v;
+    emit windowChanged();
+    relayout();
+}
+
+void CalendarEventModel::setTimelineStart(int v)
+{
+    if (m_timelineStart == v) return;
+    m_timelineStart = v;
+    emit timelineChanged();
+    if (rowCount() > 0)
+        emit dataChanged(index(0), index(rowCount() - 1), { SlotRole, SpanRole });
+}
+
+void CalendarEventModel::setSlotDuration(int v)
+{
+    v = qMax(1, v);
+    if (m_slotDuration == v) return;
+    m_slotDuration = v;
+    emit timelineChanged();
+    if (rowCount() > 0)
+        emit dataChanged(index(0), index(rowCount() - 1), { SlotRole, SpanRole });
+}
+
+void CalendarEventModel::setIcsPaths(const QStringList &v)
+{
+    if (m_icsPaths == v) return;
+    m_icsPaths = v;
+    emit icsPathsChanged();
+    reload();
+}
+
+void CalendarEventModel::reload()
+{
+    // Setters called in a row (QML initialization) share one fetch
+    if (!m_loading) {
+        m_loading = true;
+        emit loadingChanged();
+    }
+    const quint64 generation = ++m_generation;
+
+    QTimer::singleShot(0, this, [this, generation]() {
+        if (generation != m_generation) return;
+
+        if (m_cancel) m_cancel->store(true);
+        auto cancel = std::make_shared<std::atomic_bool>(false);
+        m_cancel = cancel;
+
+        const QDate from = weekStart().addMonths(-FETCH_MONTHS);
+        const QDate to = weekStart().addMonths(FETCH_MONTHS);
+        const QStringList icsPaths = m_icsPaths;
+
+        m_pool.start([this, cancel, generation, from, to, icsPaths]() {
+            bool available = true;
+            QString error;
+            const QVector<CalendarOccurrence> events = icsPaths.isEmpty()
+                ? fetchKhal(from, to, cancel, &available, &error)
+                : fetchIcs(icsPaths, from, to, cancel);
+            if (cancel->load()) return;
+
+            QMetaObject::invokeMethod(this, [this, generation, events, from, to, available, error]() {
+                onFetched(generation, events, from, to, available, error);
+            }, Qt::QueuedConnection);
+        });
+    });
+}
+
+void CalendarEventModel::onFetched(quint64 generation, const QVector<CalendarOccurrence> &events,
+                                   QDate from, QDate to, bool available, const QString &error)
+{
+    if (generation != m_generation) return;
+
+    m_events = events;
+    std::sort(m_events.begin(), m_events.end(), [](const CalendarOccurrence &a, const CalendarOccurrence &b) {
+        return a.start < b.start;
+    });
+    m_fetchedFrom = from;
+    m_fetchedTo = to;
+
+    if (m_available != available || m_lastError != error) {
+        m_available = available;
+        m_lastError = error;
+        emit availableChanged();
+    }
+
+    relayout();
+
+    m_loading = false;
+    emit loadingChanged();
+}
+
+QVector<CalendarEventModel::EventRow> CalendarEventModel::layoutDay(int day) const
+{
+    const QDate date = weekStart().addDays(day);
+    const QDateTime dayStart = startOfDay(date);
+    const QDateTime dayEnd = startOfDay(date.addDays(1));
+
+    QVector<EventRow> allDay;
+    QVector<EventRow> timed;
+    for (const CalendarOccurrence &event : m_events) {
+        // Sorted by start, nothing later can touch this day
+        if (event.start >= dayEnd) break;
+
+        const bool instant = event.start == event.end;
+        if (instant ? event.start < dayStart : event.end <= dayStart) continue;
+
+        EventRow row;
+        row.event = event;
+        row.day = day;
+        row.segmentStart = qMax(event.start, dayStart);
+        row.segmentEnd = qMin(event.end, dayEnd);
+        (event.allDay ? allDay : timed).append(row);
+    }
+
+    // Interval partitioning: earliest start first, each event takes the
+    // lowest column free at its start. A cluster of transitively overlapping
+    // events shares one column count so their widths line up.
+    std::sort(timed.begin(), timed.end(), [](const EventRow &a, const EventRow &b) {
+        if (a.segmentStart != b.segmentStart) return a.segmentStart < b.segmentStart;
+        return a.segmentEnd > b.segmentEnd;
+    });
+
+    QVector<QDateTime> columnEnds;
+    QDateTime clusterEnd;
+    int clusterBegin = 0;
+    const auto closeCluster = [&](int endIndex) {
+        for (int j = clusterBegin; j < endIndex; ++j)
+            timed[j].columnCount = columnEnds.size();
+        columnEnds.clear();
+        clusterBegin = endIndex;
+    };
+
+    for (int i = 0; i < timed.size(); ++i) {
+        EventRow &row = timed[i];
+        // Zero-length events still take room in the view
+        const QDateTime end = qMax(row.segmentEnd, row.segmentStart.addSecs(60));
+
+        if (i > clusterBegin && row.segmentStart >= clusterEnd)
+            closeCluster(i);
+
+        int column = 0;
+        while (column < columnEnds.size() && columnEnds.at(column) > row.segmentStart) ++column;
+        if (column == columnEnds.size())
+            columnEnds.append(end);
+        else
+            columnEnds[column] = end;
+        row.column = column;
+
+        clusterEnd = (i == clusterBegin) ? end : qMax(clusterEnd, end);
+    }
+    closeCluster(timed.size());
+
+    return allDay + timed;
+}
+
+void CalendarEventModel::relayout()
+{
+    const int days = qMax<int>(m_dayRows.size(), m_dayCount);
+    m_dayRows.resize(days);
+
+    int offset = 0;
+    for (int day = 0; day < days; ++day) {
+        const QVector<EventRow> rows = day < m_dayCount ? layoutDay(day) : QVector<EventRow>();
+        QVector<EventRow> &current = m_dayRows[day];
+
+        if (current != rows) {
+            if (current.size() == rows.size()) {
+                current = rows;
+                emit dataChanged(index(offset), index(offset + rows.size() - 1));
+            } else {
+                if (!current.isEmpty()) {
+                    beginRemoveRows(QModelIndex(), offset, offset + current.size() - 1);
+                    current.clear();
+                    endRemoveRows();
+                }
+                if (!rows.isEmpty()) {
+                    beginInsertRows(QModelIndex(), offset, offset + rows.size() - 1);
+                    current = rows;
+                    endInsertRows();
+                }
+            }
+        }
+        offset += current.size();
+    }
+    m_dayRows.resize(m_dayCount);
+
+    rebuildDays();
+}
+
+void CalendarEventModel::rebuildDays()
+{
+    const QLocale english(QLocale::English);
+    const QDate start = weekStart();
+
+    QVariantList days;
+    int earliest = -1;
+    for (int day = 0; day < m_dayCount; ++day) {
+        const QDate date = start.addDays(day);
+
+        QVariantList events;
+        for (const EventRow &row : std::as_const(m_dayRows.at(day))) {
+            events.append(eventData(row));
+            if (row.event.allDay) continue;
+            const int minute = row.segmentStart.time().msecsSinceStartOfDay() / 60000;
+            if (earliest == -1 || minute < earliest) earliest = minute;
+        }
+
+        days.append(QVariantMap {
+            { "name", english.dayName(date.dayOfWeek()) },
+            { "date", date.toString(Qt::ISODate) },
+            { "events", events }
+        });
+    }
+
+    if (days == m_days && earliest == m_earliestStartMinute) return;
+    m_days = days;
+    m_earliestStartMinute = earliest;
+    emit daysChanged();
+}
+
+QVariantMap CalendarEventModel::eventData(const EventRow &row)
+{
+    // Same shape the QML service used to build, for the edit and remove dialogs
+    const bool endsAtMidnight = row.segmentEnd.time() == QTime(0, 0) && row.segmentEnd > row.segmentStart;
+    return {
+        { "uid", row.event.uid },
+        { "title", row.event.title },
+        { "date", row.event.start.date().toString(Qt::ISODate) },
+        { "start", row.event.allDay ? QStringLiteral("00:00") : row.segmentStart.toString("HH:mm") },
+        { "end", row.event.allDay || endsAtMidnight ? QStringLiteral("23:59") : row.segmentEnd.toString("HH:mm") },
+        { "startDate", row.event.start },
+        { "endDate", row.event.end },
+        { "allDay", row.event.allDay }
+    };
+}
+
+int CalendarEventModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    int count = 0;
+    for (const QVector<EventRow> &rows : m_dayRows) count += rows.size();
+    return count;
+}
+
+QVariant CalendarEventModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+
+    int row = index.row();
+    const EventRow *entry = nullptr;
+    for (const QVector<EventRow> &rows : m_dayRows) {
+        if (row < rows.size()) {
+            entry = &rows.at(row);
+            break;
+        }
+        row -= rows.size();
+    }
+    if (!entry) return QVariant();
+
+    const double slotMinutes = m_slotDuration;
+    const double startMinute = entry->segmentStart.time().msecsSinceStartOfDay() / 60000.0;
+
+    switch (role) {
+        case UidRole: return entry->event.uid;
+        case TitleRole: return entry->event.title;
+        case StartRole: return entry->event.start;
+        case EndRole: return entry->event.end;
+        case StartTimeRole: return entry->segmentStart.toString("HH:mm");
+        case EndTimeRole: return entry->segmentEnd.toString("HH:mm");
+        case DateRole: return entry->segmentStart.date().toString(Qt::ISODate);
+        case AllDayRole: return entry->event.allDay;
+        case DayRole: return entry->day;
+        case SlotRole: return (startMinute - m_timelineStart) / slotMinutes;
+        case SpanRole: return entry->segmentStart.secsTo(entry->segmentEnd) / 60.0 / slotMinutes;
+        case ColumnRole: return entry->column;
+        case ColumnCountRole: return entry->columnCount;
+        case EventDataRole: return eventData(*entry);
+        default: return QVariant();
+    }
+}
+
+QHash<int, QByteArray> CalendarEventModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[UidRole] = "uid";
+    roles[TitleRole] = "title";
+    roles[StartRole] = "startDate";
+    roles[EndRole] = "endDate";
+    roles[StartTimeRole] = "startTime";
+    roles[EndTimeRole] = "endTime";
+    roles[DateRole] = "date";
+    roles[AllDayRole] = "allDay";
+    roles[DayRole] = "day";
+    roles[SlotRole] = "slot";
+    roles[SpanRole] = "span";
+    roles[ColumnRole] = "column";
+    roles[ColumnCountRole] = "columnCount";
+    roles[EventDataRole] = "eventData";
+    return roles;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QDateTime>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+#include <atomic>
+#include <memory>
+
+struct CalendarOccurrence {
+    QString   uid;
+    QString   title;
+    QDateTime start;
+    // Exclusive, all-day events end at midnight after their last day
+    QDateTime end;
+    bool      allDay = false;
+};
+
+// Events of the visible week for the dashboard time table. khal output (or
+// .ics files when icsPaths is set) is read and expanded on a worker thread,
+// then every day is laid out with an interval-partitioning sweep: overlapping
+// events get side-by-side columns. Rows carry their geometry in slot units,
+// the delegate only multiplies by its pixel sizes. When new data arrives only
+// the days whose rows differ are touched.
+class CalendarEventModel : public QAbstractListModel {
+    Q_OBJECT
+    QML_ELEMENT
+
+    // Weeks relative to the current one, and the first weekday (1 = Monday ... 7 = Sunday)
+    Q_PROPERTY(int  weekOffset     READ weekOffset     WRITE setWeekOffset     NOTIFY windowChanged FINAL)
+    Q_PROPERTY(int  firstDayOfWeek READ firstDayOfWeek WRITE setFirstDayOfWeek NOTIFY windowChanged FINAL)
+    Q_PROPERTY(int  dayCount       READ dayCount       WRITE setDayCount       NOTIFY windowChanged FINAL)
+    Q_PROPERTY(QDate weekStart     READ weekStart                              NOTIFY windowChanged FINAL)
+
+    // Timeline the slot / span roles are measured against, in minutes
+    Q_PROPERTY(int timelineStart READ timelineStart WRITE setTimelineStart NOTIFY timelineChanged FINAL)
+    Q_PROPERTY(int slotDuration  READ slotDuration  WRITE setSlotDuration  NOTIFY timelineChanged FINAL)
+
+    // Read .ics files / vdir directories directly instead of asking khal
+    Q_PROPERTY(QStringList icsPaths READ icsPaths WRITE setIcsPaths NOTIFY icsPathsChanged FINAL)
+
+    Q_PROPERTY(bool    loading   READ loading   NOTIFY loadingChanged FINAL)
+    Q_PROPERTY(bool    available READ available NOTIFY availableChanged FINAL)
+    Q_PROPERTY(QString lastError READ lastError NOTIFY availableChanged FINAL)
+
+    // One entry per visible day: { name, date, events: [eventData...] }
+    Q_PROPERTY(QVariantList days READ days NOTIFY daysChanged FINAL)
+    // Minutes from midnight of the earliest timed event in the window, -1 if none
+    Q_PROPERTY(int earliestStartMinute READ earliestStartMinute NOTIFY daysChanged FINAL)
+
+public:
+    enum Roles {
+        UidRole = Qt::UserRole + 1,
+        TitleRole,
+        StartRole,
+        EndRole,
+        StartTimeRole,
+        EndTimeRole,
+        DateRole,
+        AllDayRole,
+        DayRole,
+        SlotRole,
+        SpanRole,
+        ColumnRole,
+        ColumnCountRole,
+        EventDataRole
+    };
+
+    explicit CalendarEventModel(QObject *parent = nullptr);
+    ~CalendarEventModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int   weekOffset()     const { return m_weekOffset; }
+    int   firstDayOfWeek() const { return m_firstDayOfWeek; }
+    int   dayCount()       const { return m_dayCount; }
+    QDate weekStart()      const;
+    void setWeekOffset(int v);
+    void setFirstDayOfWeek(int v);
+    void setDayCount(int v);
+
+    int timelineStart() const { return m_timelineStart; }
+    int slotDuration()  const { return m_slotDuration; }
+    void setTimelineStart(int v);
+    void setSlotDuration(int v);
+
+    QStringList icsPaths() const { return m_icsPaths; }
+    void setIcsPaths(const QStringList &v);
+
+    bool    loading()   const { return m_loading; }
+    bool    available() const { return m_available; }
+    QString lastError() const { return m_lastError; }
+
+    QVariantList days() const { return m_days; }
+    int earliestStartMinute() const { return m_earliestStartMinute; }
+
+    Q_INVOKABLE void reload();
+    Q_INVOKABLE void nextWeek() { setWeekOffset(m_weekOffset + 1); }
+    Q_INVOKABLE void previousWeek() { setWeekOffset(m_weekOffset - 1); }
+
+signals:
+    void windowChanged();
+    void timelineChanged();
+    void icsPathsChanged();
+    void loadingChanged();
+    void availableChanged();
+    void daysChanged();
+
+private:
+    struct EventRow {
+        CalendarOccurrence event;
+        // Part of the event falling on this day
+        QDateTime segmentStart;
+        QDateTime segmentEnd;
+        int   day = 0;
+        int   column = 0;
+        int   columnCount = 1;
+
+        bool operator==(const EventRow &o) const;
+    };
+
+    void onFetched(quint64 generation, const QVector<CalendarOccurrence> &events,
+                   QDate from, QDate to, bool available, const QString &error);
+    void relayout();
+    QVector<EventRow> layoutDay(int day) const;
+    void rebuildDays();
+    static QVariantMap eventData(const EventRow &row);
+
+    int m_weekOffset     = 0;
+    int m_firstDayOfWeek = Qt::Monday;
+    int m_dayCount       = 7;
+    int m_timelineStart  = 0;
+    int m_slotDuration   = 60;
+    QStringList m_icsPaths;
+
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic_bool> m_cancel;
+    quint64 m_generation = 0;
+    bool    m_loading = false;
+    bool    m_available = false;
+    QString m_lastError;
+
+    // Everything fetched, the window is cut from it without going back to disk
+    QVector<CalendarOccurrence> m_events;
+    QDate m_fetchedFrom;
+    QDate m_fetchedTo;
+
+    // Visible rows grouped per day, flattened in order for the model
+    QVector<QVector<EventRow>> m_dayRows;
+    QVariantList m_days;
+    int m_earliestStartMinute = -1;
+};
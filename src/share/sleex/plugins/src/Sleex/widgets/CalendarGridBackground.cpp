@@ -1,10 +1,19 @@
 #include "CalendarGridBackground.hpp"
+#include <QFontMetricsF>
+#include <QGuiApplication>
 #include <QPainter>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
 #include <QTime>
+#include <QtMath>
 
 CalendarGridBackground::CalendarGridBackground(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+    : QQuickItem(parent)
 {
+    setFlag(ItemHasContents, true);
+
     m_gridLineColor = QColor(128, 128, 128, 153); // ~0.6 opacity, overridden by QML
     m_labelColor    = QColor(128, 128, 128);
     rebuildLabelCache();
@@ -17,6 +26,7 @@ void CalendarGridBackground::setDayCount(int v)
     m_dayCount = v;
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
     update();
 }
 
@@ -26,6 +36,7 @@ void CalendarGridBackground::setDayColumnWidth(qreal v)
     m_dayColumnWidth = v;
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
     update();
 }
 
@@ -35,6 +46,8 @@ void CalendarGridBackground::setTimeColumnWidth(qreal v)
     m_timeColumnWidth = v;
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
+    m_labelsDirty = true;
     update();
 }
 
@@ -44,6 +57,7 @@ void CalendarGridBackground::setColumnSpacing(qreal v)
     m_spacing = v;
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
     update();
 }
 
@@ -53,6 +67,8 @@ void CalendarGridBackground::setSlotHeight(qreal v)
     m_slotHeight = v;
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
+    m_labelsDirty = true;
     update();
 }
 
@@ -63,6 +79,7 @@ void CalendarGridBackground::setTotalSlots(int v)
     rebuildLabelCache();
     recalcImplicitSize();
     emit layoutChanged();
+    m_linesDirty = true;
     update();
 }
 
@@ -115,6 +132,7 @@ void CalendarGridBackground::setLabelColor(const QColor &c)
     if (m_labelColor == c) return;
     m_labelColor = c;
     emit styleChanged();
+    m_labelsDirty = true;
     update();
 }
 
@@ -134,41 +152,122 @@ void CalendarGridBackground::rebuildLabelCache()
         const int totalMinutes = m_startMinute + i * m_slotDuration;
         const int hour = (m_startHour + totalMinutes / 60) % 24;
         const int minute = totalMinutes % 60;
-        m_labelCache.append(QTime(hour, minute).toString(m_timeFormat));
+
+        QStaticText label(QTime(hour, minute).toString(m_timeFormat));
+        label.setTextFormat(Qt::PlainText);
+        label.prepare(QTransform(), QGuiApplication::font());
+        m_labelCache.append(label);
+    }
+    m_labelsDirty = true;
+}
+
+void CalendarGridBackground::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    // The label texture is rasterized at the window's pixel ratio
+    if (change == ItemDevicePixelRatioHasChanged || change == ItemSceneChange) {
+        m_labelsDirty = true;
+        update();
     }
+    QQuickItem::itemChange(change, value);
 }
 
-void CalendarGridBackground::paint(QPainter *painter)
+QSGNode *CalendarGridBackground::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
-    painter->setRenderHint(QPainter::Antialiasing, false);
+    // Root with two children: the gridline node, then the label image node
+    QSGNode *root = oldNode;
+    QSGGeometryNode *lines = nullptr;
+    QSGImageNode *labels = nullptr;
+
+    if (!root) {
+        root = new QSGNode;
+
+        lines = new QSGGeometryNode;
+        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawLines);
+        geometry->setLineWidth(1);
+        lines->setGeometry(geometry);
+        lines->setMaterial(new QSGFlatColorMaterial);
+        lines->setFlags(QSGNode::OwnsGeometry | QSGNode::OwnsMaterial);
+        root->appendChildNode(lines);
+
+        labels = window()->createImageNode();
+        labels->setOwnsTexture(true);
+        root->appendChildNode(labels);
+
+        m_linesDirty = true;
+        m_labelsDirty = true;
+    } else {
+        lines = static_cast<QSGGeometryNode *>(root->firstChild());
+        labels = static_cast<QSGImageNode *>(lines->nextSibling());
+    }
 
     const qreal gridLeft = m_timeColumnWidth + m_spacing;
-    const qreal gridWidth = m_dayCount > 0
-        ? m_dayCount * m_dayColumnWidth + (m_dayCount - 1) * m_spacing
-        : 0;
     const qreal gridHeight = m_totalSlots * m_slotHeight;
 
-    // Hour gridlines, one draw call each instead of one Rectangle Item each
-    QPen linePen(m_gridLineColor, 1);
-    painter->setPen(linePen);
-    for (int i = 0; i < m_totalSlots; ++i) {
-        const qreal y = i * m_slotHeight;
-        painter->drawLine(QPointF(gridLeft, y), QPointF(gridLeft + gridWidth, y));
+    auto *material = static_cast<QSGFlatColorMaterial *>(lines->material());
+    if (material->color() != m_gridLineColor) {
+        material->setColor(m_gridLineColor);
+        lines->markDirty(QSGNode::DirtyMaterial);
     }
 
-    // Day-column separators
-    for (int d = 0; d <= m_dayCount; ++d) {
-        const qreal x = gridLeft + d * (m_dayColumnWidth + m_spacing) - (d > 0 ? m_spacing : 0);
-        painter->drawLine(QPointF(x, 0), QPointF(x, gridHeight));
+    if (m_linesDirty) {
+        const qreal gridWidth = m_dayCount > 0
+            ? m_dayCount * m_dayColumnWidth + (m_dayCount - 1) * m_spacing
+            : 0;
+
+        QSGGeometry *geometry = lines->geometry();
+        geometry->allocate(2 * (m_totalSlots + m_dayCount + 1));
+        QSGGeometry::Point2D *v = geometry->vertexDataAsPoint2D();
+
+        // Half-pixel offsets keep the 1px lines on the pixel grid like the old
+        // non-antialiased QPainter lines
+        for (int i = 0; i < m_totalSlots; ++i) {
+            const float y = i * m_slotHeight + 0.5f;
+            (v++)->set(gridLeft, y);
+            (v++)->set(gridLeft + gridWidth, y);
+        }
+
+        // Day-column separators
+        for (int d = 0; d <= m_dayCount; ++d) {
+            const float x = gridLeft + d * (m_dayColumnWidth + m_spacing) - (d > 0 ? m_spacing : 0) + 0.5f;
+            (v++)->set(x, 0);
+            (v++)->set(x, gridHeight);
+        }
+
+        lines->markDirty(QSGNode::DirtyGeometry);
+        m_linesDirty = false;
     }
 
-    // Hour labels in the time gutter, using the pre-formatted cache.
-    painter->setPen(m_labelColor);
-    QFont f = painter->font();
-    painter->setFont(f);
-    for (int i = 0; i < m_labelCache.size(); ++i) {
-        const qreal y = i * m_slotHeight - f.pixelSize() / 2.0;
-        const QRectF labelRect(0, y, m_timeColumnWidth, f.pixelSize() * 1.5);
-        painter->drawText(labelRect, Qt::AlignHCenter | Qt::AlignTop, m_labelCache.at(i));
+    if (m_labelsDirty) {
+        const qreal dpr = window()->effectiveDevicePixelRatio();
+        const QSize size(qCeil(m_timeColumnWidth * dpr), qCeil(gridHeight * dpr));
+
+        if (size.isEmpty()) {
+            labels->setRect(QRectF());
+        } else {
+            QImage image(size, QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(dpr);
+            image.fill(Qt::transparent);
+
+            // The static texts are already shaped, this is only rasterization
+            const QFont font = QGuiApplication::font();
+            const qreal lineHeight = QFontMetricsF(font).height();
+            QPainter painter(&image);
+            painter.setPen(m_labelColor);
+            painter.setFont(font);
+            for (int i = 0; i < m_labelCache.size(); ++i) {
+                const QStaticText &label = m_labelCache.at(i);
+                const qreal x = (m_timeColumnWidth - label.size().width()) / 2;
+                const qreal y = i * m_slotHeight - lineHeight / 2;
+                painter.drawStaticText(QPointF(x, y), label);
+            }
+            painter.end();
+
+            labels->setTexture(window()->createTextureFromImage(image));
+            labels->setRect(0, 0, m_timeColumnWidth, gridHeight);
+        }
+        m_labelsDirty = false;
     }
-}
\ No newline at end of file
+
+    return root;
+}
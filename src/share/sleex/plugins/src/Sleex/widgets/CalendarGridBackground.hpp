@@ -1,10 +1,14 @@
 #pragma once
 
-#include <QQuickPaintedItem>
+#include <QQuickItem>
 #include <QColor>
+#include <QStaticText>
 #include <QtQml/qqmlregistration.h>
 
-class CalendarGridBackground : public QQuickPaintedItem {
+// Gridlines are one line-list geometry node, so layout changes only move
+// vertices. Hour labels are laid out once as QStaticText and rasterized into
+// a texture that is only rebuilt when the labels or their style change.
+class CalendarGridBackground : public QQuickItem {
     Q_OBJECT
     QML_ELEMENT
 
@@ -26,8 +30,6 @@ class CalendarGridBackground : public QQuickPaintedItem {
 public:
     explicit CalendarGridBackground(QQuickItem *parent = nullptr);
 
-    void paint(QPainter *painter) override;
-
     int   dayCount()        const { return m_dayCount; }
     qreal dayColumnWidth()  const { return m_dayColumnWidth; }
     qreal timeColumnWidth() const { return m_timeColumnWidth; }
@@ -58,6 +60,10 @@ signals:
     void layoutChanged();
     void styleChanged();
 
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+
 private:
     void recalcImplicitSize();
 
@@ -77,5 +83,9 @@ private:
     QColor  m_gridLineColor;
     QColor  m_labelColor;
 
-    QVector<QString> m_labelCache;
+    QVector<QStaticText> m_labelCache;
+
+    // Scene graph state, consumed by updatePaintNode()
+    bool m_linesDirty  = true;
+    bool m_labelsDirty = true;
 };
\ No newline at end of file
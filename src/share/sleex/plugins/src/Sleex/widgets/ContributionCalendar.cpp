@@ -1,9 +1,43 @@
 #include "ContributionCalendar.hpp"
-#include <QPainter>
 #include <QHoverEvent>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+
+namespace {
+// Segments per rounded corner, plenty for the few pixels of radius used here
+constexpr int CORNER_SEGMENTS = 3;
+
+// Each cell is a centre vertex fanned to an inner ring, plus an outer ring
+// half a pixel out that fades to transparent for antialiased edges
+int perimeterFor(int radius)
+{
+    return radius > 0 ? 4 * (CORNER_SEGMENTS + 1) : 4;
+}
+
+int verticesPerCell(int perimeter)
+{
+    return 1 + 2 * perimeter;
+}
+
+int indicesPerCell(int perimeter)
+{
+    return 9 * perimeter;
+}
+
+// QSGVertexColorMaterial expects premultiplied colours
+void setVertexColor(QSGGeometry::ColoredPoint2D &v, const QColor &c)
+{
+    const int a = c.alpha();
+    v.r = static_cast<uchar>(c.red()   * a / 255);
+    v.g = static_cast<uchar>(c.green() * a / 255);
+    v.b = static_cast<uchar>(c.blue()  * a / 255);
+    v.a = static_cast<uchar>(a);
+}
+}
 
 ContributionCalendar::ContributionCalendar(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+    : QQuickItem(parent)
 {
     // Sensible defaults, QML will override these
     m_colors[0] = QColor(45,  45,  45);
@@ -12,6 +46,7 @@ ContributionCalendar::ContributionCalendar(QQuickItem *parent)
     m_colors[3] = QColor(38, 166,  65);
     m_colors[4] = QColor(57, 211,  83);
 
+    setFlag(ItemHasContents, true);
     setAcceptHoverEvents(true);
 
     recalcImplicitSize();
@@ -22,6 +57,56 @@ void ContributionCalendar::setContributions(const QVariantList &v)
     if (m_contributions == v) return;
     m_contributions = v;
     emit contributionsChanged();
+    if (!m_source) loadContributionLevels();
+}
+
+void ContributionCalendar::loadContributionLevels()
+{
+    // Decoded once here instead of per cell on every frame
+    m_levels.fill(0);
+    const int count = qMin<int>(m_contributions.size(), CELLS);
+    for (int i = 0; i < count; ++i) {
+        const QVariantMap entry = m_contributions.at(i).toMap();
+        m_levels[i] = static_cast<uint8_t>(qBound(0, entry.value(QStringLiteral("level"), 0).toInt(), 4));
+    }
+
+    m_colorsDirty = true;
+    update();
+}
+
+void ContributionCalendar::setSource(GithubContributions *source)
+{
+    if (m_source == source) return;
+    if (m_source) m_source->disconnect(this);
+
+    m_source = source;
+    if (m_source)
+        connect(m_source, &GithubContributions::contributionsChanged, this, &ContributionCalendar::loadSourceLevels);
+
+    if (m_source)
+        loadSourceLevels();
+    else
+        loadContributionLevels();
+    emit sourceChanged();
+}
+
+void ContributionCalendar::loadSourceLevels()
+{
+    if (!m_source) return;
+
+    // Levels are already computed by the service, just copy them into the cells
+    m_levels.fill(0);
+    const QVector<ContributionDay> &days = m_source->days();
+    const int count = qMin<int>(days.size(), CELLS);
+    for (int i = 0; i < count; ++i)
+        m_levels[i] = days.at(i).level;
+
+    if (m_hoveredIndex >= 0) {
+        m_hoveredTooltip = tooltipFor(m_hoveredIndex);
+        emit hoveredChanged();
+    }
+
+    m_colorsDirty = true;
     update();
 }
 
@@ -29,6 +114,7 @@ void ContributionCalendar::setColor(int level, const QColor &c)
 {
     if (m_colors[level] == c) return;
     m_colors[level] = c;
+    m_colorsDirty = true;
     emit colorsChanged();
     update();
 }
@@ -37,6 +123,7 @@ void ContributionCalendar::setCellSize(int s)
 {
     if (m_cellSize == s) return;
     m_cellSize = s;
+    m_geometryDirty = true;
     recalcImplicitSize();
     emit layoutChanged();
     update();
@@ -46,6 +133,7 @@ void ContributionCalendar::setGap(int g)
 {
     if (m_gap == g) return;
     m_gap = g;
+    m_geometryDirty = true;
     recalcImplicitSize();
     emit layoutChanged();
     update();
@@ -55,6 +143,7 @@ void ContributionCalendar::setRadius(int r)
 {
     if (m_radius == r) return;
     m_radius = r;
+    m_geometryDirty = true;
     emit layoutChanged();
     update();
 }
@@ -68,45 +157,126 @@ void ContributionCalendar::recalcImplicitSize()
 }
 
 
-void ContributionCalendar::paint(QPainter *painter)
+QSGNode *ContributionCalendar::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
-    painter->setRenderHint(QPainter::Antialiasing, m_radius > 0);
-    painter->setPen(Qt::NoPen);
-
-    const int stride = m_cellSize + m_gap;
-
-    for (int col = 0; col < COLS; ++col) {
-        for (int row = 0; row < ROWS; ++row) {
-            const int idx = col * ROWS + row;
+    auto *node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode;
+        node->setMaterial(new QSGVertexColorMaterial);
+        node->setFlags(QSGNode::OwnsMaterial | QSGNode::OwnsGeometry);
+        m_geometryDirty = true;
+    }
 
-            int level = 0;
-            if (idx < m_contributions.size()) {
-                const QVariantMap entry = m_contributions.at(idx).toMap();
-                level = qBound(0, entry.value(QStringLiteral("level"), 0).toInt(), 4);
+    const int perimeter = perimeterFor(m_radius);
+    const int cellVertices = verticesPerCell(perimeter);
+
+    if (m_geometryDirty) {
+        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(),
+                                         CELLS * cellVertices,
+                                         CELLS * indicesPerCell(perimeter),
+                                         QSGGeometry::UnsignedShortType);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+        QSGGeometry::ColoredPoint2D *vertices = geometry->vertexDataAsColoredPoint2D();
+        quint16 *indices = geometry->indexDataAsUShort();
+
+        const int   stride = m_cellSize + m_gap;
+        const float r      = qMin<float>(m_radius, m_cellSize / 2.0f);
+
+        // Outward normal of each perimeter point, shared by every cell
+        QList<QPointF> offsets(perimeter);
+        QList<QPointF> normals(perimeter);
+        if (m_radius > 0) {
+            // Corner arc centres relative to the cell, clockwise from top-left
+            const QPointF corners[4] = {
+                { r, r }, { m_cellSize - r, r },
+                { m_cellSize - r, m_cellSize - r }, { r, m_cellSize - r }
+            };
+            for (int c = 0; c < 4; ++c) {
+                for (int s = 0; s <= CORNER_SEGMENTS; ++s) {
+                    const qreal angle = M_PI + c * M_PI_2 + s * M_PI_2 / CORNER_SEGMENTS;
+                    const QPointF normal(qCos(angle), qSin(angle));
+                    const int i = c * (CORNER_SEGMENTS + 1) + s;
+                    normals[i] = normal;
+                    offsets[i] = corners[c] + normal * r;
+                }
             }
+        } else {
+            // Square corners move diagonally so both edges shift by the fringe width
+            const QPointF corners[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+            for (int c = 0; c < 4; ++c) {
+                offsets[c] = corners[c] * m_cellSize;
+                normals[c] = corners[c] * 2 - QPointF(1, 1);
+            }
+        }
 
-            QColor color = m_colors[level];
-
-            if (idx == m_hoveredIndex)
-                color = color.lighter(160);
-
-            painter->setBrush(color);
+        for (int cell = 0; cell < CELLS; ++cell) {
+            const QPointF origin((cell / ROWS) * stride, (cell % ROWS) * stride);
+            QSGGeometry::ColoredPoint2D *v = vertices + cell * cellVertices;
+            quint16 *idx = indices + cell * indicesPerCell(perimeter);
+            const int base = cell * cellVertices;
+
+            const QPointF centre = origin + QPointF(m_cellSize, m_cellSize) / 2;
+            v[0].set(centre.x(), centre.y(), 0, 0, 0, 0);
+            for (int i = 0; i < perimeter; ++i) {
+                const QPointF inner = origin + offsets[i] - normals[i] * 0.5;
+                const QPointF outer = origin + offsets[i] + normals[i] * 0.5;
+                v[1 + i].set(inner.x(), inner.y(), 0, 0, 0, 0);
+                v[1 + perimeter + i].set(outer.x(), outer.y(), 0, 0, 0, 0);
+
+                const int next = (i + 1) % perimeter;
+                // Fill
+                *idx++ = base;
+                *idx++ = base + 1 + i;
+                *idx++ = base + 1 + next;
+                // Fringe quad
+                *idx++ = base + 1 + i;
+                *idx++ = base + 1 + perimeter + i;
+                *idx++ = base + 1 + next;
+                *idx++ = base + 1 + next;
+                *idx++ = base + 1 + perimeter + i;
+                *idx++ = base + 1 + perimeter + next;
+            }
+        }
 
-            const QRectF rect(
-                col * stride,
-                row * stride,
-                m_cellSize,
-                m_cellSize
-            );
+        node->setGeometry(geometry);
+        node->markDirty(QSGNode::DirtyGeometry);
+        m_geometryDirty = false;
+        m_colorsDirty = true;
+    }
 
-            if (m_radius > 0)
-                painter->drawRoundedRect(rect, m_radius, m_radius);
-            else
-                painter->fillRect(rect, color);
-        }
+    // Only the centre and inner ring carry colour, the outer ring stays transparent
+    const auto writeCellColor = [&](int cell) {
+        QColor color = m_colors[m_levels[cell]];
+        if (cell == m_hoveredIndex)
+            color = color.lighter(160);
+
+        QSGGeometry::ColoredPoint2D *v = node->geometry()->vertexDataAsColoredPoint2D() + cell * cellVertices;
+        for (int i = 0; i <= perimeter; ++i)
+            setVertexColor(v[i], color);
+    };
+
+    if (m_colorsDirty) {
+        for (int cell = 0; cell < CELLS; ++cell)
+            writeCellColor(cell);
+        m_colorsDirty = false;
+        m_dirtyCells.clear();
+        node->markDirty(QSGNode::DirtyGeometry);
+    } else if (!m_dirtyCells.isEmpty()) {
+        for (int cell : std::as_const(m_dirtyCells))
+            writeCellColor(cell);
+        m_dirtyCells.clear();
+        node->markDirty(QSGNode::DirtyGeometry);
     }
+
+    return node;
 }
 
+void ContributionCalendar::markCellDirty(int index)
+{
+    if (index >= 0 && index < CELLS && !m_dirtyCells.contains(index))
+        m_dirtyCells.append(index);
+}
 
 int ContributionCalendar::cellIndexAt(const QPointF &pos) const
 {
@@ -129,31 +299,46 @@ void ContributionCalendar::updateHovered(int index)
 {
     if (m_hoveredIndex == index) return;
 
+    markCellDirty(m_hoveredIndex);
+    markCellDirty(index);
     m_hoveredIndex = index;
 
-    if (index >= 0 && index < m_contributions.size()) {
-        const QVariantMap entry = m_contributions.at(index).toMap();
-        const int     count = entry.value(QStringLiteral("count"), 0).toInt();
-        const QString date  = entry.value(QStringLiteral("date")).toString();
-        m_hoveredTooltip = QStringLiteral("%1 commits on %2")
-                               .arg(count)
-                               .arg(date.isEmpty() ? QStringLiteral("unknown") : date);
-    } else {
-        m_hoveredTooltip.clear();
-    }
+    m_hoveredTooltip = tooltipFor(index);
 
     emit hoveredChanged();
     update();
 }
 
+QString ContributionCalendar::tooltipFor(int index) const
+{
+    int     count = 0;
+    QString date;
+
+    if (m_source) {
+        const QVector<ContributionDay> &days = m_source->days();
+        if (index < 0 || index >= days.size()) return QString();
+        count = days.at(index).count;
+        date  = days.at(index).date.toString(Qt::ISODate);
+    } else {
+        if (index < 0 || index >= m_contributions.size()) return QString();
+        const QVariantMap entry = m_contributions.at(index).toMap();
+        count = entry.value(QStringLiteral("count"), 0).toInt();
+        date  = entry.value(QStringLiteral("date")).toString();
+    }
+
+    return QStringLiteral("%1 commits on %2")
+               .arg(count)
+               .arg(date.isEmpty() ? QStringLiteral("unknown") : date);
+}
+
 void ContributionCalendar::hoverMoveEvent(QHoverEvent *event)
 {
     updateHovered(cellIndexAt(event->position()));
-    QQuickPaintedItem::hoverMoveEvent(event);
+    QQuickItem::hoverMoveEvent(event);
 }
 
 void ContributionCalendar::hoverLeaveEvent(QHoverEvent *event)
 {
     updateHovered(-1);
-    QQuickPaintedItem::hoverLeaveEvent(event);
+    QQuickItem::hoverLeaveEvent(event);
 }
\ No newline at end of file
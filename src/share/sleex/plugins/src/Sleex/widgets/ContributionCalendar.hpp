@@ -1,11 +1,18 @@
 #pragma once
 
-#include <QQuickPaintedItem>
+#include "GithubContributions.hpp"
+#include <QQuickItem>
+#include <QPointer>
 #include <QColor>
+#include <QList>
 #include <QVariantList>
 #include <QtQml/qqmlregistration.h>
+#include <array>
+#include <cstdint>
 
-class ContributionCalendar : public QQuickPaintedItem {
+// All cells are drawn by one geometry node with per-vertex colours. Hovering
+// only rewrites the colours of the cells that gained or lost the hover.
+class ContributionCalendar : public QQuickItem {
     Q_OBJECT
     QML_ELEMENT
 
@@ -13,6 +20,11 @@ class ContributionCalendar : public QQuickPaintedItem {
                READ  contributions
                WRITE setContributions
                NOTIFY contributionsChanged FINAL)
+    // Typed data from the contributions service, used instead of contributions when set
+    Q_PROPERTY(GithubContributions *source
+               READ  source
+               WRITE setSource
+               NOTIFY sourceChanged FINAL)
 
     Q_PROPERTY(QColor level0Color READ level0Color WRITE setLevel0Color NOTIFY colorsChanged FINAL)
     Q_PROPERTY(QColor level1Color READ level1Color WRITE setLevel1Color NOTIFY colorsChanged FINAL)
@@ -32,11 +44,13 @@ class ContributionCalendar : public QQuickPaintedItem {
 public:
     explicit ContributionCalendar(QQuickItem *parent = nullptr);
 
-    void paint(QPainter *painter) override;
 
     QVariantList contributions() const { return m_contributions; }
     void setContributions(const QVariantList &v);
 
+    GithubContributions *source() const { return m_source; }
+    void setSource(GithubContributions *source);
+
     QColor level0Color() const { return m_colors[0]; }
     QColor level1Color() const { return m_colors[1]; }
     QColor level2Color() const { return m_colors[2]; }
@@ -61,11 +75,13 @@ public:
 
 signals:
     void contributionsChanged();
+    void sourceChanged();
     void colorsChanged();
     void layoutChanged();
     void hoveredChanged();
 
 protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
     void hoverMoveEvent(QHoverEvent *event) override;
     void hoverLeaveEvent(QHoverEvent *event) override;
 
@@ -74,8 +90,19 @@ private:
     int  cellIndexAt(const QPointF &pos) const;
     void updateHovered(int index);
     void recalcImplicitSize();
+    void markCellDirty(int index);
+    void loadContributionLevels();
+    void loadSourceLevels();
+    QString tooltipFor(int index) const;
+
+    static constexpr int COLS = 40;
+    static constexpr int ROWS = 7;
+    static constexpr int CELLS = COLS * ROWS;
 
     QVariantList m_contributions;
+    QPointer<GithubContributions> m_source;
+    // Level of each cell, clamped to 0-4 when contributions are set
+    std::array<uint8_t, CELLS> m_levels{};
     QColor       m_colors[5];
     int          m_cellSize    = 7;
     int          m_gap         = 2;
@@ -83,6 +110,8 @@ private:
     int          m_hoveredIndex = -1;
     QString      m_hoveredTooltip;
 
-    static constexpr int COLS = 40;
-    static constexpr int ROWS = 7;
+    // Scene graph state, consumed by updatePaintNode()
+    bool         m_geometryDirty = true;
+    bool         m_colorsDirty   = true;
+    QList<int>   m_dirtyCells;
 };
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include "GithubContributions.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <algorithm>
+
+namespace {
+// Same window as the dashboard widget's "contributions this year"
+constexpr int TOTAL_WINDOW_DAYS = 365;
+
+constexpr int DEFAULT_REFRESH_MS = 10 * 60 * 1000;
+constexpr int TRANSFER_TIMEOUT_MS = 30 * 1000;
+
+// Quartiles of the non-zero counts, like GitHub does when it picks levels
+void assignQuantileLevels(QVector<ContributionDay> &days)
+{
+    QVector<int> counts;
+    for (const ContributionDay &day : std::as_const(days)) {
+        if (day.count > 0) counts.append(day.count);
+    }
+    if (counts.isEmpty()) return;
+    std::sort(counts.begin(), counts.end());
+
+    const auto quantile = [&](double q) {
+        return counts.at(qMin<int>(counts.size() - 1, static_cast<int>(q * counts.size())));
+    };
+    const int q1 = quantile(0.25);
+    const int q2 = quantile(0.50);
+    const int q3 = quantile(0.75);
+
+    for (ContributionDay &day : days) {
+        if (day.count <= 0)       day.level = 0;
+        else if (day.count <= q1) day.level = 1;
+        else if (day.count <= q2) day.level = 2;
+        else if (day.count <= q3) day.level = 3;
+        else                      day.level = 4;
+    }
+}
+}
+
+GithubContributions::GithubContributions(QObject *parent)
+    : QObject(parent)
+{
+    m_refreshTimer.setInterval(DEFAULT_REFRESH_MS);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &GithubContributions::refresh);
+}
+
+void GithubContributions::setUsername(const QString &v)
+{
+    const QString username = v.trimmed();
+    if (m_username == username) return;
+    m_username = username;
+
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+        emit loadingChanged();
+    }
+
+    m_days.clear();
+    m_total = 0;
+    m_etag.clear();
+    m_lastModified.clear();
+    m_lastUpdated = QDateTime();
+    loadCache();
+
+    emit usernameChanged();
+    emit contributionsChanged();
+
+    if (m_username.isEmpty()) {
+        m_refreshTimer.stop();
+        return;
+    }
+    m_refreshTimer.start();
+    refresh();
+}
+
+void GithubContributions::setEndpoint(const QString &v)
+{
+    if (m_endpoint == v) return;
+    m_endpoint = v;
+    // Validators belong to the old server
+    m_etag.clear();
+    m_lastModified.clear();
+    emit endpointChanged();
+    refresh();
+}
+
+void GithubContributions::setRefreshInterval(int ms)
+{
+    if (m_refreshTimer.interval() == ms) return;
+    m_refreshTimer.setInterval(ms);
+    emit refreshIntervalChanged();
+}
+
+void GithubContributions::refresh()
+{
+    if (m_username.isEmpty() || m_reply) return;
+
+    QNetworkRequest request(QUrl(m_endpoint + QString::fromUtf8(QUrl::toPercentEncoding(m_username))));
+    request.setTransferTimeout(TRANSFER_TIMEOUT_MS);
+    if (!m_days.isEmpty()) {
+        if (!m_etag.isEmpty())
+            request.setRawHeader("If-None-Match", m_etag);
+        if (!m_lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", m_lastModified);
+    }
+
+    m_reply = m_network.get(request);
+    connect(m_reply, &QNetworkReply::finished, this, &GithubContributions::onReplyFinished);
+    emit loadingChanged();
+}
+
+void GithubContributions::onReplyFinished()
+{
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    if (!reply) return;
+    reply->deleteLater();
+    emit loadingChanged();
+
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        // Cached days stay on screen, only the error is reported
+        setLastError(reply->errorString());
+        return;
+    }
+
+    if (status == 304) {
+        m_lastUpdated = QDateTime::currentDateTime();
+        setLastError(QString());
+        saveCache();
+        emit contributionsChanged();
+        return;
+    }
+
+    if (!parseResponse(reply->readAll())) {
+        setLastError(QStringLiteral("Unexpected response from %1").arg(reply->url().host()));
+        return;
+    }
+
+    m_etag = reply->rawHeader("ETag");
+    m_lastModified = reply->rawHeader("Last-Modified");
+    m_lastUpdated = QDateTime::currentDateTime();
+    setLastError(QString());
+    saveCache();
+    emit contributionsChanged();
+}
+
+bool GithubContributions::parseResponse(const QByteArray &body)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(body);
+    if (!doc.isObject()) return false;
+    const QJsonValue contributions = doc.object().value(QStringLiteral("contributions"));
+    if (!contributions.isArray()) return false;
+
+    const QDate today = QDate::currentDate();
+    const QDate yearStart = today.addDays(-TOTAL_WINDOW_DAYS);
+
+    // The API returns whole calendar years, future days included
+    QVector<ContributionDay> year;
+    year.reserve(TOTAL_WINDOW_DAYS + 1);
+    bool hasLevels = true;
+    for (const QJsonValue &value : contributions.toArray()) {
+        const QJsonObject entry = value.toObject();
+        const QDate date = QDate::fromString(entry.value(QStringLiteral("date")).toString(), Qt::ISODate);
+        if (!date.isValid() || date < yearStart || date > today) continue;
+
+        ContributionDay day;
+        day.date = date;
+        day.count = entry.value(QStringLiteral("count")).toInt();
+        const QJsonValue level = entry.value(QStringLiteral("level"));
+        if (level.isDouble())
+            day.level = static_cast<uint8_t>(qBound(0, level.toInt(), 4));
+        else
+            hasLevels = false;
+        year.append(day);
+    }
+
+    std::sort(year.begin(), year.end(), [](const ContributionDay &a, const ContributionDay &b) {
+        return a.date < b.date;
+    });
+    if (!hasLevels) assignQuantileLevels(year);
+
+    m_total = 0;
+    for (const ContributionDay &day : std::as_const(year)) m_total += day.count;
+
+    const int first = qMax(0, int(year.size()) - MAX_DAYS);
+    m_days = year.mid(first);
+    return true;
+}
+
+void GithubContributions::setLastError(const QString &error)
+{
+    if (m_lastError == error) return;
+    m_lastError = error;
+    emit lastErrorChanged();
+}
+
+QString GithubContributions::cachePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+        + "/sleex/github/" + QString::fromUtf8(QUrl::toPercentEncoding(m_username)) + ".json";
+}
+
+void GithubContributions::loadCache()
+{
+    if (m_username.isEmpty()) return;
+
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    const QJsonArray days = root.value(QStringLiteral("days")).toArray();
+    m_days.reserve(days.size());
+    for (const QJsonValue &value : days) {
+        // [ "yyyy-MM-dd", count, level ]
+        const QJsonArray entry = value.toArray();
+        ContributionDay day;
+        day.date = QDate::fromString(entry.at(0).toString(), Qt::ISODate);
+        day.count = entry.at(1).toInt();
+        day.level = static_cast<uint8_t>(qBound(0, entry.at(2).toInt(), 4));
+        if (day.date.isValid()) m_days.append(day);
+    }
+
+    m_total = root.value(QStringLiteral("total")).toInt();
+    m_etag = root.value(QStringLiteral("etag")).toString().toUtf8();
+    m_lastModified = root.value(QStringLiteral("lastModified")).toString().toUtf8();
+    m_lastUpdated = QDateTime::fromString(root.value(QStringLiteral("fetched")).toString(), Qt::ISODate);
+}
+
+void GithubContributions::saveCache() const
+{
+    QJsonArray days;
+    for (const ContributionDay &day : m_days) {
+        days.append(QJsonArray{ day.date.toString(Qt::ISODate), day.count, int(day.level) });
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("etag"), QString::fromUtf8(m_etag));
+    root.insert(QStringLiteral("lastModified"), QString::fromUtf8(m_lastModified));
+    root.insert(QStringLiteral("fetched"), m_lastUpdated.toString(Qt::ISODate));
+    root.insert(QStringLiteral("total"), m_total);
+    root.insert(QStringLiteral("days"), days);
+
+    const QString path = cachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
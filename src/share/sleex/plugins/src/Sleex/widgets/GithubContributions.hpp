@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QObject>
+#include <QDate>
+#include <QDateTime>
+#include <QNetworkAccessManager>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+#include <cstdint>
+
+class QNetworkReply;
+
+struct ContributionDay {
+    QDate   date;
+    int     count = 0;
+    uint8_t level = 0;
+};
+
+// Fetches a user's contribution calendar from the github-contributions API.
+// Requests are conditional (ETag / If-Modified-Since) and the last result is
+// kept in ~/.cache/sleex/github so the calendar has data before the network
+// answers. ContributionCalendar reads days() directly through its source
+// property, nothing goes through QVariant.
+class GithubContributions : public QObject {
+    Q_OBJECT
+    QML_ELEMENT
+    QML_SINGLETON
+
+    Q_PROPERTY(QString   username        READ username        WRITE setUsername        NOTIFY usernameChanged FINAL)
+    // Base URL the username is appended to, point it at a local server to test
+    Q_PROPERTY(QString   endpoint        READ endpoint        WRITE setEndpoint        NOTIFY endpointChanged FINAL)
+    Q_PROPERTY(int       refreshInterval READ refreshInterval WRITE setRefreshInterval NOTIFY refreshIntervalChanged FINAL)
+
+    // Contributions over the last 365 days
+    Q_PROPERTY(int       total       READ total       NOTIFY contributionsChanged FINAL)
+    Q_PROPERTY(int       dayCount    READ dayCount    NOTIFY contributionsChanged FINAL)
+    Q_PROPERTY(QDateTime lastUpdated READ lastUpdated NOTIFY contributionsChanged FINAL)
+    Q_PROPERTY(bool      loading     READ loading     NOTIFY loadingChanged FINAL)
+    Q_PROPERTY(QString   lastError   READ lastError   NOTIFY lastErrorChanged FINAL)
+
+public:
+    explicit GithubContributions(QObject *parent = nullptr);
+
+    // Number of days kept, one per ContributionCalendar cell
+    static constexpr int MAX_DAYS = 280;
+
+    QString username()        const { return m_username; }
+    QString endpoint()        const { return m_endpoint; }
+    int     refreshInterval() const { return m_refreshTimer.interval(); }
+    void setUsername(const QString &v);
+    void setEndpoint(const QString &v);
+    void setRefreshInterval(int ms);
+
+    int       total()       const { return m_total; }
+    int       dayCount()    const { return m_days.size(); }
+    QDateTime lastUpdated() const { return m_lastUpdated; }
+    bool      loading()     const { return m_reply != nullptr; }
+    QString   lastError()   const { return m_lastError; }
+
+    // Oldest first, at most MAX_DAYS entries ending today
+    const QVector<ContributionDay> &days() const { return m_days; }
+
+    Q_INVOKABLE void refresh();
+
+signals:
+    void usernameChanged();
+    void endpointChanged();
+    void refreshIntervalChanged();
+    void contributionsChanged();
+    void loadingChanged();
+    void lastErrorChanged();
+
+private:
+    void onReplyFinished();
+    bool parseResponse(const QByteArray &body);
+    void setLastError(const QString &error);
+
+    QString cachePath() const;
+    void loadCache();
+    void saveCache() const;
+
+    QString m_username;
+    QString m_endpoint = QStringLiteral("https://github-contributions-api.jogruber.de/v4/");
+
+    QNetworkAccessManager   m_network;
+    QPointer<QNetworkReply> m_reply;
+    QTimer                  m_refreshTimer;
+
+    // Validators of the cached response, sent back on the next request
+    QByteArray m_etag;
+    QByteArray m_lastModified;
+
+    QVector<ContributionDay> m_days;
+    int       m_total = 0;
+    QDateTime m_lastUpdated;
+    QString   m_lastError;
+};
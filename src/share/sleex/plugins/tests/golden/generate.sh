@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# Rewrites expected/*.scss from generate_colors_material.py, run it where
+# PIL and materialyoucolor are installed (e.g. the Sleex venv) whenever the
+# script, its dependencies or cases.txt change. PYTHON picks the interpreter.
+set -euo pipefail
+
+here="$(cd "$(dirname "$0")" && pwd)"
+sleex="$(cd "$here/../../.." && pwd)"
+script="$sleex/scripts/colors/generate_colors_material.py"
+termscheme="$sleex/scripts/terminal/scheme-base.json"
+python="${PYTHON:-python3}"
+
+mkdir -p "$here/expected"
+rm -f "$here/expected/"*.scss
+
+while read -r name arguments; do
+    [[ -z "$name" || "$name" == \#* ]] && continue
+    arguments="${arguments//@IMAGES@/$here/images}"
+    arguments="${arguments//@TERMSCHEME@/$termscheme}"
+    read -ra argv <<< "$arguments"
+    "$python" "$script" "${argv[@]}" > "$here/expected/$name.scss"
+    echo "$name"
+done < "$here/cases.txt"
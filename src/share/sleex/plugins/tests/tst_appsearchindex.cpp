@@ -0,0 +1,130 @@
+#include "AppSearchIndex.hpp"
+#include <QCollator>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+
+namespace {
+constexpr int ENTRY_COUNT = 2000;
+
+// Syllables for made-up names, a few hundred of them share their start
+const char *const SYLLABLES[] = { "ka", "lo", "mi", "ne", "su", "ta", "vo", "re", "xi", "ze" };
+
+QString syntheticName(int i) {
+    QString name;
+    for (int n = i; name.size() < 6 || n > 0; n /= 10) name += QLatin1String(SYLLABLES[n % 10]);
+    name[0] = name.at(0).toUpper();
+    return name;
+}
+
+// DesktopEntry stand-in, the index reads entries through their properties
+std::unique_ptr<QObject> makeEntry(const QString &id, const QString &name, const QString &genericName = QString()) {
+    auto entry = std::make_unique<QObject>();
+    entry->setProperty("id", id);
+    entry->setProperty("name", name);
+    entry->setProperty("genericName", genericName);
+    entry->setProperty("keywords", QStringList{ "tool", name.left(3) });
+    entry->setProperty("execString", "/usr/bin/" + name.toLower() + " %U");
+    return entry;
+}
+
+QStringList resultNames(const AppSearchIndex &index) {
+    QStringList names;
+    for (int row = 0; row < index.rowCount(); ++row)
+        names.append(index.data(index.index(row, 0), AppSearchIndex::NameRole).toString());
+    return names;
+}
+}
+
+class TestAppSearchIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void tiesFollowLocaleOrder();
+    void launchReranksCurrentQuery();
+
+    void benchmarkQuery_data();
+    void benchmarkQuery();
+
+private:
+    QList<QObject *> entries() const;
+
+    QTemporaryDir m_home;
+    std::vector<std::unique_ptr<QObject>> m_entries;
+};
+
+void TestAppSearchIndex::initTestCase() {
+    // The launch history lives under ~/.local/state/sleex
+    QVERIFY(m_home.isValid());
+    qputenv("HOME", m_home.path().toLocal8Bit());
+
+    for (int i = 0; i < ENTRY_COUNT; ++i)
+        m_entries.push_back(makeEntry(QStringLiteral("app%1.desktop").arg(i), syntheticName(i), "Utility"));
+}
+
+QList<QObject *> TestAppSearchIndex::entries() const {
+    QList<QObject *> list;
+    for (const auto &entry : m_entries) list.append(entry.get());
+    return list;
+}
+
+void TestAppSearchIndex::tiesFollowLocaleOrder() {
+    AppSearchIndex index;
+    index.setEntries(entries());
+
+    // Without launches every entry of the empty query has the same score
+    index.setQuery(QString());
+    QCOMPARE(index.count(), ENTRY_COUNT);
+    QStringList sorted = resultNames(index);
+    QCollator collator;
+    std::stable_sort(sorted.begin(), sorted.end(), collator);
+    QCOMPARE(resultNames(index), sorted);
+}
+
+void TestAppSearchIndex::launchReranksCurrentQuery() {
+    const auto alpha = makeEntry("alpha.desktop", "Files Alpha");
+    const auto beta = makeEntry("beta.desktop", "Files Beta");
+    AppSearchIndex index;
+    index.setEntries({ alpha.get(), beta.get() });
+
+    index.setQuery("files");
+    QCOMPARE(resultNames(index), QStringList({ "Files Alpha", "Files Beta" }));
+
+    QSignalSpy results(&index, &AppSearchIndex::resultsChanged);
+    index.recordLaunch("beta.desktop");
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(resultNames(index), QStringList({ "Files Beta", "Files Alpha" }));
+}
+
+void TestAppSearchIndex::benchmarkQuery_data() {
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<bool>("sloppy");
+
+    // The empty query is all ties, the others the usual typing
+    QTest::addRow("empty") << QString() << false;
+    QTest::addRow("one letter") << "k" << false;
+    QTest::addRow("prefix") << "kalo" << false;
+    QTest::addRow("generic name") << "utili" << false;
+    QTest::addRow("sloppy") << "kaloni" << true;
+}
+
+void TestAppSearchIndex::benchmarkQuery() {
+    QFETCH(QString, query);
+    QFETCH(bool, sloppy);
+
+    AppSearchIndex index;
+    index.setEntries(entries());
+    index.setSloppy(sloppy);
+
+    QBENCHMARK {
+        // Cleared first so every round scores the whole index, not the refined matches
+        index.setQuery(QStringLiteral("#"));
+        index.setQuery(query);
+    }
+    QVERIFY(index.count() > 0);
+}
+
+QTEST_GUILESS_MAIN(TestAppSearchIndex)
+#include "tst_appsearchindex.moc"
@@ -0,0 +1,251 @@
+#include "bluetoothDevices.hpp"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusVirtualObject>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QtTest>
+#include <memory>
+
+using ManagedObjects = BluetoothDeviceModel::ManagedObjects;
+using InterfaceMap = BluetoothDeviceModel::InterfaceMap;
+
+namespace {
+const QString SERVICE = QStringLiteral("org.bluez");
+const QString OBJECT_MANAGER = QStringLiteral("org.freedesktop.DBus.ObjectManager");
+const QString PROPERTIES = QStringLiteral("org.freedesktop.DBus.Properties");
+const QString ADAPTER = QStringLiteral("org.bluez.Adapter1");
+const QString DEVICE = QStringLiteral("org.bluez.Device1");
+const QString BATTERY = QStringLiteral("org.bluez.Battery1");
+
+const QString HCI0 = QStringLiteral("/org/bluez/hci0");
+const QString HEADPHONES = QStringLiteral("/org/bluez/hci0/dev_00_11_22_33_44_55");
+const QString KEYBOARD = QStringLiteral("/org/bluez/hci0/dev_66_77_88_99_AA_BB");
+const QString MOUSE = QStringLiteral("/org/bluez/hci0/dev_CC_DD_EE_FF_00_11");
+
+constexpr int TIMEOUT_MS = 5000;
+
+InterfaceMap device(const QString &address, const QString &alias, bool connected) {
+    return { { DEVICE, {
+        { "Address", address },
+        { "Alias", alias },
+        { "Adapter", QVariant::fromValue(QDBusObjectPath(HCI0)) },
+        { "Paired", true },
+        { "Connected", connected },
+    } } };
+}
+
+// bluetoothd as far as the model can tell: an ObjectManager at / and the
+// signals it sends, on a bus of the test's own
+class MockBluez : public QDBusVirtualObject {
+public:
+    explicit MockBluez(const QDBusConnection &bus) : m_bus(bus) {}
+
+    ManagedObjects objects;
+
+    QString introspect(const QString &) const override { return QString(); }
+
+    bool handleMessage(const QDBusMessage &message, const QDBusConnection &connection) override {
+        if (message.interface() != OBJECT_MANAGER || message.member() != QLatin1String("GetManagedObjects"))
+            return false;
+        connection.send(message.createReply(QVariant::fromValue(objects)));
+        return true;
+    }
+
+    void add(const QString &path, const InterfaceMap &interfaces) {
+        InterfaceMap &known = objects[QDBusObjectPath(path)];
+        for (auto it = interfaces.cbegin(); it != interfaces.cend(); ++it) known.insert(it.key(), it.value());
+
+        QDBusMessage signal = QDBusMessage::createSignal("/", OBJECT_MANAGER, "InterfacesAdded");
+        signal << QVariant::fromValue(QDBusObjectPath(path)) << QVariant::fromValue(interfaces);
+        m_bus.send(signal);
+    }
+
+    void remove(const QString &path, const QStringList &interfaces) {
+        InterfaceMap &known = objects[QDBusObjectPath(path)];
+        for (const QString &interface : interfaces) known.remove(interface);
+        if (known.isEmpty()) objects.remove(QDBusObjectPath(path));
+
+        QDBusMessage signal = QDBusMessage::createSignal("/", OBJECT_MANAGER, "InterfacesRemoved");
+        signal << QVariant::fromValue(QDBusObjectPath(path)) << interfaces;
+        m_bus.send(signal);
+    }
+
+    void change(const QString &path, const QString &interface, const QVariantMap &changed,
+                const QStringList &invalidated = {}) {
+        QVariantMap &properties = objects[QDBusObjectPath(path)][interface];
+        for (auto it = changed.cbegin(); it != changed.cend(); ++it) properties.insert(it.key(), it.value());
+        for (const QString &name : invalidated) properties.remove(name);
+
+        QDBusMessage signal = QDBusMessage::createSignal(path, PROPERTIES, "PropertiesChanged");
+        signal << interface << changed << invalidated;
+        m_bus.send(signal);
+    }
+
+private:
+    QDBusConnection m_bus;
+};
+
+int rowOf(const BluetoothDeviceModel &model, const QString &path) {
+    for (int row = 0; row < model.rowCount(); ++row) {
+        if (model.data(model.index(row), BluetoothDeviceModel::PathRole).toString() == path) return row;
+    }
+    return -1;
+}
+
+QVariant roleOf(const BluetoothDeviceModel &model, const QString &path, int role) {
+    const int row = rowOf(model, path);
+    return row < 0 ? QVariant() : model.data(model.index(row), role);
+}
+}
+
+class TestBluetoothDevices : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+
+    void loadsManagedObjects();
+    void followsObjectManagerSignals();
+    void followsPropertyChanges();
+    void refetchesWhenTheServiceReturns();
+    void closesThePrivateBus();
+
+private:
+    QProcess m_daemon;
+    QString m_address;
+    std::unique_ptr<MockBluez> m_mock;
+    std::unique_ptr<BluetoothDeviceModel> m_model;
+};
+
+void TestBluetoothDevices::initTestCase() {
+    qDBusRegisterMetaType<InterfaceMap>();
+    qDBusRegisterMetaType<ManagedObjects>();
+
+    const QString daemon = QStandardPaths::findExecutable("dbus-daemon");
+    if (daemon.isEmpty()) QSKIP("dbus-daemon is needed for the mock bus");
+
+    m_daemon.start(daemon, { "--session", "--nofork", "--print-address" });
+    QVERIFY(m_daemon.waitForStarted());
+    QVERIFY(m_daemon.waitForReadyRead(TIMEOUT_MS));
+    m_address = QString::fromUtf8(m_daemon.readLine()).trimmed();
+    QVERIFY(!m_address.isEmpty());
+}
+
+void TestBluetoothDevices::init() {
+    QDBusConnection bus = QDBusConnection::connectToBus(m_address, "mock-bluez");
+    QVERIFY(bus.isConnected());
+
+    m_mock = std::make_unique<MockBluez>(bus);
+    m_mock->objects[QDBusObjectPath(HCI0)] = { { ADAPTER, { { "Powered", true } } } };
+    m_mock->objects[QDBusObjectPath(HEADPHONES)] = device("00:11:22:33:44:55", "Headphones", true);
+    m_mock->objects[QDBusObjectPath(HEADPHONES)][BATTERY] = { { "Percentage", QVariant::fromValue(uchar(80)) } };
+    m_mock->objects[QDBusObjectPath(KEYBOARD)] = device("66:77:88:99:AA:BB", "Keyboard", false);
+    QVERIFY(bus.registerVirtualObject("/", m_mock.get(), QDBusConnection::SingleNode));
+    QVERIFY(bus.registerService(SERVICE));
+
+    m_model = std::make_unique<BluetoothDeviceModel>();
+    m_model->setBusAddress(m_address);
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 2, TIMEOUT_MS);
+}
+
+void TestBluetoothDevices::cleanup() {
+    m_model.reset();
+    QDBusConnection bus("mock-bluez");
+    bus.unregisterObject("/");
+    m_mock.reset();
+    QDBusConnection::disconnectFromBus("mock-bluez");
+}
+
+void TestBluetoothDevices::cleanupTestCase() {
+    m_daemon.kill();
+    m_daemon.waitForFinished();
+}
+
+void TestBluetoothDevices::loadsManagedObjects() {
+    QVERIFY(m_model->available());
+    QVERIFY(m_model->powered());
+    QCOMPARE(m_model->adapterPath(), HCI0);
+    QCOMPARE(m_model->connectedCount(), 1);
+
+    QCOMPARE(roleOf(*m_model, HEADPHONES, BluetoothDeviceModel::NameRole).toString(), QStringLiteral("Headphones"));
+    QCOMPARE(roleOf(*m_model, HEADPHONES, BluetoothDeviceModel::AddressRole).toString(), QStringLiteral("00:11:22:33:44:55"));
+    QCOMPARE(roleOf(*m_model, HEADPHONES, BluetoothDeviceModel::BatteryRole).toInt(), 80);
+    QCOMPARE(roleOf(*m_model, KEYBOARD, BluetoothDeviceModel::BatteryRole).toInt(), -1);
+    QVERIFY(!roleOf(*m_model, KEYBOARD, BluetoothDeviceModel::RssiRole).isValid());
+    QCOMPARE(m_model->firstConnected()->path, HEADPHONES);
+}
+
+void TestBluetoothDevices::followsObjectManagerSignals() {
+    m_mock->add(MOUSE, device("CC:DD:EE:FF:00:11", "Mouse", true));
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 3, TIMEOUT_MS);
+    QCOMPARE(m_model->connectedCount(), 2);
+
+    // Battery1 arrives on its own once the profile is up
+    m_mock->add(MOUSE, { { BATTERY, { { "Percentage", QVariant::fromValue(uchar(55)) } } } });
+    QTRY_COMPARE_WITH_TIMEOUT(roleOf(*m_model, MOUSE, BluetoothDeviceModel::BatteryRole).toInt(), 55, TIMEOUT_MS);
+
+    m_mock->remove(MOUSE, { BATTERY });
+    QTRY_COMPARE_WITH_TIMEOUT(roleOf(*m_model, MOUSE, BluetoothDeviceModel::BatteryRole).toInt(), -1, TIMEOUT_MS);
+    QCOMPARE(m_model->count(), 3);
+
+    m_mock->remove(MOUSE, { DEVICE });
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 2, TIMEOUT_MS);
+    QCOMPARE(m_model->connectedCount(), 1);
+    QCOMPARE(rowOf(*m_model, MOUSE), -1);
+}
+
+void TestBluetoothDevices::followsPropertyChanges() {
+    QSignalSpy dataChanged(m_model.get(), &QAbstractItemModel::dataChanged);
+
+    m_mock->change(KEYBOARD, DEVICE, { { "Connected", true } });
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->connectedCount(), 2, TIMEOUT_MS);
+    QVERIFY(dataChanged.last().at(2).value<QList<int>>().contains(BluetoothDeviceModel::ConnectedRole));
+
+    m_mock->change(KEYBOARD, DEVICE, { { "RSSI", QVariant::fromValue(qint16(-60)) } });
+    QTRY_COMPARE_WITH_TIMEOUT(roleOf(*m_model, KEYBOARD, BluetoothDeviceModel::RssiRole), QVariant(-60), TIMEOUT_MS);
+    m_mock->change(KEYBOARD, DEVICE, {}, { "RSSI" });
+    QTRY_VERIFY_WITH_TIMEOUT(!roleOf(*m_model, KEYBOARD, BluetoothDeviceModel::RssiRole).isValid(), TIMEOUT_MS);
+
+    m_mock->change(HEADPHONES, BATTERY, { { "Percentage", QVariant::fromValue(uchar(42)) } });
+    QTRY_COMPARE_WITH_TIMEOUT(roleOf(*m_model, HEADPHONES, BluetoothDeviceModel::BatteryRole).toInt(), 42, TIMEOUT_MS);
+
+    m_mock->change(HCI0, ADAPTER, { { "Powered", false } });
+    QTRY_VERIFY_WITH_TIMEOUT(!m_model->powered(), TIMEOUT_MS);
+    QVERIFY(m_model->available());
+}
+
+void TestBluetoothDevices::refetchesWhenTheServiceReturns() {
+    QDBusConnection bus("mock-bluez");
+
+    QVERIFY(bus.unregisterService(SERVICE));
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 0, TIMEOUT_MS);
+    QVERIFY(!m_model->available());
+
+    // Changed while it was away, the model reads it back in one call
+    m_mock->objects.remove(QDBusObjectPath(KEYBOARD));
+    QVERIFY(bus.registerService(SERVICE));
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 1, TIMEOUT_MS);
+    QVERIFY(m_model->available());
+    QCOMPARE(rowOf(*m_model, KEYBOARD), -1);
+}
+
+void TestBluetoothDevices::closesThePrivateBus() {
+    const QString name = QStringLiteral("sleex-bluetooth-") + m_address;
+    QVERIFY(QDBusConnection(name).isConnected());
+
+    m_model->setService(QStringLiteral("org.bluez.other"));
+    QTRY_COMPARE_WITH_TIMEOUT(m_model->count(), 0, TIMEOUT_MS);
+    QVERIFY(QDBusConnection(name).isConnected());
+
+    // Back on the system bus, the one opened for the address is let go
+    m_model->setBusAddress(QString());
+    QVERIFY(!QDBusConnection(name).isConnected());
+}
+
+QTEST_GUILESS_MAIN(TestBluetoothDevices)
+#include "tst_bluetoothdevices.moc"
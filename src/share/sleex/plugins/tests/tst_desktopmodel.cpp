@@ -0,0 +1,205 @@
+#include "DesktopGrid.hpp"
+#include "DesktopModel.hpp"
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+constexpr int ITEM_COUNT = 10000;
+constexpr int ROWS = 40;
+// 10k icons fill 250 columns, the rest is room to move a group into
+constexpr int MAX_COL = 299;
+constexpr int MAX_ROW = ROWS - 1;
+constexpr int SELECTION = 1000;
+
+bool fillDirectory(const QString &path, int count) {
+    for (int i = 0; i < count; ++i) {
+        QFile file(QStringLiteral("%1/file-%2.txt").arg(path).arg(i, 5, 10, QLatin1Char('0')));
+        if (!file.open(QIODevice::WriteOnly)) return false;
+    }
+    return true;
+}
+
+QPoint cellOf(const DesktopModel &model, int row) {
+    const QModelIndex index = model.index(row, 0);
+    return QPoint(model.data(index, DesktopModel::GridXRole).toInt(),
+                  model.data(index, DesktopModel::GridYRole).toInt());
+}
+
+// Every icon sits on a cell of its own
+bool cellsUnique(const DesktopModel &model) {
+    QSet<quint64> cells;
+    cells.reserve(model.rowCount());
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QPoint cell = cellOf(model, row);
+        const quint64 key = (quint64(quint32(cell.x())) << 32) | quint32(cell.y());
+        if (cells.contains(key)) return false;
+        cells.insert(key);
+    }
+    return true;
+}
+
+QVariantList firstPaths(const DesktopModel &model, int count) {
+    QVariantList paths;
+    paths.reserve(count);
+    for (int row = 0; row < count; ++row)
+        paths.append(model.data(model.index(row, 0), DesktopModel::FilePathRole));
+    return paths;
+}
+}
+
+class TestDesktopModel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void loadPlacesEveryIcon();
+    void massMoveResolvesCollisions();
+    void hiddenEntriesStayOff();
+
+    void benchmarkFirstFree();
+    void benchmarkNearestFree();
+    void benchmarkLoad();
+    void benchmarkMassMove();
+    void benchmarkRemoveMany();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+void TestDesktopModel::initTestCase() {
+    // Keeps the saved layout away from the real ~/.config/sleex
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation) + "/sleex/desktop_layout.json");
+
+    QVERIFY(m_dir.isValid());
+    QVERIFY(fillDirectory(m_dir.path(), ITEM_COUNT));
+}
+
+void TestDesktopModel::loadPlacesEveryIcon() {
+    DesktopModel model;
+    model.setRows(ROWS);
+    model.loadDirectory(m_dir.path());
+
+    QCOMPARE(model.rowCount(), ITEM_COUNT);
+    QVERIFY(cellsUnique(model));
+}
+
+void TestDesktopModel::massMoveResolvesCollisions() {
+    DesktopModel model;
+    model.setRows(ROWS);
+    model.loadDirectory(m_dir.path());
+
+    // Dropped half onto the occupied columns, half onto free ones
+    const QPoint leader = cellOf(model, 0);
+    const QVariantList selection = firstPaths(model, SELECTION);
+    model.massMove(selection, selection.first().toString(), 240, 5, MAX_COL, MAX_ROW);
+
+    QVERIFY(cellOf(model, 0) != leader);
+    QVERIFY(cellsUnique(model));
+    for (int row = 0; row < model.rowCount(); ++row) {
+        const QPoint cell = cellOf(model, row);
+        QVERIFY(cell.x() >= 0 && cell.x() <= MAX_COL);
+        QVERIFY(cell.y() >= 0 && cell.y() <= MAX_ROW);
+    }
+}
+
+void TestDesktopModel::hiddenEntriesStayOff() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(fillDirectory(dir.path(), 1));
+
+    DesktopModel model;
+    model.setRows(ROWS);
+    model.loadDirectory(dir.path());
+    QCOMPARE(model.rowCount(), 1);
+
+    // Created after the load, only the visible one shows up
+    QFile hidden(dir.filePath(".hidden"));
+    QVERIFY(hidden.open(QIODevice::WriteOnly));
+    hidden.close();
+    QFile visible(dir.filePath("visible.txt"));
+    QVERIFY(visible.open(QIODevice::WriteOnly));
+    visible.close();
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), 2, 5000);
+    for (int row = 0; row < model.rowCount(); ++row)
+        QVERIFY(!model.data(model.index(row, 0), DesktopModel::FileNameRole).toString().startsWith('.'));
+
+    // Renamed to a dotfile, it leaves the desktop
+    QVERIFY(QFile::rename(dir.filePath("visible.txt"), dir.filePath(".visible.txt")));
+    QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), 1, 5000);
+}
+
+void TestDesktopModel::benchmarkFirstFree() {
+    DesktopGrid grid(ROWS, MAX_COL);
+    for (int i = 0; i < ITEM_COUNT; ++i) grid.occupy(i / ROWS, i % ROWS);
+
+    QPoint spot;
+    QBENCHMARK {
+        spot = grid.firstFree();
+    }
+    QCOMPARE(spot, QPoint(ITEM_COUNT / ROWS, 0));
+}
+
+void TestDesktopModel::benchmarkNearestFree() {
+    DesktopGrid grid(ROWS, MAX_COL);
+    for (int i = 0; i < ITEM_COUNT; ++i) grid.occupy(i / ROWS, i % ROWS);
+
+    // From the middle of the filled block, 125 columns away from any free cell
+    QPoint spot;
+    QBENCHMARK {
+        spot = grid.nearestFree(125, ROWS / 2);
+    }
+    QCOMPARE(spot.x(), ITEM_COUNT / ROWS);
+}
+
+void TestDesktopModel::benchmarkLoad() {
+    DesktopModel model;
+    model.setRows(ROWS);
+    QBENCHMARK {
+        model.loadDirectory(m_dir.path());
+    }
+    QCOMPARE(model.rowCount(), ITEM_COUNT);
+}
+
+void TestDesktopModel::benchmarkMassMove() {
+    DesktopModel model;
+    model.setRows(ROWS);
+    model.loadDirectory(m_dir.path());
+
+    const QVariantList selection = firstPaths(model, SELECTION);
+    const QString leader = selection.first().toString();
+    QBENCHMARK {
+        // Back and forth between free space and the occupied block
+        const int targetX = cellOf(model, 0).x() == 260 ? 240 : 260;
+        model.massMove(selection, leader, targetX, 5, MAX_COL, MAX_ROW);
+    }
+    QVERIFY(cellsUnique(model));
+}
+
+void TestDesktopModel::benchmarkRemoveMany() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(fillDirectory(dir.path(), ITEM_COUNT));
+
+    DesktopModel model;
+    model.setRows(ROWS);
+    model.loadDirectory(dir.path());
+    QCOMPARE(model.rowCount(), ITEM_COUNT);
+
+    // Front rows first, every removal shifts everything after it
+    constexpr int removed = 2000;
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < removed; ++i)
+            QVERIFY(QFile::remove(QStringLiteral("%1/file-%2.txt").arg(dir.path()).arg(i, 5, 10, QLatin1Char('0'))));
+        QTRY_COMPARE_WITH_TIMEOUT(model.rowCount(), ITEM_COUNT - removed, 30000);
+    }
+    QVERIFY(cellsUnique(model));
+}
+
+QTEST_GUILESS_MAIN(TestDesktopModel)
+#include "tst_desktopmodel.moc"
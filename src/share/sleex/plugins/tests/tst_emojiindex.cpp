@@ -0,0 +1,114 @@
+#include "EmojiIndex.hpp"
+#include <QFile>
+#include <QtTest>
+
+namespace {
+constexpr int TIMEOUT_MS = 5000;
+const QString EMOJI_SCRIPT = QStringLiteral(SLEEX_EMOJI_SCRIPT);
+
+QString glyphOf(const QString &line) {
+    return line.section(' ', 0, 0);
+}
+}
+
+class TestEmojiIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void queryFillsModel();
+    void newestQueryWins();
+    void everyWordMustMatch();
+
+    void benchmarkQuery_data();
+    void benchmarkQuery();
+
+private:
+    // Loads the shipped emoji data and waits for the worker
+    void load(EmojiIndex &index);
+};
+
+void TestEmojiIndex::initTestCase() {
+    QVERIFY2(QFile::exists(EMOJI_SCRIPT), qPrintable(EMOJI_SCRIPT));
+}
+
+void TestEmojiIndex::load(EmojiIndex &index) {
+    index.setSource(EMOJI_SCRIPT);
+    QTRY_VERIFY_WITH_TIMEOUT(index.ready(), TIMEOUT_MS);
+    QVERIFY(index.emojiCount() > 1000);
+}
+
+void TestEmojiIndex::queryFillsModel() {
+    EmojiIndex index;
+    load(index);
+    if (QTest::currentTestFailed()) return;
+
+    // The empty query ranks everything in data order
+    QTRY_COMPARE_WITH_TIMEOUT(index.count(), index.emojiCount(), TIMEOUT_MS);
+
+    index.setQuery("gorilla");
+    QTRY_VERIFY_WITH_TIMEOUT(index.count() < index.emojiCount(), TIMEOUT_MS);
+    QVERIFY(index.count() > 0);
+    QCOMPARE(index.data(index.index(0, 0), EmojiIndex::GlyphRole).toString(), QStringLiteral("🦍"));
+    QCOMPARE(index.results().size(), index.count());
+    QCOMPARE(index.results(), index.search("gorilla"));
+}
+
+void TestEmojiIndex::newestQueryWins() {
+    EmojiIndex index;
+    load(index);
+    if (QTest::currentTestFailed()) return;
+    QTRY_COMPARE_WITH_TIMEOUT(index.count(), index.emojiCount(), TIMEOUT_MS);
+
+    // Typed in one go, only the last query may reach the model
+    QSignalSpy results(&index, &EmojiIndex::resultsChanged);
+    for (const QString &query : { "g", "go", "gor", "gori", "goril", "gorill", "gorilla" })
+        index.setQuery(query);
+    QTRY_VERIFY_WITH_TIMEOUT(results.size() > 0, TIMEOUT_MS);
+    QTest::qWait(100);
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(index.results(), index.search("gorilla"));
+}
+
+void TestEmojiIndex::everyWordMustMatch() {
+    EmojiIndex index;
+    load(index);
+    if (QTest::currentTestFailed()) return;
+
+    const QStringList arrows = index.search("arrow");
+    const QStringList upArrows = index.search("up arrow");
+    QVERIFY(!upArrows.isEmpty());
+    QVERIFY(upArrows.size() < arrows.size());
+    for (const QString &line : upArrows) QVERIFY(arrows.contains(line));
+    // A typo falls back to subsequence matching
+    QVERIFY(index.search("grla").contains(index.search("gorilla").first()));
+    QCOMPARE(glyphOf(index.search("up arrow").first()), QStringLiteral("↑"));
+}
+
+void TestEmojiIndex::benchmarkQuery_data() {
+    QTest::addColumn<QString>("query");
+
+    QTest::addRow("empty") << QString();
+    QTest::addRow("one letter") << "s";
+    QTest::addRow("prefix") << "smil";
+    QTest::addRow("two words") << "face smil";
+    QTest::addRow("fuzzy") << "smlng";
+}
+
+// The ranking the worker runs per keystroke
+void TestEmojiIndex::benchmarkQuery() {
+    QFETCH(QString, query);
+    EmojiIndex index;
+    load(index);
+    if (QTest::currentTestFailed()) return;
+
+    QStringList lines;
+    QBENCHMARK {
+        lines = index.search(query);
+    }
+    QVERIFY(!lines.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestEmojiIndex)
+#include "tst_emojiindex.moc"
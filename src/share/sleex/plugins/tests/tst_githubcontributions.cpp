@@ -0,0 +1,250 @@
+#include "GithubContributions.hpp"
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkProxyFactory>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest>
+
+namespace {
+constexpr int TIMEOUT_MS = 10000;
+
+// Plays the contributions API on localhost. Honours If-None-Match the way
+// the real one does and records every request it sees.
+class StandInServer : public QObject {
+public:
+    struct Request {
+        QByteArray path;
+        QHash<QByteArray, QByteArray> headers;
+    };
+
+    bool listen() {
+        connect(&m_server, &QTcpServer::newConnection, this, &StandInServer::accept);
+        return m_server.listen(QHostAddress::LocalHost);
+    }
+
+    QString endpoint() const {
+        return QStringLiteral("http://127.0.0.1:%1/v4/").arg(m_server.serverPort());
+    }
+
+    int status = 200;
+    QByteArray body;
+    QByteArray etag = "\"v1\"";
+    QByteArray lastModified = "Wed, 01 Jan 2025 00:00:00 GMT";
+    QList<Request> requests;
+
+private:
+    void accept() {
+        while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                QByteArray &buffer = m_buffers[socket];
+                buffer += socket->readAll();
+                if (!buffer.contains("\r\n\r\n")) return;
+                respond(socket, m_buffers.take(socket));
+            });
+        }
+    }
+
+    void respond(QTcpSocket *socket, const QByteArray &head) {
+        Request request;
+        const QList<QByteArray> lines = head.left(head.indexOf("\r\n\r\n")).split('\n');
+        request.path = lines.value(0).split(' ').value(1);
+        for (qsizetype i = 1; i < lines.size(); ++i) {
+            const QByteArray line = lines.at(i).trimmed();
+            const qsizetype colon = line.indexOf(':');
+            if (colon > 0) request.headers.insert(line.left(colon).toLower(), line.mid(colon + 1).trimmed());
+        }
+        requests.append(request);
+
+        const bool notModified = status == 200 && request.headers.value("if-none-match") == etag;
+        const int code = notModified ? 304 : status;
+        const QByteArray payload = notModified ? QByteArray() : body;
+
+        QByteArray response = "HTTP/1.1 " + QByteArray::number(code)
+            + (code == 200 ? " OK" : code == 304 ? " Not Modified" : " Error") + "\r\n";
+        response += "Content-Type: application/json\r\n";
+        response += "Content-Length: " + QByteArray::number(payload.size()) + "\r\n";
+        if (code < 300) {
+            response += "ETag: " + etag + "\r\n";
+            response += "Last-Modified: " + lastModified + "\r\n";
+        }
+        response += "Connection: close\r\n\r\n" + payload;
+        socket->write(response);
+        socket->disconnectFromHost();
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+};
+
+// The last `counts.size()` days up to today, and a future day the API
+// always includes for the rest of the year
+QByteArray apiBody(const QList<int> &counts, bool levels) {
+    QJsonArray contributions;
+    const QDate today = QDate::currentDate();
+    for (qsizetype i = 0; i < counts.size(); ++i) {
+        QJsonObject day;
+        day["date"] = today.addDays(i - counts.size() + 1).toString(Qt::ISODate);
+        day["count"] = counts.at(i);
+        if (levels) day["level"] = qMin(counts.at(i), 4);
+        contributions.append(day);
+    }
+    contributions.append(QJsonObject{ { "date", today.addDays(1).toString(Qt::ISODate) }, { "count", 99 } });
+    return QJsonDocument(QJsonObject{ { "contributions", contributions } }).toJson(QJsonDocument::Compact);
+}
+}
+
+class TestGithubContributions : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void fetchComputesQuantileLevels();
+    void keepsLevelsFromTheApi();
+    void revalidatesWithValidators();
+    void showsCacheBeforeTheNetwork();
+    void errorKeepsDays();
+
+private:
+    // Points a service at the stand-in and waits for the first reply
+    void fetch(GithubContributions &contributions, StandInServer &server);
+};
+
+void TestGithubContributions::initTestCase() {
+    // Keeps the cache away from ~/.cache/sleex and no proxy in between
+    QStandardPaths::setTestModeEnabled(true);
+    QNetworkProxyFactory::setUseSystemConfiguration(false);
+}
+
+void TestGithubContributions::init() {
+    QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/sleex/github").removeRecursively();
+}
+
+void TestGithubContributions::fetch(GithubContributions &contributions, StandInServer &server) {
+    contributions.setEndpoint(server.endpoint());
+    contributions.setUsername("octocat");
+    QVERIFY(contributions.loading());
+    QTRY_VERIFY_WITH_TIMEOUT(!contributions.loading(), TIMEOUT_MS);
+}
+
+void TestGithubContributions::fetchComputesQuantileLevels() {
+    StandInServer server;
+    QVERIFY(server.listen());
+    server.body = apiBody({ 0, 1, 2, 3, 4, 5, 6, 7, 8 }, false);
+
+    GithubContributions contributions;
+    fetch(contributions, server);
+    if (QTest::currentTestFailed()) return;
+
+    QCOMPARE(server.requests.size(), 1);
+    QCOMPARE(server.requests.first().path, QByteArray("/v4/octocat"));
+    QVERIFY(!server.requests.first().headers.contains("if-none-match"));
+
+    QCOMPARE(contributions.lastError(), QString());
+    // The future day is dropped
+    QCOMPARE(contributions.dayCount(), 9);
+    QCOMPARE(contributions.total(), 36);
+
+    // Quartiles of 1..8 are 3, 5 and 7
+    const QList<int> expected = { 0, 1, 1, 1, 2, 2, 3, 3, 4 };
+    for (int i = 0; i < contributions.dayCount(); ++i)
+        QCOMPARE(int(contributions.days().at(i).level), expected.at(i));
+}
+
+void TestGithubContributions::keepsLevelsFromTheApi() {
+    StandInServer server;
+    QVERIFY(server.listen());
+    server.body = apiBody({ 0, 10, 20, 1, 0 }, true);
+
+    GithubContributions contributions;
+    fetch(contributions, server);
+    if (QTest::currentTestFailed()) return;
+
+    const QList<int> expected = { 0, 4, 4, 1, 0 };
+    QCOMPARE(contributions.dayCount(), expected.size());
+    for (int i = 0; i < contributions.dayCount(); ++i)
+        QCOMPARE(int(contributions.days().at(i).level), expected.at(i));
+}
+
+void TestGithubContributions::revalidatesWithValidators() {
+    StandInServer server;
+    QVERIFY(server.listen());
+    server.body = apiBody({ 3, 1, 4 }, false);
+
+    GithubContributions contributions;
+    fetch(contributions, server);
+    if (QTest::currentTestFailed()) return;
+    const QDateTime fetched = contributions.lastUpdated();
+
+    // Unchanged on the server, it answers 304 and the days stay as they are
+    QSignalSpy changed(&contributions, &GithubContributions::contributionsChanged);
+    contributions.refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(!contributions.loading(), TIMEOUT_MS);
+
+    QCOMPARE(server.requests.size(), 2);
+    QCOMPARE(server.requests.last().headers.value("if-none-match"), server.etag);
+    QCOMPARE(server.requests.last().headers.value("if-modified-since"), server.lastModified);
+    QCOMPARE(changed.size(), 1);
+    QCOMPARE(contributions.total(), 8);
+    QCOMPARE(contributions.lastError(), QString());
+    QVERIFY(contributions.lastUpdated() >= fetched);
+
+    // A new version replaces the days
+    server.etag = "\"v2\"";
+    server.body = apiBody({ 5, 5 }, false);
+    contributions.refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(!contributions.loading(), TIMEOUT_MS);
+    QCOMPARE(contributions.total(), 10);
+    QCOMPARE(contributions.dayCount(), 2);
+}
+
+void TestGithubContributions::showsCacheBeforeTheNetwork() {
+    StandInServer server;
+    QVERIFY(server.listen());
+    server.body = apiBody({ 2, 0, 7 }, false);
+    {
+        GithubContributions contributions;
+        fetch(contributions, server);
+        if (QTest::currentTestFailed()) return;
+    }
+
+    // A fresh instance, as on the next login, has the days while its request is out
+    GithubContributions contributions;
+    contributions.setEndpoint(server.endpoint());
+    contributions.setUsername("octocat");
+    QVERIFY(contributions.loading());
+    QCOMPARE(contributions.dayCount(), 3);
+    QCOMPARE(contributions.total(), 9);
+
+    // And revalidates what it loaded instead of downloading it again
+    QTRY_VERIFY_WITH_TIMEOUT(!contributions.loading(), TIMEOUT_MS);
+    QCOMPARE(server.requests.last().headers.value("if-none-match"), server.etag);
+    QCOMPARE(contributions.total(), 9);
+}
+
+void TestGithubContributions::errorKeepsDays() {
+    StandInServer server;
+    QVERIFY(server.listen());
+    server.body = apiBody({ 1, 2 }, false);
+
+    GithubContributions contributions;
+    fetch(contributions, server);
+    if (QTest::currentTestFailed()) return;
+
+    server.status = 500;
+    contributions.refresh();
+    QTRY_VERIFY_WITH_TIMEOUT(!contributions.loading(), TIMEOUT_MS);
+
+    QVERIFY(!contributions.lastError().isEmpty());
+    QCOMPARE(contributions.dayCount(), 2);
+    QCOMPARE(contributions.total(), 3);
+}
+
+QTEST_GUILESS_MAIN(TestGithubContributions)
+#include "tst_githubcontributions.moc"
@@ -0,0 +1,77 @@
+#include "MaterialPalette.hpp"
+#include <QFile>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QtTest>
+
+namespace {
+const QString GOLDEN_DIR = QStringLiteral(SLEEX_GOLDEN_DIR);
+const QString TERMSCHEME = QStringLiteral(SLEEX_SCRIPTS_DIR "/terminal/scheme-base.json");
+}
+
+// Byte for byte against generate_colors_material.py, with the cases in
+// golden/cases.txt and the script's output in golden/expected
+class TestMaterialPalette : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void matchesPython_data();
+    void matchesPython();
+    void cachedMatchesGenerated();
+};
+
+void TestMaterialPalette::initTestCase() {
+    // SchemeCache persists what it generates, keep it out of ~/.cache
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestMaterialPalette::matchesPython_data() {
+    QTest::addColumn<QStringList>("arguments");
+    QTest::addColumn<QString>("expected");
+
+    QFile cases(GOLDEN_DIR + "/cases.txt");
+    QVERIFY(cases.open(QIODevice::ReadOnly | QIODevice::Text));
+    static const QRegularExpression space(QStringLiteral("\\s+"));
+    while (!cases.atEnd()) {
+        const QString line = QString::fromUtf8(cases.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        QStringList arguments = line.split(space, Qt::SkipEmptyParts);
+        const QString name = arguments.takeFirst();
+        for (QString &argument : arguments) {
+            argument.replace("@IMAGES@", GOLDEN_DIR + "/images");
+            argument.replace("@TERMSCHEME@", TERMSCHEME);
+        }
+        QTest::newRow(qPrintable(name)) << arguments << GOLDEN_DIR + "/expected/" + name + ".scss";
+    }
+}
+
+void TestMaterialPalette::matchesPython() {
+    QFETCH(QStringList, arguments);
+    QFETCH(QString, expected);
+
+    QFile file(expected);
+    // A case without its fixture checks nothing, it must not pass quietly
+    if (!file.open(QIODevice::ReadOnly))
+        QFAIL("No fixture for this case, run golden/generate.sh where PIL and materialyoucolor are installed");
+
+    // print() ends the script's last line too
+    const QByteArray actual = (MaterialPalette::generateScss(arguments, true) + '\n').toUtf8();
+    QCOMPARE(actual, file.readAll());
+}
+
+void TestMaterialPalette::cachedMatchesGenerated() {
+    const QStringList arguments = { "--mode", "dark", "--scheme", "scheme-tonal-spot" };
+    const QString image = GOLDEN_DIR + "/images/gradient.png";
+
+    // The IPC path answers from SchemeCache, it must say what the generator says
+    const QString generated = MaterialPalette::generateScss(QStringList { "--path", image } + arguments);
+    QVERIFY(!generated.isEmpty());
+    MaterialPalette palette;
+    QCOMPARE(palette.cached(QStringList { "--path", image } + arguments), generated);
+}
+
+QTEST_GUILESS_MAIN(TestMaterialPalette)
+#include "tst_materialpalette.moc"
@@ -0,0 +1,268 @@
+#include "settingsWriter.hpp"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+
+using namespace SleexCore;
+
+namespace {
+const QString BLOB_CONNECTION = QStringLiteral("blob_bench_conn");
+const QString READ_CONNECTION = QStringLiteral("leaf_read_conn");
+
+constexpr int MODULE_COUNT = 12;
+constexpr int GROUP_SIZE = 8;
+
+// Nested like the real options: modules of groups of mixed leaves
+QJsonObject makeModule(int leaves) {
+    QJsonObject module;
+    for (int first = 0; first < leaves; first += GROUP_SIZE) {
+        QJsonObject group;
+        for (int i = 0; i < GROUP_SIZE && first + i < leaves; ++i) {
+            const QString key = QStringLiteral("option%1").arg(i);
+            switch (i % 4) {
+                case 0: group[key] = (i / 4) % 2 == 0; break;
+                case 1: group[key] = i * 1.5; break;
+                case 2: group[key] = QStringLiteral("value-%1").arg(first + i); break;
+                default: group[key] = QJsonArray{ 1, 2, 3 }; break;
+            }
+        }
+        module[QStringLiteral("group%1").arg(first / GROUP_SIZE)] = group;
+    }
+    return module;
+}
+
+QJsonObject makeConfig(int leavesPerModule) {
+    QJsonObject config;
+    for (int i = 0; i < MODULE_COUNT; ++i)
+        config[QStringLiteral("module%1").arg(i)] = makeModule(leavesPerModule);
+    return config;
+}
+
+QString toJson(const QJsonObject &object) {
+    return QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+// The legacy JSON file is the one way into SettingsWriter that needs no
+// DatabaseManager, open() migrates it into the leaf table
+bool writeLegacyJson(const QString &path, const QJsonObject &config) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    return file.write(QJsonDocument(config).toJson(QJsonDocument::Compact)) > 0;
+}
+
+QSqlDatabase openDatabase(const QString &connection, const QString &path) {
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+    db.setDatabaseName(path);
+    if (db.open()) {
+        QSqlQuery query(db);
+        query.exec("PRAGMA journal_mode=WAL;");
+        query.exec("PRAGMA synchronous=NORMAL;");
+    }
+    return db;
+}
+
+// The layout before the leaf table, one config_json blob per module
+bool createBlobTable(QSqlDatabase &db, const QJsonObject &config) {
+    QSqlQuery query(db);
+    if (!query.exec("CREATE TABLE sleex_settings (module TEXT PRIMARY KEY, config_json TEXT)")) return false;
+    db.transaction();
+    query.prepare("INSERT INTO sleex_settings (module, config_json) VALUES (:module, :config)");
+    for (auto it = config.begin(); it != config.end(); ++it) {
+        query.bindValue(":module", it.key());
+        query.bindValue(":config", toJson(it.value().toObject()));
+        if (!query.exec()) return false;
+    }
+    return db.commit();
+}
+
+// Reads every module the way startup does, parse included
+QJsonObject loadModules(QSqlDatabase &db, const QString &source) {
+    QJsonObject config;
+    QSqlQuery query(db);
+    query.exec(QStringLiteral("SELECT module, config_json FROM %1").arg(source));
+    while (query.next())
+        config[query.value(0).toString()] = QJsonDocument::fromJson(query.value(1).toString().toUtf8()).object();
+    return config;
+}
+}
+
+class TestSettings : public QObject {
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void splitPathRoundTrip();
+    void viewNestsLeaves();
+    void batchesCountCommits();
+
+    void benchmarkUpdate_data();
+    void benchmarkUpdate();
+    void benchmarkLoad_data();
+    void benchmarkLoad();
+
+private:
+    void openLayouts(const QJsonObject &config);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+    std::unique_ptr<SettingsWriter> m_writer;
+};
+
+void TestSettings::init() {
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void TestSettings::cleanup() {
+    if (m_writer) m_writer->close();
+    m_writer.reset();
+    for (const QString &name : { BLOB_CONNECTION, READ_CONNECTION }) {
+        QSqlDatabase::database(name, false).close();
+        QSqlDatabase::removeDatabase(name);
+    }
+    m_dir.reset();
+}
+
+void TestSettings::openLayouts(const QJsonObject &config) {
+    const QString jsonPath = m_dir->filePath("settings.json");
+    QVERIFY(writeLegacyJson(jsonPath, config));
+    m_writer = std::make_unique<SettingsWriter>(m_dir->filePath("leaves.db"), jsonPath);
+    QSignalSpy opened(m_writer.get(), &SettingsWriter::opened);
+    m_writer->open();
+    QCOMPARE(opened.size(), 1);
+    QVERIFY(opened.first().at(2).toString().isEmpty());
+
+    QSqlDatabase blob = openDatabase(BLOB_CONNECTION, m_dir->filePath("blob.db"));
+    QVERIFY(blob.isOpen());
+    QVERIFY(createBlobTable(blob, config));
+    QVERIFY(openDatabase(READ_CONNECTION, m_dir->filePath("leaves.db")).isOpen());
+}
+
+void TestSettings::splitPathRoundTrip() {
+    const QStringList keys = { "apps", "org.kde.dolphin", "", "pinned" };
+    QString path;
+    for (const QString &key : keys) path = appendPathKey(path, key);
+
+    QCOMPARE(path, QStringLiteral("apps.\"org.kde.dolphin\".\"\".pinned"));
+    QCOMPARE(splitPath(path), keys);
+
+    // Quotes and backslashes inside a quoted key are escaped
+    const QStringList escaped = { "titles", "say \"hi\"", "C:\\Users.x", "back\\slash" };
+    path.clear();
+    for (const QString &key : escaped) path = appendPathKey(path, key);
+
+    QCOMPARE(path, QStringLiteral("titles.\"say \\\"hi\\\"\".\"C:\\\\Users.x\".back\\slash"));
+    QCOMPARE(splitPath(path), escaped);
+
+    QCOMPARE(splitPath("bar.clock.format"), QStringList({ "bar", "clock", "format" }));
+}
+
+void TestSettings::viewNestsLeaves() {
+    QJsonObject config = makeConfig(20);
+    QJsonObject apps;
+    apps["org.kde.dolphin"] = QJsonObject{ { "pinned", true } };
+    apps["say \"hi\""] = QJsonObject{ { "C:\\Users.x", 1 } };
+    apps["empty"] = QJsonObject();
+    config["apps"] = apps;
+
+    openLayouts(config);
+    if (QTest::currentTestFailed()) return;
+    QSqlDatabase db = QSqlDatabase::database(READ_CONNECTION);
+    QCOMPARE(loadModules(db, "sleex_settings_view"), config);
+}
+
+void TestSettings::batchesCountCommits() {
+    openLayouts(makeConfig(8));
+    if (QTest::currentTestFailed()) return;
+
+    QSignalSpy written(m_writer.get(), &SettingsWriter::batchWritten);
+    m_writer->enqueueLeaf(1, "module0", "group0.option0", false);
+    m_writer->enqueueLeaf(1, "module1", "group0.option0", false);
+    m_writer->flush();
+    m_writer->enqueueLeaf(2, "module0", "group0.option0", true);
+    m_writer->flush();
+
+    // One number per batch, whatever it holds, and readers see the last one
+    QCOMPARE(written.size(), 2);
+    const qint64 first = written.at(0).at(1).toLongLong();
+    QCOMPARE(written.at(1).at(1).toLongLong(), first + 1);
+
+    QSqlQuery query(QSqlDatabase::database(READ_CONNECTION));
+    QVERIFY(query.exec("SELECT count FROM sleex_settings_commits") && query.next());
+    QCOMPARE(query.value(0).toLongLong(), first + 1);
+}
+
+void TestSettings::benchmarkUpdate_data() {
+    QTest::addColumn<bool>("blob");
+    QTest::addColumn<int>("leaves");
+
+    // About the size of the shipped options, then a much larger one
+    for (int leaves : { 16, 256 }) {
+        QTest::addRow("blob %d", leaves * MODULE_COUNT) << true << leaves;
+        QTest::addRow("leaves %d", leaves * MODULE_COUNT) << false << leaves;
+    }
+}
+
+// One boolean toggled and committed, what a switch in the settings app costs
+void TestSettings::benchmarkUpdate() {
+    QFETCH(bool, blob);
+    QFETCH(int, leaves);
+    openLayouts(makeConfig(leaves));
+    if (QTest::currentTestFailed()) return;
+
+    bool value = false;
+    if (blob) {
+        QSqlDatabase db = QSqlDatabase::database(BLOB_CONNECTION);
+        QSqlQuery query(db);
+        query.prepare("UPDATE sleex_settings SET config_json = json_set(config_json, :path, json(:value)) "
+                      "WHERE module = :module");
+        QBENCHMARK {
+            value = !value;
+            db.transaction();
+            query.bindValue(":path", "$.group0.option0");
+            query.bindValue(":value", value ? "true" : "false");
+            query.bindValue(":module", "module0");
+            QVERIFY2(query.exec(), qPrintable(query.lastError().text()));
+            QVERIFY(db.commit());
+        }
+    } else {
+        QSignalSpy written(m_writer.get(), &SettingsWriter::batchWritten);
+        quint64 seq = 0;
+        QBENCHMARK {
+            value = !value;
+            m_writer->enqueueLeaf(++seq, "module0", "group0.option0", value);
+            m_writer->flush();
+        }
+        QCOMPARE(written.size(), int(seq));
+    }
+}
+
+void TestSettings::benchmarkLoad_data() {
+    benchmarkUpdate_data();
+}
+
+void TestSettings::benchmarkLoad() {
+    QFETCH(bool, blob);
+    QFETCH(int, leaves);
+    const QJsonObject config = makeConfig(leaves);
+    openLayouts(config);
+    if (QTest::currentTestFailed()) return;
+
+    QSqlDatabase db = QSqlDatabase::database(blob ? BLOB_CONNECTION : READ_CONNECTION);
+    const QString source = blob ? QStringLiteral("sleex_settings") : QStringLiteral("sleex_settings_view");
+    QJsonObject loaded;
+    QBENCHMARK {
+        loaded = loadModules(db, source);
+    }
+    QCOMPARE(loaded, config);
+}
+
+QTEST_GUILESS_MAIN(TestSettings)
+#include "tst_settings.moc"
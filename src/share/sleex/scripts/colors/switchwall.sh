@@ -86,7 +86,7 @@ update_wallpaper_config() {
     local wallpaper_path="$1"
 
     if [[ -f "$DB_CONFIG" ]]; then
-        sqlite3 "$DB_CONFIG" "UPDATE sleex_settings SET config_json = json_set(config_json, '$.wallpaperPath', '$wallpaper_path') WHERE module='background';"
+        sqlite3 "$DB_CONFIG" "INSERT INTO sleex_settings_leaves (module, path, type, value) VALUES ('background', 'wallpaperPath', 'string', json_quote('$wallpaper_path')) ON CONFLICT(module, path) DO UPDATE SET type = excluded.type, value = excluded.value;"
         qs -p /usr/share/sleex/ ipc call background forceWallpaperReload "$wallpaper_path"
         qs -p /usr/share/sleex/settings.qml ipc call settings reloadWallpaper "$wallpaper_path"
     fi
@@ -130,14 +130,14 @@ switch() {
             if [ -f "$thumbnail" ]; then
                 imgpath="$thumbnail"
                 matugen_args=(image "$imgpath")
-                generate_colors_material_args=(--path "$imgpath")
+                generate_colors_material_args=(--path "$(realpath "$imgpath")")
                 update_wallpaper_config "$actual_wallpaper_path"
             else
                 exit 1
             fi
         else
             matugen_args=(image "$imgpath")
-            generate_colors_material_args=(--path "$imgpath")
+            generate_colors_material_args=(--path "$(realpath "$imgpath")")
             update_wallpaper_config "$actual_wallpaper_path"
         fi
     fi
@@ -159,8 +159,17 @@ switch() {
     pre_process "$mode_flag"
 
     matugen "${matugen_args[@]}"
-    python3 "$SCRIPT_DIR/generate_colors_material.py" "${generate_colors_material_args[@]}" \
-        > "$STATE_DIR"/user/generated/material_colors.scss
+    # Cached in the running shell, the Python script generates it when the shell
+    # is not up or has not seen this wallpaper yet. The path has to be absolute,
+    # the shell does not share our working directory
+    local material_colors="$STATE_DIR/user/generated/material_colors.scss"
+    if ! qs -p /usr/share/sleex/ ipc call materialPalette generate \
+            "$(printf '%s\n' "${generate_colors_material_args[@]}")" > "$material_colors.tmp" \
+        || ! grep -q '^\$darkmode: ' "$material_colors.tmp"; then
+        python3 "$SCRIPT_DIR/generate_colors_material.py" "${generate_colors_material_args[@]}" \
+            > "$material_colors.tmp"
+    fi
+    mv "$material_colors.tmp" "$material_colors"
     "$SCRIPT_DIR"/applycolor.sh
 
     max_width_desired="$(hyprctl monitors -j | jq '([.[].width] | min)' | xargs)"
@@ -177,7 +186,7 @@ main() {
     local noswitch_flag=""
 
     get_type_from_config() {
-        local val=$(sqlite3 "$DB_CONFIG" "SELECT json_extract(config_json, '$.palette.type') FROM sleex_settings WHERE module='appearance';" 2>/dev/null)
+        local val=$(sqlite3 "$DB_CONFIG" "SELECT json_extract(value, '$') FROM sleex_settings_leaves WHERE module='appearance' AND path='palette.type';" 2>/dev/null)
         echo "${val:-auto}"
     }
 
@@ -212,7 +221,7 @@ main() {
                 ;;
             --noswitch)
                 noswitch_flag="1"
-                imgpath=$(sqlite3 "$DB_CONFIG" "SELECT json_extract(config_json, '$.wallpaperPath') FROM sleex_settings WHERE module='background';" 2>/dev/null)
+                imgpath=$(sqlite3 "$DB_CONFIG" "SELECT json_extract(value, '$') FROM sleex_settings_leaves WHERE module='background' AND path='wallpaperPath';" 2>/dev/null)
                 shift
                 ;;
             *)
@@ -1,9 +1,9 @@
 pragma Singleton
 
 import qs.modules.common
-import SleexUiKit.Functions
 import Quickshell
 import Quickshell.Io
+import Sleex.Utils
 
 /**
  * - Eases fuzzy searching for applications by name
@@ -27,21 +27,22 @@ Singleton {
         "footclient": "foot",
         "zen": "zen-browser",
     })
+    // Patterns are strings for IconResolver, the replacement keeps JS $1 syntax
     property var regexSubstitutions: [
         {
-            "regex": /^steam_app_(\d+)$/,
+            "regex": "^steam_app_(\\d+)$",
             "replace": "steam_icon_$1"
         },
         {
-            "regex": /Minecraft.*/,
+            "regex": "Minecraft.*",
             "replace": "minecraft"
         },
         {
-            "regex": /.*polkit.*/,
+            "regex": ".*polkit.*",
             "replace": "system-lock-screen"
         },
         {
-            "regex": /gcr.prompter/,
+            "regex": "gcr.prompter",
             "replace": "system-lock-screen"
         }
     ]
@@ -49,73 +50,37 @@ Singleton {
     readonly property list<DesktopEntry> list: Array.from(DesktopEntries.applications.values)
         .sort((a, b) => a.name.localeCompare(b.name))
 
-    readonly property var preppedNames: list.map(a => ({
-                name: Fuzzy.prepare(`${a.name} `),
-                entry: a
-            }))
+    // Prepared once per entry, queries are scored natively
+    property AppSearchIndex index: AppSearchIndex {
+        entries: root.list
+        sloppy: root.sloppySearch
+        scoreThreshold: root.scoreThreshold
+    }
 
     function fuzzyQuery(search: string): var { // Idk why list<DesktopEntry> doesn't work
-        if (root.sloppySearch) {
-            const results = list.map(obj => ({
-                entry: obj,
-                score: Levendist.computeScore(obj.name.toLowerCase(), search.toLowerCase())
-            })).filter(item => item.score > root.scoreThreshold)
-                .sort((a, b) => b.score - a.score)
-            return results
-                .map(item => item.entry)
-        }
+        return root.index.search(search);
+    }
 
-        return Fuzzy.go(search, preppedNames, {
-            all: true,
-            key: "name"
-        }).map(r => {
-            return r.obj.entry
-        });
+    function recordLaunch(entry) {
+        if (entry?.id)
+            root.index.recordLaunch(entry.id);
+    }
+
+    // Theme index on disk plus memoised class -> icon decisions
+    property IconResolver iconResolver: IconResolver {
+        substitutions: root.substitutions
+        regexSubstitutions: root.regexSubstitutions
+        searchIndex: root.index
     }
 
     function iconExists(iconName) {
-        if (!iconName || iconName.length == 0) return false;
-        return (Quickshell.iconPath(iconName, true).length > 0)
-            && !iconName.includes("image-missing");
+        return root.iconResolver.iconExists(iconName);
     }
 
     function guessIcon(str) {
-        if (!str || str.length == 0) return "image-missing";
-
-        // Normal substitutions
-        if (substitutions[str])
-            return substitutions[str];
-
-        // Regex substitutions
-        for (let i = 0; i < regexSubstitutions.length; i++) {
-            const substitution = regexSubstitutions[i];
-            const replacedName = str.replace(
-                substitution.regex,
-                substitution.replace,
-            );
-            if (replacedName != str) return replacedName;
-        }
-
-        // If it gets detected normally, no need to guess
-        if (iconExists(str)) return str;
-
-        let guessStr = str;
-        // Guess: Take only app name of reverse domain name notation
-        guessStr = str.split('.').slice(-1)[0].toLowerCase();
-        if (iconExists(guessStr)) return guessStr;
-        // Guess: normalize to kebab case
-        guessStr = str.toLowerCase().replace(/\s+/g, "-");
-        if (iconExists(guessStr)) return guessStr;
-        // Guess: First fuzze desktop entry match
-        const searchResults = root.fuzzyQuery(str);
-        if (searchResults.length > 0) {
-            const firstEntry = searchResults[0];
-            guessStr = firstEntry.icon
-            if (iconExists(guessStr)) return guessStr;
-        }
-
-        // Give up
-        return str;
+        // Reading the revision re-evaluates callers once the index is loaded
+        root.iconResolver.revision;
+        return root.iconResolver.guessIcon(str);
     }
 
     // Process {
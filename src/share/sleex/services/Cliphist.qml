@@ -6,6 +6,7 @@ import SleexUiKit.Functions
 import QtQuick
 import Quickshell
 import Quickshell.Io
+import Sleex.Services
 
 Singleton {
     id: root
@@ -15,17 +16,17 @@ Singleton {
     property string pressPasteCommand: "ydotool key -d 1 29:1 47:1 47:0 29:0"
     property bool sloppySearch: Config.options?.search.sloppy ?? false
     property real scoreThreshold: 0.2
-    property list<string> entries: []
-    readonly property var preparedEntries: entries.map(a => ({
-        name: Fuzzy.prepare(`${a.replace(/^\s*\S+\s+/, "")}`),
-        entry: a
-    }))
+    property ClipboardHistory history: ClipboardHistory {
+        binary: root.cliphistBinary
+    }
     function fuzzyQuery(search: string): var {
+        // Reading the revision re-evaluates callers when the history changes
+        root.history.revision;
         if (search.trim() === "") {
-            return entries;
+            return root.history.lines();
         }
         if (root.sloppySearch) {
-            const results = entries.slice(0, 100).map(str => ({
+            const results = root.history.lines(100).map(str => ({
                 entry: str,
                 score: Levendist.computeTextMatchScore(str.toLowerCase(), search.toLowerCase())
             })).filter(item => item.score > root.scoreThreshold)
@@ -34,12 +35,7 @@ Singleton {
                 .map(item => item.entry)
         }
 
-        return Fuzzy.go(search, preparedEntries, {
-            all: true,
-            key: "name"
-        }).map(r => {
-            return r.obj.entry
-        });
+        return root.history.search(search);
     }
 
     function entryIsImage(entry) {
@@ -47,8 +43,11 @@ Singleton {
     }
 
     function refresh() {
-        readProc.buffer = []
-        readProc.running = true
+        root.history.refresh()
+    }
+
+    function imageSource(entry) {
+        return root.history.imageSource(entry)
     }
 
     function copy(entry) {
@@ -71,45 +70,22 @@ Singleton {
 
     function superpaste(count, isImage = false) {
         // Find entries
-        const targetEntries = entries.filter(entry => {
-            if (!isImage) return true;
-            return entryIsImage(entry);
-        }).slice(0, count)
+        const targetEntries = root.history.lines(count, isImage)
         const pasteCommands = [...targetEntries].reverse().map(entry => `printf '${StringUtils.shellSingleQuoteEscape(entry)}' | ${root.cliphistBinary} decode | wl-copy && sleep ${root.pasteDelay} && ${root.pressPasteCommand}`)
         // Act
         Quickshell.execDetached(["bash", "-c", pasteCommands.join(` && sleep ${root.pasteDelay} && `)]);
     }
 
-    Process {
-        id: deleteProc
-        property string entry: ""
-        command: ["bash", "-c", `echo '${StringUtils.shellSingleQuoteEscape(deleteProc.entry)}' | ${root.cliphistBinary} delete`]
-        function deleteEntry(entry) {
-            deleteProc.entry = entry;
-            deleteProc.running = true;
-            deleteProc.entry = "";
-        }
-        onExited: (exitCode, exitStatus) => {
-            root.refresh();
-        }
-    }
-
     function deleteEntry(entry) {
-        deleteProc.deleteEntry(entry);
-    }
-
-    Process {
-        id: wipeProc
-        command: [root.cliphistBinary, "wipe"]
-        onExited: (exitCode, exitStatus) => {
-            root.refresh();
-        }
+        root.history.remove(entry);
     }
 
     function wipe() {
-        wipeProc.running = true;
+        root.history.wipe();
     }
 
+    // The history follows the database file; this covers a database that
+    // did not exist yet when the watch was set up
     Connections {
         target: Quickshell
         function onClipboardTextChanged() {
@@ -126,27 +102,6 @@ Singleton {
         }
     }
 
-    Process {
-        id: readProc
-        property list<string> buffer: []
-
-        command: [root.cliphistBinary, "list"]
-
-        stdout: SplitParser {
-            onRead: (line) => {
-                readProc.buffer.push(line)
-            }
-        }
-
-        onExited: (exitCode, exitStatus) => {
-            if (exitCode === 0) {
-                root.entries = readProc.buffer
-            } else {
-                console.error("[Cliphist] Failed to refresh with code", exitCode, "and status", exitStatus)
-            }
-        }
-    }
-
     IpcHandler {
         target: "cliphistService"
 
@@ -6,6 +6,7 @@ import QtQuick
 import Quickshell
 import Quickshell.Io
 import SleexUiKit.Appearance
+import Sleex.Utils
 
 /**
  * Automatically reloads generated material colors.
@@ -14,6 +15,7 @@ import SleexUiKit.Appearance
 Singleton {
     id: root
     property string filePath: Directories.generatedMaterialThemePath
+    property MaterialPalette palette: MaterialPalette {}
 
     function reapplyTheme() {
         themeFileView.reload()
@@ -56,4 +58,15 @@ Singleton {
             root.applyColors(fileContent)
         }
     }
-}
+
+    IpcHandler {
+        target: "materialPalette"
+
+        // Same flags as generate_colors_material.py, one per line, returns the SCSS it would print.
+        // Only cached palettes are answered, the UI must not wait on the quantizer. A miss is
+        // empty and gets generated in the background, switchwall.sh runs the script meanwhile
+        function generate(args: string): string {
+            return root.palette.cached(args.split("\n").filter(arg => arg.length > 0))
+        }
+    }
+}
\ No newline at end of file
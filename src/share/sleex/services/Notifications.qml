@@ -7,6 +7,7 @@ import QtQuick
 import Quickshell
 import Quickshell.Io
 import Quickshell.Services.Notifications
+import Sleex.Services
 
 /**
  * Provides extra features not in Quickshell.Services.Notifications:
@@ -59,6 +60,19 @@ Singleton {
         return JSON.stringify(notifToJSON(notif), null, 2);
     }
 
+    // History on disk, appended to on every change instead of rewritten.
+    // Also a model of the history grouped by app, for the dashboard list
+    property NotificationStore store: NotificationStore {
+        legacyPath: Directories.notificationsPath
+        onLoadedChanged: {
+            if (!loaded) return
+            root.idOffset = maxId
+            root.initDone()
+        }
+    }
+    // Notifications in the history, this session's and older ones
+    readonly property int count: store.count
+
     component NotifTimer: Timer {
         required property int notificationId
         interval: 5000
@@ -70,7 +84,7 @@ Singleton {
     }
 
     property bool silent: false
-    property var filePath: Directories.notificationsPath
+    // This session's notifications, the history is only in the store
     property list<Notif> list: []
     property var popupList: list.filter((notif) => notif.popup);
     property bool popupInhibited: (GlobalStates?.sidebarRightOpen ?? false) || silent
@@ -84,10 +98,6 @@ Singleton {
         NotifTimer {}
     }
 
-    function stringifyList(list) {
-        return JSON.stringify(list.map((notif) => notifToJSON(notif)), null, 2);
-    }
-    
     onListChanged: {
         // Update latest time for each app
         root.list.forEach((notif) => {
@@ -128,9 +138,7 @@ Singleton {
         return groups;
     }
 
-    property var groupsByAppName: groupsForList(root.list)
     property var popupGroupsByAppName: groupsForList(root.popupList)
-    property var appNameList: appNameListForGroups(root.groupsByAppName)
     property var popupAppNameList: appNameListForGroups(root.popupGroupsByAppName)
 
     // Quickshell's notification IDs starts at 1 on each run, while saved notifications
@@ -174,29 +182,44 @@ Singleton {
 
             root.notify(newNotifObject);
             // console.log(notifToString(newNotifObject));
-            notifFileView.setText(stringifyList(root.list));
+            root.store.append(notifToJSON(newNotifObject));
         }
     }
 
     function discardNotification(id) {
         // console.log("[Notifications] Discarding notification with ID: " + id);
-        const index = root.list.findIndex((notif) => notif.notificationId === id);
-        const notifServerIndex = notifServer.trackedNotifications.values.findIndex((notif) => notif.id + root.idOffset === id);
-        if (index !== -1) {
-            root.list.splice(index, 1);
-            notifFileView.setText(stringifyList(root.list));
-            triggerListChange()
-        }
-        if (notifServerIndex !== -1) {
-            notifServer.trackedNotifications.values[notifServerIndex].dismiss()
-        }
-        root.discard(id); // Emit signal
+        root.discardNotifications([id]);
+    }
+
+    // One store write and one list change however many there are
+    function discardNotifications(ids) {
+        const discarded = new Set(ids);
+        const remaining = root.list.filter((notif) => !discarded.has(notif.notificationId));
+        if (remaining.length !== root.list.length) root.list = remaining;
+        // Older ones are only in the store
+        root.store.dismiss(ids);
+        notifServer.trackedNotifications.values.forEach((notif) => {
+            if (discarded.has(notif.id + root.idOffset)) notif.dismiss()
+        })
+        ids.forEach((id) => root.discard(id)); // Emit signal
+    }
+
+    // Every notification of the app, also those past what a group row carries
+    function discardApp(appName) {
+        const ids = root.list.filter((notif) => notif.appName === appName).map((notif) => notif.notificationId);
+        const discarded = new Set(ids);
+        if (ids.length > 0) root.list = root.list.filter((notif) => notif.appName !== appName);
+        root.store.dismissApp(appName);
+        notifServer.trackedNotifications.values.forEach((notif) => {
+            if (discarded.has(notif.id + root.idOffset)) notif.dismiss()
+        })
+        ids.forEach((id) => root.discard(id)); // Emit signal
     }
 
     function discardAllNotifications() {
         root.list = []
         triggerListChange()
-        notifFileView.setText(stringifyList(root.list));
+        root.store.clear();
         notifServer.trackedNotifications.values.forEach((notif) => {
             notif.dismiss()
         })
@@ -238,51 +261,4 @@ Singleton {
     function triggerListChange() {
         root.list = root.list.slice(0)
     }
-
-    function refresh() {
-        notifFileView.reload()
-    }
-
-    Component.onCompleted: {
-        refresh()
-    }
-
-    FileView {
-        id: notifFileView
-        path: Qt.resolvedUrl(filePath)
-        onLoaded: {
-            const fileContents = notifFileView.text()
-            root.list = JSON.parse(fileContents).map((notif) => {
-                return notifComponent.createObject(root, {
-                    "notificationId": notif.notificationId,
-                    "actions": [], // Notification actions are meaningless if they're not tracked by the server or the sender is dead
-                    "appIcon": notif.appIcon,
-                    "appName": notif.appName,
-                    "body": notif.body,
-                    "image": notif.image,
-                    "summary": notif.summary,
-                    "time": notif.time,
-                    "urgency": notif.urgency,
-                });
-            });
-            // Find largest notificationId
-            let maxId = 0
-            root.list.forEach((notif) => {
-                maxId = Math.max(maxId, notif.notificationId)
-            })
-
-            // console.log("[Notifications] File loaded")
-            root.idOffset = maxId
-            root.initDone()
-        }
-        onLoadFailed: (error) => {
-            if(error == FileViewError.FileNotFound) {
-                console.log("[Notifications] File not found, creating new file.")
-                root.list = []
-                notifFileView.setText(stringifyList(root.list));
-            } else {
-                console.log("[Notifications] Error loading file: " + error)
-            }
-        }
-    }
-}
\ No newline at end of file
+}
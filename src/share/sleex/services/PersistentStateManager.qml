@@ -1,105 +1,48 @@
 pragma Singleton
 pragma ComponentBehavior: Bound
 
-import qs.modules.common
-import SleexUiKit.Functions
 import QtQuick
 import Quickshell
-import Quickshell.Io
-import Quickshell.Hyprland
-import Qt.labs.platform
+import Sleex.Core
 
 /**
  * Manages persistent states across sessions.
- * Run loadStates() once at startup to load the states, then use setState() and getState() to modify and access them.
+ * States live in the sleex_states table (see Sleex.Core StateStore), keyed by their dotted path.
+ * Each setState() is a single-row upsert, batched with other changes made in the same moment.
  */
 Singleton {
     id: root
-    property string fileDir: Directories.state
-    property string fileName: "states.json"
-    property string filePath: `${root.fileDir}/${root.fileName}`
-    property bool allowWriteback: false
 
-    function getState(nestedKey) {
-        let keys = nestedKey.split(".");
-        let obj = PersistentStates;
-        for (let i = 0; i < keys.length; ++i) {
-            if (obj[keys[i]] === undefined) {
-                console.error(`[PersistentStateManager] Key "${keys[i]}" not found in PersistentStates`);
-                return null;
-            }
-            obj = obj[keys[i]];
+    signal stateChanged(string nestedKey, var value)
+
+    function getState(nestedKey, fallback) {
+        if (!StateStore.contains(nestedKey)) {
+            if (fallback === undefined)
+                console.error(`[PersistentStateManager] Key "${nestedKey}" not found in states`);
+            return fallback === undefined ? null : fallback;
         }
-        return obj;
+        return StateStore.get(nestedKey);
     }
 
     function setState(nestedKey, value) {
-        if (!root.allowWriteback) return;
-        let keys = nestedKey.split(".");
-        let obj = PersistentStates;
-        let parents = [obj];
-
-        // Traverse and collect parent objects
-        for (let i = 0; i < keys.length - 1; ++i) {
-            if (!obj[keys[i]] || typeof obj[keys[i]] !== "object") {
-                obj[keys[i]] = {};
-            }
-            obj = obj[keys[i]];
-            parents.push(obj);
-        }
-
-        // Set the value at the innermost key
-        obj[keys[keys.length - 1]] = value;
-
-        saveStates()
+        StateStore.set(nestedKey, value);
     }
 
-    function loadStates() {
-        stateFileView.reload()
+    function removeState(nestedKey) {
+        StateStore.remove(nestedKey);
     }
 
-    function saveStates() {
-        const plainStates = ObjectUtils.toPlainObject(PersistentStates)
-        stateFileView.setText(JSON.stringify(plainStates, null, 2))
-    }
+    // Kept for callers of the old file-based API, states are loaded on first use
+    function loadStates() {}
 
-    function applyStates(fileContent) {
-        try {
-            const json = JSON.parse(fileContent);
-            ObjectUtils.applyToQtObject(PersistentStates, json);
-            root.allowWriteback = true
-        } catch (e) {
-            console.error("[PersistentStateManager] Error reading file:", e);
-            return;
-        }
-    }
-
-    Timer {
-        id: delayedFileRead
-        interval: Config.options?.hacks?.arbitraryRaceConditionDelay ?? 100
-        repeat: false
-        running: false
-        onTriggered: {
-            root.applyStates(stateFileView.text())
-        }
+    function saveStates() {
+        StateStore.flush();
     }
 
-	FileView { 
-        id: stateFileView
-        path: root.filePath
-        watchChanges: true
-        // onFileChanged: {
-        //     console.log("[PersistentStateManager] File changed, reloading...")
-        //     this.reload()
-        //     delayedFileRead.start()
-        // }
-        onLoadedChanged: {
-            const fileContent = stateFileView.text()
-            root.applyStates(fileContent)
-        }
-        onLoadFailed: (error) => {
-            console.log("[PersistentStateManager] File not found, creating new file")
-            root.saveStates()
+    Connections {
+        target: StateStore
+        function onStateChanged(key, value) {
+            root.stateChanged(key, value);
         }
     }
 }
@@ -1,27 +1,55 @@
 import qs.modules.common
 import QtQuick
 import Quickshell
-import Quickshell.Io
+import SleexUiKit.Appearance
+import Sleex.Utils
 pragma Singleton
 pragma ComponentBehavior: Bound
 
 Singleton {
     id: root
-    property var wallpaperList: []
-    
-    property string wallpaperPath: Config.options.background.wallpaperSelectorPath.lenght != 0 ? Config.options.background.wallpaperSelectorPath : Directories.wallpaperPath
-
-    Process {
-        id: listWallpapers
-        running: true
-        command: [
-            "bash", "-c",
-            "find " + root.wallpaperPath + " -type f \\( -iname '*.jpg' -o -iname '*.png' -o -iname '*.gif' -o -iname '*.webp' \\) -printf '%P\\n'"
-        ]
-        stdout: StdioCollector {
-            onStreamFinished: {
-                root.wallpaperList = text.split('\n').filter(function(item) { return item.length > 0; });
-            }
+
+    property string wallpaperPath: Config.options.background.wallpaperSelectorPath.length != 0 ? Config.options.background.wallpaperSelectorPath : Directories.wallpaperPath
+
+    property WallpaperLibrary library: WallpaperLibrary {
+        path: root.wallpaperPath
+        // Long edge, a 16:9 picture comes out 384x216 and still covers the 250x185 selector cells
+        thumbnailSize: 384
+    }
+
+    // "auto" is settled by scheme_for_image.py when applying, only source colours are filled then
+    readonly property bool schemeKnown: Config.options.appearance.palette.type !== "auto"
+    // What switchwall.sh hands the generator, so applying a wallpaper is a cache hit
+    readonly property list<string> schemeArguments: {
+        const args = ["--mode", Appearance.m3colors.darkmode ? "dark" : "light"]
+        if (!root.schemeKnown) return args
+        return args.concat(["--scheme", Config.options.appearance.palette.type,
+            "--termscheme", Directories.terminalSchemePath, "--blend_bg_fg"])
+    }
+
+    property MaterialPalette palette: MaterialPalette {}
+
+    // Colours applying the wallpaper would give, by SCSS name. Empty until SchemeCache.ready(path)
+    function previewScheme(path: string): var {
+        return root.palette.preview(path, root.schemeArguments)
+    }
+
+    onSchemeArgumentsChanged: schemePrefetchTimer.restart()
+
+    Connections {
+        target: root.library
+        function onScanningChanged() { schemePrefetchTimer.restart() }
+        function onPendingChanged() { schemePrefetchTimer.restart() }
+    }
+
+    // Waits for the thumbnails, which hash the wallpapers the cache is keyed by
+    Timer {
+        id: schemePrefetchTimer
+        interval: 3000
+        onTriggered: {
+            if (root.library.scanning || root.library.pending > 0) return
+            if (root.schemeKnown) SchemeCache.prefetch(root.library, root.schemeArguments)
+            else SchemeCache.prefetchSources(root.library)
         }
     }
 }